@@ -0,0 +1,95 @@
+#ifndef MultijetBalance_AsyncTreeWriter_H
+#define MultijetBalance_AsyncTreeWriter_H
+
+//////////////////////////////////////////////////////////////////
+// AsyncTreeWriter.h
+//////////////////////////////////////////////////////////////////
+// Runs TTree::Fill (serialization, basket compression and writes)
+// of the attached trees on one background thread.
+// Every branch gets a second buffer that only the background
+// thread reads: the tree owner keeps filling its own variables,
+// and fill() copies them to the second buffer once the previous
+// entry of that tree is written.  Entries of a tree stay in order,
+// and at most one entry per tree waits for the background thread.
+// All attached trees must belong to files only written through
+// this writer.
+//////////////////////////////////////////////////////////////////
+
+#include <map>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "MultijetBalance/ThreadPool.h"
+
+class TTree;
+class TBranch;
+
+class AsyncTreeWriter
+{
+  public:
+
+    AsyncTreeWriter();
+    // Calls finish()
+    ~AsyncTreeWriter();
+
+    // Must be called once every branch of tree is booked.  Returns false,
+    // leaving tree untouched, if a branch type cannot be double-buffered;
+    // fill() then fills it synchronously, while no other tree is written.
+    // Variable size arrays (x[n]/F, n an Int_t leaf) are supported up to
+    // maxArrayLength elements.  Object branches must be booked with the
+    // address of a pointer that outlives the writer (as HelpTreeBase).
+    bool attach( TTree* tree, int maxArrayLength = 0 );
+    // Waits for the previous entry of tree, then queues the current one
+    void fill( TTree* tree );
+    // Writes everything queued, stops the background thread and points
+    // the branches back to the variables of the tree owner
+    void finish();
+
+    unsigned int numErrors() const { return m_numErrors; };
+
+  private:
+
+    // Copies, creates and deletes the objects of one branch type
+    struct ObjectCopier {
+      virtual ~ObjectCopier() {};
+      virtual void* create() const = 0;
+      virtual void copy( const void* from, void* to ) const = 0;
+      virtual void destroy( void* object ) const = 0;
+    };
+    template< typename T > struct TypedCopier;
+    static const ObjectCopier* getCopier( const std::string& className );
+
+    struct BranchBuffers {
+      TBranch* branch;
+      const ObjectCopier* copier;  // NULL for leaf branches
+      size_t size;                 // of leaf branches, per element for variable size arrays
+      const int* count;            // of variable size arrays, NULL otherwise
+      int maxCount;
+      void* fillObject;
+      void* writeObject;
+      void* address;               // set by the tree owner, restored by finish()
+    };
+
+    struct TreeBuffers {
+      TTree* tree;
+      std::vector< BranchBuffers* > branches;
+      bool pending;
+    };
+
+    void run();
+
+    std::map< TTree*, TreeBuffers* > m_trees;
+    BoundedQueue< TreeBuffers* > m_queue;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_written;
+    unsigned int m_numErrors;
+    unsigned int m_numQueued;
+    bool m_finished;
+
+};
+
+#endif
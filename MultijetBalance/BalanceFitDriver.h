@@ -0,0 +1,153 @@
+#ifndef MultijetBalance_BalanceFitDriver_H
+#define MultijetBalance_BalanceFitDriver_H
+
+//////////////////////////////////////////////////////////////////
+// BalanceFitDriver.h
+//////////////////////////////////////////////////////////////////
+// Front-end to JES_BalanceFitter used by runFit, runBootstrapRebin
+// and runBootstrapSystematics, with the same accessors.
+// With warm starts the iterative Gaussian fit within +-NsigmaForFit
+// is done here, starting from a seed (the Nominal fit of the same
+// range, or the previous range) instead of the histogram mean and
+// RMS.  A warm fit that fails or does not converge falls back to a
+// cold JES_BalanceFitter fit.
+// JES_BalanceFitter can not be seeded, so the warm fit is this
+// driver's own iteration of TH1::Fit, not JES_BalanceFitter started
+// elsewhere.  With setValidateWarm (runFit does it for the Nominal)
+// every warm fit is also done cold, and the differences and the time
+// of both are reported by printStats; the warm result is the one kept.
+// Fits without a seed are always cold JES_BalanceFitter fits.
+// The Estimator mode replaces the fit by an iterated truncated
+// Gaussian mean and width computed in closed form from the binned
+// moments within the window, with no minimizer.  ValidateEstimator
+// fits as usual, once, and reports how far the estimator is from
+// that fit.
+// With a FitResultCache, a fit of a histogram with the same contents
+// and configuration as a cached one is not redone.  The key records
+// whether the fit was seeded but not the seed, so a seeded fit gets
+// the result of whichever seed first fit that histogram, which only
+// differs within the convergence tolerance of the warm fit or estimator.
+// Like JES_BalanceFitter, one driver must only be used by one thread.
+//////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+
+#include "MultijetBalance/FitResultCache.h"
+
+class TF1;
+class TH1;
+class TH2;
+class JES_BalanceFitter;
+
+class BalanceFitDriver
+{
+  public:
+
+    // Starting point of a warm fit
+    struct Seed {
+      double mean;
+      double sigma;
+      Seed() : mean(0.), sigma(-1.) {};
+      Seed( double m, double s ) : mean(m), sigma(s) {};
+      bool valid() const { return sigma > 0.; };
+    };
+
+    enum Mode { Fitting, Estimator, ValidateEstimator };
+
+    BalanceFitDriver( double NsigmaForFit = 1.6 );
+    ~BalanceFitDriver();
+
+    void setMode( Mode mode ){ m_mode = mode; };
+    Mode mode() const { return m_mode; };
+    // "fit", "estimator" or "validate"
+    static bool parseMode( const std::string& modeName, Mode& mode );
+
+    void setWarmStart( bool warmStart ){ m_warmStart = warmStart; };
+    bool warmStart() const { return m_warmStart; };
+    // Compare each following warm fit to a cold JES_BalanceFitter fit of the same histogram
+    void setValidateWarm( bool validateWarm ){ m_validateWarm = validateWarm; };
+
+    // Not owned, may be shared by the drivers of several threads
+    void setCache( FitResultCache* cache ){ m_cache = cache; };
+
+    // JES_BalanceFitter::Fit, unless warm starts are on and seed is valid.
+    void Fit( TH1* histo, double fitMin = 0., const Seed& seed = Seed() );
+
+    // Estimator on the pt balance of recoil pt bins firstBin to lastBin of hist,
+    // without making the projection.  Returns false if it does not converge.
+    // Never cached, it is cheaper than the hash.
+    bool estimate( const TH2* hist, int firstBin, int lastBin, double fitMin = 0., const Seed& seed = Seed() );
+
+    // Results of the last fit, as JES_BalanceFitter
+    double GetMean() const;
+    double GetMeanError() const;
+    double GetMedian() const;
+    double GetChi2Ndof() const;
+    double GetSigma() const;
+    double GetHistoMedian();
+    TH1* GetHisto();
+    TF1* GetFit();
+
+    // Seed for a later fit from the result of the last fit
+    Seed result() const { return Seed( GetMean(), GetSigma() ); };
+
+    // ValidateEstimator comparison of the last fit, empty otherwise.  Not printed here,
+    // as drivers fit on several threads, but by the caller in the order of its outputs.
+    const std::string& validationLine() const { return m_validationLine; };
+
+    // Warm start and estimator validation statistics, summed over all drivers of the process
+    static void printStats();
+
+  private:
+
+    // Result of the estimator, and its Gaussian within the window for drawing
+    struct Estimate {
+      double mean, meanError, sigma;
+      double low, high, norm;
+      Estimate() : mean(0.), meanError(0.), sigma(0.), low(0.), high(0.), norm(0.) {};
+    };
+
+    // Fit without the cache
+    void fitHisto( TH1* histo, double fitMin, const Seed& seed );
+    // The warm or cold fit, without the estimator
+    void fitOnce( TH1* histo, double fitMin, const Seed& seed );
+    double computeHistoMedian();
+    bool warmFit( TH1* histo, double fitMin, const Seed& seed, int& nPasses );
+    // warmSeconds is the time the warm fit took
+    void compareToCold( TH1* histo, double fitMin, double warmSeconds );
+    void fillEstimatorBins( const TH1* histo );
+    // Iterated truncated Gaussian on the bins in m_centers, m_sumW and m_sumW2
+    bool truncatedGaussian( double fitMin, const Seed& seed, Estimate& result ) const;
+    void useEstimate( const Estimate& result );
+    void compareToEstimator( TH1* histo, double fitMin, const Seed& seed );
+
+    Mode m_mode;
+    double m_NsigmaForFit;
+    bool m_warmStart;
+    bool m_validateWarm;
+    // The last result was computed here (warm fit or estimator) rather than by m_fitter
+    bool m_lastWarm;
+
+    FitResultCache* m_cache;
+    // The last result came from the cache
+    bool m_cached;
+    // Key of the last result if it is in the cache, else 0
+    unsigned long long m_cacheKey;
+    FitResultCache::Entry m_entry;
+
+    // Pt balance distribution used by the estimator
+    std::vector<double> m_centers;
+    std::vector<double> m_sumW;
+    std::vector<double> m_sumW2;
+
+    std::string m_validationLine;
+
+    JES_BalanceFitter* m_fitter;
+    TF1* m_func;
+    TH1* m_histo;
+    double m_mean, m_meanError, m_sigma, m_chi2Ndof;
+
+};
+
+#endif
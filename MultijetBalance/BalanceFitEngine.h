@@ -0,0 +1,122 @@
+#ifndef MultijetBalance_BalanceFitEngine_H
+#define MultijetBalance_BalanceFitEngine_H
+
+//////////////////////////////////////////////////////////////////
+// BalanceFitEngine.h
+//////////////////////////////////////////////////////////////////
+// The per-histogram step of runFit: the pt balance of every recoil
+// pt range of a recoilPt_PtBal histogram is fit (or averaged) and
+// saved as MJB, plus the fit details when fitting.
+// The engine holds no per-fit state, so one engine can be shared
+// by several threads as long as each has its own BalanceFitDriver.
+// A histogram is split by prepare() into ranges that can be fit
+// concurrently with fitRange(), and finish() fills the outputs.
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+#include <map>
+
+#include "MultijetBalance/BalanceFitDriver.h"
+#include "MultijetBalance/BalanceMoments.h"
+#include "MultijetBalance/FitPlotRecorder.h"
+
+class TFile;
+class TF1;
+class TH1D;
+class TH2;
+
+// The result of one recoil pt range (one projection)
+struct BalanceFitRange {
+  int startBin;
+  int endBin;
+  float mean;
+  float error;
+  float redChi;
+  float median;
+  float width;
+  float medianHist;
+  float projMean;
+  float projError;
+  bool filled;
+
+  // Copies of the fitted histogram and function, only if the engine keeps fits for plotting
+  TH1D* fitHisto;
+  TF1* fitFunc;
+  // Estimator validation of the fit, empty without it
+  std::string validation;
+
+  BalanceFitRange() : startBin(0), endBin(0), mean(0.), error(0.), redChi(0.), median(0.), width(0.),
+                      medianHist(0.), projMean(0.), projError(0.), filled(false), fitHisto(NULL), fitFunc(NULL) {};
+};
+
+// Everything runFit writes into the directory of one histogram
+struct BalanceFitOutput {
+  std::string dirName;
+  TH2* h_recoilPt_PtBal;
+  // Only without fits, the means of the ranges are taken from them
+  BalanceMoments moments;
+  std::vector< TH1D* > hists;
+  std::vector< BalanceFitRange > ranges;
+
+  BalanceFitOutput() : h_recoilPt_PtBal(NULL) {};
+  void write( TFile* outFile );
+  // Prints the estimator validation of every range, on the thread writing the outputs in order
+  void printValidation() const;
+  // Hands the fit of every range (<plotName>_<iRange>) and MJB (<plotName>_preprofMJB)
+  // to plots, which takes over the fitted histograms and functions.
+  void record( FitPlotRecorder& plots, const std::string& plotName );
+  void clear();
+};
+
+class BalanceFitEngine
+{
+  public:
+
+    BalanceFitEngine( bool f_fit, float upperEdge );
+    ~BalanceFitEngine();
+
+    // Reads every significant_* histogram up front, so that fit() does no I/O
+    bool loadRebinFile( std::string rebinFileName );
+
+    // Keep a copy of each fitted histogram and function, for BalanceFitOutput::record
+    void setKeepFits( bool keepFits ){ m_keepFits = keepFits; };
+
+    // Takes ownership of h_recoilPt_PtBal, which is saved in the output.
+    // The rebinning is taken from binningName (dirName if empty).
+    BalanceFitOutput* prepare( const std::string& dirName, TH2* h_recoilPt_PtBal, std::string binningName = "" ) const;
+    // Different ranges of one output may be fit on different threads.
+    // With warm starts the seed is taken from seedFor() if not given.
+    void fitRange( BalanceFitOutput* output, unsigned int iRange, BalanceFitDriver* fitter,
+                   BalanceFitDriver::Seed seed = BalanceFitDriver::Seed() ) const;
+    void finish( BalanceFitOutput* output ) const;
+
+    // Fit results of output (normally the Nominal) seed later warm-started fits of the
+    // closest range.  Not thread safe, seeds must be added before fitting in parallel.
+    void addSeeds( const BalanceFitOutput* output );
+    BalanceFitDriver::Seed seedFor( const BalanceFitOutput* output, unsigned int iRange ) const;
+
+    // prepare, fitRange for every range and finish, on this thread.
+    // Ranges without a seed from addSeeds are seeded by the previous range.
+    BalanceFitOutput* fit( const std::string& dirName, TH2* h_recoilPt_PtBal, BalanceFitDriver* fitter ) const;
+
+  private:
+
+    const TH1D* getRebinHist( const std::string& dirName ) const;
+
+    bool m_fit;
+    float m_upperEdge;
+    bool m_keepFits;
+    std::map< std::string, TH1D* > m_rebinHists;
+
+    // Recoil pt range (low and high edge) and its fit result
+    struct SeedRange {
+      double low;
+      double high;
+      BalanceFitDriver::Seed seed;
+    };
+    std::vector< SeedRange > m_seeds;
+
+};
+
+#endif
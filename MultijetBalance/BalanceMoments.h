@@ -0,0 +1,61 @@
+#ifndef MultijetBalance_BalanceMoments_H
+#define MultijetBalance_BalanceMoments_H
+
+//////////////////////////////////////////////////////////////////
+// BalanceMoments.h
+//////////////////////////////////////////////////////////////////
+// Cumulative (prefix-summed over recoil pt bins) moments of the
+// pt balance of a recoilPt_PtBal histogram.
+// The mean and mean error of ProjectionY(firstBin, lastBin) are
+// then given by one subtraction, with no histogram allocated.
+// They always use the pt balance bin centers.  ProjectionY does too,
+// except for a range of every recoil pt bin, where it copies the
+// unbinned fill statistics of the TH2 instead; its mean then differs
+// from these at the level of the pt balance bin width.
+// Used for the MJB of runFit without fits and of runMJBHists.
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+class TH1;
+class TH2;
+
+class BalanceMoments
+{
+  public:
+
+    BalanceMoments();
+    BalanceMoments( const TH2* hist );
+
+    void fill( const TH2* hist );
+
+    int nBinsX() const { return m_sumW.size() > 0 ? m_sumW.size()-1 : 0; }
+
+    // Bin ranges are inclusive and use ROOT numbering (1 to nBinsX)
+    double sumW(int firstBin, int lastBin) const;
+    double mean(int firstBin, int lastBin) const;
+    double rms(int firstBin, int lastBin) const;
+    double meanError(int firstBin, int lastBin) const;
+    // The entries of ProjectionY(firstBin, lastBin): sumW^2/sumW2, the number of entries if unweighted
+    double effectiveEntries(int firstBin, int lastBin) const;
+
+    // Sets every bin of hist, of the recoil pt binning, to the mean and mean error of its
+    // recoil pt bin, as ProfileX()->ProjectionX() of the recoilPt_PtBal histogram
+    void fillMeans( TH1* hist ) const;
+
+    // Flat copy of the tables (nMoments arrays of nBinsX+1), for binary caches
+    static const int nMoments = 4;
+    void pack( double* out ) const;
+    void unpack( int nBinsX, const double* in );
+
+  private:
+
+    // Element i is the sum over recoil pt bins 1 to i, element 0 is empty
+    std::vector<double> m_sumW;
+    std::vector<double> m_sumWY;
+    std::vector<double> m_sumWY2;
+    std::vector<double> m_sumW2;
+
+};
+
+#endif
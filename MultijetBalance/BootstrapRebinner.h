@@ -0,0 +1,128 @@
+#ifndef MultijetBalance_BootstrapRebinner_H
+#define MultijetBalance_BootstrapRebinner_H
+
+//////////////////////////////////////////////////////////////////
+// BootstrapRebinner.h
+//////////////////////////////////////////////////////////////////
+// Rebinning of a systematic variation based on the RMS of its
+// bootstrap toys, shared by runBootstrapRebin (one systematic per
+// process) and runBootstrapSystematics (all systematics in one
+// process).
+// A range of recoil pt bins is merged with the next lower bin until
+// |mean| / RMS of (sys/nominal - 1) is above the threshold.
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+
+#include <TAxis.h>
+
+#include "MultijetBalance/BalanceMoments.h"
+#include "MultijetBalance/BalanceFitDriver.h"
+#include "MultijetBalance/FitPlotRecorder.h"
+
+class TFile;
+class TH1D;
+class TH2;
+class TH2F;
+
+// The full (non-bootstrap) histogram and the toys of one variation.
+// The histograms are only needed for fits, means come from the moments.
+struct BootstrapVariation {
+  std::string name;
+  TH2F* full;
+  BalanceMoments fullMoments;
+  std::vector< TH2F* > toys;
+  std::vector< BalanceMoments > toyMoments;
+  std::vector< int > toyNumbers;
+
+  BootstrapVariation() : full(NULL) {};
+  void clear();
+};
+
+class BootstrapRebinner
+{
+  public:
+
+    BootstrapRebinner( const TAxis& recoilPtAxis, float upperEdge, double threshold );
+
+    // Stop adding toys to a range once the significance is further than nSigma
+    // standard errors (of the toy RMS) from the threshold, after at least minToys.
+    // nSigma = 0 (default) always uses every toy.  Otherwise the RMS and significance
+    // of a range come from fewer toys, so the significance values, and near the
+    // threshold the bin edges, can differ from a pass with every toy.
+    void setConvergence( double nSigma, unsigned int minToys = 20 );
+
+    // Receives the fits of the first toy of every range when rebin() is given a plotPrefix
+    void setPlotRecorder( FitPlotRecorder* plots ){ m_plots = plots; };
+
+    // Returns the significant_<name> histogram with the final binning.
+    // With a fitter the balance is fit, otherwise the mean is used.
+    // With warm starts, toy fits are seeded by the full Nominal fit of the same range,
+    // which is seeded by the Nominal fit of the previous range.
+    // With a plot recorder, the fits of the first toy are recorded as <plotPrefix>_<firstBin>_<lastBin>.
+    TH1D* rebin( const BootstrapVariation& sys, const BootstrapVariation& nominal,
+                 BalanceFitDriver* fitter = NULL, std::string plotPrefix = "" ) const;
+
+    // One significant_<name> histogram per threshold, in the same order.  The toy
+    // statistics of a range are computed once and shared by every threshold.
+    std::vector< TH1D* > rebin( const BootstrapVariation& sys, const BootstrapVariation& nominal,
+                                const std::vector<double>& thresholds,
+                                BalanceFitDriver* fitter = NULL, std::string plotPrefix = "" ) const;
+
+    // Toy and full histograms are either in TDirectories (<dir>/recoilPt_PtBal) or,
+    // with runBootstrapHistogrammer --flat, at top level (<dir>_recoilPt_PtBal).
+    // NULL if missing or not a TH2 (toys are TH2D, MultijetBalanceAlgo outputs TH2F).
+    static TH2* getBalanceHist( TFile* inFile, std::string dirName );
+    static std::string stripFlatSuffix( std::string keyName );
+    // Rebins to the initial binning, by default 16 recoil pt bins from 300 to 2000 GeV
+    // and 500 pt balance bins from 0 to 5.  A source bin goes to the target bin of its low edge.
+    // The source may be a TH2F or a TH2D, the result is a TH2F.
+    static TH2F* initialRebin( TH2* inputHist );
+    // The initial binning is taken from the axes of binning.  Not thread safe, call before rebinning.
+    static void setInitialBinning( const TH2* binning );
+    // From the initialBinning TH2 of file, if there is one
+    static bool loadInitialBinning( TFile* file );
+    // From binningFileName if given (which must have it), else from inFile if it has one
+    static bool configureInitialBinning( TFile* inFile, const std::string& binningFileName );
+    static const std::vector<double>& initialRecoilPtEdges();
+    static const std::vector<double>& initialPtBalEdges();
+    static bool isInteger( const std::string & s );
+
+    // --threshold takes a comma separated list, e.g. 1.5,2,2.5
+    static std::vector<double> parseThresholds( const std::string& thresholdList, std::vector<std::string>& thresholdNames );
+    // The first threshold is written at top level, where runFit --rebinFileName expects it.
+    // With several thresholds each is also written to a threshold_<value> directory.
+    static void writeSignificant( TFile* outFile, const std::vector< TH1D* >& h_significants, const std::vector<std::string>& thresholdNames );
+
+    // Adds the histogram of dirName (e.g. Iteration1_Zjet_Stat1_neg_97) to var.
+    // keepHists keeps the TH2F for fits, otherwise only the moments are saved.
+    static bool addToVariation( TFile* inFile, std::string dirName, BootstrapVariation& var, bool keepHists );
+
+  private:
+
+    struct RangeSignificance {
+      float RMS;
+      double significance;
+      unsigned int nToys;
+    };
+
+    RangeSignificance rangeSignificance( const BootstrapVariation& sys, const BootstrapVariation& nominal,
+                                         const std::vector<int>& nominalIndex, int iBin, int endBin,
+                                         const std::vector<double>& thresholds,
+                                         BalanceFitDriver* fitter, std::string plotPrefix,
+                                         BalanceFitDriver::Seed& nominalSeed ) const;
+
+    double balanceValue( TH2F* hist, const BalanceMoments& moments, int startBin, int endBin, BalanceFitDriver* fitter,
+                         const BalanceFitDriver::Seed& seed = BalanceFitDriver::Seed() ) const;
+
+    TAxis m_recoilPtAxis;
+    float m_upperEdge;
+    double m_threshold;
+    double m_convergenceSigma;
+    unsigned int m_convergenceMinToys;
+    FitPlotRecorder* m_plots;
+
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef MultijetBalance_EventCache_H
+#define MultijetBalance_EventCache_H
+
+//////////////////////////////////////////////////////////////////
+// EventCache.h
+//////////////////////////////////////////////////////////////////
+// Everything the variation loop of MultijetBalanceAlgo needs that
+// does not change between MJB iterations, for the events passing
+// the selection before the loop (njets, QuickTrigger, centralLead,
+// detEta, mcCleaning):
+//  - the calibrated jet kinematics, the GSC and calibration stage
+//    momenta, the JVT inputs, cleaning and jet moments,
+//  - the trigger decisions and prescales, and the event weights,
+//  - the scale of each jet from the V+jet calibration alone
+//    (scale_Vjet) and from the V+jet calibration and each
+//    JetUncertaintiesTool variation (scale_<variation>).  It is 1 for
+//    jets that get the MJB correction instead, which is the only
+//    iteration dependent step and is redone when the cache is replayed.
+// Stored as a TTree, one entry per event, with the input file name
+// and tree entry of the event so that a job replaying the cache only
+// runs over the events of its own inputs.
+// B-tagging is not cached: its decisions and scale factors depend on
+// the varied and MJB corrected kinematics, so the cache can only be
+// used without b-tag working points (see MultijetBalanceAlgo).
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+#include <map>
+
+#include <Rtypes.h>
+
+class TTree;
+
+class EventCache
+{
+  public:
+
+    // Jets beyond this (the softest) are not cached, so a replay only sees the leading maxJets jets
+    static const int maxJets = 64;
+
+    EventCache( unsigned int nTriggers, const std::vector<std::string>& calibStages,
+                const std::vector<std::string>& scaleNames );
+
+    // Creates the branches, for writing
+    void book( TTree* tree );
+    // Sets the branch addresses, for reading.  Fails if a scale or calibration
+    // stage of this job is not in the cache.
+    bool connect( TTree* tree );
+    // Input file name -> input tree entry -> cache entry, reading only those two branches.
+    // Fails if an input entry is cached twice (caches of overlapping jobs merged together).
+    static bool index( TTree* tree, std::map< std::string, std::map< Long64_t, Long64_t > >& cacheIndex );
+
+    std::string inputFile;
+    Long64_t inputEntry;
+
+    unsigned int runNumber;
+    unsigned long long eventNumber;
+    bool isMC;
+    float mcEventWeight;
+    float weightXs;
+    std::vector<char> trigPassed;
+    std::vector<float> trigPrescale;
+
+    int njet;
+    std::vector<float> pt, eta, phi, m;
+    std::vector<float> gscPt, gscEta, gscPhi, gscM;
+    std::vector<float> detEta, jetCorr;
+    std::vector<float> jvfcorr, jvtRpt, pileupPt;
+    std::vector<char> clean;
+    std::vector<float> EMFrac, HECFrac, TileFrac;
+
+    // [stage][jet]
+    std::vector< std::vector<float> > stagePt, stageEta, stagePhi, stageM;
+
+    // [scale][jet], in the order of scaleNames
+    std::vector< std::vector<float> > scale;
+
+  private:
+
+    bool setAddress( TTree* tree, const std::string& name, void* address );
+
+    std::vector<std::string> m_calibStages;
+    std::vector<std::string> m_scaleNames;
+
+    std::string* m_inputFileAddress;
+
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef MultijetBalance_FitPlotRecorder_H
+#define MultijetBalance_FitPlotRecorder_H
+
+//////////////////////////////////////////////////////////////////
+// FitPlotRecorder.h
+//////////////////////////////////////////////////////////////////
+// Fit diagnostics (the fitted histogram, the fit function and the
+// annotation text) handed over by the fitting threads.  They are
+// written to one ROOT file on a background thread, so fitting never
+// waits for them, and drawn later with drawFitPlots.
+// In Png mode that file is temporary: finish() draws every plot to
+// <outDir><name>.png on the calling (main) thread, as ROOT graphics
+// are not used off the main thread, and removes it.
+// A fit whose plot finds the queue full drops it rather than wait,
+// and finish() reports how many were dropped.
+//////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "MultijetBalance/ThreadPool.h"
+
+class TFile;
+class TH1;
+class TF1;
+
+class FitPlotRecorder
+{
+  public:
+
+    enum Mode { None, Png, File };
+
+    // "none", "png" or "file"
+    static bool parseMode( const std::string& modeName, Mode& mode );
+
+    // The plots are written to outDir+fileName, and drawn to outDir in Png mode
+    FitPlotRecorder( Mode mode, const std::string& outDir, const std::string& fileName );
+    // Calls finish()
+    ~FitPlotRecorder();
+
+    bool enabled() const { return m_mode != None; };
+
+    // Thread safe.  Takes ownership of histo and func (which may be NULL),
+    // never blocks, drops the plot if the background thread is far behind.
+    void record( const std::string& name, TH1* histo, TF1* func, const std::vector<std::string>& lines );
+
+    // Writes everything recorded so far and stops the background thread, then draws
+    // the pngs in Png mode.  Must be called on the main thread.
+    void finish();
+
+    // One plot, as recorded
+    static void draw( const std::string& pngName, TH1* histo, TF1* func, const std::vector<std::string>& lines );
+    // Draws every plot of a file written in File mode to <outPrefix><name>.png, returns the number drawn
+    static int drawFile( TFile* inFile, const std::string& outPrefix );
+
+  private:
+
+    struct FitPlot {
+      std::string name;
+      TH1* histo;
+      TF1* func;
+      std::vector<std::string> lines;
+    };
+
+    void run();
+
+    Mode m_mode;
+    std::string m_outDir;
+    std::string m_fileName;
+    TFile* m_file;
+    BoundedQueue< FitPlot* > m_queue;
+    std::thread m_thread;
+    std::atomic<unsigned int> m_nDropped;
+
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef MultijetBalance_FitResultCache_H
+#define MultijetBalance_FitResultCache_H
+
+//////////////////////////////////////////////////////////////////
+// FitResultCache.h
+//////////////////////////////////////////////////////////////////
+// Persistent cache of balance fit results, keyed by a hash of the
+// projected histogram (binning, contents and errors) and of the
+// fit configuration.  A rerun on unchanged inputs then gets every
+// fit back without a minimizer, and a changed input simply misses.
+// Shared by all BalanceFitDrivers of a process (thread safe).
+// save() merges with what other processes wrote in the meantime,
+// holding a lock on <file>.lock so that concurrent saves add up.
+//////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+class TH1;
+
+class FitResultCache
+{
+  public:
+
+    struct Entry {
+      double mean;
+      double meanError;
+      double chi2Ndof;
+      double median;
+      double sigma;
+      double histoMedian;
+    };
+
+    // Loads fileName if it exists
+    FitResultCache( const std::string& fileName );
+
+    static unsigned long long hash( const TH1* histo, const std::vector<double>& config );
+
+    bool find( unsigned long long key, Entry& entry );
+    void insert( unsigned long long key, const Entry& entry );
+
+    // prune drops the entries that were not used by this job
+    bool save( bool prune = false );
+    void printStats() const;
+
+  private:
+
+    bool load( std::map< unsigned long long, Entry >& entries ) const;
+    // save() once the lock file is held
+    bool saveLocked( bool prune );
+
+    std::string m_fileName;
+    mutable std::mutex m_mutex;
+    std::map< unsigned long long, Entry > m_entries;
+    std::map< unsigned long long, bool > m_used;
+    unsigned long m_nLoaded;
+    unsigned long m_nHits;
+    unsigned long m_nMisses;
+    unsigned long m_nInserted;
+    bool m_versionMismatch;
+
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef MultijetBalance_HistMerger_H
+#define MultijetBalance_HistMerger_H
+
+//////////////////////////////////////////////////////////////////
+// HistMerger.h
+//////////////////////////////////////////////////////////////////
+// In-memory sum of the histogram outputs of MultijetBalanceAlgo
+// (hist, cutflow and SystToolOutput streams): the Iteration
+// directories, the cutflows and the TH2DBootstrap objects.
+// Histograms of identical binning (and bin labels, for the
+// cutflows) are added array by array, bootstrap objects nominal
+// and replica by replica.  Anything else is summed with the Merge
+// of its class, or the first copy is kept if it has none, as hadd
+// does.  TTrees are not supported.
+// Unscaled MC inputs can be normalized while they are read, with
+// the scale of their MCNormalization.
+// One HistMerger is used by one thread at a time.
+//////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+#include <map>
+
+class TObject;
+class TDirectory;
+class TH1;
+
+class HistMerger
+{
+  public:
+
+    HistMerger();
+    ~HistMerger();
+
+    // Reads and adds every object of dir and of its subdirectories.  The histograms
+    // and bootstrap objects are multiplied by scale, except the cutflows and the
+    // MCNormalization of the top level.
+    bool add( TDirectory* dir, double scale = 1. );
+    // Moves or adds every object of other into this one, other is left empty
+    bool add( HistMerger& other );
+    bool write( TDirectory* dir ) const;
+    // Drops the MCNormalization of the top level, once it is applied, and counts
+    // the MC jobs of its MJBSample as normalized
+    void removeNormalization();
+
+    unsigned int numObjects() const;
+
+    // Adds from to to if they have the same binning, returns false, leaving
+    // to unchanged, otherwise
+    static bool addHist( TH1* to, const TH1* from );
+
+  private:
+
+    struct Entry {
+      TObject* object;    // NULL for directories
+      HistMerger* subDir;
+    };
+
+    bool addDirectory( TDirectory* dir, double scale, bool topLevel );
+    // Takes ownership of object
+    bool addObject( const std::string& name, TObject* object );
+    static bool scaleObject( TObject* object, double scale );
+    HistMerger* getSubDir( const std::string& name );
+    void clear();
+
+    std::vector< std::string > m_names;  // in the order they were first seen
+    std::map< std::string, Entry > m_entries;
+
+};
+
+#endif
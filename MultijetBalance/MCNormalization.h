@@ -0,0 +1,69 @@
+#ifndef MultijetBalance_MCNormalization_H
+#define MultijetBalance_MCNormalization_H
+
+//////////////////////////////////////////////////////////////////
+// MCNormalization.h
+//////////////////////////////////////////////////////////////////
+// Normalization inputs of an MC sample, written by
+// MultijetBalanceAlgo to the hist output as a TH1D
+// MJBNormalization_<mcChannelNumber> with one labeled bin each:
+//   nJobs, numEvents and sumOfWeights (first bin of the input
+//   cutflow), xs and acceptance (from XsAcc_13TeV.txt)
+// Every bin adds up when the outputs of several jobs are merged,
+// xs and acceptance are divided by nJobs on read.
+// The histograms are already weighted by xs*acceptance, so the
+// scale of a channel is 1/numEvents (as scaleHist.py applies), or
+// 1/sumOfWeights.  Data has no MJBNormalization.
+// Every job, data or MC, also writes a TH1D MJBSample counting its
+// data, MC and normalizedMC jobs, which adds up the same way, so that
+// MC jobs without MJBNormalization are found.  Once the normalization
+// is applied (runHistMerge --normalize, scaleHist.py, runMJBHists)
+// the MC jobs are counted as normalizedMC.
+//////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <map>
+
+class TDirectory;
+class TH1;
+class TH1D;
+
+class MCNormalization
+{
+  public:
+
+    MCNormalization();
+
+    static const std::string prefix;      // MJBNormalization_
+    static const std::string sampleName;  // MJBSample
+
+    // The TH1D to write for one job
+    TH1D* makeHist( int mcChannelNumber ) const;
+    // Adds every MJBNormalization_ of dir to channels, returns false if one is malformed
+    static bool read( TDirectory* dir, std::map< int, MCNormalization >& channels );
+    // MJBNormalization_ or MJBSample, neither is scaled
+    static bool isMetadata( const std::string& name );
+
+    // The MJBSample to write for one job
+    static TH1D* makeSampleHist( bool isMC );
+    // Counts the MC jobs of an MJBSample as normalized
+    static void setNormalized( TH1* sampleHist );
+    // Returns false, printing why, if the MJBSample of dir mixes data and MC, or counts MC jobs
+    // that are not normalized and have no MJBNormalization in channels (as read from dir).
+    // Files without MJBSample are only accepted if requireSample is false, or they have channels.
+    static bool check( TDirectory* dir, const std::map< int, MCNormalization >& channels, bool requireSample = false );
+
+    void add( const MCNormalization& other );
+    double scale( bool bySumOfWeights = false ) const;
+    double xs() const { return m_nJobs > 0 ? m_xsSum/m_nJobs : 0.; };
+    double acceptance() const { return m_nJobs > 0 ? m_acceptanceSum/m_nJobs : 0.; };
+
+    double m_nJobs;
+    double m_numEvents;
+    double m_sumOfWeights;
+    double m_xsSum;
+    double m_acceptanceSum;
+
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef MultijetBalance_MJBHistCalculator_H
+#define MultijetBalance_MJBHistCalculator_H
+
+//////////////////////////////////////////////////////////////////
+// MJBHistCalculator.h
+//////////////////////////////////////////////////////////////////
+// The per-directory step of runMJBHists (was calculateMJBHists.py):
+// every object of an Iteration directory of a scaled file is read
+// once and copied to the appended output, with the Phi and Beta
+// TH1Fs rebinned, and each recoilPt_PtBal<tag> histogram gives an
+// MJB<tag> correction, the mean pt balance of every recoil pt bin,
+// written to both the appended and the MJB_initial outputs.
+// The means are taken from BalanceMoments, as runFit without fits.
+// The calculator holds no state, so one calculator can be shared
+// by several threads as long as each reads its own TFile.
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+
+class TObject;
+class TFile;
+class TDirectory;
+class TH1D;
+class TH2;
+
+// Everything runMJBHists writes into the directory of one systematic
+struct MJBHistOutput {
+  std::string dirName;
+  // In the order of the input keys, each MJB<tag> right after its recoilPt_PtBal<tag>
+  std::vector< TObject* > appended;
+  // Owned by appended, only written again to the MJB_initial file
+  std::vector< TH1D* > corrections;
+
+  void write( TFile* appendedFile, TFile* correctionFile );
+  void clear();
+};
+
+class MJBHistCalculator
+{
+  public:
+
+    // Every histogram read is multiplied by scale (the MCNormalization of an unscaled input)
+    MJBHistCalculator( double scale = 1. );
+
+    // Reads the objects of the directory keyName of inFile, or the single recoilPt_PtBal
+    // histogram keyName of a file without directories (bootstrap objects).
+    // Returns NULL if keyName can not be read.
+    MJBHistOutput* calculate( TFile* inFile, const std::string& keyName ) const;
+
+    // Mean pt balance of each recoil pt bin of h_recoilPt_PtBal, as
+    // ProfileX()->ProjectionX("MJB"+tag) of calculateMJBHists.py
+    static TH1D* correction( const TH2* h_recoilPt_PtBal, const std::string& tag );
+
+  private:
+
+    void addObject( MJBHistOutput* output, TObject* object ) const;
+
+    double m_scale;
+
+};
+
+#endif
@@ -4,9 +4,16 @@
 #include "xAODAnaHelpers/HelpTreeBase.h"
 #include "TTree.h"
 
+class AsyncTreeWriter;
+
 class MiniTree : public HelpTreeBase
 {
 
+  public:
+
+    // Capacity of the jet arrays of SetFlatJets
+    static const int maxJets = 64;
+
   private:
 
     int m_njet;
@@ -33,6 +40,10 @@ class MiniTree : public HelpTreeBase
     float m_recoilM;
     float m_recoilE;
 
+    AsyncTreeWriter* m_asyncWriter;
+    bool m_shared;
+    bool m_flatJets;
+
 
 
     std::vector<float> m_jet_detEta;
@@ -47,6 +58,20 @@ class MiniTree : public HelpTreeBase
     std::vector< std::vector<float> > m_jet_BTagSFBranches;
     std::vector< std::string > m_jet_BTagNames;
 
+    float m_flatJet_pt[maxJets];
+    float m_flatJet_eta[maxJets];
+    float m_flatJet_phi[maxJets];
+    float m_flatJet_E[maxJets];
+    float m_flatJet_detEta[maxJets];
+    float m_flatJet_beta[maxJets];
+    float m_flatJet_corr[maxJets];
+    float m_flatJet_TileFrac[maxJets];
+    std::vector< std::vector<int> > m_flatJet_BTag;
+    std::vector< std::vector<float> > m_flatJet_BTagSF;
+
+    void ParseBTagNames( const std::string detailStr );
+    void FillFlatJets( const std::vector< xAOD::Jet* >& jets );
+
 
   public:
 
@@ -57,9 +82,27 @@ class MiniTree : public HelpTreeBase
     void AddJetsUser( const std::string detailStr = "" , const std::string jetName = "jet");
     void FillEventUser( const xAOD::EventInfo* eventInfo );
     void FillJetsUser( const xAOD::Jet* jet, const std::string jetName = "jet" );
+    // Fill the jet branches straight from the selected jets, without building a JetContainer.
+    // No primary vertex is given to HelpTreeBase, so jet details needing it are not supported.
+    void FillSelectedJets( const std::vector< xAOD::Jet* >& jets, const std::string jetName = "jet" );
     void ClearEventUser();
     void ClearJetsUser(const std::string jetName = "jet");
 
+    // Only book the variables common to all variations, for the event tree of m_compactTree.
+    // Call before the Add functions.
+    void SetShared( bool shared ) { m_shared = shared; };
+    // Write the jets as njet and fixed capacity arrays (maxJets) instead of vectors, with the
+    // kinematic and MJB variables only.  Call before the Add functions.
+    void SetFlatJets( bool flatJets ) { m_flatJets = flatJets; };
+    // HelpTreeBase::AddJets, or the arrays of SetFlatJets
+    void AddJets( const std::string detailStr = "", const std::string jetName = "jet" );
+
+    // Hand TTree::Fill to writer, which must outlive the filling.  Call once every branch is added.
+    void SetAsyncWriter( AsyncTreeWriter* writer );
+    // Fills the tree, on the thread of the AsyncTreeWriter if one was set
+    void Fill();
+    TTree* GetTree() { return m_tree; };
+
 //    void AddMJB(std::string detailStringMJB = "");
 //    void FillEventUser( const xAOD::EventInfo* eventInfo );
 //    void FillJetsUser( const xAOD::Jet* jet );
@@ -0,0 +1,181 @@
+#ifndef MultijetBalance_MiniTreeHists_H
+#define MultijetBalance_MiniTreeHists_H
+
+//////////////////////////////////////////////////////////////////
+// MiniTreeHists.h
+//////////////////////////////////////////////////////////////////
+// Rebuilds the MultijetHists histograms of one variation from the
+// outTree_<sysVar> trees written by MultijetBalanceAlgo with
+// m_writeTree, without xAOD.
+//  - MiniTreeEvent reads the branches of one entry, and only those,
+//    with the jets as vectors or m_flatJetBranches arrays.
+//  - MiniTreeVariations reads the outTree_variations friend of
+//    m_compactTree, which only holds recoilPt, ptBal, weight and njet
+//    of each variation (the jets of outTree are before the variations),
+//    so it can only make the --minimal histograms without a selection.
+//  - MiniTreeSelection tightens the event selection, it can only be
+//    applied to stored quantities (ptAsym, alpha, beta).
+//  - MiniTreeHists books the same histograms (names, binnings and
+//    axis titles) as MultijetHists::initialize, except the generic
+//    JetHists ones it inherits, and fills them as
+//    MultijetHists::execute.
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+
+#include <Rtypes.h>
+
+class TTree;
+class TDirectory;
+class TH1;
+class TH1F;
+class TH2F;
+
+struct MiniTreeEvent
+{
+  // MiniTree::maxJets
+  static const int maxJets = 64;
+
+  MiniTreeEvent();
+
+  // Disables all other branches.  Returns false if a required branch is missing.
+  bool connect( TTree* tree );
+  // Fills the jet vectors from the arrays of m_flatJetBranches trees, after each GetEntry
+  void update();
+
+  bool flatJets;
+  int njet;   // size of the jet vectors, the njet branch is only read for flat trees
+  float weight;
+  float ptAsym, alpha, avgBeta, ptBal;
+  float recoilPt, recoilEta, recoilPhi, recoilM, recoilE;  // MeV
+  std::vector<float>* jet_pt;   // GeV
+  std::vector<float>* jet_eta;
+  std::vector<float>* jet_phi;
+  std::vector<float>* jet_E;    // GeV
+  std::vector<float>* jet_detEta;
+  std::vector<float>* jet_beta;
+  std::vector<float>* jet_TileFrac;
+  std::vector<float>* jet_EMFrac;   // only if the tree has it
+  std::vector<float>* jet_HECFrac;  // only if the tree has it
+
+  // Per jet branch, the arrays read and the vectors they are copied to, only for flat trees
+  std::vector< std::vector<float> > m_flatArrays;
+  std::vector< std::vector<float> > m_flatVectors;
+};
+
+struct MiniTreeVariations
+{
+  MiniTreeVariations();
+
+  // The variation names of the VariationPayload arrays, from the UserInfo of tree
+  static std::vector<std::string> names( TTree* tree );
+
+  // Disables all other branches.  Returns false if a VariationPayload branch is missing.
+  bool connect( TTree* tree );
+  // Sets recoilPt, ptBal, weight and njet of event to those of variation iVar of this entry,
+  // returns false if iVar did not pass
+  bool get( unsigned int iVar, MiniTreeEvent& event ) const;
+
+  unsigned int nVar;
+  std::vector<ULong64_t> passMask;
+  std::vector<float> recoilPt;  // MeV
+  std::vector<float> ptBal;
+  std::vector<float> weight;
+  std::vector<UChar_t> njet;
+};
+
+struct MiniTreeSelection
+{
+  // Negative values keep the selection of the tree
+  MiniTreeSelection() : ptAsym(-1.), alpha(-1.), beta(-1.), allJetBeta(false) {};
+
+  bool pass( const MiniTreeEvent& event ) const;
+
+  float ptAsym;
+  float alpha;
+  float beta;
+  bool allJetBeta;  // as m_allJetBeta of MultijetBalanceAlgo
+};
+
+class MiniTreeHists
+{
+  public:
+
+    // binning is m_binning of MultijetBalanceAlgo, minimal books only recoilPt_PtBal (as bootstrapIteration)
+    MiniTreeHists( const std::vector<double>& binning, bool minimal );
+    ~MiniTreeHists();
+
+    void fill( const MiniTreeEvent& event );
+    // Adds the contents of other, which must have been made with the same binning
+    void add( const MiniTreeHists& other );
+    // Writes each histogram as <prefix><name> in dir
+    void write( TDirectory* dir, const std::string& prefix ) const;
+
+    double entries() const;
+
+  private:
+
+    TH1F* book( const std::string& name, const std::string& xlabel, int xbins, double xlow, double xhigh );
+    TH1F* book( const std::string& name, const std::string& xlabel, int xbins, const double* xbinArray );
+    TH2F* book( const std::string& name, const std::string& xlabel, int xbins, const double* xbinArray,
+                const std::string& ylabel, int ybins, double ylow, double yhigh );
+    TH2F* book( const std::string& name, const std::string& xlabel, int xbins, double xlow, double xhigh,
+                const std::string& ylabel, int ybins, double ylow, double yhigh );
+    TH2F* book( const std::string& name, const std::string& xlabel, int xbins, const double* xbinArray,
+                const std::string& ylabel, int ybins, const double* ybinArray );
+    TH2F* book( const std::string& name, const std::string& xlabel, int xbins, double xlow, double xhigh,
+                const std::string& ylabel, int ybins, const double* ybinArray );
+
+    bool m_minimal;
+    int m_numSavedJets;
+    std::vector< TH1* > m_hists;
+
+    std::vector< TH1F* > m_MJBNjetsPt;
+    std::vector< TH1F* > m_MJBNjetsEta;
+    std::vector< TH1F* > m_MJBNjetsPhi;
+    std::vector< TH1F* > m_MJBNjetsM;
+    std::vector< TH1F* > m_MJBNjetsE;
+    std::vector< TH1F* > m_MJBNjetsRapidity;
+    std::vector< TH1F* > m_MJBNjetsBeta;
+
+    TH1F* m_avgBeta;
+    TH1F* m_alpha;
+    TH1F* m_njet;
+    TH1F* m_ptAsym;
+    TH1F* m_ptBal;
+    TH2F* m_ptAsym_njet;
+    TH1F* m_recoilEta;
+    TH1F* m_recoilPhi;
+    TH1F* m_recoilM;
+    TH1F* m_recoilE;
+    TH1F* m_subOverRecoilPt;
+    TH1F* m_recoilPt_center;
+
+    TH1F* m_recoilPt;
+    TH2F* m_recoilPt_jet0Pt;
+    TH2F* m_recoilPt_jet1Pt;
+    TH2F* m_recoilPt_avgBeta;
+    TH2F* m_recoilPt_alpha;
+    TH2F* m_recoilPt_njet;
+    TH2F* m_leadJetPt_jet1Pt;
+    TH2F* m_leadJetPt_avgBeta;
+    TH2F* m_leadJetPt_alpha;
+    TH2F* m_leadJetPt_njet;
+
+    TH2F* m_recoilPt_ptBal;
+    TH2F* m_leadJetPt_ptBal;
+    TH2F* m_recoilPt_ptBal_eta1;
+    TH2F* m_recoilPt_ptBal_eta2;
+    TH2F* m_recoilPt_ptBal_eta3;
+
+    TH2F* m_leadJetPt_EMFrac;
+    TH2F* m_recoilPt_EMFrac;
+    TH2F* m_leadJetPt_HECFrac;
+    TH2F* m_recoilPt_HECFrac;
+    TH2F* m_leadJetPt_TileFrac;
+    TH2F* m_recoilPt_TileFrac;
+
+};
+
+#endif
@@ -15,6 +15,7 @@
 // inlude the parent class header for tree
 #ifndef __MAKECINT__
 #include "MultijetBalance/MiniTree.h"
+#include "MultijetBalance/OutputPolicy.h"
 #endif
 
 #include <sstream>
@@ -39,6 +40,11 @@ class TrigDecisionTool;
 }
 
 class SystContainer;
+class EventCache;
+class AsyncTreeWriter;
+class VariationPayload;
+class TTree;
+class TFile;
 
 class MultijetBalanceAlgo : public EL::Algorithm
 {
@@ -82,6 +88,9 @@ class MultijetBalanceAlgo : public EL::Algorithm
     bool m_reverseSubleading;
     bool m_writeTree;                 // true will write out a TTree
     bool m_writeNominalTree;          // true will write out only the Nominal TTree
+    bool m_asyncTreeWriter;           // true will fill the TTrees on a background thread
+    bool m_compactTree;               // true will write one event tree and a friend of per-variation results, instead of a tree per variation
+    bool m_flatJetBranches;           // true will write the TTree jets as njet and fixed size arrays instead of vectors
     std::string m_MJBDetailStr;              // Will print out extra histograms
     std::string m_eventDetailStr;            // Will print out extra histograms
     std::string m_jetDetailStr;              // Will print out extra histograms
@@ -95,6 +104,11 @@ class MultijetBalanceAlgo : public EL::Algorithm
     int m_systTool_nToys;
     std::string m_binning;
     std::string m_VjetCalibFile;
+    bool m_writeEventCache;           // true will write the iteration independent event cache
+    std::string m_eventCacheDir;      // if set, run from the event cache in <dir>/<sample name>.root instead of the input
+    bool m_writeEventList;            // true will write the input entries passing the selection common to all variations
+    std::string m_eventListDir;       // if set, only read the input entries of the event list in <dir>/<sample name>.root
+    std::string m_outputPolicies;     // compression and basket settings per output stream, "stream=ALGO:level:autoFlush:basketSize,..."
 
     bool m_bTag;
     std::string m_bTagWPsString;
@@ -170,6 +184,24 @@ class MultijetBalanceAlgo : public EL::Algorithm
     std::vector<std::string> m_JCSTokens; //!
     std::vector<std::string> m_JCSStrings; //!
 
+    EventCache* m_eventCache; //!
+    TTree* m_eventCacheTree; //!
+    TFile* m_eventCacheFile; //!
+    std::vector<int> m_eventCacheScaleIndex; //!
+    bool m_eventCacheReplay; //!
+    bool m_eventCacheScales; //!
+    // input file name -> entry -> cache entry
+    std::map< std::string, std::map< Long64_t, Long64_t > > m_eventCacheIndex; //!
+    const std::map< Long64_t, Long64_t >* m_eventCacheThisFile; //!
+
+    TTree* m_eventListTree; //!
+    std::string m_eventListFileName; //!
+    Long64_t m_eventListEntry; //!
+    unsigned long long m_eventListEventNumber; //!
+    // input file name -> entry -> event number
+    std::map< std::string, std::map< Long64_t, unsigned long long > > m_eventList; //!
+    const std::map< Long64_t, unsigned long long >* m_eventListThisFile; //!
+
     EL::StatusCode passCutAll();
     EL::StatusCode passCut(int iVar);
 
@@ -182,8 +214,13 @@ class MultijetBalanceAlgo : public EL::Algorithm
 
     //MiniTree* m_nominalTree; //!
     std::vector<MiniTree*> m_treeList; //!
+    AsyncTreeWriter* m_treeWriter; //!
+    TTree* m_variationTree; //!
+    VariationPayload* m_variationPayload; //!
     EL::StatusCode getLumiWeights(const xAOD::EventInfo* eventInfo);
     std::vector<MultijetHists*> m_jetHists; //!
+    std::map<std::string, OutputPolicy> m_outputPolicyMap; //!
+    const OutputPolicy* outputPolicy(const std::string& stream) const;
 
     #endif
 
@@ -198,6 +235,10 @@ class MultijetBalanceAlgo : public EL::Algorithm
   EL::StatusCode loadVjetCalibration();
   EL::StatusCode loadMJBCalibration();
   EL::StatusCode loadBTagTools();
+  EL::StatusCode loadEventCache();
+  EL::StatusCode replayEventCache( Long64_t iEntry );
+  void setEventCacheFile();
+  EL::StatusCode loadEventList();
 
     #ifndef __MAKECINT__
      EL::StatusCode applyJetCalibrationTool( xAOD::Jet* jet);
@@ -205,7 +246,12 @@ class MultijetBalanceAlgo : public EL::Algorithm
      EL::StatusCode applyJetUncertaintyTool( xAOD::Jet* jet , int iVar );
      EL::StatusCode applyVjetCalibration( xAOD::Jet* jet , int iVar );
      EL::StatusCode applyMJBCalibration( xAOD::Jet* jet , int iVar, bool isLead = false );
+     EL::StatusCode applyVariationCalibration( std::vector< xAOD::Jet*>* jets, const std::vector<TLorentzVector>& originalJetKinematics, int iVar );
+     EL::StatusCode applyBTagTools( xAOD::Jet* jet );
      EL::StatusCode reorderJets(std::vector< xAOD::Jet*>* signalJets);
+     EL::StatusCode fillEventCache( const xAOD::EventInfo* eventInfo, std::vector< xAOD::Jet*>* jets, const std::vector<TLorentzVector>& originalJetKinematics );
+     EL::StatusCode runVariations( const xAOD::EventInfo* eventInfo, std::vector< xAOD::Jet*>* originalSignalJets,
+                                   const std::vector<TLorentzVector>& originalJetKinematics );
 
     #endif
 
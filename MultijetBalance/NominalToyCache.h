@@ -0,0 +1,79 @@
+#ifndef MultijetBalance_NominalToyCache_H
+#define MultijetBalance_NominalToyCache_H
+
+//////////////////////////////////////////////////////////////////
+// NominalToyCache.h
+//////////////////////////////////////////////////////////////////
+// Binary cache of the initialRebin'd Nominal toys of a bootstrap
+// file, so that every systematic job maps them read-only instead
+// of decoding and rebinning the same TH2Fs again.
+// Only the moments (mean) mode reads the mapped records in place.
+// Fits need a TH2F to project, so in fit mode every toy is still
+// copied out of the map into its own TH2F; the cache then saves the
+// reading and rebinning, but not the memory or the copy.
+// The cache is written next to the input file as
+//   <input>.<iteration>_Nominal.cache
+// and is rebuilt if the input file size or time stamp changes.
+//
+// Layout (all fields 8 bytes, so every array is aligned):
+//   header, recoil pt edges, pt balance edges, then one record
+//   for the full histogram and one per toy, each holding the
+//   toy number (-1 for full), entries, the packed BalanceMoments
+//   and the bin contents and errors squared (with under/overflow).
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+
+class TFile;
+class TH2F;
+struct BootstrapVariation;
+
+class NominalToyCache
+{
+  public:
+
+    NominalToyCache();
+    ~NominalToyCache();
+
+    static std::string cacheName( const std::string& inFileName, const std::string& iteration );
+
+    // Rebins every <iteration>_Nominal[_<toy>] histogram of inFile and writes the cache.
+    // The file is written under a temporary name and renamed, so concurrent jobs never see a partial cache.
+    static bool build( TFile* inFile, const std::string& inFileName, const std::string& iteration );
+
+    // Maps the cache, returns false if it is missing, corrupt or older than inFileName
+    bool open( const std::string& inFileName, const std::string& iteration );
+    void close();
+
+    // Adds the full histogram and the toys in toyNumbers (all toys if empty) to var.
+    // keepHists copies every toy into a new TH2F for fits, otherwise only the moments are copied.
+    bool fill( BootstrapVariation& var, bool keepHists, const std::vector<int>& toyNumbers = std::vector<int>() ) const;
+
+    unsigned int nToys() const;
+
+  private:
+
+    struct Header {
+      char magic[8];
+      long long version;
+      long long nRecords;
+      long long nBinsX;
+      long long nBinsY;
+      long long inputSize;
+      long long inputMTime;
+    };
+
+    static std::size_t recordSize( long long nBinsX, long long nBinsY );
+    TH2F* makeHist( const std::string& name, const double* record ) const;
+
+    void* m_map;
+    std::size_t m_mapSize;
+    const Header* m_header;
+    const double* m_xEdges;
+    const double* m_yEdges;
+    const double* m_records;
+
+};
+
+#endif
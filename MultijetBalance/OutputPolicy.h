@@ -0,0 +1,51 @@
+#ifndef MultijetBalance_OutputPolicy_H
+#define MultijetBalance_OutputPolicy_H
+
+//////////////////////////////////////////////////////////////////
+// OutputPolicy.h
+//////////////////////////////////////////////////////////////////
+// Compression and basket settings of one output file, written as
+//   ALGO[:level[:autoFlush[:basketSize]]]
+// with ALGO one of ZLIB, LZMA or LZ4 (ROOT 6.12 and later), or
+// DEFAULT to keep the algorithm ROOT gives the file.  A missing
+// level keeps the ROOT level (0 writes uncompressed), a 0 or missing
+// autoFlush/basketSize keeps the ROOT value; autoFlush follows
+// TTree::SetAutoFlush (>0 entries, <0 bytes).
+// e.g. "LZ4:4" for intermediate files, "LZMA:9:-30000000" for final ones.
+//////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <map>
+
+#include <Rtypes.h>
+
+class TFile;
+class TTree;
+
+class OutputPolicy
+{
+  public:
+
+    OutputPolicy();
+
+    // Returns false, leaving the policy unchanged, if policy is malformed
+    bool parse( const std::string& policy );
+    // Must be called before anything is written to file, the branches take
+    // the compression of their file when they are booked
+    void apply( TFile* file ) const;
+    // Must be called once every branch of tree is booked
+    void apply( TTree* tree ) const;
+
+    std::string str() const;
+
+    // Parses "stream=policy,stream=policy", returns false on the first malformed entry
+    static bool parseList( const std::string& policies, std::map< std::string, OutputPolicy >& policyMap );
+
+    int m_algorithm;      // ROOT::ECompressionAlgorithm, 0 keeps the ROOT default
+    int m_level;          // -1 keeps the ROOT level
+    Long64_t m_autoFlush;
+    int m_basketSize;
+
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef MultijetBalance_SystematicArrays_H
+#define MultijetBalance_SystematicArrays_H
+
+//////////////////////////////////////////////////////////////////
+// SystematicArrays.h
+//////////////////////////////////////////////////////////////////
+// The histograms of every Iteration directory (systematic) of an
+// MJB file, held as one contiguous buffer of bin contents and one
+// of bin errors, with every cell of one histogram of one
+// directory next to each other.  The TH1 of each entry is only
+// kept for its binning, names and titles.
+// The second stage operations of the Python scripts are single
+// passes over these buffers:
+//  - doubleRatio        data/MC of each systematic, as
+//                       calculateDoubleRatio.py
+//  - relativeShifts     (sys-nominal)/nominal of each systematic, as
+//                       calculateDoubleRatioSys.py
+//  - combine            quadrature sums of the positive and of the
+//                       negative relative shifts of groups of
+//                       systematics, as plotSysRatios.py
+// Errors follow TH1::Add and TH1::Divide for uncorrelated inputs.
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+#include <map>
+
+class TDirectory;
+class TH1;
+
+class SystematicArrays
+{
+  public:
+
+    SystematicArrays();
+    ~SystematicArrays();
+
+    // Reads every histogram whose name contains histFilter from each Iteration directory of dir
+    bool load( TDirectory* dir, const std::string& histFilter );
+    // Writes each directory with its histograms, in the order they were added
+    bool write( TDirectory* dir ) const;
+
+    unsigned int numDirs() const { return m_dirNames.size(); };
+    const std::string& dirName( unsigned int iDir ) const { return m_dirNames.at(iDir); };
+    int findDir( const std::string& name ) const;
+    // The single directory containing Nominal, -1 otherwise
+    int nominalDir() const;
+    // The first directory containing Nominal, -1 if there is none
+    int findNominal() const;
+
+    // Entries of directory iDir, in the order they were added
+    const std::vector<int>& dirEntries( unsigned int iDir ) const { return m_dirEntries.at(iDir); };
+    // Entry of histogram name in directory iDir, -1 if there is none
+    int findEntry( unsigned int iDir, const std::string& name ) const;
+    const std::string& entryName( int iEntry ) const { return m_entryNames.at(iEntry); };
+    const TH1* entryHist( int iEntry ) const { return m_entryHists.at(iEntry); };
+    int numCells( int iEntry ) const { return m_entryCells.at(iEntry); };
+    double* content( int iEntry ) { return &m_content[ m_entryOffsets.at(iEntry) ]; };
+    const double* content( int iEntry ) const { return &m_content[ m_entryOffsets.at(iEntry) ]; };
+    double* error( int iEntry ) { return &m_error[ m_entryOffsets.at(iEntry) ]; };
+    const double* error( int iEntry ) const { return &m_error[ m_entryOffsets.at(iEntry) ]; };
+
+    unsigned int addDir( const std::string& name );
+    // Adds an entry with the binning and titles of binning and zero contents, returns its index
+    int addEntry( unsigned int iDir, const std::string& name, const TH1* binning );
+
+    // Double ratio of every directory of data or mc, named Double<name>.  Directories only in
+    // data are divided by the nominal mc one, directories only in mc divide the nominal data.
+    // With mirrorToys, a data directory <sys>_<i> only in data is divided by the mc <sys>
+    // (the toys of bootstrap files, as mirrorMCtoData.py).  With mcNominalOnly every data
+    // directory is divided by the nominal mc one.
+    static bool doubleRatio( const SystematicArrays& data, const SystematicArrays& mc, bool mirrorToys, bool mcNominalOnly,
+                             const std::string& histFilter, SystematicArrays& out );
+    // Copies the nominal directory, and diff_<name> = (sys-nominal)/nominal for every other.
+    // The nominal of a directory also in reference is taken from reference (the bootstrap rebinned ones).
+    static bool relativeShifts( const SystematicArrays& in, const SystematicArrays* reference, SystematicArrays& out );
+    // For every group, a directory Combined_<group> with <name>_Up and <name>_Dn of each histogram
+    // of the nominal directory.  Groups are the members of groupDirs, each a list of directories of in.
+    static bool combine( const SystematicArrays& in, const std::vector<std::string>& groupNames,
+                         const std::vector< std::vector<unsigned int> >& groupDirs, SystematicArrays& out );
+
+    static bool sameBinning( const TH1* a, const TH1* b );
+
+  private:
+
+    void clear();
+
+    std::vector<std::string> m_dirNames;
+    std::vector< std::vector<int> > m_dirEntries;
+    std::vector< std::map<std::string, int> > m_dirEntryIndex;
+
+    std::vector<std::string> m_entryNames;
+    std::vector<TH1*> m_entryHists;
+    std::vector<int> m_entryCells;
+    std::vector<size_t> m_entryOffsets;
+
+    std::vector<double> m_content;
+    std::vector<double> m_error;
+
+};
+
+#endif
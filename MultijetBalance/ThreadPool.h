@@ -0,0 +1,122 @@
+#ifndef MultijetBalance_ThreadPool_H
+#define MultijetBalance_ThreadPool_H
+
+//////////////////////////////////////////////////////////////////
+// ThreadPool.h
+//////////////////////////////////////////////////////////////////
+// Small fixed-size work-stealing thread pool and bounded queue used
+// by the post-processing executables in util/ (the queue also by
+// AsyncTreeWriter).
+// Each worker owns a deque: tasks submitted from a worker go to its
+// own deque and are run newest-first, idle workers steal the oldest
+// task of another worker.
+// Not given a dictionary.
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class ThreadPool
+{
+  public:
+
+    // nThreads of 0 uses the number of hardware threads.
+    // maxQueued > 0 makes submit() from outside the pool block while that
+    // many tasks are waiting, which bounds the memory held by tasks that
+    // have not started yet.
+    ThreadPool(unsigned int nThreads = 0, unsigned int maxQueued = 0);
+    ~ThreadPool();
+
+    void submit( std::function<void()> task );
+    void wait();
+    unsigned int size() const { return m_threads.size(); }
+
+    // Index of the calling worker thread, or -1 outside of the pool
+    int workerIndex() const;
+
+  private:
+
+    struct WorkerQueue {
+      std::deque< std::function<void()> > tasks;
+      std::mutex mutex;
+    };
+
+    void run(unsigned int iWorker);
+    bool popLocal(unsigned int iWorker, std::function<void()>& task);
+    bool steal(unsigned int iWorker, std::function<void()>& task);
+
+    std::vector< std::thread > m_threads;
+    std::vector< WorkerQueue* > m_queues;
+    std::mutex m_mutex;
+    std::condition_variable m_taskReady;
+    std::condition_variable m_taskDone;
+    unsigned int m_maxQueued;
+    unsigned int m_nextQueue;
+    unsigned int m_queued;
+    unsigned int m_active;
+    bool m_stop;
+
+};
+
+
+// Blocking FIFO with a fixed capacity, used to hand results from the
+// worker threads to a single consumer (e.g. the thread writing a TFile).
+template< typename T >
+class BoundedQueue
+{
+  public:
+
+    BoundedQueue(unsigned int capacity) : m_capacity(capacity > 0 ? capacity : 1), m_closed(false) {};
+
+    void push( T item ){
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_notFull.wait(lock, [this]{ return m_items.size() < m_capacity || m_closed; });
+      m_items.push_back( item );
+      m_notEmpty.notify_one();
+    }
+
+    // Never waits, returns false (without adding item) if the queue is full or closed
+    bool tryPush( T item ){
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if( m_items.size() >= m_capacity || m_closed )
+        return false;
+      m_items.push_back( item );
+      m_notEmpty.notify_one();
+      return true;
+    }
+
+    // Returns false once the queue is closed and fully drained
+    bool pop( T& item ){
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_notEmpty.wait(lock, [this]{ return !m_items.empty() || m_closed; });
+      if( m_items.empty() )
+        return false;
+      item = m_items.front();
+      m_items.pop_front();
+      m_notFull.notify_one();
+      return true;
+    }
+
+    void close(){
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_closed = true;
+      m_notEmpty.notify_all();
+      m_notFull.notify_all();
+    }
+
+  private:
+
+    std::deque< T > m_items;
+    unsigned int m_capacity;
+    bool m_closed;
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef MultijetBalance_TriggerScan_H
+#define MultijetBalance_TriggerScan_H
+
+//////////////////////////////////////////////////////////////////
+// TriggerScan.h
+//////////////////////////////////////////////////////////////////
+// Trigger turn-on curves and recoil pt binning from the
+// outTree_<sysVar> trees of MultijetBalanceAlgo, as checkTrigger.py
+// and getBinningQuick.py.
+//  - TriggerScanEvent reads recoilPt, passedTriggers, jet_pt (vector
+//    or m_flatJetBranches array) and weight of one entry, and only
+//    those.
+//  - TriggerScanHists fills, for each turn-on trigger but the last,
+//    the wrong, unbaised and correct numerator and denominator of
+//    checkTrigger.py against the next trigger of the list, and the
+//    10 GeV recoil pt histogram finept of the binning triggers,
+//    each above its efficiency threshold.  finept is unweighted, as
+//    getBinningQuick.py, the turn-ons take the event weight.
+//  - efficientPt and balancedBinning are the efficiency point of
+//    the checkTrigger.py plots and the bin search of
+//    getBinningQuick.py.
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+
+class TTree;
+class TDirectory;
+class TH1;
+class TH1F;
+
+struct TriggerScanEvent
+{
+  // MiniTree::maxJets
+  static const int maxJets = 64;
+
+  TriggerScanEvent();
+  ~TriggerScanEvent();
+
+  // Disables all other branches, weight is not read if useWeight is false.
+  // Returns false if a required branch is missing.
+  bool connect( TTree* tree, bool useWeight );
+  // Sets passed, after each GetEntry
+  void update( const std::vector<std::string>& triggerNames );
+
+  int numJets() const { return flatJets ? njet : (int) jet_ptVector->size(); };
+  float jetPt( int iJet ) const { return flatJets ? jet_ptArray[iJet] : jet_ptVector->at(iJet); };
+
+  bool flatJets;
+  int njet;
+  float weight;
+  float recoilPt;                       // MeV
+  float jet_ptArray[maxJets];           // GeV
+  std::vector<float>* jet_ptVector;     // GeV
+  std::vector<std::string>* passedTriggers;
+  std::vector<char> passed;             // per name given to update
+};
+
+class TriggerScanHists
+{
+  public:
+
+    static const int nTypes = 3;
+    static const char* typeNames[nTypes];  // wrong, unbaised, correct
+
+    // binThresholds are the recoil pt (GeV) above which each binning trigger is efficient,
+    // ptAsym the maximum subleading jet over recoil pt
+    TriggerScanHists( const std::vector<std::string>& turnOnTriggers, const std::vector<std::string>& binTriggers,
+                      const std::vector<double>& binThresholds, float ptAsym );
+    ~TriggerScanHists();
+
+    // Every trigger of the turn-ons and of the binning, in the order of TriggerScanEvent::passed
+    const std::vector<std::string>& triggerNames() const { return m_triggerNames; };
+
+    // Returns true if the event passes the ptAsym cut.  eventWeight is not applied to finePt.
+    bool fill( const TriggerScanEvent& event, double eventWeight );
+    // Adds the contents of other, which must have been made with the same triggers
+    void add( const TriggerScanHists& other );
+    void write( TDirectory* dir ) const;
+
+    unsigned int numTurnOns() const { return m_numerators.size(); };
+    const std::string& turnOnTrigger( unsigned int iTurnOn ) const { return m_turnOnTriggers.at(iTurnOn); };
+    // lead selects the leading jet pt histograms instead of the recoil pt ones
+    const TH1F* numerator( unsigned int iTurnOn, int iType, bool lead ) const;
+    const TH1F* denominator( unsigned int iTurnOn, int iType, bool lead ) const;
+    const TH1F* finePt() const { return m_finePt; };
+
+    // Lower edge of the bin at which numerator/denominator becomes efficient: after the first
+    // bin followed by 5 increasing ones, the last bin still increasing, up to above 0.990
+    static double efficientPt( const TH1* numerator, const TH1* denominator );
+    // Extends fixedEdges with bins of whole finePt bins above its last edge, of at least
+    // minFineBins bins and minEvents entries each.  A remainder below minEvents is merged into
+    // the last new bin.  numEvents is filled with the content of every bin.
+    static std::vector<double> balancedBinning( const TH1* finePt, const std::vector<double>& fixedEdges,
+                                                double minEvents, int minFineBins, std::vector<double>& numEvents );
+
+  private:
+
+    std::vector<std::string> m_turnOnTriggers;
+    std::vector<std::string> m_triggerNames;
+    std::vector<unsigned int> m_binTriggerIndex;  // in m_triggerNames
+    std::vector<double> m_binThresholds;          // MeV
+    float m_ptAsym;
+
+    std::vector< std::vector<TH1F*> > m_numerators;       // [turnOn][type]
+    std::vector< std::vector<TH1F*> > m_denominators;
+    std::vector< std::vector<TH1F*> > m_leadNumerators;
+    std::vector< std::vector<TH1F*> > m_leadDenominators;
+    TH1F* m_finePt;
+    std::vector< TH1* > m_hists;
+
+};
+
+#endif
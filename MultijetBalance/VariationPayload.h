@@ -0,0 +1,51 @@
+#ifndef MultijetBalance_VariationPayload_H
+#define MultijetBalance_VariationPayload_H
+
+//////////////////////////////////////////////////////////////////
+// VariationPayload.h
+//////////////////////////////////////////////////////////////////
+// The per-variation results of one event for m_compactTree: a friend
+// of the single event tree (outTree), with one entry per event and
+// one fixed size array element per variation of m_sysVar.
+//  - passMask[(nVar+63)/64]/l : bit iVar set if variation iVar passed
+//  - recoilPt[nVar]/F (MeV), ptBal[nVar]/F, weight[nVar]/F,
+//    njet[nVar]/b, all 0 for variations that did not pass
+// The variation names are TObjStrings in the UserInfo of the tree,
+// in the order of the arrays.
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <string>
+
+#include <Rtypes.h>
+
+class TTree;
+
+class VariationPayload
+{
+  public:
+
+    VariationPayload( const std::vector<std::string>& sysVarNames );
+
+    void book( TTree* tree );
+    void clear();
+    void set( unsigned int iVar, float recoilPt, float ptBal, float weight, int njet );
+    bool anyPassed() const;
+
+    // For readers of the tree
+    static bool passed( const ULong64_t* passMask, unsigned int iVar ){
+      return (passMask[iVar/64] >> (iVar%64)) & 1;
+    };
+
+  private:
+
+    std::vector<std::string> m_sysVarNames;
+    std::vector<ULong64_t> m_passMask;
+    std::vector<float> m_recoilPt;
+    std::vector<float> m_ptBal;
+    std::vector<float> m_weight;
+    std::vector<UChar_t> m_njet;
+
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+#include <TROOT.h>
+#include <TTree.h>
+#include <TBranch.h>
+#include <TBranchElement.h>
+#include <TLeaf.h>
+#include <TObjArray.h>
+
+#include "MultijetBalance/AsyncTreeWriter.h"
+
+using namespace std;
+
+template< typename T >
+struct AsyncTreeWriter::TypedCopier : public AsyncTreeWriter::ObjectCopier {
+  void* create() const { return new T(); };
+  void copy( const void* from, void* to ) const { *((T*) to) = *((const T*) from); };
+  void destroy( void* object ) const { delete (T*) object; };
+};
+
+// The object branch types booked by HelpTreeBase and MiniTree
+const AsyncTreeWriter::ObjectCopier* AsyncTreeWriter::getCopier( const std::string& className ){
+  static const TypedCopier< std::vector<float> > vectorFloat;
+  static const TypedCopier< std::vector<double> > vectorDouble;
+  static const TypedCopier< std::vector<int> > vectorInt;
+  static const TypedCopier< std::vector<unsigned int> > vectorUInt;
+  static const TypedCopier< std::vector<char> > vectorChar;
+  static const TypedCopier< std::vector<std::string> > vectorString;
+  static const TypedCopier< std::vector< std::vector<float> > > vectorVectorFloat;
+  static const TypedCopier< std::vector< std::vector<int> > > vectorVectorInt;
+
+  if( className == "vector<float>" )                return &vectorFloat;
+  if( className == "vector<double>" )               return &vectorDouble;
+  if( className == "vector<int>" )                  return &vectorInt;
+  if( className == "vector<unsigned int>" )         return &vectorUInt;
+  if( className == "vector<char>" )                 return &vectorChar;
+  if( className == "vector<string>" )               return &vectorString;
+  if( className == "vector<vector<float> >" )       return &vectorVectorFloat;
+  if( className == "vector<vector<int> >" )         return &vectorVectorInt;
+  return NULL;
+}
+
+AsyncTreeWriter :: AsyncTreeWriter() :
+  m_queue(1024),  // never reached, each tree has at most one entry queued
+  m_numErrors(0),
+  m_numQueued(0),
+  m_finished(false)
+{
+  // TTree::Fill of the background thread changes gDirectory and gFile
+  ROOT::EnableThreadSafety();
+  m_thread = std::thread( &AsyncTreeWriter::run, this );
+}
+
+AsyncTreeWriter :: ~AsyncTreeWriter()
+{
+  finish();
+  for( std::map< TTree*, TreeBuffers* >::iterator it = m_trees.begin(); it != m_trees.end(); ++it ){
+    TreeBuffers* buffers = it->second;
+    for(unsigned int iB=0; iB < buffers->branches.size(); ++iB){
+      BranchBuffers* branch = buffers->branches.at(iB);
+      if( branch->copier )
+        branch->copier->destroy( branch->writeObject );
+      else
+        delete[] (char*) branch->writeObject;
+      delete branch;
+    }
+    delete buffers;
+  }
+}
+
+bool AsyncTreeWriter::attach( TTree* tree, int maxArrayLength ){
+  if( m_finished || m_trees.count(tree) > 0 )
+    return false;
+
+  TreeBuffers* buffers = new TreeBuffers();
+  buffers->tree = tree;
+  buffers->pending = false;
+
+  // First check every branch, so that tree is untouched on failure
+  bool f_supported = true;
+  TObjArray* branchList = tree->GetListOfBranches();
+  for(int iB=0; iB < branchList->GetEntries(); ++iB){
+    TBranch* thisBranch = (TBranch*) branchList->At(iB);
+    BranchBuffers* branch = new BranchBuffers();
+    branch->branch = thisBranch;
+    branch->copier = NULL;
+    branch->size = 0;
+    branch->count = NULL;
+    branch->maxCount = 0;
+    branch->writeObject = NULL;
+    branch->address = NULL;
+    buffers->branches.push_back( branch );
+
+    if( thisBranch->IsA() == TBranchElement::Class() ){
+      TBranchElement* thisElement = (TBranchElement*) thisBranch;
+      branch->copier = getCopier( thisElement->GetClassName() );
+      branch->fillObject = thisElement->GetObject();
+      // Booked with the address of a pointer of the tree owner, that finish() restores
+      branch->address = thisElement->GetAddress();
+      if( !branch->copier || !branch->fillObject || !branch->address || *((void**) branch->address) != branch->fillObject ){
+        cout << "AsyncTreeWriter: branch " << thisBranch->GetName() << " of type " << thisElement->GetClassName()
+             << " cannot be double-buffered, " << tree->GetName() << " is filled synchronously" << endl;
+        f_supported = false;
+        break;
+      }
+    }else if( thisBranch->IsA() == TBranch::Class() ){
+      TObjArray* leafList = thisBranch->GetListOfLeaves();
+      TLeaf* leaf = (leafList->GetEntries() == 1) ? (TLeaf*) leafList->At(0) : NULL;
+      branch->fillObject = thisBranch->GetAddress();
+      branch->address = branch->fillObject;
+      TLeaf* leafCount = leaf ? leaf->GetLeafCount() : NULL;
+      if( !leaf || !branch->fillObject || (leafCount && (maxArrayLength <= 0 || leafCount->GetLenType() != sizeof(int))) ){
+        cout << "AsyncTreeWriter: branch " << thisBranch->GetName() << " is not a single leaf of known size, "
+             << tree->GetName() << " is filled synchronously" << endl;
+        f_supported = false;
+        break;
+      }
+      branch->size = leaf->GetLenType()*leaf->GetLenStatic();
+      if( leafCount ){
+        // Still the variable of the tree owner, the count branch is redirected below
+        branch->count = (const int*) leafCount->GetBranch()->GetAddress();
+        branch->maxCount = maxArrayLength;
+      }
+    }else{
+      cout << "AsyncTreeWriter: branch " << thisBranch->GetName() << " of class " << thisBranch->ClassName()
+           << " cannot be double-buffered, " << tree->GetName() << " is filled synchronously" << endl;
+      f_supported = false;
+      break;
+    }
+  }
+
+  if( !f_supported ){
+    for(unsigned int iB=0; iB < buffers->branches.size(); ++iB)
+      delete buffers->branches.at(iB);
+    delete buffers;
+    return false;
+  }
+
+  // Point the branches to the buffers of the background thread.  Object
+  // branches take the address of a pointer, which must stay valid.
+  for(unsigned int iB=0; iB < buffers->branches.size(); ++iB){
+    BranchBuffers* branch = buffers->branches.at(iB);
+    if( branch->copier ){
+      branch->writeObject = branch->copier->create();
+      branch->branch->SetAddress( &branch->writeObject );
+    }else{
+      size_t capacity = branch->count ? branch->size*branch->maxCount : branch->size;
+      branch->writeObject = new char[capacity];
+      std::memset( branch->writeObject, 0, capacity );
+      branch->branch->SetAddress( branch->writeObject );
+    }
+  }
+
+  m_trees[tree] = buffers;
+  return true;
+}
+
+void AsyncTreeWriter::fill( TTree* tree ){
+  std::map< TTree*, TreeBuffers* >::iterator it = m_trees.find( tree );
+  if( m_finished || it == m_trees.end() ){
+    // Trees that could not be attached may share the file of the others,
+    // so they are filled here only while the background thread is idle
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_written.wait( lock, [this]{ return m_numQueued == 0; } );
+    tree->Fill();
+    return;
+  }
+  TreeBuffers* buffers = it->second;
+
+  {
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_written.wait( lock, [buffers]{ return !buffers->pending; } );
+    buffers->pending = true;
+    ++m_numQueued;
+  }
+
+  for(unsigned int iB=0; iB < buffers->branches.size(); ++iB){
+    BranchBuffers* branch = buffers->branches.at(iB);
+    if( branch->copier )
+      branch->copier->copy( branch->fillObject, branch->writeObject );
+    else if( branch->count )
+      std::memcpy( branch->writeObject, branch->fillObject, branch->size*std::max( 0, std::min( *branch->count, branch->maxCount ) ) );
+    else
+      std::memcpy( branch->writeObject, branch->fillObject, branch->size );
+  }
+
+  m_queue.push( buffers );
+}
+
+void AsyncTreeWriter::finish(){
+  if( m_finished )
+    return;
+  m_finished = true;
+  m_queue.close();
+  m_thread.join();
+
+  // The buffers are deleted with the writer, while the trees are written
+  // later, so the branches go back to addresses of the tree owner
+  for( std::map< TTree*, TreeBuffers* >::iterator it = m_trees.begin(); it != m_trees.end(); ++it ){
+    TreeBuffers* buffers = it->second;
+    for(unsigned int iB=0; iB < buffers->branches.size(); ++iB){
+      BranchBuffers* branch = buffers->branches.at(iB);
+      branch->branch->SetAddress( branch->address );
+    }
+  }
+
+  if( m_numErrors > 0 )
+    cout << "AsyncTreeWriter: " << m_numErrors << " entries could not be written" << endl;
+}
+
+void AsyncTreeWriter::run(){
+  TreeBuffers* buffers = NULL;
+  while( m_queue.pop( buffers ) ){
+    if( buffers->tree->Fill() < 0 )
+      ++m_numErrors;
+
+    {
+      std::lock_guard<std::mutex> lock( m_mutex );
+      buffers->pending = false;
+      --m_numQueued;
+    }
+    m_written.notify_all();
+  }
+}
@@ -0,0 +1,499 @@
+#include <iostream>
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <sstream>
+#include <chrono>
+
+#include <TF1.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <TMath.h>
+
+#include "JES_ResponseFitter/JES_BalanceFitter.h"
+
+#include "MultijetBalance/BalanceFitDriver.h"
+#include "MultijetBalance/FitResultCache.h"
+
+using namespace std;
+
+namespace {
+  // Summed over the drivers of every thread
+  std::atomic<long> s_nColdFits(0);
+  std::atomic<long> s_nWarmFits(0);
+  std::atomic<long> s_nWarmPasses(0);
+  std::atomic<long> s_nFallbacks(0);
+  std::atomic<long> s_nFuncs(0);
+
+  // Estimator validation, differences of estimator - fit
+  std::mutex s_validationMutex;
+  long s_nValidated = 0;
+  long s_nEstimatorFailed = 0;
+  double s_sumPull2 = 0.;
+  double s_maxPull = 0.;
+  double s_maxRelSigma = 0.;
+
+  // Warm start validation, differences of warm - cold fit
+  long s_nWarmValidated = 0;
+  double s_sumWarmPull2 = 0.;
+  double s_maxWarmPull = 0.;
+  double s_maxWarmRelSigma = 0.;
+  double s_warmSeconds = 0.;
+  double s_coldSeconds = 0.;
+
+  double secondsSince( const std::chrono::steady_clock::time_point& start ){
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+  }
+
+  const int maxEstimatorPasses = 50;
+
+  const int maxWarmPasses = 20;
+  // Convergence of mean and width, relative to the width
+  const double warmTolerance = 1e-3;
+}
+
+BalanceFitDriver :: BalanceFitDriver( double NsigmaForFit ) :
+  m_mode(Fitting),
+  m_NsigmaForFit(NsigmaForFit),
+  m_warmStart(false),
+  m_validateWarm(false),
+  m_lastWarm(false),
+  m_cache(NULL),
+  m_cached(false),
+  m_cacheKey(0),
+  m_histo(NULL),
+  m_mean(0.),
+  m_meanError(0.),
+  m_sigma(0.),
+  m_chi2Ndof(0.)
+{
+  m_fitter = new JES_BalanceFitter(NsigmaForFit);
+  // Unique name, TF1s are registered globally by name
+  std::string funcName = "BalanceFitDriver_gaus_"+to_string( s_nFuncs++ );
+  m_func = new TF1( funcName.c_str(), "gaus", 0., 5. );
+}
+
+BalanceFitDriver :: ~BalanceFitDriver()
+{
+  delete m_func;
+  delete m_fitter;
+}
+
+bool BalanceFitDriver::parseMode( const std::string& modeName, Mode& mode ){
+  if( modeName.compare("fit") == 0 )
+    mode = Fitting;
+  else if( modeName.compare("estimator") == 0 )
+    mode = Estimator;
+  else if( modeName.compare("validate") == 0 )
+    mode = ValidateEstimator;
+  else
+    return false;
+  return true;
+}
+
+void BalanceFitDriver::Fit( TH1* histo, double fitMin, const Seed& seed ){
+  m_cached = false;
+  m_cacheKey = 0;
+  m_validationLine.clear();
+
+  // Validation is only meaningful if the fit is actually done
+  if( !m_cache || m_mode == ValidateEstimator ){
+    fitHisto( histo, fitMin, seed );
+    return;
+  }
+
+  // Whether there is a seed decides between a warm fit (or seeded estimator) and JES_BalanceFitter,
+  // but its values only decide where the iteration starts, so they are not part of the key.
+  // Otherwise a rerun, whose seeds come from fits that differ at the level of their tolerance, never hits.
+  bool seeded = ( m_warmStart || m_mode == Estimator ) && seed.valid();
+  std::vector<double> config = { fitMin, m_NsigmaForFit, double(m_mode), double(m_warmStart), double(seeded) };
+  unsigned long long key = FitResultCache::hash( histo, config );
+
+  if( m_cache->find( key, m_entry ) ){
+    m_histo = histo;
+    m_cached = true;
+    m_lastWarm = true;
+    m_cacheKey = key;
+    m_mean = m_entry.mean;
+    m_meanError = m_entry.meanError;
+    m_chi2Ndof = m_entry.chi2Ndof;
+    m_sigma = m_entry.sigma;
+
+    // For drawing, the Gaussian through the peak within the fit window
+    m_func->SetRange( std::max(fitMin, m_mean-m_NsigmaForFit*m_sigma), m_mean+m_NsigmaForFit*m_sigma );
+    m_func->SetParameter( 0, histo->GetBinContent( histo->FindBin(m_mean) ) );
+    m_func->SetParameter( 1, m_mean );
+    m_func->SetParameter( 2, m_sigma );
+    return;
+  }
+
+  fitHisto( histo, fitMin, seed );
+
+  // The histogram median is only added once it is asked for
+  m_cacheKey = key;
+  m_entry.mean = GetMean();
+  m_entry.meanError = GetMeanError();
+  m_entry.chi2Ndof = GetChi2Ndof();
+  m_entry.median = GetMedian();
+  m_entry.sigma = GetSigma();
+  m_entry.histoMedian = NAN;
+  m_cache->insert( key, m_entry );
+}
+
+void BalanceFitDriver::fitHisto( TH1* histo, double fitMin, const Seed& seed ){
+  m_histo = histo;
+
+  if( m_mode == Estimator ){
+    fillEstimatorBins( histo );
+    Estimate result;
+    if( truncatedGaussian( fitMin, seed, result ) ){
+      useEstimate( result );
+      return;
+    }
+    // As for a failed warm start, a fit is better than no result
+  }
+
+  fitOnce( histo, fitMin, seed );
+
+  // The estimator is compared to the fit that is reported
+  if( m_mode == ValidateEstimator )
+    compareToEstimator( histo, fitMin, seed );
+}
+
+void BalanceFitDriver::fitOnce( TH1* histo, double fitMin, const Seed& seed ){
+  // Only a seeded fit is done here, anything else is JES_BalanceFitter as without warm starts
+  if( m_warmStart && seed.valid() ){
+    int nPasses = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if( warmFit( histo, fitMin, seed, nPasses ) ){
+      double warmSeconds = secondsSince( start );
+      m_lastWarm = true;
+      ++s_nWarmFits;
+      s_nWarmPasses += nPasses;
+      if( m_validateWarm )
+        compareToCold( histo, fitMin, warmSeconds );
+      return;
+    }
+    ++s_nFallbacks;
+  }
+
+  m_lastWarm = false;
+  ++s_nColdFits;
+  m_fitter->Fit( histo, fitMin );
+}
+
+void BalanceFitDriver::fillEstimatorBins( const TH1* histo ){
+  m_centers.resize( histo->GetNbinsX() );
+  m_sumW.resize( histo->GetNbinsX() );
+  m_sumW2.resize( histo->GetNbinsX() );
+  for(int iBin=1; iBin <= histo->GetNbinsX(); ++iBin){
+    double error = histo->GetBinError(iBin);
+    m_centers[iBin-1] = histo->GetXaxis()->GetBinCenter(iBin);
+    m_sumW[iBin-1] = histo->GetBinContent(iBin);
+    m_sumW2[iBin-1] = error*error;
+  }
+}
+
+// Iterated Gaussian fit within mean +- NsigmaForFit * sigma, as JES_BalanceFitter,
+// but starting from the seed.  Returns false if a pass fails or it does not converge.
+bool BalanceFitDriver::warmFit( TH1* histo, double fitMin, const Seed& seed, int& nPasses ){
+
+  double mean = seed.mean;
+  double sigma = seed.sigma;
+  double xMin = histo->GetXaxis()->GetXmin();
+  double xMax = histo->GetXaxis()->GetXmax();
+
+  for(nPasses=1; nPasses <= maxWarmPasses; ++nPasses){
+
+    double low = mean - m_NsigmaForFit*sigma;
+    double high = mean + m_NsigmaForFit*sigma;
+    if( low < fitMin )
+      low = fitMin;
+    if( low >= high )
+      return false;
+
+    m_func->SetRange( low, high );
+    double norm = histo->GetBinContent( histo->FindBin(mean) );
+    m_func->SetParameter( 0, norm > 0. ? norm : histo->GetMaximum() );
+    m_func->SetParameter( 1, mean );
+    m_func->SetParameter( 2, sigma );
+
+    // N: the function is not attached to the (possibly shared) histogram
+    int status = histo->Fit( m_func, "RQN0" );
+    double newMean = m_func->GetParameter(1);
+    double newSigma = fabs( m_func->GetParameter(2) );
+    if( status != 0 || newSigma <= 0. || newMean < xMin || newMean > xMax )
+      return false;
+
+    bool converged = fabs(newMean-mean) < warmTolerance*newSigma && fabs(newSigma-sigma) < warmTolerance*newSigma;
+    mean = newMean;
+    sigma = newSigma;
+    if( converged ){
+      m_mean = mean;
+      m_sigma = sigma;
+      m_meanError = m_func->GetParError(1);
+      m_chi2Ndof = m_func->GetNDF() > 0 ? m_func->GetChisquare() / m_func->GetNDF() : 0.;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Fits histo cold with JES_BalanceFitter after a warm fit, and keeps the differences
+// and the time of both fits.  The warm result stays the result of the driver.
+void BalanceFitDriver::compareToCold( TH1* histo, double fitMin, double warmSeconds ){
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  m_fitter->Fit( histo, fitMin );
+  double coldSeconds = secondsSince( start );
+  double coldMean = m_fitter->GetMean(), coldError = m_fitter->GetMeanError(), coldSigma = m_fitter->GetSigma();
+
+  double pull = coldError > 0. ? (m_mean - coldMean) / coldError : 0.;
+  double relSigma = coldSigma > 0. ? (m_sigma - coldSigma) / coldSigma : 0.;
+
+  std::lock_guard<std::mutex> lock(s_validationMutex);
+  ++s_nWarmValidated;
+  s_warmSeconds += warmSeconds;
+  s_coldSeconds += coldSeconds;
+  s_sumWarmPull2 += pull*pull;
+  if( fabs(pull) > s_maxWarmPull )
+    s_maxWarmPull = fabs(pull);
+  if( fabs(relSigma) > s_maxWarmRelSigma )
+    s_maxWarmRelSigma = fabs(relSigma);
+}
+
+bool BalanceFitDriver::estimate( const TH2* hist, int firstBin, int lastBin, double fitMin, const Seed& seed ){
+  m_histo = NULL;
+  m_cached = false;
+  m_cacheKey = 0;
+  m_validationLine.clear();
+
+  int nBinsY = hist->GetNbinsY();
+  m_centers.resize( nBinsY );
+  m_sumW.assign( nBinsY, 0. );
+  m_sumW2.assign( nBinsY, 0. );
+  for(int iBinY=1; iBinY <= nBinsY; ++iBinY){
+    m_centers[iBinY-1] = hist->GetYaxis()->GetBinCenter(iBinY);
+    for(int iBinX=firstBin; iBinX <= lastBin; ++iBinX){
+      double content = hist->GetBinContent(iBinX, iBinY);
+      if( content == 0. )
+        continue;
+      double error = hist->GetBinError(iBinX, iBinY);
+      m_sumW[iBinY-1] += content;
+      m_sumW2[iBinY-1] += error*error;
+    }
+  }
+  Estimate result;
+  if( !truncatedGaussian( fitMin, seed, result ) )
+    return false;
+  useEstimate( result );
+  return true;
+}
+
+// For a Gaussian of width sigma truncated at +-k sigma, the variance is
+//   sigma^2 * (1 - 2 k phi(k) / (2 Phi(k) - 1)),
+// so the width follows from the variance of the bins within the window.
+// Iterates mean and width until the window no longer changes.
+bool BalanceFitDriver::truncatedGaussian( double fitMin, const Seed& seed, Estimate& result ) const {
+
+  double k = m_NsigmaForFit;
+  double coverage = TMath::Erf( k/sqrt(2.) );
+  double truncation = 1. - 2.*k*exp(-0.5*k*k)/sqrt(2.*TMath::Pi()) / coverage;
+
+  unsigned int nBins = m_centers.size();
+  double mean = seed.mean, sigma = seed.sigma;
+  if( !seed.valid() ){
+    // Start from the full distribution, as the fit does
+    double w = 0., wy = 0., wy2 = 0.;
+    for(unsigned int iBin=0; iBin < nBins; ++iBin){
+      w += m_sumW[iBin];
+      wy += m_sumW[iBin]*m_centers[iBin];
+      wy2 += m_sumW[iBin]*m_centers[iBin]*m_centers[iBin];
+    }
+    if( w <= 0. )
+      return false;
+    mean = wy/w;
+    sigma = sqrt( fabs(wy2/w - mean*mean) );
+  }
+
+  for(int iPass=1; iPass <= maxEstimatorPasses; ++iPass){
+    double low = mean - k*sigma;
+    double high = mean + k*sigma;
+    if( low < fitMin )
+      low = fitMin;
+
+    double w = 0., wy = 0., wy2 = 0., w2 = 0.;
+    for(unsigned int iBin=0; iBin < nBins; ++iBin){
+      if( m_centers[iBin] < low || m_centers[iBin] > high || m_sumW[iBin] == 0. )
+        continue;
+      w += m_sumW[iBin];
+      wy += m_sumW[iBin]*m_centers[iBin];
+      wy2 += m_sumW[iBin]*m_centers[iBin]*m_centers[iBin];
+      w2 += m_sumW2[iBin];
+    }
+    if( w <= 0. || w2 <= 0. )
+      return false;
+
+    double newMean = wy/w;
+    double variance = wy2/w - newMean*newMean;
+    if( variance <= 0. )
+      return false;
+    double newSigma = sqrt( variance / truncation );
+
+    bool converged = fabs(newMean-mean) < warmTolerance*newSigma && fabs(newSigma-sigma) < warmTolerance*newSigma;
+    mean = newMean;
+    sigma = newSigma;
+    if( converged ){
+      result.mean = mean;
+      result.sigma = sigma;
+      result.meanError = sqrt( variance / (w*w/w2) );
+
+      // For drawing, the Gaussian with the same area within the window
+      double binWidth = nBins > 1 ? (m_centers[nBins-1]-m_centers[0])/(nBins-1) : 1.;
+      result.low = low;
+      result.high = high;
+      result.norm = w*binWidth / (sigma*sqrt(2.*TMath::Pi())*coverage);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void BalanceFitDriver::useEstimate( const Estimate& result ){
+  m_lastWarm = true;
+  m_mean = result.mean;
+  m_sigma = result.sigma;
+  m_meanError = result.meanError;
+  m_chi2Ndof = 0.;
+
+  m_func->SetRange( result.low, result.high );
+  m_func->SetParameter( 0, result.norm );
+  m_func->SetParameter( 1, result.mean );
+  m_func->SetParameter( 2, result.sigma );
+}
+
+// Runs the estimator on the histogram of the fit just done, and keeps the differences.
+// The fit is left as it is, whether the estimator converges or not.
+void BalanceFitDriver::compareToEstimator( TH1* histo, double fitMin, const Seed& seed ){
+  fillEstimatorBins( histo );
+  Estimate result;
+  if( !truncatedGaussian( fitMin, seed, result ) ){
+    m_validationLine = "Estimator validation "+std::string(histo->GetName())+": the estimator did not converge";
+    std::lock_guard<std::mutex> lock(s_validationMutex);
+    ++s_nEstimatorFailed;
+    return;
+  }
+
+  double pull = GetMeanError() > 0. ? (result.mean - GetMean()) / GetMeanError() : 0.;
+  double relSigma = GetSigma() > 0. ? (result.sigma - GetSigma()) / GetSigma() : 0.;
+  std::ostringstream line;
+  line << "Estimator validation " << histo->GetName() << ": fit mean " << GetMean() << " +- " << GetMeanError()
+       << ", estimator " << result.mean << " (" << pull << " sigma), width " << GetSigma() << " vs " << result.sigma;
+  m_validationLine = line.str();
+
+  std::lock_guard<std::mutex> lock(s_validationMutex);
+  ++s_nValidated;
+  s_sumPull2 += pull*pull;
+  if( fabs(pull) > s_maxPull )
+    s_maxPull = fabs(pull);
+  if( fabs(relSigma) > s_maxRelSigma )
+    s_maxRelSigma = fabs(relSigma);
+}
+
+double BalanceFitDriver::GetMean() const {
+  return m_lastWarm ? m_mean : m_fitter->GetMean();
+}
+
+double BalanceFitDriver::GetMeanError() const {
+  return m_lastWarm ? m_meanError : m_fitter->GetMeanError();
+}
+
+// The median of a Gaussian is its mean
+double BalanceFitDriver::GetMedian() const {
+  if( m_cached )
+    return m_entry.median;
+  return m_lastWarm ? m_mean : m_fitter->GetMedian();
+}
+
+double BalanceFitDriver::GetChi2Ndof() const {
+  return m_lastWarm ? m_chi2Ndof : m_fitter->GetChi2Ndof();
+}
+
+double BalanceFitDriver::GetSigma() const {
+  return m_lastWarm ? m_sigma : m_fitter->GetSigma();
+}
+
+double BalanceFitDriver::GetHistoMedian(){
+  if( m_cached && !std::isnan(m_entry.histoMedian) )
+    return m_entry.histoMedian;
+
+  double histoMedian = computeHistoMedian();
+  if( m_cacheKey != 0 ){
+    m_entry.histoMedian = histoMedian;
+    m_cache->insert( m_cacheKey, m_entry );
+  }
+  return histoMedian;
+}
+
+double BalanceFitDriver::computeHistoMedian(){
+  if( !m_lastWarm )
+    return m_fitter->GetHistoMedian();
+
+  double probability = 0.5, median = 0.;
+  if( m_histo ){
+    m_histo->GetQuantiles( 1, &median, &probability );
+    return median;
+  }
+
+  // Estimator on a TH2, interpolate within the bin that crosses half the total
+  double total = 0., cumulative = 0.;
+  for(unsigned int iBin=0; iBin < m_sumW.size(); ++iBin)
+    total += m_sumW[iBin];
+  double binWidth = m_centers.size() > 1 ? m_centers[1]-m_centers[0] : 0.;
+  for(unsigned int iBin=0; iBin < m_sumW.size(); ++iBin){
+    if( m_sumW[iBin] > 0. && cumulative + m_sumW[iBin] >= 0.5*total )
+      return m_centers[iBin] - 0.5*binWidth + binWidth*(0.5*total - cumulative)/m_sumW[iBin];
+    cumulative += m_sumW[iBin];
+  }
+  return median;
+}
+
+TH1* BalanceFitDriver::GetHisto(){
+  return m_lastWarm ? m_histo : m_fitter->GetHisto();
+}
+
+TF1* BalanceFitDriver::GetFit(){
+  return m_lastWarm ? m_func : m_fitter->GetFit();
+}
+
+void BalanceFitDriver::printStats(){
+  {
+    std::lock_guard<std::mutex> lock(s_validationMutex);
+    if( s_nValidated + s_nEstimatorFailed > 0 ){
+      cout << "Estimator validation: " << s_nValidated << " projections, RMS pull of the mean "
+           << (s_nValidated > 0 ? sqrt(s_sumPull2/s_nValidated) : 0.) << ", largest pull " << s_maxPull
+           << ", largest relative width difference " << s_maxRelSigma << ", " << s_nEstimatorFailed << " did not converge" << endl;
+    }
+    if( s_nWarmValidated > 0 ){
+      cout << "Warm start validation: " << s_nWarmValidated << " warm fits refit cold with JES_BalanceFitter, RMS pull of the mean "
+           << sqrt(s_sumWarmPull2/s_nWarmValidated) << ", largest pull " << s_maxWarmPull
+           << ", largest relative width difference " << s_maxWarmRelSigma << endl;
+      // The saving of warm starts, against JES_BalanceFitter on the same histograms
+      cout << "Warm start validation: warm fits took " << s_warmSeconds << " s, cold JES_BalanceFitter fits of the same histograms "
+           << s_coldSeconds << " s";
+      if( s_coldSeconds > 0. )
+        cout << " (" << 100.*(1.-s_warmSeconds/s_coldSeconds) << "% saved)";
+      cout << endl;
+    }
+  }
+
+  if( s_nWarmFits + s_nFallbacks == 0 )
+    return;
+
+  double warmPasses = s_nWarmFits > 0 ? double(s_nWarmPasses)/s_nWarmFits : 0.;
+  cout << "Warm start: " << s_nWarmFits << " seeded fits with " << warmPasses << " Gaussian fit passes each, "
+       << s_nFallbacks << " fell back to JES_BalanceFitter, " << s_nColdFits << " JES_BalanceFitter fits in total" << endl;
+}
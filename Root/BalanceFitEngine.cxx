@@ -0,0 +1,364 @@
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+
+#include <TFile.h>
+#include <TKey.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <TArrayD.h>
+#include <TF1.h>
+
+#include "MultijetBalance/BalanceFitEngine.h"
+
+using namespace std;
+
+void BalanceFitOutput::write( TFile* outFile ){
+  // Create output directory
+  outFile->mkdir(dirName.c_str());
+  TDirectoryFile* sysDir = (TDirectoryFile*) outFile->Get(dirName.c_str());
+  sysDir->cd();
+
+  // Save Histograms
+  if( h_recoilPt_PtBal ){
+    h_recoilPt_PtBal->SetDirectory(sysDir); h_recoilPt_PtBal->Write();
+  }
+  for(unsigned int iH=0; iH < hists.size(); ++iH){
+    hists.at(iH)->SetDirectory(sysDir); hists.at(iH)->Write();
+  }
+}
+
+void BalanceFitOutput::record( FitPlotRecorder& plots, const std::string& plotName ){
+
+  for( unsigned int iRange=0; iRange < ranges.size(); ++iRange){
+    BalanceFitRange& range = ranges.at(iRange);
+    if( !range.filled || !range.fitHisto || !range.fitFunc )
+      continue;
+
+    std::vector<std::string> lines;
+    char name[200];
+
+    sprintf(name, "Bins: %i to %i", range.startBin, range.endBin);
+    lines.push_back(name);
+
+    sprintf(name, "pT: %.0f %.0f", h_recoilPt_PtBal->GetXaxis()->GetBinLowEdge(range.startBin), h_recoilPt_PtBal->GetXaxis()->GetBinUpEdge(range.endBin));
+    lines.push_back(name);
+
+    sprintf(name,"Mean: %.3f", range.mean);
+    lines.push_back(name);
+
+    sprintf(name,"Fit Median: %.3f", range.median);
+    lines.push_back(name);
+
+    if (range.error < 0.5){
+      sprintf(name,"Hist Median: %.3f", range.medianHist);
+      lines.push_back(name);
+    }
+
+    sprintf(name,"Error: %.4f", range.error);
+    lines.push_back(name);
+
+    sprintf(name,"RedChi2: %.2f", range.redChi);
+    lines.push_back(name);
+
+    sprintf(name,"Width: %.2f", range.width);
+    lines.push_back(name);
+
+    sprintf(name,"Projection Mean: %.3f", range.projMean);
+    lines.push_back(name);
+
+    sprintf(name,"Projection Error: %.4f", range.projError);
+    lines.push_back(name);
+
+    // runFit numbered the ranges from 1
+    plots.record( plotName+"_"+to_string(iRange+1), range.fitHisto, range.fitFunc, lines );
+    range.fitHisto = NULL;
+    range.fitFunc = NULL;
+  }
+
+  if( hists.size() > 0 ){
+    TH1* h_MJB = (TH1*) hists.at(0)->Clone( (plotName+"_preprofMJB").c_str() );
+    plots.record( plotName+"_preprofMJB", h_MJB, NULL, std::vector<std::string>() );
+  }
+}
+
+void BalanceFitOutput::printValidation() const {
+  for(unsigned int iR=0; iR < ranges.size(); ++iR){
+    if( ranges.at(iR).validation.size() > 0 )
+      cout << ranges.at(iR).validation << endl;
+  }
+}
+
+void BalanceFitOutput::clear(){
+  for(unsigned int iR=0; iR < ranges.size(); ++iR){
+    delete ranges.at(iR).fitHisto;
+    delete ranges.at(iR).fitFunc;
+  }
+  ranges.clear();
+  delete h_recoilPt_PtBal;
+  h_recoilPt_PtBal = NULL;
+  for(unsigned int iH=0; iH < hists.size(); ++iH){
+    delete hists.at(iH);
+  }
+  hists.clear();
+}
+
+BalanceFitEngine :: BalanceFitEngine( bool f_fit, float upperEdge ) :
+  m_fit(f_fit),
+  m_upperEdge(upperEdge),
+  m_keepFits(false)
+{
+}
+
+BalanceFitEngine :: ~BalanceFitEngine()
+{
+  for( std::map<std::string, TH1D*>::iterator it = m_rebinHists.begin(); it != m_rebinHists.end(); ++it){
+    delete it->second;
+  }
+}
+
+bool BalanceFitEngine::loadRebinFile( std::string rebinFileName ){
+
+  if( rebinFileName.find("significant") == std::string::npos){
+    cout << "Rebinning only accepts \"significant\" files " << endl;
+    return false;
+  }
+
+  TFile* rebinFile = TFile::Open(rebinFileName.c_str(), "READ");
+  if( !rebinFile || rebinFile->IsZombie() ){
+    cout << "Error, rebin file " << rebinFileName << " does not exist." << endl;
+    return false;
+  }
+
+  TIter next(rebinFile->GetListOfKeys());
+  TKey *key;
+  while ((key = (TKey*)next() )){
+    std::string histName = key->GetName();
+    if( histName.find("significant_") != 0 )
+      continue;
+    TH1D* rebinHist = (TH1D*) rebinFile->Get( histName.c_str() );
+    rebinHist->SetDirectory(0);
+    m_rebinHists[histName] = rebinHist;
+  }
+  rebinFile->Close();
+
+  cout << "Loaded " << m_rebinHists.size() << " rebin histograms from " << rebinFileName << endl;
+  return true;
+}
+
+const TH1D* BalanceFitEngine::getRebinHist( const std::string& dirName ) const {
+
+  std::string thisSysType;
+  if (dirName.find("MCType") != std::string::npos){
+    thisSysType = "significant_Nominal";
+  }else{
+    thisSysType = "significant_"+dirName.substr(dirName.find_first_of('_')+1, dirName.size());
+  }
+
+  std::map<std::string, TH1D*>::const_iterator it = m_rebinHists.find( thisSysType );
+  // Toys use the binning of their systematic
+  if( it == m_rebinHists.end() )
+    it = m_rebinHists.find( thisSysType.substr(0, thisSysType.find_last_of('_')) );
+  if( it == m_rebinHists.end() )
+    return NULL;
+  return it->second;
+}
+
+BalanceFitOutput* BalanceFitEngine::prepare( const std::string& dirName, TH2* h_recoilPt_PtBal, std::string binningName ) const {
+
+  if( binningName.size() == 0 )
+    binningName = dirName;
+
+  BalanceFitOutput* output = new BalanceFitOutput();
+  output->dirName = dirName;
+  output->h_recoilPt_PtBal = h_recoilPt_PtBal;
+  if( !m_fit )
+    output->moments.fill( h_recoilPt_PtBal );
+
+  // Get Binning of output histogram
+  const TArrayD* xBins = h_recoilPt_PtBal->GetXaxis()->GetXbins();
+  const Double_t* xBinsD = xBins->GetArray();
+  int numBins = h_recoilPt_PtBal->GetNbinsX();
+
+  while( m_upperEdge < xBinsD[numBins]){
+    numBins--;
+  }
+  std::vector<Double_t> final_xBins(numBins+1);
+  for(int iBin = 0; iBin <= numBins; ++iBin){
+    if (xBinsD[iBin] < m_upperEdge)
+      final_xBins[iBin] = xBinsD[iBin];
+    else
+      final_xBins[iBin] = m_upperEdge;
+  }
+
+  TH1D* h_template = new TH1D("Template", "Template", numBins, &final_xBins[0]);
+  h_template->SetDirectory(0);
+
+  TH1D* h_mean = (TH1D*) h_template->Clone("MJB");  h_mean->SetTitle("MJB");
+  output->hists.push_back( h_mean );
+  if( m_fit ){
+    std::string fitHistNames[] = {"Error", "ReducedChi", "Median", "Width", "MedianHist"};
+    for(unsigned int iH=0; iH < 5; ++iH){
+      TH1D* thisHist = (TH1D*) h_template->Clone( fitHistNames[iH].c_str() );
+      thisHist->SetTitle( fitHistNames[iH].c_str() );
+      output->hists.push_back( thisHist );
+    }
+  }
+  delete h_template;
+
+  //each index of binsToCombine will correspond to 1 fit
+  //each element of binsToCombine will be the end bin to fit to, with the previous element being the starting bin
+  vector<int> binsToCombine;
+  const TH1D* rebinHist = m_rebinHists.size() > 0 ? getRebinHist( binningName ) : NULL;
+  if( rebinHist ){
+    const Double_t* xBinsDRebin = rebinHist->GetXaxis()->GetXbins()->GetArray();
+    int rebin_numBins = rebinHist->GetNbinsX();
+    int iRebin = 0;
+    for(int iBin = 0; iBin <= numBins; ++iBin){
+      if( iRebin <= rebin_numBins && xBinsDRebin[iRebin] == final_xBins[iBin]){
+        binsToCombine.push_back( iBin );
+        iRebin++;
+      }
+    }
+  }else{
+    if( m_rebinHists.size() > 0 )
+      cout << "Warning, no rebin histogram for " << binningName << ", using the original binning" << endl;
+    for(int iBin = 0; iBin <= numBins; ++iBin){
+      binsToCombine.push_back( iBin );
+    }
+  }
+
+  for( unsigned int iRange=1; iRange < binsToCombine.size(); ++iRange){
+    BalanceFitRange range;
+    range.startBin = binsToCombine.at(iRange-1)+1;
+    range.endBin = binsToCombine.at(iRange);
+    output->ranges.push_back( range );
+  }
+
+  return output;
+}
+
+void BalanceFitEngine::addSeeds( const BalanceFitOutput* output ){
+  if( !m_fit )
+    return;
+  for( unsigned int iRange=0; iRange < output->ranges.size(); ++iRange){
+    const BalanceFitRange& range = output->ranges.at(iRange);
+    if( !range.filled )
+      continue;
+    SeedRange seedRange;
+    seedRange.low = output->h_recoilPt_PtBal->GetXaxis()->GetBinLowEdge( range.startBin );
+    seedRange.high = output->h_recoilPt_PtBal->GetXaxis()->GetBinUpEdge( range.endBin );
+    seedRange.seed = BalanceFitDriver::Seed( range.mean, range.width );
+    m_seeds.push_back( seedRange );
+  }
+}
+
+// The seed range with the closest center, as rebinned systematics rarely match the Nominal ranges exactly
+BalanceFitDriver::Seed BalanceFitEngine::seedFor( const BalanceFitOutput* output, unsigned int iRange ) const {
+  const BalanceFitRange& range = output->ranges.at(iRange);
+  double center = 0.5*( output->h_recoilPt_PtBal->GetXaxis()->GetBinLowEdge( range.startBin )
+                      + output->h_recoilPt_PtBal->GetXaxis()->GetBinUpEdge( range.endBin ) );
+
+  BalanceFitDriver::Seed seed;
+  double closest = -1.;
+  for( unsigned int iSeed=0; iSeed < m_seeds.size(); ++iSeed){
+    double distance = fabs( 0.5*(m_seeds.at(iSeed).low + m_seeds.at(iSeed).high) - center );
+    if( closest < 0. || distance < closest ){
+      closest = distance;
+      seed = m_seeds.at(iSeed).seed;
+    }
+  }
+  return seed;
+}
+
+void BalanceFitEngine::fitRange( BalanceFitOutput* output, unsigned int iRange, BalanceFitDriver* fitter, BalanceFitDriver::Seed seed ) const {
+
+  BalanceFitRange& range = output->ranges.at(iRange);
+
+  // The mean of the projection, without building it.  For a range of every recoil pt bin this
+  // is the binned mean, where ProjectionY would give the unbinned mean of the TH2 fills (see BalanceMoments.h)
+  if( !m_fit ){
+    if( output->moments.effectiveEntries( range.startBin, range.endBin ) < 1 )
+      return;
+    range.filled = true;
+    range.projMean = output->moments.mean( range.startBin, range.endBin );
+    range.projError = output->moments.meanError( range.startBin, range.endBin );
+    range.mean = range.projMean;
+    range.error = range.projError;
+    return;
+  }
+
+  std::string projName = output->dirName+"_proj_"+to_string(iRange);
+  TH1D* h_proj = output->h_recoilPt_PtBal->ProjectionY( projName.c_str(), range.startBin, range.endBin, "ed");
+  if (h_proj->GetEntries() < 1){
+    delete h_proj;
+    return;
+  }
+
+  range.filled = true;
+  range.projMean = h_proj->GetMean();
+  range.projError = h_proj->GetMeanError();
+
+  if( m_fit ){
+    if( fitter->warmStart() && !seed.valid() )
+      seed = seedFor( output, iRange );
+    // Warm fits of the Nominal are checked against cold fits
+    if( fitter->warmStart() )
+      fitter->setValidateWarm( output->dirName.find("Nominal") != std::string::npos );
+    fitter->Fit(h_proj, 0, seed); // Rebin histogram and fit
+    range.validation = fitter->validationLine();
+    range.mean = fitter->GetMean();
+    range.error = fitter->GetMeanError();
+    range.median = fitter->GetMedian();
+    range.redChi = fitter->GetChi2Ndof();
+    range.width = fitter->GetSigma();
+    if (range.error < 0.5)
+      range.medianHist = fitter->GetHistoMedian();
+    else
+      range.medianHist = -99.0;
+
+    if( m_keepFits ){
+      range.fitHisto = (TH1D*) fitter->GetHisto()->Clone( (projName+"_fitHisto").c_str() );
+      range.fitHisto->SetDirectory(0);
+      range.fitFunc = (TF1*) fitter->GetFit()->Clone( (projName+"_fitFunc").c_str() );
+    }
+  }
+
+  delete h_proj;
+}
+
+void BalanceFitEngine::finish( BalanceFitOutput* output ) const {
+
+  //output histogram will have the same binning as the final result
+  for( unsigned int iRange=0; iRange < output->ranges.size(); ++iRange){
+    const BalanceFitRange& range = output->ranges.at(iRange);
+    if( !range.filled )
+      continue;
+    for(int iBin = range.startBin; iBin <= range.endBin; ++iBin){
+      output->hists.at(0)->SetBinContent( iBin, range.mean );
+      output->hists.at(0)->SetBinError( iBin, range.error );
+      if( m_fit ){
+        output->hists.at(1)->SetBinContent(iBin, range.error );
+        output->hists.at(2)->SetBinContent(iBin, range.redChi);
+        output->hists.at(3)->SetBinContent(iBin, range.median);
+        output->hists.at(4)->SetBinContent(iBin, range.width);
+        output->hists.at(5)->SetBinContent(iBin, range.medianHist);
+      }
+    }
+  }
+}
+
+BalanceFitOutput* BalanceFitEngine::fit( const std::string& dirName, TH2* h_recoilPt_PtBal, BalanceFitDriver* fitter ) const {
+  BalanceFitOutput* output = prepare( dirName, h_recoilPt_PtBal );
+  for( unsigned int iRange=0; iRange < output->ranges.size(); ++iRange){
+    BalanceFitDriver::Seed seed;
+    if( m_fit && fitter->warmStart() ){
+      seed = seedFor( output, iRange );
+      if( !seed.valid() && iRange > 0 && output->ranges.at(iRange-1).filled )
+        seed = BalanceFitDriver::Seed( output->ranges.at(iRange-1).mean, output->ranges.at(iRange-1).width );
+    }
+    fitRange( output, iRange, fitter, seed );
+  }
+  finish( output );
+  return output;
+}
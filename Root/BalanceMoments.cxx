@@ -0,0 +1,119 @@
+#include <cmath>
+
+#include <TH1.h>
+#include <TH2.h>
+
+#include "MultijetBalance/BalanceMoments.h"
+
+BalanceMoments :: BalanceMoments()
+{
+}
+
+BalanceMoments :: BalanceMoments( const TH2* hist )
+{
+  fill( hist );
+}
+
+// Follows TH1::GetStats for a projection: pt balance bin centers weighted
+// by the bin contents, with the bin errors squared as sum of weights squared
+void BalanceMoments::fill( const TH2* hist ){
+
+  int nBinsX = hist->GetNbinsX();
+  int nBinsY = hist->GetNbinsY();
+  const TAxis* yAxis = hist->GetYaxis();
+
+  m_sumW.assign( nBinsX+1, 0. );
+  m_sumWY.assign( nBinsX+1, 0. );
+  m_sumWY2.assign( nBinsX+1, 0. );
+  m_sumW2.assign( nBinsX+1, 0. );
+
+  std::vector<double> binCenters(nBinsY+1, 0.);
+  for(int iBinY=1; iBinY < nBinsY+1; ++iBinY){
+    binCenters.at(iBinY) = yAxis->GetBinCenter(iBinY);
+  }
+
+  for(int iBinX=1; iBinX < nBinsX+1; ++iBinX){
+    double sumW = 0., sumWY = 0., sumWY2 = 0., sumW2 = 0.;
+    for(int iBinY=1; iBinY < nBinsY+1; ++iBinY){
+      double content = hist->GetBinContent(iBinX, iBinY);
+      if( content == 0. )
+        continue;
+      double error = hist->GetBinError(iBinX, iBinY);
+      double y = binCenters[iBinY];
+      sumW   += content;
+      sumWY  += content*y;
+      sumWY2 += content*y*y;
+      sumW2  += error*error;
+    }
+    m_sumW[iBinX]   = m_sumW[iBinX-1]   + sumW;
+    m_sumWY[iBinX]  = m_sumWY[iBinX-1]  + sumWY;
+    m_sumWY2[iBinX] = m_sumWY2[iBinX-1] + sumWY2;
+    m_sumW2[iBinX]  = m_sumW2[iBinX-1]  + sumW2;
+  }
+
+}
+
+double BalanceMoments::sumW(int firstBin, int lastBin) const {
+  return m_sumW.at(lastBin) - m_sumW.at(firstBin-1);
+}
+
+double BalanceMoments::mean(int firstBin, int lastBin) const {
+  double w = sumW(firstBin, lastBin);
+  if( w == 0. )
+    return 0.;
+  return (m_sumWY.at(lastBin) - m_sumWY.at(firstBin-1)) / w;
+}
+
+double BalanceMoments::rms(int firstBin, int lastBin) const {
+  double w = sumW(firstBin, lastBin);
+  if( w == 0. )
+    return 0.;
+  double thisMean = mean(firstBin, lastBin);
+  double variance = (m_sumWY2.at(lastBin) - m_sumWY2.at(firstBin-1)) / w - thisMean*thisMean;
+  return variance > 0. ? std::sqrt(variance) : 0.;
+}
+
+// Same definition as TH1::GetMeanError, RMS / sqrt(effective entries)
+double BalanceMoments::meanError(int firstBin, int lastBin) const {
+  double w = sumW(firstBin, lastBin);
+  double w2 = m_sumW2.at(lastBin) - m_sumW2.at(firstBin-1);
+  if( w == 0. || w2 <= 0. )
+    return 0.;
+  double nEff = w*w/w2;
+  return rms(firstBin, lastBin) / std::sqrt(nEff);
+}
+
+double BalanceMoments::effectiveEntries(int firstBin, int lastBin) const {
+  double w = sumW(firstBin, lastBin);
+  double w2 = m_sumW2.at(lastBin) - m_sumW2.at(firstBin-1);
+  if( w2 <= 0. )
+    return 0.;
+  return w*w/w2;
+}
+
+void BalanceMoments::fillMeans( TH1* hist ) const {
+  if( hist->GetSumw2N() == 0 )
+    hist->Sumw2();
+  for(int iBin=1; iBin <= nBinsX() && iBin <= hist->GetNbinsX(); ++iBin){
+    hist->SetBinContent( iBin, mean(iBin, iBin) );
+    hist->SetBinError( iBin, meanError(iBin, iBin) );
+  }
+}
+
+void BalanceMoments::pack( double* out ) const {
+  int nBins = m_sumW.size();
+  for(int iBin=0; iBin < nBins; ++iBin){
+    out[iBin]         = m_sumW[iBin];
+    out[nBins+iBin]   = m_sumWY[iBin];
+    out[2*nBins+iBin] = m_sumWY2[iBin];
+    out[3*nBins+iBin] = m_sumW2[iBin];
+  }
+}
+
+void BalanceMoments::unpack( int nBinsX, const double* in ){
+  int nBins = nBinsX+1;
+  m_sumW.assign(   in,         in+nBins );
+  m_sumWY.assign(  in+nBins,   in+2*nBins );
+  m_sumWY2.assign( in+2*nBins, in+3*nBins );
+  m_sumW2.assign(  in+3*nBins, in+4*nBins );
+}
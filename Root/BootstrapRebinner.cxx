@@ -0,0 +1,507 @@
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <map>
+#include <algorithm>
+#include <sstream>
+
+#include <TFile.h>
+#include <TF1.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <TMath.h>
+
+#include "MultijetBalance/BootstrapRebinner.h"
+
+using namespace std;
+
+namespace {
+
+///// Records the last fit for plotting //////////////
+void recordFit(int startBin, int endBin, string plotName, BalanceFitDriver* m_BalFit, FitPlotRecorder* plots){
+  TH1D* thisHisto = (TH1D*) m_BalFit->GetHisto();
+  // The estimator on a TH2 has no projection to draw
+  if( !thisHisto )
+    return;
+
+  float thisMean = 0., thisError = 0., thisRedChi = 0., thisMedian = 0., thisWidth = 0., thisMedianHist = 0.;
+
+  thisMean = m_BalFit->GetMean();
+  thisError = m_BalFit->GetMeanError();
+  thisMedian = m_BalFit->GetMedian();
+  thisRedChi = m_BalFit->GetChi2Ndof();
+  thisWidth = m_BalFit->GetSigma();
+
+  if (thisError < 0.5)
+    thisMedianHist = m_BalFit->GetHistoMedian();
+  else
+    thisMedianHist = -99.;
+
+  std::vector<std::string> lines;
+  char name[200];
+
+  sprintf(name, "Bins: %i to %i", startBin, endBin);
+  lines.push_back(name);
+
+  sprintf(name, "pT: %.0f to %.0f", thisHisto->GetXaxis()->GetBinLowEdge(startBin), thisHisto->GetXaxis()->GetBinUpEdge(endBin));
+  lines.push_back(name);
+
+  sprintf(name,"Mean: %.3f", thisMean);
+  lines.push_back(name);
+
+  sprintf(name,"Fit Median: %.3f", thisMedian);
+  lines.push_back(name);
+
+  sprintf(name,"Hist Median: %.3f", thisMedianHist);
+  lines.push_back(name);
+
+  sprintf(name,"Error: %.4f", thisError);
+  lines.push_back(name);
+
+  sprintf(name,"RedChi2: %.2f", thisRedChi);
+  lines.push_back(name);
+
+  sprintf(name,"Width: %.2f", thisWidth);
+  lines.push_back(name);
+
+  TH1* histo = (TH1*) thisHisto->Clone( (plotName+"_fitHisto").c_str() );
+  TF1* func = (TF1*) m_BalFit->GetFit()->Clone( (plotName+"_fitFunc").c_str() );
+  plots->record( plotName, histo, func, lines );
+}
+
+}
+
+void BootstrapVariation::clear(){
+  delete full;
+  full = NULL;
+  for(unsigned int iT=0; iT < toys.size(); ++iT){
+    delete toys.at(iT);
+  }
+  toys.clear();
+  toyMoments.clear();
+  toyNumbers.clear();
+}
+
+BootstrapRebinner :: BootstrapRebinner( const TAxis& recoilPtAxis, float upperEdge, double threshold ) :
+  m_recoilPtAxis(recoilPtAxis),
+  m_upperEdge(upperEdge),
+  m_threshold(threshold),
+  m_convergenceSigma(0.),
+  m_convergenceMinToys(20),
+  m_plots(NULL)
+{
+}
+
+void BootstrapRebinner::setConvergence( double nSigma, unsigned int minToys ){
+  m_convergenceSigma = nSigma;
+  m_convergenceMinToys = minToys < 2 ? 2 : minToys;
+}
+
+bool BootstrapRebinner::isInteger(const std::string & s){
+  if(s.empty() || ((!isdigit(s[0])) && (s[0] != '-') && (s[0] != '+'))) return false ;
+
+  char * p ;
+  strtol(s.c_str(), &p, 10) ;
+
+  return (*p == 0) ;
+}
+
+std::vector<double> BootstrapRebinner::parseThresholds( const std::string& thresholdList, std::vector<std::string>& thresholdNames ){
+  std::vector<double> thresholds;
+  thresholdNames.clear();
+  std::stringstream ss(thresholdList);
+  std::string thisThreshold;
+  while( std::getline(ss, thisThreshold, ',') ){
+    if( thisThreshold.size() == 0 )
+      continue;
+    thresholds.push_back( std::stof(thisThreshold) );
+    thresholdNames.push_back( thisThreshold );
+  }
+  return thresholds;
+}
+
+void BootstrapRebinner::writeSignificant( TFile* outFile, const std::vector< TH1D* >& h_significants, const std::vector<std::string>& thresholdNames ){
+  if( h_significants.size() < 1 )
+    return;
+
+  outFile->cd();
+  h_significants.at(0)->Write("", TObject::kOverwrite);
+  if( h_significants.size() < 2 )
+    return;
+
+  for(unsigned int iT=0; iT < h_significants.size(); ++iT){
+    std::string dirName = "threshold_"+thresholdNames.at(iT);
+    TDirectory* thresholdDir = (TDirectory*) outFile->Get( dirName.c_str() );
+    if( !thresholdDir )
+      thresholdDir = outFile->mkdir( dirName.c_str() );
+    thresholdDir->cd();
+    h_significants.at(iT)->Write("", TObject::kOverwrite);
+  }
+  outFile->cd();
+}
+
+TH2* BootstrapRebinner::getBalanceHist( TFile* inFile, std::string dirName ){
+  TObject* thisObject = inFile->Get( (dirName+"/recoilPt_PtBal").c_str() );
+  if( !thisObject )
+    thisObject = inFile->Get( (dirName+"_recoilPt_PtBal").c_str() );
+  if( !thisObject )
+    return NULL;
+  TH2* thisHist = dynamic_cast<TH2*>( thisObject );
+  if( !thisHist ){
+    cout << "Error, recoilPt_PtBal of " << dirName << " is a " << thisObject->ClassName() << ", not a TH2" << endl;
+    delete thisObject;
+  }
+  return thisHist;
+}
+
+std::string BootstrapRebinner::stripFlatSuffix( std::string keyName ){
+  std::size_t flatPos = keyName.rfind("_recoilPt_PtBal");
+  if( flatPos != std::string::npos && flatPos+15 == keyName.size() )
+    keyName.erase(flatPos);
+  return keyName;
+}
+
+namespace {
+  // Target binning of initialRebin, set before any rebinning is done
+  std::vector<double> s_recoilPtEdges = {300, 360, 420, 480, 540, 600, 660, 720, 780, 840, 900, 960, 1020, 1140, 1260, 1480, 2000};
+  std::vector<double> s_ptBalEdges;
+
+  // Target bin of every source bin, from the source bin low edges (under/overflow included)
+  std::vector<int> mapBins( const TAxis* source, const std::vector<double>& targetEdges ){
+    int nTarget = targetEdges.size()-1;
+    std::vector<int> targetBins( source->GetNbins()+2, -1 );
+    for(int iBin=1; iBin <= source->GetNbins(); ++iBin){
+      double x = source->GetBinLowEdge(iBin)+0.0001;
+      int iTarget = std::upper_bound( targetEdges.begin(), targetEdges.end(), x ) - targetEdges.begin();
+      targetBins[iBin] = iTarget > nTarget ? nTarget+1 : iTarget;
+    }
+    return targetBins;
+  }
+
+  // Adds the contents of a TH2F or TH2D array to the target cells, and their squares to the target errors
+  template< typename T >
+  void addCells( const T* in, int nBinsX, int nBinsY, const std::vector<int>& targetX, const std::vector<int>& targetY,
+                 int strideOut, Float_t* out, Double_t* outSumw2 ){
+    int strideIn = nBinsX+2;
+    for(int iBinY=1; iBinY < nBinsY+1; ++iBinY){
+      int rowIn = iBinY*strideIn;
+      int rowOut = targetY[iBinY]*strideOut;
+      for(int iBinX=1; iBinX < nBinsX+1; ++iBinX){
+        double content = in[rowIn+iBinX];
+        int iCell = rowOut+targetX[iBinX];
+        out[iCell] += content;
+        outSumw2[iCell] += content*content;
+      }
+    }
+  }
+}
+
+void BootstrapRebinner::setInitialBinning( const TH2* binning ){
+  s_recoilPtEdges.clear();
+  for(int iBin=1; iBin <= binning->GetNbinsX()+1; ++iBin)
+    s_recoilPtEdges.push_back( binning->GetXaxis()->GetBinLowEdge(iBin) );
+  s_ptBalEdges.clear();
+  for(int iBin=1; iBin <= binning->GetNbinsY()+1; ++iBin)
+    s_ptBalEdges.push_back( binning->GetYaxis()->GetBinLowEdge(iBin) );
+}
+
+bool BootstrapRebinner::loadInitialBinning( TFile* file ){
+  TH2* binning = (TH2*) file->Get("initialBinning");
+  if( !binning )
+    return false;
+  setInitialBinning( binning );
+  delete binning;
+  return true;
+}
+
+bool BootstrapRebinner::configureInitialBinning( TFile* inFile, const std::string& binningFileName ){
+  if( binningFileName.size() == 0 ){
+    if( loadInitialBinning( inFile ) )
+      cout << "Using the initialBinning of the input file" << endl;
+    return true;
+  }
+
+  TFile* binningFile = TFile::Open( binningFileName.c_str(), "READ" );
+  bool loaded = binningFile && !binningFile->IsZombie() && loadInitialBinning( binningFile );
+  if( binningFile )
+    binningFile->Close();
+  if( !loaded )
+    cout << "Error, could not read initialBinning from " << binningFileName << endl;
+  return loaded;
+}
+
+const std::vector<double>& BootstrapRebinner::initialRecoilPtEdges(){
+  return s_recoilPtEdges;
+}
+
+const std::vector<double>& BootstrapRebinner::initialPtBalEdges(){
+  if( s_ptBalEdges.size() == 0 ){
+    for(int i=0; i < 500+1; ++i){
+      s_ptBalEdges.push_back( i/100. );
+    }
+  }
+  return s_ptBalEdges;
+}
+
+// Every source bin is added to the target bin of its low edge (+0.0001), the error as
+// if it was filled once with its content, as the Fill of the original runBootstrapRebin,
+// but each source row and column is mapped once and the sums go straight into the bin
+// arrays.  The bootstrap toys are TH2D, MultijetBalanceAlgo histograms TH2F.
+TH2F* BootstrapRebinner::initialRebin( TH2* inputHist ){
+
+  const std::vector<double>& xEdges = initialRecoilPtEdges();
+  const std::vector<double>& yEdges = initialPtBalEdges();
+
+  std::string histName = inputHist->GetName();
+  inputHist->SetName( ("tmp_"+histName).c_str() );
+  TH2F* newHist = new TH2F( histName.c_str(), inputHist->GetTitle(), xEdges.size()-1, &xEdges[0], yEdges.size()-1, &yEdges[0]);
+  newHist->Sumw2();
+
+  std::vector<int> targetX = mapBins( inputHist->GetXaxis(), xEdges );
+  std::vector<int> targetY = mapBins( inputHist->GetYaxis(), yEdges );
+
+  int nBinsX = inputHist->GetNbinsX();
+  int nBinsY = inputHist->GetNbinsY();
+  int strideOut = newHist->GetNbinsX()+2;
+  Float_t* out = newHist->GetArray();
+  Double_t* outSumw2 = newHist->GetSumw2()->GetArray();
+
+  if( TH2D* inputD = dynamic_cast<TH2D*>( inputHist ) ){
+    addCells( inputD->GetArray(), nBinsX, nBinsY, targetX, targetY, strideOut, out, outSumw2 );
+  }else if( TH2F* inputF = dynamic_cast<TH2F*>( inputHist ) ){
+    addCells( inputF->GetArray(), nBinsX, nBinsY, targetX, targetY, strideOut, out, outSumw2 );
+  }else{
+    for(int iBinY=1; iBinY < nBinsY+1; ++iBinY){
+      for(int iBinX=1; iBinX < nBinsX+1; ++iBinX){
+        double content = inputHist->GetBinContent( iBinX, iBinY );
+        int iCell = targetY[iBinY]*strideOut+targetX[iBinX];
+        out[iCell] += content;
+        outSumw2[iCell] += content*content;
+      }
+    }
+  }
+  // Statistics from the bin contents, so at the target bin centres and not at the
+  // low edge fill positions, and one entry per source bin as Fill gave
+  newHist->ResetStats();
+  newHist->SetEntries( nBinsX*nBinsY );
+  return newHist;
+}
+
+bool BootstrapRebinner::addToVariation( TFile* inFile, std::string dirName, BootstrapVariation& var, bool keepHists ){
+
+  TH2* h_recoilPt_PtBal = getBalanceHist( inFile, dirName );
+  if( !h_recoilPt_PtBal || h_recoilPt_PtBal->IsZombie() ){
+    cout << "Error, could not retrieve recoilPt_PtBal for " << dirName << endl;
+    return false;
+  }
+  TH2F* rebin_recoilPt_PtBal = initialRebin( h_recoilPt_PtBal );
+  delete h_recoilPt_PtBal;
+
+  //dirName formats are like Iteration1_Zjet_Stat1_neg_97 for toys, or Iteration1_Zjet_Stat1_neg
+  //if last field is an integer, then it's a toy.  Otherwise it's the full (non-bootstrap) result
+  std::string toyNum = dirName.substr(dirName.find_last_of('_')+1, dirName.size());
+  if( isInteger(toyNum) ){
+    var.toyMoments.push_back( BalanceMoments(rebin_recoilPt_PtBal) );
+    var.toyNumbers.push_back( std::stoi(toyNum) );
+    if( keepHists )
+      var.toys.push_back( rebin_recoilPt_PtBal );
+    else
+      delete rebin_recoilPt_PtBal;
+  }else{
+    // The full histogram is always kept, it is small compared to the toys
+    var.fullMoments.fill( rebin_recoilPt_PtBal );
+    delete var.full;
+    var.full = rebin_recoilPt_PtBal;
+  }
+
+  return true;
+}
+
+double BootstrapRebinner::balanceValue( TH2F* hist, const BalanceMoments& moments, int startBin, int endBin, BalanceFitDriver* fitter,
+                                        const BalanceFitDriver::Seed& seed ) const {
+  if( !fitter )
+    return moments.mean(startBin, endBin);
+
+  // The estimator works on the TH2 directly
+  if( fitter->mode() == BalanceFitDriver::Estimator && fitter->estimate( hist, startBin, endBin, 0, seed ) )
+    return fitter->GetMean();
+
+  TH1D* h_proj = hist->ProjectionY( (std::string(hist->GetName())+"_proj").c_str(), startBin, endBin, "ed" );
+  fitter->Fit(h_proj, 0, seed); // Rebin histogram and fit
+  double thisMean = fitter->GetMean();
+  delete h_proj;
+  return thisMean;
+}
+
+TH1D* BootstrapRebinner::rebin( const BootstrapVariation& sys, const BootstrapVariation& nominal,
+                                BalanceFitDriver* fitter, std::string plotPrefix ) const {
+  std::vector< TH1D* > h_significants = rebin( sys, nominal, std::vector<double>(1, m_threshold), fitter, plotPrefix );
+  return h_significants.size() > 0 ? h_significants.at(0) : NULL;
+}
+
+std::vector< TH1D* > BootstrapRebinner::rebin( const BootstrapVariation& sys, const BootstrapVariation& nominal,
+                                               const std::vector<double>& thresholds,
+                                               BalanceFitDriver* fitter, std::string plotPrefix ) const {
+
+  // Each toy is compared to the Nominal toy with the same toy number
+  std::vector<int> nominalIndex;
+  for(unsigned int iH = 0; iH < sys.toyNumbers.size(); ++iH){
+    int iNom = -1;
+    for(unsigned int iN = 0; iN < nominal.toyNumbers.size(); ++iN){
+      if( nominal.toyNumbers.at(iN) == sys.toyNumbers.at(iH) ){
+        iNom = iN;
+        break;
+      }
+    }
+    if( iNom < 0 ){
+      cout << "Error, no Nominal toy " << sys.toyNumbers.at(iH) << " for " << sys.name << endl;
+      return std::vector< TH1D* >();
+    }
+    nominalIndex.push_back( iNom );
+  }
+  if( nominalIndex.size() < 1 || !sys.full || !nominal.full ){
+    cout << "Error getting toys or nominal histogram for " << sys.name << endl;
+    return std::vector< TH1D* >();
+  }
+  if( fitter && (sys.toys.size() != sys.toyMoments.size() || nominal.toys.size() != nominal.toyMoments.size()) ){
+    cout << "Error, fits for " << sys.name << " require the toy histograms" << endl;
+    return std::vector< TH1D* >();
+  }
+
+  //Ignore any bins above upperEdge
+  int largestBin = m_recoilPtAxis.GetNbins();
+  while( m_recoilPtAxis.GetBinLowEdge(largestBin) >= m_upperEdge){
+    largestBin--;
+  }
+
+  // Toy statistics of each range are shared by all thresholds, which often visit the same ranges
+  std::map< std::pair<int,int>, RangeSignificance > rangeCache;
+  BalanceFitDriver::Seed nominalSeed;
+  unsigned long nToysUsed = 0, nToysAvailable = 0;
+
+  std::vector< TH1D* > h_significants;
+  for(unsigned int iThreshold=0; iThreshold < thresholds.size(); ++iThreshold){
+    double threshold = thresholds.at(iThreshold);
+
+    vector<int> reverseBinEdges; //we start from upper end
+    reverseBinEdges.push_back( largestBin );
+    vector<float> values_significant;
+
+    // Loop over all bins //
+    for( int iBin=reverseBinEdges.at(reverseBinEdges.size()-1); iBin > 0; --iBin){
+
+      int endBin = reverseBinEdges.at(reverseBinEdges.size()-1);
+
+      std::pair<int,int> range(iBin, endBin);
+      std::map< std::pair<int,int>, RangeSignificance >::iterator cached = rangeCache.find(range);
+      if( cached == rangeCache.end() ){
+        RangeSignificance thisRange = rangeSignificance( sys, nominal, nominalIndex, iBin, endBin, thresholds, fitter,
+                                                         iThreshold == 0 ? plotPrefix : "", nominalSeed );
+        nToysUsed += thisRange.nToys;
+        nToysAvailable += sys.toyMoments.size();
+        cached = rangeCache.insert( std::make_pair(range, thisRange) ).first;
+      }
+      float RMS = cached->second.RMS;
+      double significance = cached->second.significance;
+
+      // If significant, then save this bin as an edge. //
+      // Otherwise this bin will be added with the next bin //
+      if (RMS==0 ||  (significance > threshold)  ){
+        reverseBinEdges.push_back(iBin-1);
+        if (RMS == 0)
+          values_significant.push_back( 0 );
+        else
+          values_significant.push_back( significance );
+      }
+
+    }//for all bins
+
+    // Create histograms of the significance values with the final binning //
+    int numBins = reverseBinEdges.size()-1;
+    std::vector<Double_t> newXbins(numBins+1);
+    for(unsigned int i=0; i < reverseBinEdges.size(); ++i){
+      newXbins[numBins-i] = m_recoilPtAxis.GetBinUpEdge(reverseBinEdges.at(i));
+      if (newXbins[numBins-i] > m_upperEdge)
+        newXbins[numBins-i] = m_upperEdge;
+    }
+    TH1D* h_significant = new TH1D( ("significant_"+sys.name).c_str(), ("significant_"+sys.name).c_str(), numBins, &newXbins[0]);
+    h_significant->SetDirectory(0);
+    for(int iBin=1; iBin < h_significant->GetNbinsX()+1; ++iBin){
+      h_significant->SetBinContent(iBin, values_significant.at(numBins-iBin) );
+    }
+    h_significants.push_back( h_significant );
+  }//for all thresholds
+
+  if( m_convergenceSigma > 0. || thresholds.size() > 1 )
+    cout << sys.name << " used " << nToysUsed << " of " << nToysAvailable << " toy evaluations for "
+         << rangeCache.size() << " ranges and " << thresholds.size() << " thresholds" << endl;
+
+  return h_significants;
+}
+
+BootstrapRebinner::RangeSignificance BootstrapRebinner::rangeSignificance( const BootstrapVariation& sys, const BootstrapVariation& nominal,
+    const std::vector<int>& nominalIndex, int iBin, int endBin, const std::vector<double>& thresholds,
+    BalanceFitDriver* fitter, std::string plotPrefix, BalanceFitDriver::Seed& nominalSeed ) const {
+
+  //Get fits of this iBin projection for full (non-bootstrap)
+  //The Nominal fit seeds every other fit of this range, and the Nominal fit of the next range
+  float full_nominalVal = balanceValue( nominal.full, nominal.fullMoments, iBin, endBin, fitter, nominalSeed );
+  if( fitter )
+    nominalSeed = fitter->result();
+  float full_sysVal = balanceValue( sys.full, sys.fullMoments, iBin, endBin, fitter, nominalSeed );
+
+  // Get mean value from full (non-bootstrap) results //
+  float mean = (full_nominalVal == 0 ? 0 : ((full_sysVal/full_nominalVal)-1.)  );
+
+  vector<float> meanValues;
+  // Running (Welford) mean and variance of the toys, for the convergence check
+  double runningMean = 0., runningM2 = 0.;
+  // Loop over all toys //
+  for(unsigned int iH = 0; iH < sys.toyMoments.size(); ++iH){
+    int iNom = nominalIndex.at(iH);
+    float nominalVal = balanceValue( fitter ? nominal.toys.at(iNom) : NULL, nominal.toyMoments.at(iNom), iBin, endBin, fitter, nominalSeed );
+    float sysVal = balanceValue( fitter ? sys.toys.at(iH) : NULL, sys.toyMoments.at(iH), iBin, endBin, fitter, nominalSeed );
+
+    //!! Need to check here if fit failed, and otherwise give the projection?
+    meanValues.push_back(   nominalVal == 0 ? 0 : ((sysVal/nominalVal)-1.)  );
+
+    // Draw this fit for the first toy //
+    if( fitter && m_plots && iH == 0 && plotPrefix.size() > 0){
+      string plotName = plotPrefix+"_"+to_string(iBin)+"_"+to_string( endBin );
+      recordFit(iBin, endBin, plotName, fitter, m_plots);
+    }
+
+    if( m_convergenceSigma > 0. ){
+      unsigned int nToys = meanValues.size();
+      double delta = meanValues.back() - runningMean;
+      runningMean += delta / nToys;
+      runningM2 += delta * (meanValues.back() - runningMean);
+
+      // The relative standard error of a sample standard deviation is 1/sqrt(2(n-1)),
+      // stop once the significance is on one side of every threshold within nSigma of it
+      if( nToys >= m_convergenceMinToys && nToys < sys.toyMoments.size() && runningM2 > 0. ){
+        double significance = fabs(mean) / sqrt(runningM2 / (nToys-1));
+        double relError = m_convergenceSigma / sqrt(2.*(nToys-1));
+        bool converged = true;
+        for(unsigned int iT=0; iT < thresholds.size() && converged; ++iT){
+          converged = ( significance*(1.-relError) > thresholds.at(iT) || significance*(1.+relError) < thresholds.at(iT) );
+        }
+        if( converged )
+          break;
+      }
+    }
+  }
+
+  RangeSignificance thisRange;
+  thisRange.nToys = meanValues.size();
+
+  // Get RMS value from toys //
+  float RMS =  TMath::RMS(meanValues.size(), &meanValues[0]);
+
+  double mu = mean / RMS / RMS;
+  double sig = 1.0/ RMS / RMS;
+
+  thisRange.RMS = RMS;
+  thisRange.significance = (RMS == 0) ? 0 : fabs(mu)/sqrt(sig);
+  return thisRange;
+}
@@ -0,0 +1,180 @@
+#include <iostream>
+
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+
+#include "MultijetBalance/EventCache.h"
+
+using namespace std;
+
+EventCache :: EventCache( unsigned int nTriggers, const std::vector<std::string>& calibStages, const std::vector<std::string>& scaleNames ) :
+  inputFile(""),
+  inputEntry(0),
+  runNumber(0),
+  eventNumber(0),
+  isMC(false),
+  mcEventWeight(1.),
+  weightXs(1.),
+  trigPassed(nTriggers, 0),
+  trigPrescale(nTriggers, 1.),
+  njet(0),
+  pt(maxJets), eta(maxJets), phi(maxJets), m(maxJets),
+  gscPt(maxJets), gscEta(maxJets), gscPhi(maxJets), gscM(maxJets),
+  detEta(maxJets), jetCorr(maxJets),
+  jvfcorr(maxJets), jvtRpt(maxJets), pileupPt(maxJets),
+  clean(maxJets),
+  EMFrac(maxJets), HECFrac(maxJets), TileFrac(maxJets),
+  stagePt(calibStages.size(), std::vector<float>(maxJets)),
+  stageEta(calibStages.size(), std::vector<float>(maxJets)),
+  stagePhi(calibStages.size(), std::vector<float>(maxJets)),
+  stageM(calibStages.size(), std::vector<float>(maxJets)),
+  scale(scaleNames.size(), std::vector<float>(maxJets, 1.)),
+  m_calibStages(calibStages),
+  m_scaleNames(scaleNames),
+  m_inputFileAddress(&inputFile)
+{
+}
+
+void EventCache::book( TTree* tree ){
+  int nTriggers = trigPassed.size();
+  std::string triggerSize = "["+to_string(nTriggers)+"]";
+
+  tree->Branch("inputFile", &inputFile);
+  tree->Branch("inputEntry", &inputEntry, "inputEntry/L");
+  tree->Branch("runNumber", &runNumber, "runNumber/i");
+  tree->Branch("eventNumber", &eventNumber, "eventNumber/l");
+  tree->Branch("isMC", &isMC, "isMC/O");
+  tree->Branch("mcEventWeight", &mcEventWeight, "mcEventWeight/F");
+  tree->Branch("weightXs", &weightXs, "weightXs/F");
+  if( nTriggers > 0 ){
+    tree->Branch("trigPassed", &trigPassed[0], ("trigPassed"+triggerSize+"/O").c_str());
+    tree->Branch("trigPrescale", &trigPrescale[0], ("trigPrescale"+triggerSize+"/F").c_str());
+  }
+
+  tree->Branch("njet", &njet, "njet/I");
+  tree->Branch("pt", &pt[0], "pt[njet]/F");
+  tree->Branch("eta", &eta[0], "eta[njet]/F");
+  tree->Branch("phi", &phi[0], "phi[njet]/F");
+  tree->Branch("m", &m[0], "m[njet]/F");
+  tree->Branch("gscPt", &gscPt[0], "gscPt[njet]/F");
+  tree->Branch("gscEta", &gscEta[0], "gscEta[njet]/F");
+  tree->Branch("gscPhi", &gscPhi[0], "gscPhi[njet]/F");
+  tree->Branch("gscM", &gscM[0], "gscM[njet]/F");
+  tree->Branch("detEta", &detEta[0], "detEta[njet]/F");
+  tree->Branch("jetCorr", &jetCorr[0], "jetCorr[njet]/F");
+  tree->Branch("jvfcorr", &jvfcorr[0], "jvfcorr[njet]/F");
+  tree->Branch("jvtRpt", &jvtRpt[0], "jvtRpt[njet]/F");
+  tree->Branch("pileupPt", &pileupPt[0], "pileupPt[njet]/F");
+  tree->Branch("clean", &clean[0], "clean[njet]/O");
+  tree->Branch("EMFrac", &EMFrac[0], "EMFrac[njet]/F");
+  tree->Branch("HECFrac", &HECFrac[0], "HECFrac[njet]/F");
+  tree->Branch("TileFrac", &TileFrac[0], "TileFrac[njet]/F");
+
+
+  for(unsigned int iS=0; iS < m_calibStages.size(); ++iS){
+    std::string name = m_calibStages.at(iS);
+    tree->Branch((name+"_pt").c_str(), &stagePt.at(iS)[0], (name+"_pt[njet]/F").c_str());
+    tree->Branch((name+"_eta").c_str(), &stageEta.at(iS)[0], (name+"_eta[njet]/F").c_str());
+    tree->Branch((name+"_phi").c_str(), &stagePhi.at(iS)[0], (name+"_phi[njet]/F").c_str());
+    tree->Branch((name+"_m").c_str(), &stageM.at(iS)[0], (name+"_m[njet]/F").c_str());
+  }
+
+  for(unsigned int iScale=0; iScale < m_scaleNames.size(); ++iScale){
+    std::string name = "scale_"+m_scaleNames.at(iScale);
+    tree->Branch(name.c_str(), &scale.at(iScale)[0], (name+"[njet]/F").c_str());
+  }
+}
+
+bool EventCache::setAddress( TTree* tree, const std::string& name, void* address ){
+  if( !tree->GetBranch( name.c_str() ) ){
+    cout << "Error, the event cache has no branch " << name << endl;
+    return false;
+  }
+  tree->SetBranchAddress( name.c_str(), address );
+  return true;
+}
+
+bool EventCache::connect( TTree* tree ){
+  bool connected = true;
+  connected = setAddress(tree, "inputFile", &m_inputFileAddress) && connected;
+  connected = setAddress(tree, "inputEntry", &inputEntry) && connected;
+  connected = setAddress(tree, "runNumber", &runNumber) && connected;
+  connected = setAddress(tree, "eventNumber", &eventNumber) && connected;
+  connected = setAddress(tree, "isMC", &isMC) && connected;
+  connected = setAddress(tree, "mcEventWeight", &mcEventWeight) && connected;
+  connected = setAddress(tree, "weightXs", &weightXs) && connected;
+  if( trigPassed.size() > 0 ){
+    TBranch* trigBranch = tree->GetBranch("trigPassed");
+    if( !trigBranch || trigBranch->GetLeaf("trigPassed")->GetLen() != (int) trigPassed.size() ){
+      cout << "Error, the event cache was made with another number of triggers" << endl;
+      return false;
+    }
+    connected = setAddress(tree, "trigPassed", &trigPassed[0]) && connected;
+    connected = setAddress(tree, "trigPrescale", &trigPrescale[0]) && connected;
+  }
+
+  connected = setAddress(tree, "njet", &njet) && connected;
+  connected = setAddress(tree, "pt", &pt[0]) && connected;
+  connected = setAddress(tree, "eta", &eta[0]) && connected;
+  connected = setAddress(tree, "phi", &phi[0]) && connected;
+  connected = setAddress(tree, "m", &m[0]) && connected;
+  connected = setAddress(tree, "gscPt", &gscPt[0]) && connected;
+  connected = setAddress(tree, "gscEta", &gscEta[0]) && connected;
+  connected = setAddress(tree, "gscPhi", &gscPhi[0]) && connected;
+  connected = setAddress(tree, "gscM", &gscM[0]) && connected;
+  connected = setAddress(tree, "detEta", &detEta[0]) && connected;
+  connected = setAddress(tree, "jetCorr", &jetCorr[0]) && connected;
+  connected = setAddress(tree, "jvfcorr", &jvfcorr[0]) && connected;
+  connected = setAddress(tree, "jvtRpt", &jvtRpt[0]) && connected;
+  connected = setAddress(tree, "pileupPt", &pileupPt[0]) && connected;
+  connected = setAddress(tree, "clean", &clean[0]) && connected;
+  connected = setAddress(tree, "EMFrac", &EMFrac[0]) && connected;
+  connected = setAddress(tree, "HECFrac", &HECFrac[0]) && connected;
+  connected = setAddress(tree, "TileFrac", &TileFrac[0]) && connected;
+
+
+  for(unsigned int iS=0; iS < m_calibStages.size(); ++iS){
+    std::string name = m_calibStages.at(iS);
+    connected = setAddress(tree, name+"_pt", &stagePt.at(iS)[0]) && connected;
+    connected = setAddress(tree, name+"_eta", &stageEta.at(iS)[0]) && connected;
+    connected = setAddress(tree, name+"_phi", &stagePhi.at(iS)[0]) && connected;
+    connected = setAddress(tree, name+"_m", &stageM.at(iS)[0]) && connected;
+  }
+
+  for(unsigned int iScale=0; iScale < m_scaleNames.size(); ++iScale){
+    connected = setAddress(tree, "scale_"+m_scaleNames.at(iScale), &scale.at(iScale)[0]) && connected;
+  }
+
+  return connected;
+}
+
+bool EventCache::index( TTree* tree, std::map< std::string, std::map< Long64_t, Long64_t > >& cacheIndex ){
+  TBranch* fileBranch = tree->GetBranch("inputFile");
+  TBranch* entryBranch = tree->GetBranch("inputEntry");
+  if( !fileBranch || !entryBranch ){
+    cout << "Error, the event cache has no input file and entry, it was written before they were cached" << endl;
+    return false;
+  }
+
+  std::string thisFile;
+  std::string* thisFileAddress = &thisFile;
+  Long64_t thisEntry = 0;
+  fileBranch->SetAddress( &thisFileAddress );
+  entryBranch->SetAddress( &thisEntry );
+
+  bool unique = true;
+  Long64_t numEntries = tree->GetEntries();
+  for(Long64_t iEntry=0; iEntry < numEntries; ++iEntry){
+    fileBranch->GetEntry(iEntry);
+    entryBranch->GetEntry(iEntry);
+    if( !cacheIndex[thisFile].insert( std::make_pair(thisEntry, iEntry) ).second ){
+      cout << "Error, entry " << thisEntry << " of " << thisFile << " is cached more than once" << endl;
+      unique = false;
+      break;
+    }
+  }
+  tree->ResetBranchAddresses();
+
+  return unique;
+}
@@ -0,0 +1,167 @@
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+
+#include <TFile.h>
+#include <TKey.h>
+#include <TNamed.h>
+#include <TH1.h>
+#include <TF1.h>
+#include <TCanvas.h>
+#include <TLatex.h>
+
+#include "MultijetBalance/FitPlotRecorder.h"
+
+using namespace std;
+
+FitPlotRecorder :: FitPlotRecorder( Mode mode, const std::string& outDir, const std::string& fileName ) :
+  m_mode(mode),
+  m_outDir(outDir),
+  m_fileName(outDir+fileName),
+  m_file(NULL),
+  m_queue(256),
+  m_nDropped(0)
+{
+  if( m_mode != None ){
+    m_file = TFile::Open( m_fileName.c_str(), "RECREATE" );
+    if( !m_file || m_file->IsZombie() ){
+      cout << "Error, could not create fit plot file " << m_fileName << ", fit plots are not saved" << endl;
+      delete m_file;
+      m_file = NULL;
+      m_mode = None;
+    }
+  }
+  if( m_mode != None )
+    m_thread = std::thread( &FitPlotRecorder::run, this );
+}
+
+FitPlotRecorder :: ~FitPlotRecorder()
+{
+  finish();
+}
+
+bool FitPlotRecorder::parseMode( const std::string& modeName, Mode& mode ){
+  if( modeName.compare("none") == 0 )
+    mode = None;
+  else if( modeName.compare("png") == 0 )
+    mode = Png;
+  else if( modeName.compare("file") == 0 )
+    mode = File;
+  else
+    return false;
+  return true;
+}
+
+void FitPlotRecorder::record( const std::string& name, TH1* histo, TF1* func, const std::vector<std::string>& lines ){
+  if( m_mode == None || !histo ){
+    delete histo;
+    delete func;
+    return;
+  }
+  histo->SetDirectory(0);
+  FitPlot* plot = new FitPlot();
+  plot->name = name;
+  plot->histo = histo;
+  plot->func = func;
+  plot->lines = lines;
+  if( !m_queue.tryPush( plot ) ){
+    delete plot->histo;
+    delete plot->func;
+    delete plot;
+    ++m_nDropped;
+  }
+}
+
+void FitPlotRecorder::finish(){
+  if( !m_thread.joinable() )
+    return;
+  m_queue.close();
+  m_thread.join();
+  if( m_file ){
+    m_file->Close();
+    delete m_file;
+    m_file = NULL;
+    if( m_mode == Png ){
+      TFile* plotFile = TFile::Open( m_fileName.c_str(), "READ" );
+      int nDrawn = plotFile ? drawFile( plotFile, m_outDir ) : 0;
+      delete plotFile;
+      std::remove( m_fileName.c_str() );
+      cout << "Drew " << nDrawn << " fit plots to " << m_outDir << endl;
+    }else{
+      cout << "Fit plots saved in " << m_fileName << ", draw them with drawFitPlots" << endl;
+    }
+  }
+  if( m_nDropped > 0 )
+    cout << "Warning, " << m_nDropped << " fit plots were dropped as writing them fell behind the fits" << endl;
+}
+
+void FitPlotRecorder::run(){
+  FitPlot* plot = NULL;
+  while( m_queue.pop( plot ) ){
+    m_file->cd();
+    plot->histo->Write( plot->name.c_str() );
+    if( plot->func )
+      plot->func->Write( (plot->name+"_fit").c_str() );
+    std::string text;
+    for(unsigned int iL=0; iL < plot->lines.size(); ++iL)
+      text += (iL > 0 ? "\n" : "") + plot->lines.at(iL);
+    TNamed textObject( (plot->name+"_text").c_str(), text.c_str() );
+    textObject.Write();
+    delete plot->histo;
+    delete plot->func;
+    delete plot;
+  }
+}
+
+void FitPlotRecorder::draw( const std::string& pngName, TH1* histo, TF1* func, const std::vector<std::string>& lines ){
+  TCanvas c1("c1");
+  TLatex lt;
+  lt.SetTextSize(0.04);
+  lt.SetNDC();
+
+  c1.cd();
+  histo->Draw();
+  if( func )
+    func->Draw("same");
+
+  float ltx = 0.62;
+  float lty = 0.80;
+  for(unsigned int iL=0; iL < lines.size(); ++iL){
+    lt.DrawLatex(ltx,lty,lines.at(iL).c_str());
+    lty -= 0.05;
+  }
+
+  c1.Update();
+  c1.SaveAs( pngName.c_str() );
+}
+
+int FitPlotRecorder::drawFile( TFile* inFile, const std::string& outPrefix ){
+  int nDrawn = 0;
+  TIter next(inFile->GetListOfKeys());
+  TKey *key;
+  while ((key = (TKey*)next() )){
+    std::string className = key->GetClassName();
+    if( className.find("TH1") != 0 )
+      continue;
+
+    std::string name = key->GetName();
+    TH1* histo = (TH1*) key->ReadObj();
+    TF1* func = (TF1*) inFile->Get( (name+"_fit").c_str() );
+    TNamed* text = (TNamed*) inFile->Get( (name+"_text").c_str() );
+
+    std::vector<std::string> lines;
+    if( text ){
+      std::istringstream textStream( text->GetTitle() );
+      std::string line;
+      while( std::getline(textStream, line) )
+        lines.push_back( line );
+    }
+
+    draw( outPrefix+name+".png", histo, func, lines );
+    ++nDrawn;
+    delete histo;
+    delete func;
+    delete text;
+  }
+  return nDrawn;
+}
@@ -0,0 +1,185 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+
+#include <TH1.h>
+
+#include "MultijetBalance/FitResultCache.h"
+
+using namespace std;
+
+namespace {
+  const char cacheMagic[8] = {'M','J','B','F','I','T','C','1'};
+  // Increase whenever the fit procedure changes, which invalidates every entry
+  const long long cacheVersion = 1;
+
+  // FNV-1a, stable across runs and platforms of the same endianness
+  void hashBytes( unsigned long long& h, const void* data, std::size_t size ){
+    const unsigned char* bytes = (const unsigned char*) data;
+    for(std::size_t i=0; i < size; ++i){
+      h ^= bytes[i];
+      h *= 1099511628211ULL;
+    }
+  }
+
+  struct Record {
+    unsigned long long key;
+    FitResultCache::Entry entry;
+  };
+}
+
+FitResultCache :: FitResultCache( const std::string& fileName ) :
+  m_fileName(fileName),
+  m_nLoaded(0),
+  m_nHits(0),
+  m_nMisses(0),
+  m_nInserted(0),
+  m_versionMismatch(false)
+{
+  load( m_entries );
+  m_nLoaded = m_entries.size();
+}
+
+unsigned long long FitResultCache::hash( const TH1* histo, const std::vector<double>& config ){
+  unsigned long long h = 14695981039346656037ULL;
+
+  int nBins = histo->GetNbinsX();
+  hashBytes( h, &nBins, sizeof(nBins) );
+  for(int iBin=0; iBin <= nBins+1; ++iBin){
+    double values[3] = { histo->GetXaxis()->GetBinLowEdge(iBin), histo->GetBinContent(iBin), histo->GetBinError(iBin) };
+    hashBytes( h, values, sizeof(values) );
+  }
+  if( config.size() > 0 )
+    hashBytes( h, &config[0], sizeof(double)*config.size() );
+  return h;
+}
+
+bool FitResultCache::load( std::map< unsigned long long, Entry >& entries ) const {
+  FILE* cacheFile = fopen( m_fileName.c_str(), "rb" );
+  if( !cacheFile )
+    return false;
+
+  char magic[8];
+  long long version = 0, nRecords = 0;
+  bool valid = fread(magic, sizeof(magic), 1, cacheFile) == 1 && memcmp(magic, cacheMagic, sizeof(magic)) == 0
+            && fread(&version, sizeof(version), 1, cacheFile) == 1 && version == cacheVersion
+            && fread(&nRecords, sizeof(nRecords), 1, cacheFile) == 1;
+  if( !valid ){
+    fclose(cacheFile);
+    cout << "Fit cache " << m_fileName << " is from another version, starting a new one" << endl;
+    const_cast<FitResultCache*>(this)->m_versionMismatch = true;
+    return false;
+  }
+
+  std::vector<Record> records( nRecords );
+  if( nRecords > 0 && fread(&records[0], sizeof(Record), nRecords, cacheFile) != (std::size_t) nRecords ){
+    fclose(cacheFile);
+    cout << "Fit cache " << m_fileName << " is truncated, starting a new one" << endl;
+    return false;
+  }
+  fclose(cacheFile);
+
+  for(unsigned int iR=0; iR < records.size(); ++iR){
+    entries[ records.at(iR).key ] = records.at(iR).entry;
+  }
+  return true;
+}
+
+bool FitResultCache::find( unsigned long long key, Entry& entry ){
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::map< unsigned long long, Entry >::const_iterator it = m_entries.find( key );
+  if( it == m_entries.end() ){
+    ++m_nMisses;
+    return false;
+  }
+  ++m_nHits;
+  m_used[key] = true;
+  entry = it->second;
+  return true;
+}
+
+void FitResultCache::insert( unsigned long long key, const Entry& entry ){
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if( m_entries.find(key) == m_entries.end() )
+    ++m_nInserted;
+  m_entries[key] = entry;
+  m_used[key] = true;
+}
+
+bool FitResultCache::save( bool prune ){
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // Other jobs saving to the same file wait until this one has renamed its copy, so that
+  // the reload below sees every entry they saved.  flock is advisory, and only holds
+  // between the hosts of a shared file system if it supports it.
+  std::string lockName = m_fileName+".lock";
+  int lockFile = open( lockName.c_str(), O_RDWR | O_CREAT, 0666 );
+  if( lockFile < 0 || flock( lockFile, LOCK_EX ) != 0 ){
+    cout << "Error, could not lock fit cache " << lockName << endl;
+    if( lockFile >= 0 )
+      close( lockFile );
+    return false;
+  }
+  bool saved = saveLocked( prune );
+  flock( lockFile, LOCK_UN );
+  close( lockFile );
+  return saved;
+}
+
+bool FitResultCache::saveLocked( bool prune ){
+  // Keep what other jobs added since this one started
+  std::map< unsigned long long, Entry > entries;
+  if( !prune )
+    load( entries );
+  for( std::map< unsigned long long, Entry >::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it){
+    if( prune && m_used.find(it->first) == m_used.end() )
+      continue;
+    entries[it->first] = it->second;
+  }
+
+  std::vector<Record> records;
+  for( std::map< unsigned long long, Entry >::const_iterator it = entries.begin(); it != entries.end(); ++it){
+    Record record;
+    record.key = it->first;
+    record.entry = it->second;
+    records.push_back( record );
+  }
+
+  std::string tmpName = m_fileName+".tmp"+to_string(getpid());
+  FILE* cacheFile = fopen( tmpName.c_str(), "wb" );
+  if( !cacheFile ){
+    cout << "Error, could not write fit cache " << tmpName << endl;
+    return false;
+  }
+  long long version = cacheVersion, nRecords = records.size();
+  bool written = fwrite(cacheMagic, sizeof(cacheMagic), 1, cacheFile) == 1
+              && fwrite(&version, sizeof(version), 1, cacheFile) == 1
+              && fwrite(&nRecords, sizeof(nRecords), 1, cacheFile) == 1
+              && (nRecords == 0 || fwrite(&records[0], sizeof(Record), nRecords, cacheFile) == (std::size_t) nRecords);
+  written = (fclose(cacheFile) == 0) && written;
+  if( !written || rename(tmpName.c_str(), m_fileName.c_str()) != 0 ){
+    cout << "Error, could not write fit cache " << m_fileName << endl;
+    remove( tmpName.c_str() );
+    return false;
+  }
+
+  cout << "Saved " << nRecords << " fits to " << m_fileName << (prune ? " (pruned to the fits of this job)" : "") << endl;
+  return true;
+}
+
+void FitResultCache::printStats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  unsigned long nLookups = m_nHits + m_nMisses;
+  unsigned long nStale = 0;
+  for( std::map< unsigned long long, Entry >::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it){
+    if( m_used.find(it->first) == m_used.end() )
+      ++nStale;
+  }
+  cout << "Fit cache " << m_fileName << ": " << m_nHits << " hits and " << m_nMisses << " misses ("
+       << (nLookups > 0 ? 100.*m_nHits/nLookups : 0.) << "% hit rate), " << m_nLoaded << " entries loaded"
+       << (m_versionMismatch ? " (previous cache invalidated by a version change)" : "") << ", "
+       << m_nInserted << " new, " << nStale << " not used by this job (use --fitCachePrune to drop them)" << endl;
+}
@@ -0,0 +1,327 @@
+#include <iostream>
+#include <set>
+#include <algorithm>
+
+#include <TDirectory.h>
+#include <TKey.h>
+#include <TList.h>
+#include <TClass.h>
+#include <TTree.h>
+#include <TH1.h>
+#include <TAxis.h>
+#include <TArrayD.h>
+#include <TArrayF.h>
+#include <TProfile.h>
+#include <TProfile2D.h>
+#include <TProfile3D.h>
+
+#include "BootstrapGenerator/TH2DBootstrap.h"
+
+#include "MultijetBalance/HistMerger.h"
+#include "MultijetBalance/MCNormalization.h"
+
+using namespace std;
+
+namespace {
+
+// Same edges and, for the cutflows, same bin labels
+bool sameAxis( const TAxis* a, const TAxis* b ){
+  if( a->GetNbins() != b->GetNbins() || a->GetXmin() != b->GetXmin() || a->GetXmax() != b->GetXmax() )
+    return false;
+  if( a->GetXbins()->GetSize() != b->GetXbins()->GetSize() )
+    return false;
+  for(int iEdge=0; iEdge < a->GetXbins()->GetSize(); ++iEdge){
+    if( a->GetXbins()->At(iEdge) != b->GetXbins()->At(iEdge) )
+      return false;
+  }
+  if( a->GetLabels() || b->GetLabels() ){
+    for(int iBin=1; iBin <= a->GetNbins(); ++iBin){
+      if( std::string(a->GetBinLabel(iBin)) != std::string(b->GetBinLabel(iBin)) )
+        return false;
+    }
+  }
+  return true;
+}
+
+// The generic merge of ROOT handles different binnings and label orders
+bool addOrMerge( TH1* to, TH1* from ){
+  if( HistMerger::addHist( to, from ) )
+    return true;
+  TList list;
+  list.Add( from );
+  return to->Merge( &list ) >= 0;
+}
+
+}
+
+HistMerger :: HistMerger()
+{
+}
+
+HistMerger :: ~HistMerger()
+{
+  clear();
+}
+
+void HistMerger::clear(){
+  for( std::map< std::string, Entry >::iterator it = m_entries.begin(); it != m_entries.end(); ++it ){
+    delete it->second.object;
+    delete it->second.subDir;
+  }
+  m_entries.clear();
+  m_names.clear();
+}
+
+unsigned int HistMerger::numObjects() const {
+  unsigned int nObjects = 0;
+  for( std::map< std::string, Entry >::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it ){
+    if( it->second.subDir )
+      nObjects += it->second.subDir->numObjects();
+    else
+      ++nObjects;
+  }
+  return nObjects;
+}
+
+HistMerger* HistMerger::getSubDir( const std::string& name ){
+  std::map< std::string, Entry >::iterator it = m_entries.find( name );
+  if( it != m_entries.end() ){
+    if( !it->second.subDir )
+      cout << "HistMerger: " << name << " is both a directory and an object" << endl;
+    return it->second.subDir;
+  }
+  Entry thisEntry;
+  thisEntry.object = NULL;
+  thisEntry.subDir = new HistMerger();
+  m_entries[name] = thisEntry;
+  m_names.push_back( name );
+  return thisEntry.subDir;
+}
+
+bool HistMerger::add( TDirectory* dir, double scale ){
+  return addDirectory( dir, scale, true );
+}
+
+bool HistMerger::addDirectory( TDirectory* dir, double scale, bool topLevel ){
+  // Keys are sorted newest cycle first
+  std::set<std::string> seen;
+  TIter next( dir->GetListOfKeys() );
+  TKey* key;
+  while( (key = (TKey*) next()) ){
+    std::string name = key->GetName();
+    if( !seen.insert( name ).second )
+      continue;
+
+    TClass* thisClass = TClass::GetClass( key->GetClassName() );
+    if( thisClass && thisClass->InheritsFrom( TDirectory::Class() ) ){
+      TDirectory* inDir = dir->GetDirectory( name.c_str() );
+      HistMerger* subDir = getSubDir( name );
+      if( !inDir || !subDir || !subDir->addDirectory( inDir, scale, false ) )
+        return false;
+    }else if( thisClass && thisClass->InheritsFrom( TTree::Class() ) ){
+      cout << "HistMerger: " << name << " in " << dir->GetName() << " is a TTree, merge tree outputs with hadd" << endl;
+      return false;
+    }else{
+      TObject* object = key->ReadObj();
+      if( !object ){
+        cout << "HistMerger: could not read " << name << " in " << dir->GetName() << endl;
+        return false;
+      }
+      TH1* hist = dynamic_cast<TH1*>( object );
+      if( hist )
+        hist->SetDirectory(0);
+      bool f_unscaled = topLevel && (name.compare(0, 7, "cutflow") == 0 || MCNormalization::isMetadata( name ));
+      if( scale != 1. && !f_unscaled && !scaleObject( object, scale ) ){
+        cout << "HistMerger: cannot scale " << name << " of class " << object->ClassName() << endl;
+        delete object;
+        return false;
+      }
+      if( !addObject( name, object ) )
+        return false;
+    }
+  }
+  return true;
+}
+
+bool HistMerger::scaleObject( TObject* object, double scale ){
+  TH1* hist = dynamic_cast<TH1*>( object );
+  if( hist ){
+    hist->Scale( scale );
+    return true;
+  }
+  TH2DBootstrap* bootstrap = dynamic_cast<TH2DBootstrap*>( object );
+  if( bootstrap ){
+    const_cast<TH1*>( (const TH1*) bootstrap->GetNominal() )->Scale( scale );
+    for(int iReplica=0; iReplica < (int) bootstrap->GetNReplica(); ++iReplica)
+      const_cast<TH1*>( (const TH1*) bootstrap->GetReplica(iReplica) )->Scale( scale );
+    return true;
+  }
+  return false;
+}
+
+void HistMerger::removeNormalization(){
+  std::vector< std::string > names;
+  for(unsigned int iName=0; iName < m_names.size(); ++iName){
+    std::map< std::string, Entry >::iterator it = m_entries.find( m_names.at(iName) );
+    if( it->first.compare(0, MCNormalization::prefix.size(), MCNormalization::prefix) == 0 && !it->second.subDir ){
+      delete it->second.object;
+      m_entries.erase( it );
+    }else{
+      if( it->first == MCNormalization::sampleName && !it->second.subDir && dynamic_cast<TH1*>( it->second.object ) )
+        MCNormalization::setNormalized( (TH1*) it->second.object );
+      names.push_back( m_names.at(iName) );
+    }
+  }
+  m_names = names;
+}
+
+bool HistMerger::add( HistMerger& other ){
+  for(unsigned int iName=0; iName < other.m_names.size(); ++iName){
+    const std::string& name = other.m_names.at(iName);
+    Entry& otherEntry = other.m_entries[name];
+    if( otherEntry.subDir ){
+      HistMerger* subDir = getSubDir( name );
+      if( !subDir || !subDir->add( *otherEntry.subDir ) )
+        return false;
+    }else{
+      TObject* object = otherEntry.object;
+      otherEntry.object = NULL;
+      if( !addObject( name, object ) )
+        return false;
+    }
+  }
+  other.clear();
+  return true;
+}
+
+bool HistMerger::addObject( const std::string& name, TObject* object ){
+  std::map< std::string, Entry >::iterator it = m_entries.find( name );
+  if( it == m_entries.end() ){
+    Entry thisEntry;
+    thisEntry.object = object;
+    thisEntry.subDir = NULL;
+    m_entries[name] = thisEntry;
+    m_names.push_back( name );
+    return true;
+  }
+  if( it->second.subDir ){
+    cout << "HistMerger: " << name << " is both a directory and an object" << endl;
+    delete object;
+    return false;
+  }
+
+  TObject* existing = it->second.object;
+  bool f_added = true;
+  TH1* existingHist = dynamic_cast<TH1*>( existing );
+  TH1* hist = dynamic_cast<TH1*>( object );
+  TH2DBootstrap* existingBootstrap = dynamic_cast<TH2DBootstrap*>( existing );
+  TH2DBootstrap* bootstrap = dynamic_cast<TH2DBootstrap*>( object );
+  if( existingHist && hist ){
+    f_added = addOrMerge( existingHist, hist );
+  }else if( existingBootstrap && bootstrap ){
+    // The toys of every job are generated with the same number of replicas
+    int nReplica = existingBootstrap->GetNReplica();
+    if( nReplica != (int) bootstrap->GetNReplica() ){
+      cout << "HistMerger: " << name << " has " << nReplica << " and " << bootstrap->GetNReplica() << " replicas" << endl;
+      f_added = false;
+    }else{
+      f_added = addOrMerge( const_cast<TH1*>( (const TH1*) existingBootstrap->GetNominal() ), const_cast<TH1*>( (const TH1*) bootstrap->GetNominal() ) );
+      for(int iReplica=0; iReplica < nReplica && f_added; ++iReplica)
+        f_added = addOrMerge( const_cast<TH1*>( (const TH1*) existingBootstrap->GetReplica(iReplica) ), const_cast<TH1*>( (const TH1*) bootstrap->GetReplica(iReplica) ) );
+    }
+  }else if( existing->IsA() == object->IsA() && existing->IsA()->GetMerge() ){
+    TList list;
+    list.Add( object );
+    f_added = existing->IsA()->GetMerge()( existing, &list, NULL ) >= 0;
+  }
+  // Otherwise the first copy is kept
+
+  if( !f_added )
+    cout << "HistMerger: could not add " << name << " of class " << object->ClassName() << endl;
+  delete object;
+  return f_added;
+}
+
+bool HistMerger::addHist( TH1* to, const TH1* from ){
+  if( to->GetDimension() != from->GetDimension() || to->GetNcells() != from->GetNcells() )
+    return false;
+  if( !sameAxis( to->GetXaxis(), from->GetXaxis() ) )
+    return false;
+  if( to->GetDimension() > 1 && !sameAxis( to->GetYaxis(), from->GetYaxis() ) )
+    return false;
+  if( to->GetDimension() > 2 && !sameAxis( to->GetZaxis(), from->GetZaxis() ) )
+    return false;
+
+  // Profiles also carry the entries of each bin
+  if( to->InheritsFrom( TProfile::Class() ) || to->InheritsFrom( TProfile2D::Class() ) || to->InheritsFrom( TProfile3D::Class() )
+      || to->IsA() != from->IsA() )
+    return to->Add( from );
+
+  TArrayD* toD = dynamic_cast<TArrayD*>( to );
+  const TArrayD* fromD = dynamic_cast<const TArrayD*>( from );
+  TArrayF* toF = dynamic_cast<TArrayF*>( to );
+  const TArrayF* fromF = dynamic_cast<const TArrayF*>( from );
+  if( !(toD && fromD) && !(toF && fromF) )
+    return to->Add( from );
+
+  // Before any content changes, GetStats may recompute them from the bins
+  Double_t toStats[TH1::kNstat];
+  Double_t fromStats[TH1::kNstat];
+  std::fill( toStats, toStats+TH1::kNstat, 0. );
+  std::fill( fromStats, fromStats+TH1::kNstat, 0. );
+  to->GetStats( toStats );
+  from->GetStats( fromStats );
+  double entries = to->GetEntries() + from->GetEntries();
+
+  const int nCells = to->GetNcells();
+  if( from->GetSumw2N() > 0 && to->GetSumw2N() == 0 )
+    to->Sumw2();
+  if( to->GetSumw2N() > 0 ){
+    double* toSumw2 = to->GetSumw2()->GetArray();
+    if( from->GetSumw2N() > 0 ){
+      const double* fromSumw2 = from->GetSumw2()->GetArray();
+      for(int iCell=0; iCell < nCells; ++iCell)
+        toSumw2[iCell] += fromSumw2[iCell];
+    }else{
+      // Unit weights
+      for(int iCell=0; iCell < nCells; ++iCell)
+        toSumw2[iCell] += from->GetBinContent(iCell);
+    }
+  }
+
+  if( toD ){
+    double* toContent = toD->GetArray();
+    const double* fromContent = fromD->GetArray();
+    for(int iCell=0; iCell < nCells; ++iCell)
+      toContent[iCell] += fromContent[iCell];
+  }else{
+    float* toContent = toF->GetArray();
+    const float* fromContent = fromF->GetArray();
+    for(int iCell=0; iCell < nCells; ++iCell)
+      toContent[iCell] += fromContent[iCell];
+  }
+
+  for(int iStat=0; iStat < TH1::kNstat; ++iStat)
+    toStats[iStat] += fromStats[iStat];
+  to->PutStats( toStats );
+  to->SetEntries( entries );
+  return true;
+}
+
+bool HistMerger::write( TDirectory* dir ) const {
+  for(unsigned int iName=0; iName < m_names.size(); ++iName){
+    const std::string& name = m_names.at(iName);
+    const Entry& thisEntry = m_entries.find( name )->second;
+    if( thisEntry.subDir ){
+      TDirectory* outDir = dir->mkdir( name.c_str() );
+      if( !outDir || !thisEntry.subDir->write( outDir ) )
+        return false;
+    }else{
+      if( dir->WriteTObject( thisEntry.object, name.c_str() ) <= 0 ){
+        cout << "HistMerger: could not write " << name << " to " << dir->GetName() << endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
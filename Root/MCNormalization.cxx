@@ -0,0 +1,150 @@
+#include <iostream>
+#include <set>
+
+#include <TDirectory.h>
+#include <TKey.h>
+#include <TH1D.h>
+#include <TAxis.h>
+
+#include "MultijetBalance/MCNormalization.h"
+
+using namespace std;
+
+const std::string MCNormalization::prefix = "MJBNormalization_";
+const std::string MCNormalization::sampleName = "MJBSample";
+
+namespace {
+  const int nFields = 5;
+  const char* fieldNames[nFields] = { "nJobs", "numEvents", "sumOfWeights", "xs", "acceptance" };
+  const int nSampleFields = 3;
+  const char* sampleFieldNames[nSampleFields] = { "data", "MC", "normalizedMC" };
+}
+
+MCNormalization :: MCNormalization() :
+  m_nJobs(0.),
+  m_numEvents(0.),
+  m_sumOfWeights(0.),
+  m_xsSum(0.),
+  m_acceptanceSum(0.)
+{
+}
+
+TH1D* MCNormalization::makeHist( int mcChannelNumber ) const {
+  std::string name = prefix+to_string(mcChannelNumber);
+  TH1D* hist = new TH1D( name.c_str(), name.c_str(), nFields, 0, nFields );
+  for(int iField=0; iField < nFields; ++iField)
+    hist->GetXaxis()->SetBinLabel( iField+1, fieldNames[iField] );
+  hist->SetBinContent( 1, m_nJobs );
+  hist->SetBinContent( 2, m_numEvents );
+  hist->SetBinContent( 3, m_sumOfWeights );
+  hist->SetBinContent( 4, m_xsSum );
+  hist->SetBinContent( 5, m_acceptanceSum );
+  return hist;
+}
+
+bool MCNormalization::isMetadata( const std::string& name ){
+  return name.compare(0, prefix.size(), prefix) == 0 || name == sampleName;
+}
+
+TH1D* MCNormalization::makeSampleHist( bool isMC ){
+  TH1D* hist = new TH1D( sampleName.c_str(), sampleName.c_str(), nSampleFields, 0, nSampleFields );
+  for(int iField=0; iField < nSampleFields; ++iField)
+    hist->GetXaxis()->SetBinLabel( iField+1, sampleFieldNames[iField] );
+  hist->SetBinContent( isMC ? 2 : 1, 1 );
+  return hist;
+}
+
+void MCNormalization::setNormalized( TH1* sampleHist ){
+  sampleHist->SetBinContent( 3, sampleHist->GetBinContent(3)+sampleHist->GetBinContent(2) );
+  sampleHist->SetBinContent( 2, 0 );
+}
+
+bool MCNormalization::check( TDirectory* dir, const std::map< int, MCNormalization >& channels, bool requireSample ){
+  TH1* sampleHist = dynamic_cast<TH1*>( dir->Get( sampleName.c_str() ) );
+  if( !sampleHist ){
+    if( requireSample && channels.size() == 0 ){
+      cout << "MCNormalization: " << dir->GetName() << " has neither " << sampleName << " nor " << prefix << ", it cannot be told from data" << endl;
+      return false;
+    }
+    return true;
+  }
+  sampleHist->SetDirectory(0);
+  if( sampleHist->GetNbinsX() != nSampleFields ){
+    cout << "MCNormalization: " << sampleName << " in " << dir->GetName() << " is not a sample histogram" << endl;
+    delete sampleHist;
+    return false;
+  }
+  double nData = sampleHist->GetBinContent(1);
+  double nMC = sampleHist->GetBinContent(2);
+  double nNormalized = sampleHist->GetBinContent(3);
+  delete sampleHist;
+
+  double nNormJobs = 0.;
+  for( std::map< int, MCNormalization >::const_iterator it = channels.begin(); it != channels.end(); ++it )
+    nNormJobs += it->second.m_nJobs;
+
+  if( nData > 0. && nMC+nNormalized > 0. ){
+    cout << "MCNormalization: " << dir->GetName() << " sums " << nData << " data and " << nMC+nNormalized << " MC jobs" << endl;
+    return false;
+  }
+  if( nMC > 0. && nNormalized > 0. ){
+    cout << "MCNormalization: " << dir->GetName() << " sums " << nMC << " MC jobs with " << nNormalized << " already normalized ones" << endl;
+    return false;
+  }
+  if( nNormJobs != nMC ){
+    cout << "MCNormalization: " << dir->GetName() << " has " << prefix << " for " << nNormJobs << " of its " << nMC
+         << " unnormalized MC jobs, write the missing jobs again" << endl;
+    return false;
+  }
+  return true;
+}
+
+bool MCNormalization::read( TDirectory* dir, std::map< int, MCNormalization >& channels ){
+  std::set<std::string> seen;
+  TIter next( dir->GetListOfKeys() );
+  TKey* key;
+  while( (key = (TKey*) next()) ){
+    std::string name = key->GetName();
+    if( name.compare(0, prefix.size(), prefix) != 0 || !seen.insert( name ).second )
+      continue;
+
+    TH1D* hist = dynamic_cast<TH1D*>( key->ReadObj() );
+    if( !hist || hist->GetNbinsX() != nFields ){
+      cout << "MCNormalization: " << name << " in " << dir->GetName() << " is not a normalization histogram" << endl;
+      delete hist;
+      return false;
+    }
+    hist->SetDirectory(0);
+    int mcChannelNumber = 0;
+    try{
+      mcChannelNumber = std::stoi( name.substr( prefix.size() ) );
+    }catch( const std::exception& ){
+      cout << "MCNormalization: " << name << " has no channel number" << endl;
+      delete hist;
+      return false;
+    }
+
+    MCNormalization thisJob;
+    thisJob.m_nJobs = hist->GetBinContent(1);
+    thisJob.m_numEvents = hist->GetBinContent(2);
+    thisJob.m_sumOfWeights = hist->GetBinContent(3);
+    thisJob.m_xsSum = hist->GetBinContent(4);
+    thisJob.m_acceptanceSum = hist->GetBinContent(5);
+    channels[mcChannelNumber].add( thisJob );
+    delete hist;
+  }
+  return true;
+}
+
+void MCNormalization::add( const MCNormalization& other ){
+  m_nJobs += other.m_nJobs;
+  m_numEvents += other.m_numEvents;
+  m_sumOfWeights += other.m_sumOfWeights;
+  m_xsSum += other.m_xsSum;
+  m_acceptanceSum += other.m_acceptanceSum;
+}
+
+double MCNormalization::scale( bool bySumOfWeights ) const {
+  double norm = bySumOfWeights ? m_sumOfWeights : m_numEvents;
+  return norm != 0. ? 1./norm : 0.;
+}
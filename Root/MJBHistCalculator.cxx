@@ -0,0 +1,136 @@
+#include <iostream>
+
+#include <TFile.h>
+#include <TKey.h>
+#include <TDirectoryFile.h>
+#include <TH1.h>
+#include <TH2.h>
+
+#include "MultijetBalance/MJBHistCalculator.h"
+#include "MultijetBalance/BalanceMoments.h"
+
+using namespace std;
+
+void MJBHistOutput::write( TFile* appendedFile, TFile* correctionFile ){
+  appendedFile->mkdir(dirName.c_str());
+  TDirectoryFile* newDir = (TDirectoryFile*) appendedFile->Get(dirName.c_str());
+  newDir->cd();
+  for(unsigned int iObj=0; iObj < appended.size(); ++iObj){
+    appended.at(iObj)->Write();
+  }
+
+  correctionFile->mkdir(dirName.c_str());
+  TDirectoryFile* correctionDir = (TDirectoryFile*) correctionFile->Get(dirName.c_str());
+  correctionDir->cd();
+  for(unsigned int iH=0; iH < corrections.size(); ++iH){
+    corrections.at(iH)->Write();
+  }
+}
+
+void MJBHistOutput::clear(){
+  for(unsigned int iObj=0; iObj < appended.size(); ++iObj){
+    delete appended.at(iObj);
+  }
+  appended.clear();
+  corrections.clear();
+}
+
+MJBHistCalculator :: MJBHistCalculator( double scale ) :
+  m_scale(scale)
+{
+}
+
+MJBHistOutput* MJBHistCalculator::calculate( TFile* inFile, const std::string& keyName ) const {
+
+  TObject* topObject = inFile->Get( keyName.c_str() );
+  if( !topObject ){
+    cout << "Error, could not retrieve " << keyName << " from " << inFile->GetName() << endl;
+    return NULL;
+  }
+
+  MJBHistOutput* output = new MJBHistOutput();
+
+  // Without directory structure each top level histogram is one systematic
+  if( topObject->InheritsFrom( TH2::Class() ) ){
+    output->dirName = keyName;
+    std::size_t pos = output->dirName.find("_recoilPt_PtBal");
+    if( pos != std::string::npos )
+      output->dirName.erase(pos, 15);
+    ((TH1*) topObject)->SetDirectory(0);
+    addObject( output, topObject );
+    return output;
+  }
+
+  TDirectory* oldDir = dynamic_cast<TDirectory*>( topObject );
+  if( !oldDir ){
+    cout << "Error, " << keyName << " is neither a directory nor a 2D histogram" << endl;
+    delete topObject;
+    delete output;
+    return NULL;
+  }
+
+  output->dirName = keyName;
+  TIter next(oldDir->GetListOfKeys());
+  TKey *key;
+  while ((key = (TKey*)next() )){
+    // Only histograms and other objects are copied, as calculateMJBHists.py
+    if( std::string(key->GetClassName()).find("TDirectory") != std::string::npos )
+      continue;
+    TObject* object = key->ReadObj();
+    if( !object )
+      continue;
+    if( object->InheritsFrom( TH1::Class() ) )
+      ((TH1*) object)->SetDirectory(0);
+    addObject( output, object );
+  }
+
+  return output;
+}
+
+void MJBHistCalculator::addObject( MJBHistOutput* output, TObject* object ) const {
+
+  output->appended.push_back( object );
+  if( !object->InheritsFrom( TH1::Class() ) )
+    return;
+
+  TH1* hist = (TH1*) object;
+  if( m_scale != 1. )
+    hist->Scale( m_scale );
+
+  std::string histName = hist->GetName();
+  // Only exactly TH1F, as the type check of calculateMJBHists.py
+  if( hist->IsA() == TH1F::Class() ){
+    if( histName.find("Phi") != std::string::npos )
+      hist->Rebin(4);
+    if( histName.find("Beta") != std::string::npos )
+      hist->Rebin(2);
+  }
+
+  std::size_t pos = histName.find("recoilPt_PtBal");
+  if( pos == std::string::npos || !hist->InheritsFrom( TH2::Class() ) )
+    return;
+
+  TH1D* MJBcorrection = correction( (TH2*) hist, histName.substr(pos+14) );
+  output->appended.push_back( MJBcorrection );
+  output->corrections.push_back( MJBcorrection );
+}
+
+TH1D* MJBHistCalculator::correction( const TH2* h_recoilPt_PtBal, const std::string& tag ){
+
+  const TAxis* xAxis = h_recoilPt_PtBal->GetXaxis();
+  std::string histName = "MJB"+tag;
+  TH1D* MJBcorrection = NULL;
+  if( xAxis->GetXbins()->GetSize() > 0 )
+    MJBcorrection = new TH1D( histName.c_str(), ("MJBcorrection"+tag).c_str(), xAxis->GetNbins(), xAxis->GetXbins()->GetArray() );
+  else
+    MJBcorrection = new TH1D( histName.c_str(), ("MJBcorrection"+tag).c_str(), xAxis->GetNbins(), xAxis->GetXmin(), xAxis->GetXmax() );
+  MJBcorrection->SetDirectory(0);
+  MJBcorrection->GetXaxis()->SetTitle( xAxis->GetTitle() );
+  MJBcorrection->GetYaxis()->SetTitle( "p_{T}^{Jet 1}/p_{T}^{Recoil}" );
+
+  BalanceMoments moments( h_recoilPt_PtBal );
+  moments.fillMeans( MJBcorrection );
+  MJBcorrection->SetEntries( h_recoilPt_PtBal->GetEntries() );
+
+  return MJBcorrection;
+}
@@ -4,10 +4,14 @@
 #include "xAODEventInfo/EventInfo.h"
 
 #include "MultijetBalance/MiniTree.h"
+#include "MultijetBalance/AsyncTreeWriter.h"
 
 
 MiniTree :: MiniTree(xAOD::TEvent * event, TTree* tree, TFile* file) :
-  HelpTreeBase(event, tree, file, 1e3)
+  HelpTreeBase(event, tree, file, 1e3),
+  m_asyncWriter(NULL),
+  m_shared(false),
+  m_flatJets(false)
 {
   if ( m_debug ) Info("MiniTree", "Creating output TTree %s", tree->GetName());
 }
@@ -18,8 +22,16 @@ MiniTree :: ~MiniTree()
 
 void MiniTree::AddEventUser(std::string detailStringMJB)
 {
+  if( m_shared ){
+    m_tree->Branch("weight_xs", &m_weight_xs, "weight_xs/F");
+    m_tree->Branch("weight_mcEventWeight", &m_weight_mcEventWeight, "weight_mcEventWeight/F");
+    return;
+  }
+
   // event variables
-  m_tree->Branch("njet", &m_njet, "njet/I");
+  // njet is the count of the jet arrays with m_flatJets, booked with them
+  if( !m_flatJets )
+    m_tree->Branch("njet", &m_njet, "njet/I");
   m_tree->Branch("trig", &m_trig, "trig/I");
 //  m_tree->Branch("lumiBlock", &m_lumiBlock, "lumiBlock/I");
 
@@ -46,10 +58,8 @@ void MiniTree::AddEventUser(std::string detailStringMJB)
 
 }
 
-void MiniTree::AddJetsUser(const std::string detailStr, const std::string jetName)
+void MiniTree::ParseBTagNames( const std::string detailStr )
 {
-
-  std::cout << "AddJetsUser gives " << detailStr << std::endl;
   if (detailStr.find("MJBbTag_") != std::string::npos){
     std::string tmp = detailStr.substr(detailStr.find("MJBbTag_")+8, detailStr.size());
     tmp = tmp.substr(0, detailStr.find_last_of(' '));
@@ -58,15 +68,60 @@ void MiniTree::AddJetsUser(const std::string detailStr, const std::string jetNam
     std::string thisSubStr;
     while (std::getline(ssbtag, thisSubStr, ',')) {
       m_jet_BTagNames.push_back( thisSubStr );
-      std::vector<int> thisBTagBranch;
-      m_jet_BTagBranches.push_back( thisBTagBranch );
-      m_tree->Branch( ("jet_BTag_"+thisSubStr).c_str(), &m_jet_BTagBranches.at(m_jet_BTagBranches.size()-1) );
-      std::vector<float> thisBTagSFBranch;
-      m_jet_BTagSFBranches.push_back( thisBTagSFBranch );
-      m_tree->Branch( ("jet_BTagSF_"+thisSubStr).c_str(), &m_jet_BTagSFBranches.at(m_jet_BTagSFBranches.size()-1) );
-
     }
   }
+}
+
+void MiniTree::AddJets( const std::string detailStr, const std::string jetName )
+{
+  if( !m_flatJets ){
+    HelpTreeBase::AddJets( detailStr, jetName );
+    return;
+  }
+
+  // njet and fixed capacity arrays of the kinematics (GeV) and of the MJB variables, one pair of arrays per b-tag WP
+  m_tree->Branch("njet", &m_njet, "njet/I");
+  m_tree->Branch("jet_pt", m_flatJet_pt, "jet_pt[njet]/F");
+  m_tree->Branch("jet_eta", m_flatJet_eta, "jet_eta[njet]/F");
+  m_tree->Branch("jet_phi", m_flatJet_phi, "jet_phi[njet]/F");
+  m_tree->Branch("jet_E", m_flatJet_E, "jet_E[njet]/F");
+  m_tree->Branch("jet_detEta", m_flatJet_detEta, "jet_detEta[njet]/F");
+  m_tree->Branch("jet_corr", m_flatJet_corr, "jet_corr[njet]/F");
+  m_tree->Branch("jet_TileFrac", m_flatJet_TileFrac, "jet_TileFrac[njet]/F");
+  if( m_shared )
+    return;
+
+  m_tree->Branch("jet_beta", m_flatJet_beta, "jet_beta[njet]/F");
+
+  ParseBTagNames( detailStr );
+  m_flatJet_BTag.assign( m_jet_BTagNames.size(), std::vector<int>(maxJets, 0) );
+  m_flatJet_BTagSF.assign( m_jet_BTagNames.size(), std::vector<float>(maxJets, 0.) );
+  for(unsigned int iB=0; iB < m_jet_BTagNames.size(); ++iB){
+    std::string thisBTagName = m_jet_BTagNames.at(iB);
+    m_tree->Branch( ("jet_BTag_"+thisBTagName).c_str(), &m_flatJet_BTag.at(iB)[0], ("jet_BTag_"+thisBTagName+"[njet]/I").c_str() );
+    m_tree->Branch( ("jet_BTagSF_"+thisBTagName).c_str(), &m_flatJet_BTagSF.at(iB)[0], ("jet_BTagSF_"+thisBTagName+"[njet]/F").c_str() );
+  }
+}
+
+void MiniTree::AddJetsUser(const std::string detailStr, const std::string jetName)
+{
+
+  std::cout << "AddJetsUser gives " << detailStr << std::endl;
+  if( m_shared ){
+    m_tree->Branch("jet_detEta", &m_jet_detEta);
+    m_tree->Branch("jet_corr", &m_jet_corr);
+    m_tree->Branch("jet_TileFrac", &m_jet_TileFrac);
+    return;
+  }
+
+  ParseBTagNames( detailStr );
+  // Booked once all are known, a growing vector would move the branch addresses
+  m_jet_BTagBranches.resize( m_jet_BTagNames.size() );
+  m_jet_BTagSFBranches.resize( m_jet_BTagNames.size() );
+  for(unsigned int iB=0; iB < m_jet_BTagNames.size(); ++iB){
+    m_tree->Branch( ("jet_BTag_"+m_jet_BTagNames.at(iB)).c_str(), &m_jet_BTagBranches.at(iB) );
+    m_tree->Branch( ("jet_BTagSF_"+m_jet_BTagNames.at(iB)).c_str(), &m_jet_BTagSFBranches.at(iB) );
+  }
 
   // jet things
   m_tree->Branch("jet_detEta", &m_jet_detEta);
@@ -90,9 +145,12 @@ void MiniTree::FillEventUser( const xAOD::EventInfo* eventInfo ) {
 //  m_actualInteractionsPerCrossing = eventInfo->actualInteractionsPerCrossing();
 //  m_averageInteractionsPerCrossing = eventInfo->averageInteractionsPerCrossing();
 
-  m_weight = eventInfo->auxdecor< float >( "weight" );
   m_weight_xs = eventInfo->auxdecor< float >( "weight_xs" );
   m_weight_mcEventWeight = eventInfo->auxdecor< float >( "weight_mcEventWeight" );
+  if( m_shared )
+    return;
+
+  m_weight = eventInfo->auxdecor< float >( "weight" );
   m_weight_prescale = eventInfo->auxdecor< float >( "weight_prescale" );
 
   m_ptAsym = eventInfo->auxdecor< float >( "ptAsym" );
@@ -122,6 +180,20 @@ void MiniTree::FillJetsUser( const xAOD::Jet* jet, const std::string ) {
     m_jet_detEta.push_back( -999 );
   }
 
+  if( m_shared ){
+    if (jet->isAvailable< float >( "jetCorr" ) ){
+      m_jet_corr.push_back( jet->auxdata< float >("jetCorr") );
+    }else{
+      m_jet_corr.push_back( -999 );
+    }
+    if (jet->isAvailable< float >( "TileFrac" ) ){
+      m_jet_TileFrac.push_back( jet->auxdata< float >("TileFrac") );
+    }else{
+      m_jet_TileFrac.push_back( -999 );
+    }
+    return;
+  }
+
   if (jet->isAvailable< float >( "beta" ) ){
     m_jet_beta.push_back( jet->auxdata< float >("beta") );
   }else{
@@ -150,7 +222,7 @@ void MiniTree::FillJetsUser( const xAOD::Jet* jet, const std::string ) {
 
 
 
-  for(int iB=0; iB < m_jet_BTagNames.size(); ++iB){
+  for(unsigned int iB=0; iB < m_jet_BTagNames.size(); ++iB){
     std::string thisBTagName = m_jet_BTagNames.at(iB);
 
   
@@ -176,6 +248,67 @@ void MiniTree::FillJetsUser( const xAOD::Jet* jet, const std::string ) {
 
 }
 
+void MiniTree::FillSelectedJets( const std::vector< xAOD::Jet* >& jets, const std::string jetName ) {
+
+  m_njet = jets.size();
+  if( m_flatJets ){
+    FillFlatJets( jets );
+    return;
+  }
+
+  this->ClearJets( jetName );
+  for( unsigned int iJet=0; iJet < jets.size(); ++iJet ){
+    this->FillJet( jets.at(iJet), NULL, -1, jetName );
+  }
+
+}
+
+namespace {
+  template< typename T >
+  T decoration( const xAOD::Jet* jet, const std::string& name ){
+    if( jet->isAvailable< T >( name ) )
+      return jet->auxdata< T >( name );
+    return -999;
+  }
+}
+
+void MiniTree::FillFlatJets( const std::vector< xAOD::Jet* >& jets ) {
+
+  // Jets beyond the capacity of the arrays are dropped
+  m_njet = std::min( (int) jets.size(), maxJets );
+  for( int iJet=0; iJet < m_njet; ++iJet ){
+    const xAOD::Jet* jet = jets.at(iJet);
+    m_flatJet_pt[iJet] = jet->pt() / m_units;
+    m_flatJet_eta[iJet] = jet->eta();
+    m_flatJet_phi[iJet] = jet->phi();
+    m_flatJet_E[iJet] = jet->e() / m_units;
+    m_flatJet_detEta[iJet] = decoration< float >( jet, "detEta" );
+    m_flatJet_corr[iJet] = decoration< float >( jet, "jetCorr" );
+    m_flatJet_TileFrac[iJet] = decoration< float >( jet, "TileFrac" );
+    if( m_shared )
+      continue;
+
+    m_flatJet_beta[iJet] = decoration< float >( jet, "beta" );
+    for(unsigned int iB=0; iB < m_jet_BTagNames.size(); ++iB){
+      m_flatJet_BTag.at(iB)[iJet] = decoration< int >( jet, "BTag_"+m_jet_BTagNames.at(iB)+"Fixed" );
+      m_flatJet_BTagSF.at(iB)[iJet] = decoration< float >( jet, "BTagSF_"+m_jet_BTagNames.at(iB)+"Fixed" );
+    }
+  }
+
+}
+
+void MiniTree::SetAsyncWriter( AsyncTreeWriter* writer ) {
+  // Trees that cannot be attached still go through writer, which keeps them off the file while it writes
+  writer->attach( m_tree, maxJets );
+  m_asyncWriter = writer;
+}
+
+void MiniTree::Fill() {
+  if( m_asyncWriter )
+    m_asyncWriter->fill( m_tree );
+  else
+    HelpTreeBase::Fill();
+}
 
 void MiniTree::ClearEventUser() {
 }
@@ -188,7 +321,7 @@ void MiniTree::ClearJetsUser(const std::string jetName ) {
 //  m_jet_HECFrac.clear();
   m_jet_TileFrac.clear();
 //  m_jet_EnergyPerSampling.clear();
-  for(int iB=0; iB < m_jet_BTagNames.size(); ++iB){
+  for(unsigned int iB=0; iB < m_jet_BTagNames.size(); ++iB){
     m_jet_BTagBranches.at(iB).clear();
     m_jet_BTagSFBranches.at(iB).clear();
   }
@@ -0,0 +1,459 @@
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#include <TTree.h>
+#include <TBranch.h>
+#include <TLeaf.h>
+#include <TDirectory.h>
+#include <TH1F.h>
+#include <TH2F.h>
+#include <TMath.h>
+#include <TLorentzVector.h>
+#include <TList.h>
+#include <TObjString.h>
+
+#include "MultijetBalance/MiniTreeHists.h"
+#include "MultijetBalance/VariationPayload.h"
+
+using namespace std;
+
+MiniTreeEvent :: MiniTreeEvent() :
+  flatJets(false),
+  njet(0), weight(0.),
+  ptAsym(0.), alpha(0.), avgBeta(0.), ptBal(0.),
+  recoilPt(0.), recoilEta(0.), recoilPhi(0.), recoilM(0.), recoilE(0.),
+  jet_pt(NULL), jet_eta(NULL), jet_phi(NULL), jet_E(NULL),
+  jet_detEta(NULL), jet_beta(NULL), jet_TileFrac(NULL),
+  jet_EMFrac(NULL), jet_HECFrac(NULL)
+{
+}
+
+bool MiniTreeEvent::connect( TTree* tree ){
+  const char* required[] = { "weight", "ptAsym", "alpha", "avgBeta", "ptBal",
+                             "recoilPt", "recoilEta", "recoilPhi", "recoilM", "recoilE",
+                             "jet_pt", "jet_eta", "jet_phi", "jet_E", "jet_detEta", "jet_beta", "jet_TileFrac" };
+  for( const char* branchName : required ){
+    if( !tree->GetBranch( branchName ) ){
+      cout << "Error, " << tree->GetName() << " has no branch " << branchName << endl;
+      return false;
+    }
+  }
+
+  // m_flatJetBranches trees hold jet_pt[njet] arrays instead of vectors
+  TLeaf* ptLeaf = tree->GetBranch("jet_pt")->GetLeaf("jet_pt");
+  flatJets = ptLeaf && ptLeaf->GetLeafCount();
+
+  tree->SetBranchStatus("*", 0);
+  for( const char* branchName : required )
+    tree->SetBranchStatus( branchName, 1 );
+
+  if( flatJets ){
+    tree->SetBranchStatus("njet", 1);
+    tree->SetBranchAddress("njet", &njet);
+  }
+  tree->SetBranchAddress("weight", &weight);
+  tree->SetBranchAddress("ptAsym", &ptAsym);
+  tree->SetBranchAddress("alpha", &alpha);
+  tree->SetBranchAddress("avgBeta", &avgBeta);
+  tree->SetBranchAddress("ptBal", &ptBal);
+  tree->SetBranchAddress("recoilPt", &recoilPt);
+  tree->SetBranchAddress("recoilEta", &recoilEta);
+  tree->SetBranchAddress("recoilPhi", &recoilPhi);
+  tree->SetBranchAddress("recoilM", &recoilM);
+  tree->SetBranchAddress("recoilE", &recoilE);
+
+  std::vector< std::pair< std::string, std::vector<float>** > > jetBranches = {
+    {"jet_pt", &jet_pt}, {"jet_eta", &jet_eta}, {"jet_phi", &jet_phi}, {"jet_E", &jet_E},
+    {"jet_detEta", &jet_detEta}, {"jet_beta", &jet_beta}, {"jet_TileFrac", &jet_TileFrac} };
+  if( tree->GetBranch("jet_EMFrac") && tree->GetBranch("jet_HECFrac") ){
+    tree->SetBranchStatus("jet_EMFrac", 1);
+    tree->SetBranchStatus("jet_HECFrac", 1);
+    jetBranches.push_back( std::make_pair( std::string("jet_EMFrac"), &jet_EMFrac ) );
+    jetBranches.push_back( std::make_pair( std::string("jet_HECFrac"), &jet_HECFrac ) );
+  }
+
+  // The arrays are copied into vectors by update(), so that the jets are read the same way for both layouts
+  m_flatArrays.assign( flatJets ? jetBranches.size() : 0, std::vector<float>(maxJets, 0.) );
+  m_flatVectors.assign( flatJets ? jetBranches.size() : 0, std::vector<float>() );
+  for(unsigned int iB=0; iB < jetBranches.size(); ++iB){
+    if( flatJets ){
+      tree->SetBranchAddress( jetBranches.at(iB).first.c_str(), &m_flatArrays.at(iB)[0] );
+      *(jetBranches.at(iB).second) = &m_flatVectors.at(iB);
+    }else{
+      tree->SetBranchAddress( jetBranches.at(iB).first.c_str(), jetBranches.at(iB).second );
+    }
+  }
+
+  return true;
+}
+
+void MiniTreeEvent::update(){
+  // The njet branch of vector trees was not filled before m_flatJetBranches was added
+  if( !flatJets ){
+    njet = jet_pt->size();
+    return;
+  }
+  int numJets = std::max( 0, std::min( njet, maxJets ) );
+  for(unsigned int iB=0; iB < m_flatArrays.size(); ++iB)
+    m_flatVectors[iB].assign( m_flatArrays[iB].begin(), m_flatArrays[iB].begin()+numJets );
+}
+
+MiniTreeVariations :: MiniTreeVariations() :
+  nVar(0)
+{
+}
+
+std::vector<std::string> MiniTreeVariations::names( TTree* tree ){
+  std::vector<std::string> sysVarNames;
+  TIter next( tree->GetUserInfo() );
+  TObject* thisObject;
+  while(( thisObject = next() )){
+    TObjString* thisName = dynamic_cast<TObjString*>( thisObject );
+    if( thisName )
+      sysVarNames.push_back( thisName->GetName() );
+  }
+  return sysVarNames;
+}
+
+bool MiniTreeVariations::connect( TTree* tree ){
+  const char* required[] = { "passMask", "recoilPt", "ptBal", "weight", "njet" };
+  for( const char* branchName : required ){
+    if( !tree->GetBranch( branchName ) ){
+      cout << "Error, " << tree->GetName() << " has no branch " << branchName << endl;
+      return false;
+    }
+  }
+
+  nVar = names( tree ).size();
+  if( nVar == 0 ){
+    cout << "Error, " << tree->GetName() << " has no variation names in its UserInfo" << endl;
+    return false;
+  }
+
+  // Fixed size arrays, as booked by VariationPayload
+  passMask.assign( (nVar+63)/64, 0 );
+  recoilPt.assign( nVar, 0. );
+  ptBal.assign( nVar, 0. );
+  weight.assign( nVar, 0. );
+  njet.assign( nVar, 0 );
+
+  tree->SetBranchStatus("*", 0);
+  for( const char* branchName : required )
+    tree->SetBranchStatus( branchName, 1 );
+  tree->SetBranchAddress("passMask", &passMask[0]);
+  tree->SetBranchAddress("recoilPt", &recoilPt[0]);
+  tree->SetBranchAddress("ptBal", &ptBal[0]);
+  tree->SetBranchAddress("weight", &weight[0]);
+  tree->SetBranchAddress("njet", &njet[0]);
+
+  return true;
+}
+
+bool MiniTreeVariations::get( unsigned int iVar, MiniTreeEvent& event ) const {
+  if( iVar >= nVar || !VariationPayload::passed( &passMask[0], iVar ) )
+    return false;
+  event.recoilPt = recoilPt[iVar];
+  event.ptBal = ptBal[iVar];
+  event.weight = weight[iVar];
+  event.njet = njet[iVar];
+  return true;
+}
+
+bool MiniTreeSelection::pass( const MiniTreeEvent& event ) const {
+  if( ptAsym >= 0. && event.ptAsym > ptAsym )
+    return false;
+
+  if( alpha >= 0. && (M_PI-event.alpha) > alpha )
+    return false;
+
+  if( beta >= 0. ){
+    // As the beta selection of MultijetBalanceAlgo
+    float leadJetPt = event.jet_pt->at(0);
+    float smallestBeta = 10.;
+    for(unsigned int iJet=1; iJet < event.jet_pt->size(); ++iJet){
+      float thisBeta = event.jet_beta->at(iJet);
+      if( allJetBeta )
+        smallestBeta = thisBeta;
+      else if( (thisBeta < smallestBeta) && (event.jet_pt->at(iJet) > leadJetPt*0.25) )
+        smallestBeta = thisBeta;
+    }
+    if( smallestBeta < beta )
+      return false;
+  }
+
+  return true;
+}
+
+MiniTreeHists :: MiniTreeHists( const std::vector<double>& binning, bool minimal ) :
+  m_minimal(minimal),
+  m_numSavedJets(6)
+{
+  int numBins = binning.size()-1;
+  const double* binArray = &binning[0];
+
+  // pt balance binnings
+  Double_t ptBalBins[501];
+  int numPtBalBins = 500;
+  for(int i=0; i < numPtBalBins+1; ++i){
+    ptBalBins[i] = i/100.;
+  }
+
+  m_recoilPt_ptBal = book("recoilPt_PtBal",
+          "Recoil System p_{T} [GeV]", numBins, binArray,
+          "p_{T} Balance", numPtBalBins, ptBalBins);
+  if( m_minimal )
+    return;
+
+  for(int iJet=0; iJet < m_numSavedJets; ++iJet){
+    std::string jetNum = to_string(iJet);
+    m_MJBNjetsPt.push_back(       book("jetPt_jet"+jetNum,       "jet p_{T} [GeV]", 400, 0, 4000. ) );
+    m_MJBNjetsEta.push_back(      book("jetEta_jet"+jetNum,      "jet_{"+jetNum+"} #eta", 80, -4., 4.) );
+    m_MJBNjetsPhi.push_back(      book("jetPhi_jet"+jetNum,      "jet_{"+jetNum+"} #phi",60, -TMath::Pi(), TMath::Pi() ) );
+    m_MJBNjetsM.push_back(        book("jetMass_jet"+jetNum,     "jet_{"+jetNum+"} Mass [GeV]", 80, 0, 400.) );
+    m_MJBNjetsE.push_back(        book("jetEnergy_jet"+jetNum,   "jet_{"+jetNum+"} Energy [GeV]", 100, 0, 3000.) );
+    m_MJBNjetsRapidity.push_back( book("jetRapidity_jet"+jetNum, "jet Rapidity",80, -4., 4.) );
+    m_MJBNjetsBeta.push_back(     book("jetBeta_jet"+jetNum,     "jet_{"+jetNum+"} #beta", 90, 1.6, 3.15) );
+  }
+
+  m_avgBeta = book("avgBeta", "Average Beta Angle", 90, 1.6, 3.15);
+  m_alpha = book("alpha", "Alpha Angle", 80, 2.74, 3.15);
+  m_njet = book("njet", "Number of Jets", 12, 0., 12.);
+  m_ptAsym = book("ptAsym", "p_{T} Asymmetry", 90, 0., 0.9);
+  m_ptBal = book("ptBal", " p_{T} Balance", 80, 0., 4.);
+  m_ptAsym_njet = book("ptAsym_njet",
+          "p_{T} Asymmetry", 90, 0., 0.9,
+          "Number of Jets", 12, 0., 12.);
+
+  m_recoilEta = book("recoilEta", "Recoil System #eta", 80, -4., 4.);
+  m_recoilPhi = book("recoilPhi", "Recoil System #phi", 60, -TMath::Pi(), TMath::Pi());
+  m_recoilM = book("recoilM", "Recoil System Mass (GeV)", 100, 0, 3000.);
+  m_recoilE = book("recoilE", "Recoil System Energy (GeV)", 100, 0., 3000.);
+  m_subOverRecoilPt = book("subOverRecoilPt", "Subleading Jet p_{T} / Recoil System p_{T}", 100, 0., 1.);
+  m_recoilPt_center = book("recoilPt_center", "Recoil System p_{T}", 200, 0, 4000.);
+
+  m_recoilPt = book("recoilPt", "Recoil System p_{T} (GeV)", numBins, binArray);
+
+  m_recoilPt_jet0Pt = book("recoilPt_leadJetPt",
+          "Recoil System p_{T} [GeV]", numBins, binArray,
+          "Leading Jet p_{T} [GeV]", 400, 0, 4000. );
+  m_recoilPt_jet1Pt = book("recoilPt_jet1Pt",
+          "Recoil System p_{T} [GeV]", numBins, binArray,
+          "Subleading Jet p_{T} [GeV]", 300, 0, 3000);
+  m_recoilPt_avgBeta = book("recoilPt_avgBeta",
+          "Recoil System p_{T} [GeV]", numBins, binArray,
+          "Average #beta", 90, 1.6, 3.15);
+  m_recoilPt_alpha = book("recoilPt_alpha",
+          "Recoil System p_{T} [GeV]", numBins, binArray,
+          "Alpha", 80, 2.74, 3.15);
+  m_recoilPt_njet = book("recoilPt_njet",
+          "Recoil System p_{T} [GeV]", numBins, binArray,
+          "Number of Jets", 12, 0., 12.);
+
+  m_leadJetPt_jet1Pt = book("leadJetPt_jet1Pt",
+          "Leading Jet p_{T} [GeV]", 400, 0, 4000.,
+          "Subleading Jet p_{T} [GeV]", 300, 0, 3000. );
+  m_leadJetPt_avgBeta = book("leadJetPt_avgBeta",
+          "Leading Jet p_{T} [GeV]", 400, 0, 4000.,
+          "Average #beta", 90, 1.6, 3.15);
+  m_leadJetPt_alpha = book("leadJetPt_alpha",
+          "Leading Jet p_{T} [GeV]", 400, 0, 4000.,
+          "Alpha", 80, 2.74, 3.15);
+  m_leadJetPt_njet = book("leadJetPt_njet",
+          "Leading Jet p_{T} [GeV]", 400, 0, 4000.,
+          "Number of Jets", 12, 0., 12.);
+
+  m_leadJetPt_ptBal = book("leadJetPt_PtBal",
+          "Leading Jet p_{T} [GeV]", 400, 0, 4000.,
+          "p_{T} Balance",  numPtBalBins, ptBalBins);
+
+  m_recoilPt_ptBal_eta1 = book("recoilPt_PtBal_eta1",
+          "Recoil System p_{T} [GeV]", numBins, binArray,
+          "p_{T} Balance", numPtBalBins, ptBalBins);
+  m_recoilPt_ptBal_eta2 = book("recoilPt_PtBal_eta2",
+          "Recoil System p_{T} [GeV]", numBins, binArray,
+          "Inverse  p_{T} Balance", numPtBalBins, ptBalBins);
+  m_recoilPt_ptBal_eta3 = book("recoilPt_PtBal_eta3",
+          "Recoil System p_{T} [GeV]", numBins, binArray,
+          "p_{T} Balance", numPtBalBins, ptBalBins);
+
+  m_leadJetPt_EMFrac = book("leadJetPt_EMFrac",
+          "Leading Jet p_{T} [GeV]", 400, 0, 4000.,
+          "EMFrac", 100, 0., 1.);
+  m_recoilPt_EMFrac = book("recoilPt_EMFrac",
+          "Recoil System p_{T} [GeV]", numBins, binArray,
+          "EMFrac", 100, 0., 1.);
+  m_leadJetPt_HECFrac = book("leadJetPt_HECFrac",
+          "Leading Jet p_{T} [GeV]", 400, 0, 4000.,
+          "HECFrac", 100, 0., 1.);
+  m_recoilPt_HECFrac = book("recoilPt_HECFrac",
+          "Recoil System p_{T} [GeV]", numBins, binArray,
+          "HECFrac", 100, 0., 1.);
+  m_leadJetPt_TileFrac = book("leadJetPt_TileFrac",
+          "Leading Jet p_{T} [GeV]", 400, 0, 4000.,
+          "TileFrac", 100, 0., 1.);
+  m_recoilPt_TileFrac = book("recoilPt_TileFrac",
+          "Recoil System p_{T} [GeV]", numBins, binArray,
+          "TileFrac", 100, 0., 1.);
+}
+
+MiniTreeHists :: ~MiniTreeHists()
+{
+  for(unsigned int iH=0; iH < m_hists.size(); ++iH)
+    delete m_hists.at(iH);
+}
+
+TH1F* MiniTreeHists::book( const std::string& name, const std::string& xlabel, int xbins, double xlow, double xhigh ){
+  TH1F* histo = new TH1F( name.c_str(), name.c_str(), xbins, xlow, xhigh );
+  histo->SetDirectory(0);
+  histo->GetXaxis()->SetTitle( xlabel.c_str() );
+  histo->Sumw2();
+  m_hists.push_back( histo );
+  return histo;
+}
+
+TH1F* MiniTreeHists::book( const std::string& name, const std::string& xlabel, int xbins, const double* xbinArray ){
+  TH1F* histo = new TH1F( name.c_str(), name.c_str(), xbins, xbinArray );
+  histo->SetDirectory(0);
+  histo->GetXaxis()->SetTitle( xlabel.c_str() );
+  histo->Sumw2();
+  m_hists.push_back( histo );
+  return histo;
+}
+
+TH2F* MiniTreeHists::book( const std::string& name, const std::string& xlabel, int xbins, const double* xbinArray,
+                           const std::string& ylabel, int ybins, double ylow, double yhigh ){
+  TH2F* histo = new TH2F( name.c_str(), name.c_str(), xbins, xbinArray, ybins, ylow, yhigh );
+  histo->SetDirectory(0);
+  histo->GetXaxis()->SetTitle( xlabel.c_str() );
+  histo->GetYaxis()->SetTitle( ylabel.c_str() );
+  histo->Sumw2();
+  m_hists.push_back( histo );
+  return histo;
+}
+
+TH2F* MiniTreeHists::book( const std::string& name, const std::string& xlabel, int xbins, double xlow, double xhigh,
+                           const std::string& ylabel, int ybins, double ylow, double yhigh ){
+  TH2F* histo = new TH2F( name.c_str(), name.c_str(), xbins, xlow, xhigh, ybins, ylow, yhigh );
+  histo->SetDirectory(0);
+  histo->GetXaxis()->SetTitle( xlabel.c_str() );
+  histo->GetYaxis()->SetTitle( ylabel.c_str() );
+  histo->Sumw2();
+  m_hists.push_back( histo );
+  return histo;
+}
+
+TH2F* MiniTreeHists::book( const std::string& name, const std::string& xlabel, int xbins, const double* xbinArray,
+                           const std::string& ylabel, int ybins, const double* ybinArray ){
+  TH2F* histo = new TH2F( name.c_str(), name.c_str(), xbins, xbinArray, ybins, ybinArray );
+  histo->SetDirectory(0);
+  histo->GetXaxis()->SetTitle( xlabel.c_str() );
+  histo->GetYaxis()->SetTitle( ylabel.c_str() );
+  histo->Sumw2();
+  m_hists.push_back( histo );
+  return histo;
+}
+
+TH2F* MiniTreeHists::book( const std::string& name, const std::string& xlabel, int xbins, double xlow, double xhigh,
+                           const std::string& ylabel, int ybins, const double* ybinArray ){
+  TH2F* histo = new TH2F( name.c_str(), name.c_str(), xbins, xlow, xhigh, ybins, ybinArray );
+  histo->SetDirectory(0);
+  histo->GetXaxis()->SetTitle( xlabel.c_str() );
+  histo->GetYaxis()->SetTitle( ylabel.c_str() );
+  histo->Sumw2();
+  m_hists.push_back( histo );
+  return histo;
+}
+
+void MiniTreeHists::fill( const MiniTreeEvent& event ){
+
+  float recoilJetPt = event.recoilPt/1e3;
+  float thisPtBal = event.ptBal;
+  float eventWeight = event.weight;
+
+  if( m_minimal ){
+    m_recoilPt_ptBal->Fill(recoilJetPt, thisPtBal, eventWeight);
+    return;
+  }
+
+  const std::vector<float>& jetPt = *event.jet_pt;
+  float leadJetPt = jetPt.at(0);
+
+  /////////////////// Fill individual Jet Hists //////////////////////////
+  int numJets = std::min( m_numSavedJets, (int)jetPt.size() );
+  for(int iJet=0; iJet < numJets; ++iJet){
+    TLorentzVector thisJet;
+    thisJet.SetPtEtaPhiE( jetPt.at(iJet), event.jet_eta->at(iJet), event.jet_phi->at(iJet), event.jet_E->at(iJet) );
+    m_MJBNjetsPt.at(iJet)->        Fill( jetPt.at(iJet),            eventWeight);
+    m_MJBNjetsEta.at(iJet)->       Fill( event.jet_eta->at(iJet),   eventWeight);
+    m_MJBNjetsPhi.at(iJet)->       Fill( event.jet_phi->at(iJet),   eventWeight);
+    m_MJBNjetsM.at(iJet)->         Fill( thisJet.M(),               eventWeight);
+    m_MJBNjetsE.at(iJet)->         Fill( event.jet_E->at(iJet),     eventWeight);
+    m_MJBNjetsBeta.at(iJet)->      Fill( event.jet_beta->at(iJet),  eventWeight);
+  }
+
+  m_recoilEta->Fill( event.recoilEta, eventWeight);
+  m_recoilPhi->Fill( event.recoilPhi, eventWeight);
+  m_recoilM->Fill( event.recoilM/1e3, eventWeight);
+  m_recoilE->Fill( event.recoilE/1e3, eventWeight);
+  m_recoilPt_center->Fill( recoilJetPt, eventWeight);
+  m_subOverRecoilPt->Fill( jetPt.at(1)/recoilJetPt, eventWeight);
+
+  m_avgBeta->Fill(event.avgBeta, eventWeight);
+  m_alpha->Fill(event.alpha, eventWeight);
+  m_njet->Fill(event.njet, eventWeight);
+  m_ptAsym->Fill(event.ptAsym, eventWeight);
+  m_ptBal->Fill(thisPtBal, eventWeight);
+
+  m_ptAsym_njet->Fill(event.ptAsym, event.njet, eventWeight);
+
+  ///// For Pt Binned Histograms //////
+  m_recoilPt->Fill( recoilJetPt, eventWeight);
+
+  m_recoilPt_jet0Pt      ->Fill(recoilJetPt, leadJetPt, eventWeight);
+  m_recoilPt_jet1Pt      ->Fill(recoilJetPt, jetPt.at(1), eventWeight);
+  m_recoilPt_avgBeta     ->Fill(recoilJetPt, event.avgBeta, eventWeight);
+  m_recoilPt_alpha       ->Fill(recoilJetPt, event.alpha, eventWeight);
+  m_recoilPt_njet        ->Fill(recoilJetPt, event.njet, eventWeight);
+
+  m_leadJetPt_jet1Pt      ->Fill(leadJetPt, jetPt.at(1), eventWeight);
+  m_leadJetPt_avgBeta     ->Fill(leadJetPt, event.avgBeta, eventWeight);
+  m_leadJetPt_alpha       ->Fill(leadJetPt, event.alpha, eventWeight);
+  m_leadJetPt_njet        ->Fill(leadJetPt, event.njet, eventWeight);
+
+  m_recoilPt_ptBal ->Fill(recoilJetPt, thisPtBal, eventWeight);
+  m_leadJetPt_ptBal ->Fill(leadJetPt, thisPtBal, eventWeight);
+
+  float leadDetEta = fabs( event.jet_detEta->at(0) );
+  if( leadDetEta <= 0.4 ) {
+    m_recoilPt_ptBal_eta1->Fill(recoilJetPt, thisPtBal, eventWeight);
+  }else if( leadDetEta <= 0.8 ) {
+    m_recoilPt_ptBal_eta2->Fill(recoilJetPt, thisPtBal, eventWeight);
+  }else if( leadDetEta <= 1.2 ) {
+    m_recoilPt_ptBal_eta3->Fill(recoilJetPt, thisPtBal, eventWeight);
+  }
+
+  if( event.jet_EMFrac ){
+    m_recoilPt_EMFrac   ->Fill( recoilJetPt, event.jet_EMFrac->at(0), eventWeight );
+    m_recoilPt_HECFrac  ->Fill( recoilJetPt, event.jet_HECFrac->at(0), eventWeight );
+    m_leadJetPt_EMFrac     ->Fill( leadJetPt, event.jet_EMFrac->at(0), eventWeight );
+    m_leadJetPt_HECFrac    ->Fill( leadJetPt, event.jet_HECFrac->at(0), eventWeight );
+  }
+  m_recoilPt_TileFrac ->Fill( recoilJetPt, event.jet_TileFrac->at(0), eventWeight);
+  m_leadJetPt_TileFrac ->Fill( leadJetPt, event.jet_TileFrac->at(0), eventWeight);
+}
+
+void MiniTreeHists::add( const MiniTreeHists& other ){
+  for(unsigned int iH=0; iH < m_hists.size(); ++iH)
+    m_hists.at(iH)->Add( other.m_hists.at(iH) );
+}
+
+void MiniTreeHists::write( TDirectory* dir, const std::string& prefix ) const {
+  dir->cd();
+  for(unsigned int iH=0; iH < m_hists.size(); ++iH)
+    m_hists.at(iH)->Write( (prefix+m_hists.at(iH)->GetName()).c_str() );
+}
+
+double MiniTreeHists::entries() const {
+  return m_recoilPt_ptBal->GetEntries();
+}
@@ -2,6 +2,8 @@
 #include <EventLoop/Job.h>
 #include <EventLoop/Worker.h>
 #include "EventLoop/OutputStream.h"
+#include <SampleHandler/MetaFields.h>
+#include <SampleHandler/MetaObject.h>
 
 // EDM include(s):
 #include "AthContainers/ConstDataVector.h"
@@ -39,6 +41,10 @@
 #include <xAODAnaHelpers/tools/ReturnCheckConfig.h>
 
 #include "SystTool/SystContainer.h"
+#include "MultijetBalance/EventCache.h"
+#include "MultijetBalance/AsyncTreeWriter.h"
+#include "MultijetBalance/VariationPayload.h"
+#include "MultijetBalance/MCNormalization.h"
 
 
 using namespace std;
@@ -80,6 +86,9 @@ MultijetBalanceAlgo :: MultijetBalanceAlgo (std::string name) :
   m_reverseSubleading = false;
   m_writeTree = false;
   m_writeNominalTree = false;
+  m_asyncTreeWriter = false;
+  m_compactTree = false;
+  m_flatJetBranches = false;
   m_MJBDetailStr = "";
   m_eventDetailStr = "";
   m_jetDetailStr = "";
@@ -93,6 +102,25 @@ MultijetBalanceAlgo :: MultijetBalanceAlgo (std::string name) :
   m_systTool_nToys = 100;
   m_binning = "";
   m_VjetCalibFile = "";
+  m_writeEventCache = false;
+  m_eventCacheDir = "";
+  m_writeEventList = false;
+  m_eventListDir = "";
+  m_outputPolicies = "";
+
+  m_treeWriter = nullptr;
+  m_variationTree = nullptr;
+  m_variationPayload = nullptr;
+  m_eventCache = nullptr;
+  m_eventCacheTree = nullptr;
+  m_eventCacheFile = nullptr;
+  m_eventCacheReplay = false;
+  m_eventCacheScales = false;
+  m_eventCacheThisFile = nullptr;
+  m_eventListTree = nullptr;
+  m_eventListEntry = 0;
+  m_eventListEventNumber = 0;
+  m_eventListThisFile = nullptr;
 
   m_bTagFileName = "$ROOTCOREBIN/data/xAODAnaHelpers/2015-PreRecomm-13TeV-MC12-CDI-October23_v1.root";
   m_bTagVar    = "MV2c20";
@@ -164,6 +192,53 @@ EL::StatusCode  MultijetBalanceAlgo :: configure (){
   if( m_writeNominalTree )
     m_writeTree = true;
 
+  // A single tree already
+  if( m_writeNominalTree && m_compactTree ){
+    Info("configure()", "m_writeNominalTree writes only the Nominal tree, turning off m_compactTree.");
+    m_compactTree = false;
+  }
+
+  if( m_writeEventCache && m_eventCacheDir.size() > 0 ){
+    Error("configure()", "Cannot both write and run from the event cache.  Exiting.");
+    return EL::StatusCode::FAILURE;
+  }
+
+  // B-tag decisions and scale factors depend on the varied and MJB corrected pt, which a
+  // replayed cache entry cannot evaluate again (the tagger inputs are not cached)
+  if( (m_writeEventCache || m_eventCacheDir.size() > 0) && m_bTagWPs.size() > 0 ){
+    Error("configure()", "The event cache cannot be used with b-tag working points (m_bTagWPsString %s), set m_bTagWPsString to \"\".  Exiting.", m_bTagWPsString.c_str());
+    return EL::StatusCode::FAILURE;
+  }
+
+  if( m_writeEventList && m_eventListDir.size() > 0 ){
+    Error("configure()", "Cannot both write and read an event list.  Exiting.");
+    return EL::StatusCode::FAILURE;
+  }
+
+  // Skipped input events are missing from the first bins of the cutflow
+  if( m_eventListDir.size() > 0 ){
+    Info("configure()", "Reading only the entries of the event list.  Turning off cutflow, the MC normalization is still written.");
+    m_useCutFlow = false;
+  }
+
+  // Compression and basket settings of the output streams
+  m_outputPolicyMap.clear();
+  if( !OutputPolicy::parseList( m_outputPolicies, m_outputPolicyMap ) ){
+    Error("configure()", "Could not parse m_outputPolicies %s.  Exiting.", m_outputPolicies.c_str());
+    return EL::StatusCode::FAILURE;
+  }
+  for( std::map<std::string, OutputPolicy>::iterator it = m_outputPolicyMap.begin(); it != m_outputPolicyMap.end(); ++it ){
+    if( it->first == "hist" ){
+      // EventLoop opens and merges the hist-*.root files itself, wk()->getOutputFile only gives the declared streams
+      Warning("configure()", "The hist stream is written by EventLoop, its output policy is ignored.  Use runHistMerge --policy on the hist output instead.");
+    } else if( it->first != "tree" && it->first != "cutflow" && it->first != "SystToolOutput" && it->first != "eventCache" && it->first != "eventList" ){
+      Error("configure()", "Unknown output stream %s in m_outputPolicies.  Exiting.", it->first.c_str());
+      return EL::StatusCode::FAILURE;
+    } else {
+      Info("configure()", "Output policy of %s: %s", it->first.c_str(), it->second.str().c_str());
+    }
+  }
+
   m_comEnergy = "13TeV";
   if( m_MCPileupCheckContainer.compare("None") == 0 )
     m_useMCPileupCheck = false;
@@ -221,6 +296,12 @@ EL::StatusCode MultijetBalanceAlgo :: setupJob (EL::Job& job)
 
   job.outputAdd(EL::OutputStream("SystToolOutput"));
 
+  if( m_writeEventCache )
+    job.outputAdd(EL::OutputStream("eventCache"));
+
+  if( m_writeEventList )
+    job.outputAdd(EL::OutputStream("eventList"));
+
   return EL::StatusCode::SUCCESS;
 }
 
@@ -253,6 +334,24 @@ EL::StatusCode MultijetBalanceAlgo :: changeInput (bool firstFile)
   // Here you do everything you need to do when we change input files,
   // e.g. resetting branch addresses on trees.  If you are using
   // D3PDReader or a similar service this method is not needed.
+
+  // Input files are identified by their name, without the directory
+  m_eventListFileName = wk()->inputFile()->GetName();
+  m_eventListFileName = m_eventListFileName.substr( m_eventListFileName.find_last_of("/")+1 );
+
+  if( m_eventListDir.size() > 0 ){
+    if( firstFile && loadEventList() == EL::StatusCode::FAILURE )
+      return EL::StatusCode::FAILURE;
+
+    auto thisFile = m_eventList.find( m_eventListFileName );
+    m_eventListThisFile = (thisFile == m_eventList.end()) ? nullptr : &(thisFile->second);
+    Info("changeInput()", "Reading %lu entries of %s", (m_eventListThisFile ? m_eventListThisFile->size() : 0), m_eventListFileName.c_str());
+  }
+
+  // The cache is only loaded in initialize(), after the first file
+  if( m_eventCacheReplay )
+    setEventCacheFile();
+
   return EL::StatusCode::SUCCESS;
 }
 
@@ -303,10 +402,21 @@ EL::StatusCode MultijetBalanceAlgo :: initialize ()
   if (loadMJBCalibration() == EL::StatusCode::FAILURE)
     return EL::StatusCode::FAILURE;
 
+  if( m_writeEventCache || m_eventCacheDir.size() > 0 ){
+    if( loadEventCache() == EL::StatusCode::FAILURE )
+      return EL::StatusCode::FAILURE;
+  }
+
   if( m_bootstrap ){
     systTool = new SystContainer(m_sysVar, m_bins, m_systTool_nToys);
+    if( outputPolicy("SystToolOutput") )
+      outputPolicy("SystToolOutput")->apply( wk()->getOutputFile("SystToolOutput") );
   }
 
+  // Written by BasicEventSelection
+  if( outputPolicy("cutflow") )
+    outputPolicy("cutflow")->apply( wk()->getOutputFile("cutflow") );
+
   if(m_useCutFlow) {
     Info("initialize()", "Setting Cutflow");
 
@@ -392,30 +502,77 @@ EL::StatusCode MultijetBalanceAlgo :: initialize ()
       Error("initialize()","Failed to get file for output tree!");
       return EL::StatusCode::FAILURE;
     }
-    for(int unsigned iVar=0; iVar < m_sysVar.size(); ++iVar){
-      cout << "iVar/Nominal " << iVar << " " << m_NominalIndex << endl;
-      if (m_writeNominalTree && (int) iVar != m_NominalIndex)
-        continue;
-
-      TTree * outTree = new TTree( ("outTree_"+m_sysVar.at(iVar)).c_str(), ("outTree_"+m_sysVar.at(iVar) ).c_str());
-      if( !outTree ) {
-        Error("initialize()","Failed to get output tree!");
-        return EL::StatusCode::FAILURE;
-      }
+    if( outputPolicy("tree") )
+      outputPolicy("tree")->apply( treeFile );
+    if( m_compactTree ){
+      // One tree of the variables common to all variations, and a friend of the results of each variation
+      TTree * outTree = new TTree( "outTree", "outTree" );
       outTree->SetDirectory( treeFile );
       MiniTree* thisMiniTree = new MiniTree(m_event, outTree, treeFile);
+      thisMiniTree->SetShared( true );
       m_treeList.push_back(thisMiniTree);
-    }//for iVar
+
+      m_variationTree = new TTree( "outTree_variations", "outTree_variations" );
+      m_variationTree->SetDirectory( treeFile );
+      m_variationPayload = new VariationPayload( m_sysVar );
+      m_variationPayload->book( m_variationTree );
+      outTree->AddFriend( m_variationTree );
+    }else{
+      for(int unsigned iVar=0; iVar < m_sysVar.size(); ++iVar){
+        cout << "iVar/Nominal " << iVar << " " << m_NominalIndex << endl;
+        if (m_writeNominalTree && (int) iVar != m_NominalIndex)
+          continue;
+
+        TTree * outTree = new TTree( ("outTree_"+m_sysVar.at(iVar)).c_str(), ("outTree_"+m_sysVar.at(iVar) ).c_str());
+        if( !outTree ) {
+          Error("initialize()","Failed to get output tree!");
+          return EL::StatusCode::FAILURE;
+        }
+        outTree->SetDirectory( treeFile );
+        MiniTree* thisMiniTree = new MiniTree(m_event, outTree, treeFile);
+        m_treeList.push_back(thisMiniTree);
+      }//for iVar
+    }//if m_compactTree
 
     for( unsigned int iTree=0; iTree < m_treeList.size(); ++iTree){
+      m_treeList.at(iTree)->SetFlatJets( m_flatJetBranches );
       m_treeList.at(iTree)->AddEvent(m_eventDetailStr);
       m_treeList.at(iTree)->AddJets( (m_jetDetailStr+" MJBbTag_"+m_bTagWPsString).c_str());
       m_treeList.at(iTree)->AddTrigger( m_trigDetailStr );
 //      m_treeList.at(iTree)->AddMJB(m_MJBDetailStr);
+      if( outputPolicy("tree") )
+        outputPolicy("tree")->apply( m_treeList.at(iTree)->GetTree() );
     }//for iTree
+    if( m_variationTree && outputPolicy("tree") )
+      outputPolicy("tree")->apply( m_variationTree );
+
+    if( m_asyncTreeWriter ){
+      m_treeWriter = new AsyncTreeWriter();
+      for( unsigned int iTree=0; iTree < m_treeList.size(); ++iTree)
+        m_treeList.at(iTree)->SetAsyncWriter( m_treeWriter );
+      if( m_variationTree )
+        m_treeWriter->attach( m_variationTree );
+    }
 
   }//if m_writeTree
 
+  if( m_writeEventList ){
+    TFile * listFile = wk()->getOutputFile ("eventList");
+    if( !listFile ) {
+      Error("initialize()","Failed to get file for the event list!");
+      return EL::StatusCode::FAILURE;
+    }
+    if( outputPolicy("eventList") )
+      outputPolicy("eventList")->apply( listFile );
+    m_eventListTree = new TTree("eventList", "eventList");
+    m_eventListTree->SetDirectory( listFile );
+    m_eventListTree->Branch("fileName", &m_eventListFileName);
+    m_eventListTree->Branch("entry", &m_eventListEntry, "entry/L");
+    m_eventListTree->Branch("eventNumber", &m_eventListEventNumber, "eventNumber/l");
+    if( outputPolicy("eventList") )
+      outputPolicy("eventList")->apply( m_eventListTree );
+  }
+
   Info("initialize()", "Succesfully initialized output TTree! \n");
 
   return EL::StatusCode::SUCCESS;
@@ -436,6 +593,25 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
     wk()->skipEvent();  return EL::StatusCode::SUCCESS;
   }
 
+  // All events come from the event cache, each input entry replays its own cache entry
+  // so that every job only runs over the events of its inputs
+  if( m_eventCacheReplay ){
+    if( m_eventCacheThisFile ){
+      auto cacheEntry = m_eventCacheThisFile->find( wk()->treeEntry() );
+      if( cacheEntry != m_eventCacheThisFile->end() && replayEventCache( cacheEntry->second ) == EL::StatusCode::FAILURE )
+        return EL::StatusCode::FAILURE;
+    }
+    wk()->skipEvent();  return EL::StatusCode::SUCCESS;
+  }
+
+  // Only the entries of the event list can pass the selection common to all variations,
+  // skip the others before reading anything
+  if( m_eventListDir.size() > 0 ){
+    if( !m_eventListThisFile || m_eventListThisFile->count( wk()->treeEntry() ) == 0 ){
+      wk()->skipEvent();  return EL::StatusCode::SUCCESS;
+    }
+  }
+
   if(m_eventCounter %100000 == 0)
     Info("execute()", "Event # %i", m_eventCounter);
 
@@ -452,6 +628,11 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
   HelperFunctions::retrieve(eventInfo, "EventInfo", m_event, m_store);
   m_mcEventWeight = (m_isMC ? eventInfo->mcEventWeight() : 1.) ;
 
+  if( m_eventListThisFile && m_eventListThisFile->at( wk()->treeEntry() ) != eventInfo->eventNumber() ){
+    Error("execute()", "Entry %lli of %s is not the event of the event list, the input files have changed.  Exiting.", wk()->treeEntry(), m_eventListFileName.c_str());
+    return EL::StatusCode::FAILURE;
+  }
+
   //const xAOD::VertexContainer* vertices = HelperFunctions::getContainer<xAOD::VertexContainer>("PrimaryVertices", m_event, m_store);;
   const xAOD::VertexContainer* vertices = 0;
   HelperFunctions::retrieve(vertices, "PrimaryVertices", m_event, m_store);
@@ -482,10 +663,6 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
 
   /////////////////////////// Begin Selections and Creation of Variables ///////////////////////////////
   if(m_debug) Info("execute()", "Begin Selections ");
-  //Standard values that may be varied
-  float alphaCut, betaCut, ptAsymCut, ptThresholdCut;
-
-
   if(m_debug) Info("execute()", "Get Raw Kinematics ");
   vector<TLorentzVector> rawJetKinematics;
   for (unsigned int iJet = 0; iJet < originalSignalJets->size(); ++iJet){
@@ -548,6 +725,23 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
   passCutAll(); //mcCleaning
 
 
+  //// TileFrac, from the energy in each sampling layer ////
+  for(unsigned int iJet=0; iJet < originalSignalJets->size(); ++iJet){
+
+    vector<float> thisEPerSamp = originalSignalJets->at(iJet)->auxdata< vector< float> >("EnergyPerSampling");
+    float TotalE = 0., TileE = 0.;
+    for( int iLayer=0; iLayer < 24; ++iLayer){
+      TotalE += thisEPerSamp.at(iLayer);
+    }
+
+    TileE += thisEPerSamp.at(12);
+    TileE += thisEPerSamp.at(13);
+    TileE += thisEPerSamp.at(14);
+
+    originalSignalJets->at(iJet)->auxdecor< float >( "TileFrac" ) = TileE / TotalE;
+
+  }
+
   //Save original pt of all jets
   //!! to pointer?
   vector<TLorentzVector> originalJetKinematics;
@@ -557,6 +751,32 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
     originalJetKinematics.push_back(thisJet);
   }
 
+  if( m_writeEventCache )
+    fillEventCache( eventInfo, originalSignalJets, originalJetKinematics );
+
+  if( m_writeEventList ){
+    m_eventListEntry = wk()->treeEntry();
+    m_eventListEventNumber = eventInfo->eventNumber();
+    m_eventListTree->Fill();
+  }
+
+  runVariations( eventInfo, originalSignalJets, originalJetKinematics );
+
+
+  delete originalSignalJetsSC.first; delete originalSignalJetsSC.second; delete originalSignalJets;
+
+  return EL::StatusCode::SUCCESS;
+}
+
+
+// Everything after the selection common to all variations: the variation loop, from
+// originalSignalJets (in the order of originalJetKinematics) either of the input or of the event cache
+EL::StatusCode MultijetBalanceAlgo :: runVariations( const xAOD::EventInfo* eventInfo, std::vector< xAOD::Jet*>* originalSignalJets,
+                                                     const std::vector<TLorentzVector>& originalJetKinematics ){
+
+  //Standard values that may be varied
+  float alphaCut, betaCut, ptAsymCut, ptThresholdCut;
+
   //!! Add the following for the EIC issue
   //Because the V+jet calibrations can be less than 1, there exists a disjoint jet pt spectrum.
   //I.e. if V+jet calibration ends at 950 GeV, but a 950 GeV jets goes to 945 GeV, then jets at 946 GeV should be ignored
@@ -566,7 +786,6 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
    if( (!m_reverseSubleading && (originalJetKinematics.at(1).Pt() > m_subLeadingPtThreshold.at(m_MJBIteration)) )
        || (m_reverseSubleading && (originalJetKinematics.at(1).Pt() <= m_subLeadingPtThreshold.at(m_MJBIteration)) ) ){
 
-     delete originalSignalJetsSC.first; delete originalSignalJetsSC.second; delete originalSignalJets;
      wk()->skipEvent();  return EL::StatusCode::SUCCESS;
    }
   }
@@ -574,6 +793,16 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
   int m_cutflowFirst_SystLoop = m_iCutflow; //Get cutflow position for systematic looping
   vector< xAOD::Jet*>* signalJets = new std::vector< xAOD::Jet* >();
 
+  //The shared tree of m_compactTree holds the jets before any variation, it is only filled if a variation passes
+  if( m_writeTree && m_compactTree ){
+    m_variationPayload->clear();
+    eventInfo->auxdecor< float >("weight_mcEventWeight") = m_mcEventWeight;
+    eventInfo->auxdecor< float >("weight_xs") = m_xs * m_acceptance;
+    m_treeList.at(0)->FillEvent( eventInfo );
+    m_treeList.at(0)->FillSelectedJets( *originalSignalJets );
+    m_treeList.at(0)->FillTrigger( eventInfo );
+  }
+
   for(unsigned int iVar=0; iVar < m_sysVar.size(); ++iVar){
 
     if(m_debug) Info("execute()", "Starting variation %i %s", iVar, m_sysVar.at(iVar).c_str());
@@ -598,55 +827,7 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
 
 
     if(m_debug) Info("execute()", "Apply other calibrations ");
-    for (unsigned int iJet = 0; iJet < signalJets->size(); ++iJet){
-
-      if(m_sysTool.at(iVar) == 1){
-        int iCalibStage = m_sysToolIndex.at(iVar);
-        xAOD::JetFourMom_t jetCalibStageCopy = signalJets->at(iJet)->getAttribute<xAOD::JetFourMom_t>( m_JCSStrings.at(iCalibStage).c_str() );
-        signalJets->at(iJet)->auxdata< float >("pt") = jetCalibStageCopy.Pt();
-        signalJets->at(iJet)->auxdata< float >("eta") = jetCalibStageCopy.Eta();
-        signalJets->at(iJet)->auxdata< float >("phi") = jetCalibStageCopy.Phi();
-        signalJets->at(iJet)->auxdata< float >("e") = jetCalibStageCopy.E();
-      } else {
-
-        // Must reset jet kinematics for this iVar of m_sysVar
-        if( iJet !=0 || m_leadingInsitu ){ //Use Insitu Correction
-          signalJets->at(iJet)->auxdata< float >("pt") = originalJetKinematics.at(iJet).Pt();
-          signalJets->at(iJet)->auxdata< float >("eta") = originalJetKinematics.at(iJet).Eta();
-          signalJets->at(iJet)->auxdata< float >("phi") = originalJetKinematics.at(iJet).Phi();
-          signalJets->at(iJet)->auxdata< float >("e") = originalJetKinematics.at(iJet).E();
-        } else { //Get GSC Correction  for leading jet
-          xAOD::JetFourMom_t jetCalibGSCCopy = signalJets->at(iJet)->getAttribute<xAOD::JetFourMom_t>("JetGSCScaleMomentum");
-          signalJets->at(iJet)->auxdata< float >("pt") = jetCalibGSCCopy.Pt();
-          signalJets->at(iJet)->auxdata< float >("eta") = jetCalibGSCCopy.Eta();
-          signalJets->at(iJet)->auxdata< float >("phi") = jetCalibGSCCopy.Phi();
-          signalJets->at(iJet)->auxdata< float >("e") = jetCalibGSCCopy.E();
-        }
-      }
-
-
-      if(iJet == 0){
-        if( m_leadingInsitu){ //Apply standard systematic to lead jet
-          applyJetUncertaintyTool( signalJets->at(iJet) , iVar );
-        } else if( m_closureTest ){ //Apply MJB to lead jet
-          //apply previous correction for closure test??
-          applyMJBCalibration( signalJets->at(iJet), iVar, true );
-        }
-      }//leading jet
-
-      if(iJet > 0){  //Apply standard systematic to subleading jets
-        //!! Changed it to manually select based on subleading pt, due to EIC issue
-        //!! Might need to change this so jetuncertaintytool is applied beyond subLeadingPtThreshold
-        if( m_noLimitJESPt || signalJets->at(iJet)->pt() <= m_subLeadingPtThreshold.at(0) ){
-          if (m_VjetCalib)
-            applyVjetCalibration( signalJets->at(iJet) , iVar );
-          applyJetUncertaintyTool( signalJets->at(iJet) , iVar );
-        }else{
-          applyMJBCalibration( signalJets->at(iJet) , iVar );
-        }
-      }
-
-    }
+    applyVariationCalibration( signalJets, originalJetKinematics, iVar );
     reorderJets( signalJets );
 
     if(m_debug) Info("execute()", "Subleading pt selection ");
@@ -692,7 +873,9 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
     if(m_debug) Info("execute()", "Jet Cleaning ");
     //// Specialized jet Cleaning: ignore event if any of the used jets are not clean ////
     for(unsigned int iJet = 0; iJet < signalJets->size(); ++iJet){
-      if(! m_JetCleaningTool->accept( *(signalJets->at(iJet))) ){
+      bool isClean = m_eventCacheReplay ? signalJets->at(iJet)->auxdecor< char >("cleanJet") : m_JetCleaningTool->accept( *(signalJets->at(iJet)) );
+      if(! isClean ){
+        delete signalJets;
         wk()->skipEvent();  return EL::StatusCode::SUCCESS;
       }//clean jet
     }
@@ -713,11 +896,11 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
       passedTriggers = true;
 
     for( unsigned int iT=0; iT < m_triggers.size(); ++iT){
-      auto triggerChainGroup = m_trigDecTools.at(iT)->getChainGroup(m_triggers.at(iT));
       if(recoilJets.Pt() > m_triggerThresholds.at(iT)){
-        if( triggerChainGroup->isPassed() ){
+        bool passedThisTrigger = m_eventCacheReplay ? m_eventCache->trigPassed.at(iT) : m_trigDecTools.at(iT)->getChainGroup(m_triggers.at(iT))->isPassed();
+        if( passedThisTrigger ){
           passedTriggers = true;
-          prescale = m_trigDecTools.at(iT)->getPrescale(m_triggers.at(iT));
+          prescale = m_eventCacheReplay ? m_eventCache->trigPrescale.at(iT) : m_trigDecTools.at(iT)->getPrescale(m_triggers.at(iT));
         }
         break;
       }//recoil Pt
@@ -770,39 +953,10 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
 
 
     //////////// B-tagging ///////////////
-    for(unsigned int iB=0; iB < m_bTagWPs.size(); ++iB){ 
-      for(unsigned int iJet=0; iJet < signalJets->size(); ++iJet){
-        //m_MJBDetailStr  is bTag85
-        SG::AuxElement::Decorator< int > isBTag( ("BTag_"+m_bTagWPs.at(iB)+"Fixed").c_str() );
-        if( m_BJetSelectTools.at(iB)->accept( signalJets->at(iJet) ) ) {
-          isBTag( *signalJets->at(iJet) ) = 1;
-        }else{
-          isBTag( *signalJets->at(iJet) ) = 0;
-        }
-  
-  
-        float thisSF(1.0);
-        SG::AuxElement::Decorator< float > bTagSF( ("BTagSF_"+m_bTagWPs.at(iB)+"Fixed").c_str() );
-        if( m_isMC && fabs(signalJets->at(iJet)->eta()) < 2.5 ){
-          CP::CorrectionCode BJetEffCode;
-          if( isBTag( *signalJets->at(iJet) ) == 1 ){
-            BJetEffCode = m_BJetEffSFTools.at(iB)->getScaleFactor( *signalJets->at(iJet), thisSF );
-          }else{
-            BJetEffCode = m_BJetEffSFTools.at(iB)->getInefficiencyScaleFactor( *signalJets->at(iJet), thisSF );
-          }
-          if (BJetEffCode == CP::CorrectionCode::Error){
-            Warning( "execute()", "Error in m_BJetEFFSFTool's getEfficiencyScaleFactor, setting Scale Factor to -2");
-            thisSF = -2;
-            //return EL::StatusCode::FAILURE;
-          }
-  
-        } // if m_isMC, get SF
-  
-        bTagSF( *signalJets->at(iJet) ) = thisSF;
-        //cout << iJet << " " << " WP:" << m_bTagWPs.at(iB) << " gives " << isBTag(*signalJets->at(iJet)) << " of " << thisSF << endl;
-  
-      }//signalJets
-    }//bTagWPs
+    //At the kinematics of this variation, there are no working points when running from the event cache
+    for(unsigned int iJet=0; iJet < signalJets->size(); ++iJet){
+      applyBTagTools( signalJets->at(iJet) );
+    }
 
     //%%%%%%%%%%%%%%%%%%%%%%%%%%% End Selections %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%5
 
@@ -816,23 +970,6 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
     eventInfo->auxdecor< float >( "ptBal" ) = signalJets->at(0)->pt() / recoilJets.Pt();
     eventInfo->auxdecor< float >( "ptBal2" ) = 0.5 * (signalJets->at(0)->pt() + recoilJets.Pt()) / recoilJets.Pt();
 
-    for(unsigned int iJet=0; iJet < signalJets->size(); ++iJet){
-
-      vector<float> thisEPerSamp = signalJets->at(iJet)->auxdata< vector< float> >("EnergyPerSampling");
-      float TotalE = 0., TileE = 0.;
-      for( int iLayer=0; iLayer < 24; ++iLayer){
-        TotalE += thisEPerSamp.at(iLayer);
-      }
-
-      TileE += thisEPerSamp.at(12);
-      TileE += thisEPerSamp.at(13);
-      TileE += thisEPerSamp.at(14);
-
-      signalJets->at(iJet)->auxdecor< float >( "TileFrac" ) = TileE / TotalE;
-
-    }
-
-
     eventInfo->auxdecor< float >("weight_mcEventWeight") = m_mcEventWeight;
     eventInfo->auxdecor< float >("weight_prescale") = prescale;
     eventInfo->auxdecor< float >("weight_xs") = m_xs * m_acceptance;
@@ -849,24 +986,15 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
 
     if(m_debug) Info("execute()", "Begin TTree output for %s", m_sysVar.at(iVar).c_str() );
   ///////////////// Optional MiniTree Output for Nominal Only //////////////////////////
-    if( m_writeTree ) {
+    if( m_writeTree && m_compactTree ) {
+      m_variationPayload->set( iVar, recoilJets.Pt(), eventInfo->auxdecor< float >( "ptBal" ), eventInfo->auxdecor< float >( "weight" ), signalJets->size() );
+    } else if( m_writeTree ) {
       if(!m_writeNominalTree ||  m_NominalIndex == (int) iVar) {
-      //!! The following is a bit slow!
-        std::pair< xAOD::JetContainer*, xAOD::ShallowAuxContainer* > originalSignalJetsSC = xAOD::shallowCopyContainer( *inJets );
-        xAOD::JetContainer* plottingJets = new xAOD::JetContainer();
-        xAOD::JetAuxContainer* plottingJetsAux = new xAOD::JetAuxContainer();
-        plottingJets->setStore( plottingJetsAux );
-        for(unsigned int iJet=0; iJet < signalJets->size(); ++iJet){
-          xAOD::Jet* newJet = new xAOD::Jet();
-          newJet->makePrivateStore( *(signalJets->at(iJet)) );
-          plottingJets->push_back( newJet );
-        }
-
         int iTree = iVar;
         if( m_writeNominalTree)
           iTree = 0;
         if(eventInfo)   m_treeList.at(iTree)->FillEvent( eventInfo    );
-        if(signalJets)  m_treeList.at(iTree)->FillJets(  plottingJets);
+        if(signalJets)  m_treeList.at(iTree)->FillSelectedJets( *signalJets );
         m_treeList.at(iTree)->FillTrigger( eventInfo );
         m_treeList.at(iTree)->Fill();
 //        m_treeList.at(iTree)->ClearMJB();
@@ -875,8 +1003,6 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
         //if(signalJets)  m_nominalTree->FillJets(  *plottingJets  );
         //m_nominalTree->Fill();
         //m_nominalTree->ClearUser();
-        delete plottingJets;
-        delete plottingJetsAux;
       }//If it's not m_writeNominalTree or else we're on the nominal sample
     }//if m_writeTree
 
@@ -888,6 +1014,14 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
 
   }//For each iVar
 
+  if( m_writeTree && m_compactTree && m_variationPayload->anyPassed() ){
+    m_treeList.at(0)->Fill();
+    if( m_treeWriter )
+      m_treeWriter->fill( m_variationTree );
+    else
+      m_variationTree->Fill();
+  }
+
 //!! Other ideas
 /*
     std::pair< xAOD::JetContainer*, xAOD::ShallowAuxContainer* > originalSignalJetsSC = xAOD::shallowCopyContainer( *inJets );
@@ -918,7 +1052,6 @@ EL::StatusCode MultijetBalanceAlgo :: execute ()
 
 
   delete signalJets;
-  delete originalSignalJetsSC.first; delete originalSignalJetsSC.second; delete originalSignalJets;
 
   return EL::StatusCode::SUCCESS;
 }
@@ -951,6 +1084,16 @@ EL::StatusCode MultijetBalanceAlgo :: finalize ()
     m_jetHists.at(iVar)->finalize();
   }
 
+  // All entries must be in the trees before EventLoop writes them
+  if( m_treeWriter ){
+    m_treeWriter->finish();
+    if( m_treeWriter->numErrors() > 0 ){
+      Error("finalize()", "%u TTree entries could not be written", m_treeWriter->numErrors());
+      return EL::StatusCode::FAILURE;
+    }
+    delete m_treeWriter; m_treeWriter = nullptr;
+  }
+  delete m_variationPayload; m_variationPayload = nullptr;
 
   if( m_bootstrap ){
     systTool->writeToFile(wk()->getOutputFile("SystToolOutput"));
@@ -965,6 +1108,13 @@ EL::StatusCode MultijetBalanceAlgo :: finalize ()
     }
   }
 
+  delete m_eventCache; m_eventCache = nullptr;
+  if( m_eventCacheFile ){
+    m_eventCacheFile->Close();
+    delete m_eventCacheFile; m_eventCacheFile = nullptr;
+    m_eventCacheTree = nullptr;
+  }
+
   delete m_JetCalibrationTool; m_JetCalibrationTool = nullptr;
   delete m_JetCleaningTool; m_JetCleaningTool = nullptr;
   delete m_JetUncertaintiesTool; m_JetUncertaintiesTool = nullptr;
@@ -1005,6 +1155,27 @@ EL::StatusCode MultijetBalanceAlgo :: finalize ()
     wk()->addOutput(histCutflowW);
   }//m_useCutFlow
 
+  // Normalization inputs of the MC histograms, applied on read by runHistMerge --normalize and runFit.
+  // Also written by the jobs without cutflow (event list, event cache replay, bootstrap iterations):
+  // BasicEventSelection still sees every input event, this algorithm only skips them.
+  wk()->addOutput( MCNormalization::makeSampleHist( m_isMC ) );
+  if(m_isMC){
+    TFile *file = wk()->getOutputFile ("cutflow");
+    TH1D* origCutflowHist = file ? (TH1D*)file->Get("cutflow") : nullptr;
+    TH1D* origCutflowHistW = file ? (TH1D*)file->Get("cutflow_weighted") : nullptr;
+    if( !origCutflowHist || !origCutflowHistW ){
+      Error("finalize()", "No cutflow of BasicEventSelection, the MC normalization cannot be written");
+      return EL::StatusCode::FAILURE;
+    }
+    MCNormalization normalization;
+    normalization.m_nJobs = 1;
+    normalization.m_numEvents = origCutflowHist->GetBinContent(1);
+    normalization.m_sumOfWeights = origCutflowHistW->GetBinContent(1);
+    normalization.m_xsSum = m_xs;
+    normalization.m_acceptanceSum = m_acceptance;
+    wk()->addOutput( normalization.makeHist( m_mcChannelNumber ) );
+  }
+
   //Only if Nominal is available
   if( m_writeTree && m_NominalIndex >= 0) {
     TH1D *treeCutflow, *treeCutflowW;
@@ -1641,6 +1812,128 @@ EL::StatusCode MultijetBalanceAlgo :: loadMJBCalibration(){
 return EL::StatusCode::SUCCESS;
 }
 
+// The output policy of stream, NULL if m_outputPolicies has none
+const OutputPolicy* MultijetBalanceAlgo :: outputPolicy(const std::string& stream) const {
+  std::map<std::string, OutputPolicy>::const_iterator it = m_outputPolicyMap.find( stream );
+  if( it == m_outputPolicyMap.end() )
+    return nullptr;
+  return &(it->second);
+}
+
+// Sets up the event cache, either to write it (m_writeEventCache) or to run from it (m_eventCacheDir)
+EL::StatusCode MultijetBalanceAlgo :: loadEventCache(){
+  if(m_debug) Info("loadEventCache()", "loadEventCache");
+
+  // The first scale is the V+jet calibration alone, shared by all variations that do not
+  // vary the JES, the others are one per JetUncertaintiesTool variation
+  std::vector<std::string> scaleNames;
+  scaleNames.push_back("Vjet");
+  m_eventCacheScaleIndex.clear();
+  for(unsigned int iVar=0; iVar < m_sysVar.size(); ++iVar){
+    if( m_sysTool.at(iVar) == 1 ){ //JCS, neither is applied
+      m_eventCacheScaleIndex.push_back( -1 );
+    } else if( m_sysTool.at(iVar) == 0 ){
+      scaleNames.push_back( m_sysVar.at(iVar) );
+      m_eventCacheScaleIndex.push_back( scaleNames.size()-1 );
+    } else {
+      m_eventCacheScaleIndex.push_back( 0 );
+    }
+  }
+  m_eventCache = new EventCache( m_triggers.size(), m_JCSStrings, scaleNames );
+
+  if( m_writeEventCache ){
+    if( m_NominalIndex < 0 ){
+      Error("loadEventCache()", "Writing the event cache requires the Nominal variation.  Exiting.");
+      return EL::StatusCode::FAILURE;
+    }
+    TFile * cacheFile = wk()->getOutputFile ("eventCache");
+    if( !cacheFile ) {
+      Error("loadEventCache()","Failed to get file for the event cache!");
+      return EL::StatusCode::FAILURE;
+    }
+    if( outputPolicy("eventCache") )
+      outputPolicy("eventCache")->apply( cacheFile );
+    m_eventCacheTree = new TTree("eventCache", "eventCache");
+    m_eventCacheTree->SetDirectory( cacheFile );
+    m_eventCache->book( m_eventCacheTree );
+    if( outputPolicy("eventCache") )
+      outputPolicy("eventCache")->apply( m_eventCacheTree );
+    Info("loadEventCache()", "Writing the event cache");
+    return EL::StatusCode::SUCCESS;
+  }
+
+  std::string sampleName = wk()->metaData()->castString( SH::MetaFields::sampleName );
+  std::string cacheFileName = gSystem->ExpandPathName( (m_eventCacheDir+"/"+sampleName+".root").c_str() );
+  m_eventCacheFile = TFile::Open( cacheFileName.c_str(), "READ" );
+  if( !m_eventCacheFile || m_eventCacheFile->IsZombie() ){
+    Error("loadEventCache()", "Could not open the event cache %s.  Exiting.", cacheFileName.c_str());
+    return EL::StatusCode::FAILURE;
+  }
+  m_eventCacheTree = (TTree*) m_eventCacheFile->Get("eventCache");
+  if( !m_eventCacheTree || !EventCache::index( m_eventCacheTree, m_eventCacheIndex ) ){
+    Error("loadEventCache()", "%s has no event cache that can be replayed, write it again.  Exiting.", cacheFileName.c_str());
+    return EL::StatusCode::FAILURE;
+  }
+  if( !m_eventCache->connect( m_eventCacheTree ) ){
+    Error("loadEventCache()", "%s is not an event cache of this configuration, it needs every variation, calibration stage and b-tag working point of this job.  Exiting.", cacheFileName.c_str());
+    return EL::StatusCode::FAILURE;
+  }
+
+  // Everything comes from the cache, the cache entries of the input entries of this job are replayed
+  m_eventCacheReplay = true;
+  setEventCacheFile();
+  m_eventCacheScales = true;
+  m_useCutFlow = false;
+  m_writeTree = false;
+  m_writeNominalTree = false;
+  Info("loadEventCache()", "Running from the event cache %s with %lli events of %lu input files, the input events are skipped.  Turning off cutflow and ttree, the MC normalization is still written.", cacheFileName.c_str(), m_eventCacheTree->GetEntries(), m_eventCacheIndex.size());
+
+  return EL::StatusCode::SUCCESS;
+}
+
+// Points the replay to the cache entries of the current input file
+void MultijetBalanceAlgo :: setEventCacheFile(){
+  auto thisFile = m_eventCacheIndex.find( m_eventListFileName );
+  m_eventCacheThisFile = (thisFile == m_eventCacheIndex.end()) ? nullptr : &(thisFile->second);
+  Info("setEventCacheFile()", "Replaying %lu cached events of %s", (m_eventCacheThisFile ? m_eventCacheThisFile->size() : 0), m_eventListFileName.c_str());
+}
+
+// Reads the event list written by a previous job with m_writeEventList
+EL::StatusCode MultijetBalanceAlgo :: loadEventList(){
+  if(m_debug) Info("loadEventList()", "loadEventList");
+
+  std::string sampleName = wk()->metaData()->castString( SH::MetaFields::sampleName );
+  std::string listFileName = gSystem->ExpandPathName( (m_eventListDir+"/"+sampleName+".root").c_str() );
+  TFile* listFile = TFile::Open( listFileName.c_str(), "READ" );
+  if( !listFile || listFile->IsZombie() ){
+    Error("loadEventList()", "Could not open the event list %s.  Exiting.", listFileName.c_str());
+    return EL::StatusCode::FAILURE;
+  }
+  TTree* listTree = (TTree*) listFile->Get("eventList");
+  if( !listTree ){
+    Error("loadEventList()", "%s has no event list.  Exiting.", listFileName.c_str());
+    return EL::StatusCode::FAILURE;
+  }
+
+  std::string* fileName = nullptr;
+  Long64_t entry = 0;
+  unsigned long long eventNumber = 0;
+  listTree->SetBranchAddress("fileName", &fileName);
+  listTree->SetBranchAddress("entry", &entry);
+  listTree->SetBranchAddress("eventNumber", &eventNumber);
+  for(Long64_t iEntry=0; iEntry < listTree->GetEntries(); ++iEntry){
+    listTree->GetEntry(iEntry);
+    m_eventList[*fileName][entry] = eventNumber;
+  }
+  Info("loadEventList()", "Loaded %lli entries of %lu input files from %s", listTree->GetEntries(), m_eventList.size(), listFileName.c_str());
+
+  listFile->Close();
+  delete listFile;
+  delete fileName;
+
+  return EL::StatusCode::SUCCESS;
+}
+
 EL::StatusCode MultijetBalanceAlgo :: applyJetCalibrationTool( xAOD::Jet* jet){
   if(m_debug) Info("applyJetCalibrationTool()", "applyJetCalibrationTool");
   if ( m_JetCalibrationTool->applyCorrection( *jet ) == CP::CorrectionCode::Error ) {
@@ -1760,6 +2053,111 @@ EL::StatusCode MultijetBalanceAlgo :: applyMJBCalibration( xAOD::Jet* jet , int
 }
 
 
+// Resets the kinematics of jets (in the order of originalJetKinematics) for variation iVar, and applies
+// the V+jet calibration and JetUncertaintiesTool, or the MJB calibration, as appropriate for each jet.
+// The V+jet and JES part is a pure scale of each jet, which is taken from the event cache once known.
+EL::StatusCode MultijetBalanceAlgo :: applyVariationCalibration( std::vector< xAOD::Jet*>* jets, const std::vector<TLorentzVector>& originalJetKinematics, int iVar ){
+  if(m_debug) Info("applyVariationCalibration()", "applyVariationCalibration ");
+
+  for (unsigned int iJet = 0; iJet < jets->size(); ++iJet){
+    xAOD::Jet* jet = jets->at(iJet);
+
+    if(m_sysTool.at(iVar) == 1){
+      int iCalibStage = m_sysToolIndex.at(iVar);
+      xAOD::JetFourMom_t jetCalibStageCopy = jet->getAttribute<xAOD::JetFourMom_t>( m_JCSStrings.at(iCalibStage).c_str() );
+      jet->auxdata< float >("pt") = jetCalibStageCopy.Pt();
+      jet->auxdata< float >("eta") = jetCalibStageCopy.Eta();
+      jet->auxdata< float >("phi") = jetCalibStageCopy.Phi();
+      jet->auxdata< float >("e") = jetCalibStageCopy.E();
+    } else {
+
+      // Must reset jet kinematics for this iVar of m_sysVar
+      if( iJet !=0 || m_leadingInsitu ){ //Use Insitu Correction
+        jet->auxdata< float >("pt") = originalJetKinematics.at(iJet).Pt();
+        jet->auxdata< float >("eta") = originalJetKinematics.at(iJet).Eta();
+        jet->auxdata< float >("phi") = originalJetKinematics.at(iJet).Phi();
+        jet->auxdata< float >("e") = originalJetKinematics.at(iJet).E();
+      } else { //Get GSC Correction  for leading jet
+        xAOD::JetFourMom_t jetCalibGSCCopy = jet->getAttribute<xAOD::JetFourMom_t>("JetGSCScaleMomentum");
+        jet->auxdata< float >("pt") = jetCalibGSCCopy.Pt();
+        jet->auxdata< float >("eta") = jetCalibGSCCopy.Eta();
+        jet->auxdata< float >("phi") = jetCalibGSCCopy.Phi();
+        jet->auxdata< float >("e") = jetCalibGSCCopy.E();
+      }
+    }
+
+    // The leading jet gets the standard systematic (but no V+jet calibration) if m_leadingInsitu,
+    // subleading jets get both, but only below the subleading pt threshold due to the EIC issue.
+    //!! Might need to change this so jetuncertaintytool is applied beyond subLeadingPtThreshold
+    bool applyJES = false;
+    if( iJet == 0 )
+      applyJES = m_leadingInsitu;
+    else
+      applyJES = ( m_noLimitJESPt || jet->pt() <= m_subLeadingPtThreshold.at(0) );
+
+    if( applyJES ){
+      // Jets beyond EventCache::maxJets are not cached, and always get their scale from the tools
+      int iScale = ( m_eventCache && iJet < (unsigned int) EventCache::maxJets ) ? m_eventCacheScaleIndex.at(iVar) : -1;
+      if( m_eventCacheScales && iScale >= 0 ){
+        float thisScale = m_eventCache->scale.at(iScale).at(iJet);
+        jet->auxdata< float >("pt") *= thisScale;
+        jet->auxdata< float >("e") *= thisScale;
+      } else {
+        float ptBefore = jet->pt();
+        if (iJet > 0 && m_VjetCalib)
+          applyVjetCalibration( jet , iVar );
+        applyJetUncertaintyTool( jet , iVar );
+        if( iScale >= 0 )
+          m_eventCache->scale.at(iScale).at(iJet) = jet->pt() / ptBefore;
+      }
+    } else if( iJet > 0 ){
+      applyMJBCalibration( jet , iVar );
+    } else if( m_closureTest ){ //Apply MJB to lead jet
+      //apply previous correction for closure test??
+      applyMJBCalibration( jet, iVar, true );
+    }
+
+  }
+
+  return EL::StatusCode::SUCCESS;
+}
+
+// Decorates the b-tag decision and (in)efficiency scale factor of each working point
+EL::StatusCode MultijetBalanceAlgo :: applyBTagTools( xAOD::Jet* jet ){
+  if(m_debug) Info("applyBTagTools()", "applyBTagTools ");
+
+  for(unsigned int iB=0; iB < m_bTagWPs.size(); ++iB){
+    //m_MJBDetailStr  is bTag85
+    SG::AuxElement::Decorator< int > isBTag( ("BTag_"+m_bTagWPs.at(iB)+"Fixed").c_str() );
+    if( m_BJetSelectTools.at(iB)->accept( jet ) ) {
+      isBTag( *jet ) = 1;
+    }else{
+      isBTag( *jet ) = 0;
+    }
+
+    float thisSF(1.0);
+    SG::AuxElement::Decorator< float > bTagSF( ("BTagSF_"+m_bTagWPs.at(iB)+"Fixed").c_str() );
+    if( m_isMC && fabs(jet->eta()) < 2.5 ){
+      CP::CorrectionCode BJetEffCode;
+      if( isBTag( *jet ) == 1 ){
+        BJetEffCode = m_BJetEffSFTools.at(iB)->getScaleFactor( *jet, thisSF );
+      }else{
+        BJetEffCode = m_BJetEffSFTools.at(iB)->getInefficiencyScaleFactor( *jet, thisSF );
+      }
+      if (BJetEffCode == CP::CorrectionCode::Error){
+        Warning( "execute()", "Error in m_BJetEFFSFTool's getEfficiencyScaleFactor, setting Scale Factor to -2");
+        thisSF = -2;
+        //return EL::StatusCode::FAILURE;
+      }
+
+    } // if m_isMC, get SF
+
+    bTagSF( *jet ) = thisSF;
+  }//bTagWPs
+
+  return EL::StatusCode::SUCCESS;
+}
+
 EL::StatusCode MultijetBalanceAlgo :: reorderJets( std::vector< xAOD::Jet*>* theseJets ){
 
   if(m_debug) Info("reorderJets()", "reorderJets ");
@@ -1777,3 +2175,152 @@ EL::StatusCode MultijetBalanceAlgo :: reorderJets( std::vector< xAOD::Jet*>* the
   return EL::StatusCode::SUCCESS;
 }
 
+
+// Fills the event cache with the jets passing the selection common to all variations, in the order of
+// originalJetKinematics.  Cleaning and b-tagging are evaluated at these (nominal) kinematics.
+EL::StatusCode MultijetBalanceAlgo :: fillEventCache( const xAOD::EventInfo* eventInfo, std::vector< xAOD::Jet*>* jets, const std::vector<TLorentzVector>& originalJetKinematics ){
+  if(m_debug) Info("fillEventCache()", "fillEventCache");
+
+  m_eventCache->inputFile = m_eventListFileName;
+  m_eventCache->inputEntry = wk()->treeEntry();
+  m_eventCache->runNumber = eventInfo->runNumber();
+  m_eventCache->eventNumber = eventInfo->eventNumber();
+  m_eventCache->isMC = m_isMC;
+  m_eventCache->mcEventWeight = m_mcEventWeight;
+  m_eventCache->weightXs = m_xs * m_acceptance;
+
+  for( unsigned int iT=0; iT < m_triggers.size(); ++iT){
+    bool passedThisTrigger = m_trigDecTools.at(iT)->getChainGroup(m_triggers.at(iT))->isPassed();
+    m_eventCache->trigPassed.at(iT) = passedThisTrigger;
+    m_eventCache->trigPrescale.at(iT) = passedThisTrigger ? m_trigDecTools.at(iT)->getPrescale(m_triggers.at(iT)) : 1.;
+  }
+
+  // Only the leading EventCache::maxJets jets are cached, the analysed jets are left untouched
+  unsigned int nCached = jets->size();
+  if( nCached > (unsigned int) EventCache::maxJets ){
+    Warning("fillEventCache()", "Run %u event %llu has %u signal jets, only the leading %i are written to the event cache.",
+        eventInfo->runNumber(), (unsigned long long) eventInfo->eventNumber(), nCached, EventCache::maxJets);
+    nCached = EventCache::maxJets;
+  }
+  m_eventCache->njet = nCached;
+  for(unsigned int iJet=0; iJet < nCached; ++iJet){
+    xAOD::Jet* jet = jets->at(iJet);
+    m_eventCache->pt.at(iJet) = jet->pt();
+    m_eventCache->eta.at(iJet) = jet->eta();
+    m_eventCache->phi.at(iJet) = jet->phi();
+    m_eventCache->m.at(iJet) = jet->m();
+
+    xAOD::JetFourMom_t jetCalibGSCCopy = jet->getAttribute<xAOD::JetFourMom_t>("JetGSCScaleMomentum");
+    m_eventCache->gscPt.at(iJet) = jetCalibGSCCopy.Pt();
+    m_eventCache->gscEta.at(iJet) = jetCalibGSCCopy.Eta();
+    m_eventCache->gscPhi.at(iJet) = jetCalibGSCCopy.Phi();
+    m_eventCache->gscM.at(iJet) = jetCalibGSCCopy.M();
+    for(unsigned int iS=0; iS < m_JCSStrings.size(); ++iS){
+      xAOD::JetFourMom_t jetCalibStageCopy = jet->getAttribute<xAOD::JetFourMom_t>( m_JCSStrings.at(iS).c_str() );
+      m_eventCache->stagePt.at(iS).at(iJet) = jetCalibStageCopy.Pt();
+      m_eventCache->stageEta.at(iS).at(iJet) = jetCalibStageCopy.Eta();
+      m_eventCache->stagePhi.at(iS).at(iJet) = jetCalibStageCopy.Phi();
+      m_eventCache->stageM.at(iS).at(iJet) = jetCalibStageCopy.M();
+    }
+
+    m_eventCache->detEta.at(iJet) = jet->auxdecor< float >("detEta");
+    m_eventCache->jetCorr.at(iJet) = jet->auxdecor< float >("jetCorr");
+    m_eventCache->jvfcorr.at(iJet) = jet->getAttribute<float>("JvtJvfcorr");
+    m_eventCache->jvtRpt.at(iJet) = jet->getAttribute<float>("JvtRpt");
+    m_eventCache->pileupPt.at(iJet) = jet->getAttribute<xAOD::JetFourMom_t>("JetPileupScaleMomentum").Pt();
+    m_eventCache->clean.at(iJet) = m_JetCleaningTool->accept( *jet );
+    m_eventCache->EMFrac.at(iJet) = jet->auxdata< float >("EMFrac");
+    m_eventCache->HECFrac.at(iJet) = jet->auxdata< float >("HECFrac");
+    m_eventCache->TileFrac.at(iJet) = jet->auxdecor< float >("TileFrac");
+
+  }
+
+  // The scales of the V+jet calibration and each JES variation, which the variation loop of this
+  // event then takes from the cache as well
+  m_eventCacheScales = false;
+  std::vector<bool> foundScale( m_eventCache->scale.size(), false );
+  for(unsigned int iVar=0; iVar < m_sysVar.size(); ++iVar){
+    int iScale = m_eventCacheScaleIndex.at(iVar);
+    if( iScale < 0 || foundScale.at(iScale) )
+      continue;
+    for(unsigned int iJet=0; iJet < nCached; ++iJet)
+      m_eventCache->scale.at(iScale).at(iJet) = 1.;
+    applyVariationCalibration( jets, originalJetKinematics, iVar );
+    foundScale.at(iScale) = true;
+  }
+  m_eventCacheScales = true;
+
+  // The jets are left as before the variations, as runVariations (and its shared compact tree) expects them
+  for(unsigned int iJet=0; iJet < jets->size(); ++iJet){
+    xAOD::Jet* jet = jets->at(iJet);
+    jet->auxdata< float >("pt") = originalJetKinematics.at(iJet).Pt();
+    jet->auxdata< float >("eta") = originalJetKinematics.at(iJet).Eta();
+    jet->auxdata< float >("phi") = originalJetKinematics.at(iJet).Phi();
+    jet->auxdata< float >("e") = originalJetKinematics.at(iJet).E();
+  }
+
+  m_eventCacheTree->Fill();
+
+  return EL::StatusCode::SUCCESS;
+}
+
+// Runs the variation loop over entry iEntry of the event cache, instead of the input event
+EL::StatusCode MultijetBalanceAlgo :: replayEventCache( Long64_t iEntry ){
+  if(m_debug) Info("replayEventCache()", "replayEventCache");
+
+  const EventCache& cache = *m_eventCache;
+  if( m_eventCacheTree->GetEntry(iEntry) <= 0 ){
+    Error("replayEventCache()", "Could not read entry %lli of the event cache.  Exiting.", iEntry);
+    return EL::StatusCode::FAILURE;
+  }
+  // m_xs and m_acceptance are those of getLumiWeights, and are kept for the MJBNormalization of this job
+  if( fabs( cache.weightXs - m_xs*m_acceptance ) > 1e-6*fabs( cache.weightXs ) ){
+    Error("replayEventCache()", "The event cache was written with xs*acceptance %g, not %g of this job.  Exiting.", cache.weightXs, m_xs*m_acceptance);
+    return EL::StatusCode::FAILURE;
+  }
+
+  xAOD::EventInfo* eventInfo = new xAOD::EventInfo();
+  eventInfo->makePrivateStore();
+  xAOD::JetContainer* cacheJets = new xAOD::JetContainer();
+  xAOD::JetAuxContainer* cacheJetsAux = new xAOD::JetAuxContainer();
+  cacheJets->setStore( cacheJetsAux );
+  std::vector< xAOD::Jet*>* originalSignalJets = new std::vector< xAOD::Jet* >();
+  std::vector<TLorentzVector> originalJetKinematics;
+
+  eventInfo->setRunNumber( cache.runNumber );
+  eventInfo->setEventNumber( cache.eventNumber );
+  m_mcEventWeight = cache.mcEventWeight;
+
+  for(int iJet=0; iJet < cache.njet; ++iJet){
+    xAOD::Jet* jet = new xAOD::Jet();
+    cacheJets->push_back( jet );
+    jet->setJetP4( xAOD::JetFourMom_t( cache.pt.at(iJet), cache.eta.at(iJet), cache.phi.at(iJet), cache.m.at(iJet) ) );
+    jet->setJetP4( "JetGSCScaleMomentum", xAOD::JetFourMom_t( cache.gscPt.at(iJet), cache.gscEta.at(iJet), cache.gscPhi.at(iJet), cache.gscM.at(iJet) ) );
+    // Only the pt of the pileup scale is needed by the JVT update, unless it is a cached calibration stage
+    jet->setJetP4( "JetPileupScaleMomentum", xAOD::JetFourMom_t( cache.pileupPt.at(iJet), cache.eta.at(iJet), cache.phi.at(iJet), 0. ) );
+    for(unsigned int iS=0; iS < m_JCSStrings.size(); ++iS){
+      jet->setJetP4( m_JCSStrings.at(iS), xAOD::JetFourMom_t( cache.stagePt.at(iS).at(iJet), cache.stageEta.at(iS).at(iJet), cache.stagePhi.at(iS).at(iJet), cache.stageM.at(iS).at(iJet) ) );
+    }
+    jet->setAttribute<float>( "JvtJvfcorr", cache.jvfcorr.at(iJet) );
+    jet->setAttribute<float>( "JvtRpt", cache.jvtRpt.at(iJet) );
+    jet->setAttribute<float>( "EMFrac", cache.EMFrac.at(iJet) );
+    jet->setAttribute<float>( "HECFrac", cache.HECFrac.at(iJet) );
+    jet->auxdecor< float >( "detEta" ) = cache.detEta.at(iJet);
+    jet->auxdecor< float >( "jetCorr" ) = cache.jetCorr.at(iJet);
+    jet->auxdecor< float >( "TileFrac" ) = cache.TileFrac.at(iJet);
+    jet->auxdecor< char >( "cleanJet" ) = cache.clean.at(iJet);
+    originalSignalJets->push_back( jet );
+
+    TLorentzVector thisJet;
+    thisJet.SetPtEtaPhiE(jet->pt(), jet->eta(), jet->phi(), jet->e());
+    originalJetKinematics.push_back(thisJet);
+  }
+
+  EL::StatusCode status = runVariations( eventInfo, originalSignalJets, originalJetKinematics );
+
+  delete originalSignalJets;
+  delete cacheJets; delete cacheJetsAux;
+  delete eventInfo;
+
+  return status;
+}
@@ -0,0 +1,269 @@
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <TFile.h>
+#include <TKey.h>
+#include <TH2.h>
+
+#include "MultijetBalance/BootstrapRebinner.h"
+#include "MultijetBalance/NominalToyCache.h"
+
+using namespace std;
+
+namespace {
+  const char cacheMagic[8] = {'M','J','B','N','O','M','C','1'};
+  const long long cacheVersion = 1;
+}
+
+NominalToyCache :: NominalToyCache() :
+  m_map(NULL),
+  m_mapSize(0),
+  m_header(NULL),
+  m_xEdges(NULL),
+  m_yEdges(NULL),
+  m_records(NULL)
+{
+}
+
+NominalToyCache :: ~NominalToyCache()
+{
+  close();
+}
+
+std::string NominalToyCache::cacheName( const std::string& inFileName, const std::string& iteration ){
+  return inFileName+"."+iteration+"_Nominal.cache";
+}
+
+// toy number, entries, moments, contents and errors squared
+std::size_t NominalToyCache::recordSize( long long nBinsX, long long nBinsY ){
+  return 2 + BalanceMoments::nMoments*(nBinsX+1) + 2*(nBinsX+2)*(nBinsY+2);
+}
+
+bool NominalToyCache::build( TFile* inFile, const std::string& inFileName, const std::string& iteration ){
+
+  struct stat inputStat;
+  if( stat(inFileName.c_str(), &inputStat) != 0 ){
+    cout << "Error, could not stat " << inFileName << endl;
+    return false;
+  }
+
+  // The full histogram goes first, then the toys in file order
+  std::string nominalName = iteration+"_Nominal";
+  std::vector<std::string> dirNames;
+  dirNames.push_back( nominalName );
+  TIter next(inFile->GetListOfKeys());
+  TKey *key;
+  while ((key = (TKey*)next() )){
+    std::string dirName = BootstrapRebinner::stripFlatSuffix( key->GetName() );
+    if( dirName.find(nominalName+"_") != 0 )
+      continue;
+    if( BootstrapRebinner::isInteger( dirName.substr(nominalName.size()+1) ) )
+      dirNames.push_back( dirName );
+  }
+
+  std::string tmpName = cacheName(inFileName, iteration)+".tmp"+to_string(getpid());
+  FILE* cacheFile = fopen(tmpName.c_str(), "wb");
+  if( !cacheFile ){
+    cout << "Error, could not create " << tmpName << endl;
+    return false;
+  }
+
+  bool written = true;
+  std::vector<double> record;
+  for(unsigned int iD=0; iD < dirNames.size() && written; ++iD){
+    TH2* h_recoilPt_PtBal = BootstrapRebinner::getBalanceHist( inFile, dirNames.at(iD) );
+    if( !h_recoilPt_PtBal ){
+      cout << "Error, could not retrieve recoilPt_PtBal for " << dirNames.at(iD) << endl;
+      written = false;
+      break;
+    }
+    TH2F* rebinHist = BootstrapRebinner::initialRebin( h_recoilPt_PtBal );
+    delete h_recoilPt_PtBal;
+
+    long long nBinsX = rebinHist->GetNbinsX();
+    long long nBinsY = rebinHist->GetNbinsY();
+
+    if( iD == 0 ){
+      Header header;
+      memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+      header.version = cacheVersion;
+      header.nRecords = dirNames.size();
+      header.nBinsX = nBinsX;
+      header.nBinsY = nBinsY;
+      header.inputSize = inputStat.st_size;
+      header.inputMTime = inputStat.st_mtime;
+      written = (fwrite(&header, sizeof(Header), 1, cacheFile) == 1);
+
+      std::vector<double> edges;
+      for(int iBin=1; iBin <= nBinsX+1; ++iBin)
+        edges.push_back( rebinHist->GetXaxis()->GetBinLowEdge(iBin) );
+      for(int iBin=1; iBin <= nBinsY+1; ++iBin)
+        edges.push_back( rebinHist->GetYaxis()->GetBinLowEdge(iBin) );
+      written = written && (fwrite(&edges[0], sizeof(double), edges.size(), cacheFile) == edges.size());
+      record.assign( recordSize(nBinsX, nBinsY), 0. );
+    }
+
+    std::string toyNum = dirNames.at(iD).substr( dirNames.at(iD).find_last_of('_')+1 );
+    record[0] = (iD == 0) ? -1 : std::stoi(toyNum);
+    record[1] = rebinHist->GetEntries();
+    BalanceMoments(rebinHist).pack( &record[2] );
+    double* contents = &record[2 + BalanceMoments::nMoments*(nBinsX+1)];
+    double* errors2 = contents + (nBinsX+2)*(nBinsY+2);
+    for(int iBinX=0; iBinX < nBinsX+2; ++iBinX){
+      for(int iBinY=0; iBinY < nBinsY+2; ++iBinY){
+        int iCell = iBinX*(nBinsY+2)+iBinY;
+        double error = rebinHist->GetBinError(iBinX, iBinY);
+        contents[iCell] = rebinHist->GetBinContent(iBinX, iBinY);
+        errors2[iCell] = error*error;
+      }
+    }
+    delete rebinHist;
+
+    written = written && (fwrite(&record[0], sizeof(double), record.size(), cacheFile) == record.size());
+  }
+
+  written = (fclose(cacheFile) == 0) && written;
+  if( !written || rename(tmpName.c_str(), cacheName(inFileName, iteration).c_str()) != 0 ){
+    cout << "Error writing Nominal toy cache " << tmpName << endl;
+    remove(tmpName.c_str());
+    return false;
+  }
+
+  cout << "Wrote Nominal toy cache " << cacheName(inFileName, iteration) << " with " << dirNames.size()-1 << " toys" << endl;
+  return true;
+}
+
+bool NominalToyCache::open( const std::string& inFileName, const std::string& iteration ){
+
+  close();
+
+  struct stat inputStat, cacheStat;
+  std::string fileName = cacheName(inFileName, iteration);
+  if( stat(inFileName.c_str(), &inputStat) != 0 || stat(fileName.c_str(), &cacheStat) != 0 )
+    return false;
+  if( cacheStat.st_size < (off_t) sizeof(Header) )
+    return false;
+
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  if( fd < 0 )
+    return false;
+  void* map = mmap(NULL, cacheStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if( map == MAP_FAILED )
+    return false;
+
+  m_map = map;
+  m_mapSize = cacheStat.st_size;
+  m_header = (const Header*) m_map;
+
+  // Anything unexpected is treated as a stale cache
+  bool valid = memcmp(m_header->magic, cacheMagic, sizeof(cacheMagic)) == 0
+            && m_header->version == cacheVersion
+            && m_header->inputSize == inputStat.st_size
+            && m_header->inputMTime == inputStat.st_mtime
+            && m_header->nRecords > 0;
+  if( valid ){
+    std::size_t expectedSize = sizeof(Header) + sizeof(double)*( (m_header->nBinsX+1) + (m_header->nBinsY+1)
+                               + m_header->nRecords*recordSize(m_header->nBinsX, m_header->nBinsY) );
+    valid = (expectedSize == m_mapSize);
+  }
+  if( !valid ){
+    cout << "Nominal toy cache " << fileName << " is stale, ignoring it" << endl;
+    close();
+    return false;
+  }
+
+  m_xEdges = (const double*) ((const char*) m_map + sizeof(Header));
+  m_yEdges = m_xEdges + m_header->nBinsX+1;
+  m_records = m_yEdges + m_header->nBinsY+1;
+
+  // A cache made with another initial binning is stale too
+  const std::vector<double>& xEdges = BootstrapRebinner::initialRecoilPtEdges();
+  const std::vector<double>& yEdges = BootstrapRebinner::initialPtBalEdges();
+  if( xEdges.size() != (std::size_t) m_header->nBinsX+1 || yEdges.size() != (std::size_t) m_header->nBinsY+1
+      || !std::equal( xEdges.begin(), xEdges.end(), m_xEdges ) || !std::equal( yEdges.begin(), yEdges.end(), m_yEdges ) ){
+    cout << "Nominal toy cache " << fileName << " has another initial binning, ignoring it" << endl;
+    close();
+    return false;
+  }
+  return true;
+}
+
+void NominalToyCache::close(){
+  if( m_map )
+    munmap(m_map, m_mapSize);
+  m_map = NULL;
+  m_mapSize = 0;
+  m_header = NULL;
+  m_xEdges = m_yEdges = m_records = NULL;
+}
+
+unsigned int NominalToyCache::nToys() const {
+  return m_header ? m_header->nRecords-1 : 0;
+}
+
+TH2F* NominalToyCache::makeHist( const std::string& name, const double* record ) const {
+  int nBinsX = m_header->nBinsX;
+  int nBinsY = m_header->nBinsY;
+  TH2F* hist = new TH2F( name.c_str(), name.c_str(), nBinsX, m_xEdges, nBinsY, m_yEdges );
+  hist->SetDirectory(0);
+  hist->Sumw2();
+
+  const double* contents = record + 2 + BalanceMoments::nMoments*(nBinsX+1);
+  const double* errors2 = contents + (nBinsX+2)*(nBinsY+2);
+  for(int iBinX=0; iBinX < nBinsX+2; ++iBinX){
+    for(int iBinY=0; iBinY < nBinsY+2; ++iBinY){
+      int iCell = iBinX*(nBinsY+2)+iBinY;
+      if( contents[iCell] == 0. && errors2[iCell] == 0. )
+        continue;
+      hist->SetBinContent(iBinX, iBinY, contents[iCell]);
+      hist->SetBinError(iBinX, iBinY, sqrt(errors2[iCell]));
+    }
+  }
+  hist->SetEntries( record[1] );
+  return hist;
+}
+
+bool NominalToyCache::fill( BootstrapVariation& var, bool keepHists, const std::vector<int>& toyNumbers ) const {
+
+  if( !m_header )
+    return false;
+
+  int nBinsX = m_header->nBinsX;
+  std::size_t thisRecordSize = recordSize(m_header->nBinsX, m_header->nBinsY);
+  for(long long iR=0; iR < m_header->nRecords; ++iR){
+    const double* record = m_records + iR*thisRecordSize;
+    int toyNumber = record[0];
+
+    if( toyNumber < 0 ){
+      delete var.full;
+      var.full = makeHist( "recoilPt_PtBal", record );
+      var.fullMoments.unpack( nBinsX, record+2 );
+      continue;
+    }
+
+    if( toyNumbers.size() > 0 ){
+      bool wanted = false;
+      for(unsigned int iT=0; iT < toyNumbers.size() && !wanted; ++iT)
+        wanted = (toyNumbers.at(iT) == toyNumber);
+      if( !wanted )
+        continue;
+    }
+
+    var.toyMoments.push_back( BalanceMoments() );
+    var.toyMoments.back().unpack( nBinsX, record+2 );
+    var.toyNumbers.push_back( toyNumber );
+    // The fits project a TH2F, so fit mode copies each toy out of the map
+    if( keepHists )
+      var.toys.push_back( makeHist( "recoilPt_PtBal_"+to_string(toyNumber), record ) );
+  }
+
+  return true;
+}
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <RVersion.h>
+#include <TFile.h>
+#include <TTree.h>
+
+#include "MultijetBalance/OutputPolicy.h"
+
+using namespace std;
+
+OutputPolicy :: OutputPolicy() :
+  m_algorithm(0),
+  m_level(-1),
+  m_autoFlush(0),
+  m_basketSize(0)
+{
+}
+
+bool OutputPolicy::parse( const std::string& policy ){
+  std::vector<std::string> fields;
+  std::stringstream ss(policy);
+  std::string thisField;
+  while( std::getline(ss, thisField, ':') )
+    fields.push_back( thisField );
+  if( fields.size() == 0 || fields.size() > 4 ){
+    cout << "OutputPolicy: " << policy << " is not ALGO[:level[:autoFlush[:basketSize]]]" << endl;
+    return false;
+  }
+
+  int algorithm = 0;
+  if( fields.at(0) == "ZLIB" )
+    algorithm = 1;
+  else if( fields.at(0) == "LZMA" )
+    algorithm = 2;
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,12,0)
+  else if( fields.at(0) == "LZ4" )
+    algorithm = 4;
+#endif
+  else if( fields.at(0) != "DEFAULT" ){
+    cout << "OutputPolicy: unknown or unavailable compression algorithm " << fields.at(0) << " in " << policy << endl;
+    return false;
+  }
+
+  int level = -1;
+  Long64_t autoFlush = 0;
+  int basketSize = 0;
+  try{
+    if( fields.size() > 1 && fields.at(1).size() > 0 )
+      level = std::stoi( fields.at(1) );
+    if( fields.size() > 2 && fields.at(2).size() > 0 )
+      autoFlush = std::stoll( fields.at(2) );
+    if( fields.size() > 3 && fields.at(3).size() > 0 )
+      basketSize = std::stoi( fields.at(3) );
+  }catch( const std::exception& ){
+    cout << "OutputPolicy: " << policy << " has a non-integer level, autoFlush or basketSize" << endl;
+    return false;
+  }
+  if( level > 9 || basketSize < 0 ){
+    cout << "OutputPolicy: " << policy << " needs a level of at most 9 and a positive basketSize" << endl;
+    return false;
+  }
+
+  m_algorithm = algorithm;
+  m_level = level;
+  m_autoFlush = autoFlush;
+  m_basketSize = basketSize;
+  return true;
+}
+
+bool OutputPolicy::parseList( const std::string& policies, std::map< std::string, OutputPolicy >& policyMap ){
+  std::stringstream ss(policies);
+  std::string thisEntry;
+  while( std::getline(ss, thisEntry, ',') ){
+    if( thisEntry.size() == 0 )
+      continue;
+    size_t pos = thisEntry.find('=');
+    if( pos == std::string::npos || pos == 0 ){
+      cout << "OutputPolicy: " << thisEntry << " is not stream=policy" << endl;
+      return false;
+    }
+    OutputPolicy thisPolicy;
+    if( !thisPolicy.parse( thisEntry.substr(pos+1) ) )
+      return false;
+    policyMap[ thisEntry.substr(0, pos) ] = thisPolicy;
+  }
+  return true;
+}
+
+void OutputPolicy::apply( TFile* file ) const {
+  if( !file )
+    return;
+  if( m_algorithm > 0 )
+    file->SetCompressionAlgorithm( m_algorithm );
+  if( m_level >= 0 )
+    file->SetCompressionLevel( m_level );
+}
+
+void OutputPolicy::apply( TTree* tree ) const {
+  if( !tree )
+    return;
+  if( m_autoFlush != 0 )
+    tree->SetAutoFlush( m_autoFlush );
+  if( m_basketSize > 0 )
+    tree->SetBasketSize( "*", m_basketSize );
+}
+
+std::string OutputPolicy::str() const {
+  std::string algoName = "DEFAULT";
+  if( m_algorithm == 1 )
+    algoName = "ZLIB";
+  else if( m_algorithm == 2 )
+    algoName = "LZMA";
+  else if( m_algorithm == 4 )
+    algoName = "LZ4";
+
+  std::stringstream ss;
+  ss << algoName << ":";
+  if( m_level >= 0 )
+    ss << m_level;
+  ss << ":" << m_autoFlush << ":" << m_basketSize;
+  return ss.str();
+}
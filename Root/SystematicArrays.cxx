@@ -0,0 +1,408 @@
+#include <iostream>
+#include <set>
+#include <cmath>
+#include <cctype>
+
+#include <TDirectory.h>
+#include <TKey.h>
+#include <TClass.h>
+#include <TH1.h>
+#include <TAxis.h>
+#include <TArrayD.h>
+
+#include "MultijetBalance/SystematicArrays.h"
+
+using namespace std;
+
+namespace {
+
+bool sameAxis( const TAxis* a, const TAxis* b ){
+  if( a->GetNbins() != b->GetNbins() || a->GetXmin() != b->GetXmin() || a->GetXmax() != b->GetXmax() )
+    return false;
+  if( a->GetXbins()->GetSize() != b->GetXbins()->GetSize() )
+    return false;
+  for(int iEdge=0; iEdge < a->GetXbins()->GetSize(); ++iEdge){
+    if( a->GetXbins()->At(iEdge) != b->GetXbins()->At(iEdge) )
+      return false;
+  }
+  return true;
+}
+
+// The mc directory a bootstrap toy <sys>_<i> of data mirrors, "" if name is not a toy
+std::string toyParent( const std::string& name ){
+  size_t underscore = name.find_last_of('_');
+  if( underscore == std::string::npos || underscore+1 == name.size() )
+    return "";
+  for(size_t iChar=underscore+1; iChar < name.size(); ++iChar){
+    if( !isdigit( name.at(iChar) ) )
+      return "";
+  }
+  return name.substr(0, underscore);
+}
+
+}
+
+SystematicArrays :: SystematicArrays()
+{
+}
+
+SystematicArrays :: ~SystematicArrays()
+{
+  clear();
+}
+
+void SystematicArrays::clear(){
+  for(unsigned int iEntry=0; iEntry < m_entryHists.size(); ++iEntry)
+    delete m_entryHists.at(iEntry);
+  m_dirNames.clear();
+  m_dirEntries.clear();
+  m_dirEntryIndex.clear();
+  m_entryNames.clear();
+  m_entryHists.clear();
+  m_entryCells.clear();
+  m_entryOffsets.clear();
+  m_content.clear();
+  m_error.clear();
+}
+
+int SystematicArrays::findDir( const std::string& name ) const {
+  for(unsigned int iDir=0; iDir < m_dirNames.size(); ++iDir){
+    if( m_dirNames.at(iDir) == name )
+      return iDir;
+  }
+  return -1;
+}
+
+int SystematicArrays::findNominal() const {
+  for(unsigned int iDir=0; iDir < m_dirNames.size(); ++iDir){
+    if( m_dirNames.at(iDir).find("Nominal") != std::string::npos )
+      return iDir;
+  }
+  return -1;
+}
+
+int SystematicArrays::nominalDir() const {
+  int iNominal = -1;
+  for(unsigned int iDir=0; iDir < m_dirNames.size(); ++iDir){
+    if( m_dirNames.at(iDir).find("Nominal") != std::string::npos ){
+      if( iNominal >= 0 ){
+        cout << "SystematicArrays: both " << m_dirNames.at(iNominal) << " and " << m_dirNames.at(iDir) << " are nominal" << endl;
+        return -1;
+      }
+      iNominal = iDir;
+    }
+  }
+  if( iNominal < 0 )
+    cout << "SystematicArrays: no Nominal directory" << endl;
+  return iNominal;
+}
+
+int SystematicArrays::findEntry( unsigned int iDir, const std::string& name ) const {
+  std::map<std::string, int>::const_iterator it = m_dirEntryIndex.at(iDir).find( name );
+  return it == m_dirEntryIndex.at(iDir).end() ? -1 : it->second;
+}
+
+unsigned int SystematicArrays::addDir( const std::string& name ){
+  m_dirNames.push_back( name );
+  m_dirEntries.push_back( std::vector<int>() );
+  m_dirEntryIndex.push_back( std::map<std::string, int>() );
+  return m_dirNames.size()-1;
+}
+
+int SystematicArrays::addEntry( unsigned int iDir, const std::string& name, const TH1* binning ){
+  TH1* hist = (TH1*) binning->Clone( name.c_str() );
+  hist->SetDirectory(0);
+  int iEntry = m_entryNames.size();
+  m_entryNames.push_back( name );
+  m_entryHists.push_back( hist );
+  m_entryCells.push_back( hist->GetNcells() );
+  m_entryOffsets.push_back( m_content.size() );
+  m_content.resize( m_content.size()+hist->GetNcells(), 0. );
+  m_error.resize( m_error.size()+hist->GetNcells(), 0. );
+  m_dirEntries.at(iDir).push_back( iEntry );
+  m_dirEntryIndex.at(iDir)[name] = iEntry;
+  return iEntry;
+}
+
+bool SystematicArrays::load( TDirectory* dir, const std::string& histFilter ){
+  clear();
+
+  // Keys are sorted newest cycle first
+  std::set<std::string> seenDirs;
+  TIter nextDir( dir->GetListOfKeys() );
+  TKey* dirKey;
+  while( (dirKey = (TKey*) nextDir()) ){
+    std::string dirName = dirKey->GetName();
+    TClass* dirClass = TClass::GetClass( dirKey->GetClassName() );
+    if( dirName.find("Iteration") == std::string::npos || !dirClass || !dirClass->InheritsFrom( TDirectory::Class() ) )
+      continue;
+    if( !seenDirs.insert( dirName ).second )
+      continue;
+
+    TDirectory* inDir = dir->GetDirectory( dirName.c_str() );
+    if( !inDir ){
+      cout << "SystematicArrays: could not read " << dirName << endl;
+      return false;
+    }
+    unsigned int iDir = addDir( dirName );
+
+    std::set<std::string> seenHists;
+    TIter nextHist( inDir->GetListOfKeys() );
+    TKey* histKey;
+    while( (histKey = (TKey*) nextHist()) ){
+      std::string histName = histKey->GetName();
+      TClass* histClass = TClass::GetClass( histKey->GetClassName() );
+      if( histName.find( histFilter ) == std::string::npos || !histClass || !histClass->InheritsFrom( TH1::Class() ) )
+        continue;
+      if( !seenHists.insert( histName ).second )
+        continue;
+
+      TH1* hist = dynamic_cast<TH1*>( histKey->ReadObj() );
+      if( !hist ){
+        cout << "SystematicArrays: could not read " << dirName << "/" << histName << endl;
+        return false;
+      }
+      hist->SetDirectory(0);
+      int iEntry = addEntry( iDir, histName, hist );
+      double* thisContent = content( iEntry );
+      double* thisError = error( iEntry );
+      for(int iCell=0; iCell < numCells( iEntry ); ++iCell){
+        thisContent[iCell] = hist->GetBinContent(iCell);
+        thisError[iCell] = hist->GetBinError(iCell);
+      }
+      delete hist;
+    }
+  }
+  return true;
+}
+
+bool SystematicArrays::write( TDirectory* dir ) const {
+  for(unsigned int iDir=0; iDir < m_dirNames.size(); ++iDir){
+    TDirectory* outDir = dir->mkdir( m_dirNames.at(iDir).c_str() );
+    if( !outDir ){
+      cout << "SystematicArrays: could not create " << m_dirNames.at(iDir) << endl;
+      return false;
+    }
+    for(unsigned int iE=0; iE < m_dirEntries.at(iDir).size(); ++iE){
+      int iEntry = m_dirEntries.at(iDir).at(iE);
+      TH1* hist = (TH1*) m_entryHists.at(iEntry)->Clone( m_entryNames.at(iEntry).c_str() );
+      hist->SetDirectory(0);
+      if( hist->GetSumw2N() == 0 )
+        hist->Sumw2();
+      double entries = hist->GetEntries();
+      const double* thisContent = content( iEntry );
+      const double* thisError = error( iEntry );
+      for(int iCell=0; iCell < numCells( iEntry ); ++iCell){
+        hist->SetBinContent( iCell, thisContent[iCell] );
+        hist->SetBinError( iCell, thisError[iCell] );
+      }
+      hist->SetEntries( entries );
+      int nBytes = outDir->WriteTObject( hist, m_entryNames.at(iEntry).c_str() );
+      delete hist;
+      if( nBytes <= 0 ){
+        cout << "SystematicArrays: could not write " << m_dirNames.at(iDir) << "/" << m_entryNames.at(iEntry) << endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool SystematicArrays::sameBinning( const TH1* a, const TH1* b ){
+  if( a->GetDimension() != b->GetDimension() || a->GetNcells() != b->GetNcells() )
+    return false;
+  if( !sameAxis( a->GetXaxis(), b->GetXaxis() ) )
+    return false;
+  if( a->GetDimension() > 1 && !sameAxis( a->GetYaxis(), b->GetYaxis() ) )
+    return false;
+  if( a->GetDimension() > 2 && !sameAxis( a->GetZaxis(), b->GetZaxis() ) )
+    return false;
+  return true;
+}
+
+bool SystematicArrays::doubleRatio( const SystematicArrays& data, const SystematicArrays& mc, bool mirrorToys, bool mcNominalOnly,
+                                    const std::string& histFilter, SystematicArrays& out ){
+  out.clear();
+  // The toys of bootstrap files are nominal directories too, the first one is used
+  int dataNominal = data.findNominal();
+  int mcNominal = mc.findNominal();
+  if( dataNominal < 0 || mcNominal < 0 ){
+    cout << "SystematicArrays: no Nominal directory in " << (dataNominal < 0 ? "data" : "MC") << endl;
+    return false;
+  }
+
+  // There are more systematics for data than for MC
+  std::vector<std::string> outDirs;
+  std::vector<int> dataDirs, mcDirs;
+  for(unsigned int iData=0; iData < data.numDirs(); ++iData){
+    int iMC = mcNominalOnly ? -1 : mc.findDir( data.dirName(iData) );
+    if( iMC < 0 && mirrorToys && toyParent( data.dirName(iData) ).size() > 0 )
+      iMC = mc.findDir( toyParent( data.dirName(iData) ) );
+    outDirs.push_back( data.dirName(iData) );
+    dataDirs.push_back( iData );
+    mcDirs.push_back( iMC < 0 ? mcNominal : iMC );
+  }
+  for(unsigned int iMC=0; iMC < mc.numDirs() && !mcNominalOnly; ++iMC){
+    if( data.findDir( mc.dirName(iMC) ) < 0 ){
+      outDirs.push_back( mc.dirName(iMC) );
+      dataDirs.push_back( dataNominal );
+      mcDirs.push_back( iMC );
+    }
+  }
+
+  for(unsigned int iOut=0; iOut < outDirs.size(); ++iOut){
+    unsigned int iOutDir = out.addDir( outDirs.at(iOut) );
+    const std::vector<int>& mcEntries = mc.dirEntries( mcDirs.at(iOut) );
+    for(unsigned int iE=0; iE < mcEntries.size(); ++iE){
+      int iMCEntry = mcEntries.at(iE);
+      const std::string& histName = mc.entryName( iMCEntry );
+      if( histName.find( histFilter ) == std::string::npos )
+        continue;
+      int iDataEntry = data.findEntry( dataDirs.at(iOut), histName );
+      if( iDataEntry < 0 ){
+        cout << "SystematicArrays: " << mc.dirName( mcDirs.at(iOut) ) << "/" << histName << " is in MC but not in "
+             << data.dirName( dataDirs.at(iOut) ) << " of data" << endl;
+        return false;
+      }
+      if( !sameBinning( data.entryHist( iDataEntry ), mc.entryHist( iMCEntry ) ) ){
+        cout << "SystematicArrays: " << histName << " of " << outDirs.at(iOut) << " has a different binning in data and MC" << endl;
+        return false;
+      }
+
+      const TH1* dataHist = data.entryHist( iDataEntry );
+      int iOutEntry = out.addEntry( iOutDir, "Double"+histName, dataHist );
+      TH1* outHist = out.m_entryHists.at( iOutEntry );
+      outHist->SetTitle( ("Double "+std::string(dataHist->GetTitle())).c_str() );
+      outHist->GetYaxis()->SetTitle("Double MJB");
+
+      const double* d = data.content( iDataEntry );
+      const double* dErr = data.error( iDataEntry );
+      const double* m = mc.content( iMCEntry );
+      const double* mErr = mc.error( iMCEntry );
+      double* r = out.content( iOutEntry );
+      double* rErr = out.error( iOutEntry );
+      const int nCells = out.numCells( iOutEntry );
+      for(int iCell=0; iCell < nCells; ++iCell){
+        if( m[iCell] == 0. ){
+          r[iCell] = 0.;
+          rErr[iCell] = 0.;
+          continue;
+        }
+        double m2 = m[iCell]*m[iCell];
+        r[iCell] = d[iCell]/m[iCell];
+        rErr[iCell] = sqrt( dErr[iCell]*dErr[iCell]*m2 + mErr[iCell]*mErr[iCell]*d[iCell]*d[iCell] )/m2;
+      }
+    }
+  }
+  return true;
+}
+
+bool SystematicArrays::relativeShifts( const SystematicArrays& in, const SystematicArrays* reference, SystematicArrays& out ){
+  out.clear();
+  int nominal = in.nominalDir();
+  if( nominal < 0 )
+    return false;
+
+  for(unsigned int iDir=0; iDir < in.numDirs(); ++iDir){
+    unsigned int iOutDir = out.addDir( in.dirName(iDir) );
+    const SystematicArrays* nomArrays = &in;
+    int nomDir = nominal;
+    if( reference && reference->findDir( in.dirName(iDir) ) >= 0 ){
+      nomArrays = reference;
+      nomDir = reference->findDir( in.dirName(iDir) );
+    }
+
+    const std::vector<int>& entries = in.dirEntries( iDir );
+    for(unsigned int iE=0; iE < entries.size(); ++iE){
+      int iEntry = entries.at(iE);
+      const std::string& histName = in.entryName( iEntry );
+      const int nCells = in.numCells( iEntry );
+
+      if( (int) iDir == nominal ){
+        int iOutEntry = out.addEntry( iOutDir, histName, in.entryHist( iEntry ) );
+        std::copy( in.content(iEntry), in.content(iEntry)+nCells, out.content(iOutEntry) );
+        std::copy( in.error(iEntry), in.error(iEntry)+nCells, out.error(iOutEntry) );
+        continue;
+      }
+
+      int iNomEntry = nomArrays->findEntry( nomDir, histName );
+      if( iNomEntry < 0 || !sameBinning( in.entryHist( iEntry ), nomArrays->entryHist( iNomEntry ) ) ){
+        cout << "SystematicArrays: no nominal " << histName << " of the binning of " << in.dirName(iDir) << endl;
+        return false;
+      }
+
+      int iOutEntry = out.addEntry( iOutDir, "diff_"+histName, in.entryHist( iEntry ) );
+      const double* s = in.content( iEntry );
+      const double* sErr = in.error( iEntry );
+      const double* n = nomArrays->content( iNomEntry );
+      const double* nErr = nomArrays->error( iNomEntry );
+      double* r = out.content( iOutEntry );
+      double* rErr = out.error( iOutEntry );
+      for(int iCell=0; iCell < nCells; ++iCell){
+        if( n[iCell] == 0. ){
+          r[iCell] = 0.;
+          rErr[iCell] = 0.;
+          continue;
+        }
+        double diff = s[iCell]-n[iCell];
+        double diffErr2 = sErr[iCell]*sErr[iCell] + nErr[iCell]*nErr[iCell];
+        double n2 = n[iCell]*n[iCell];
+        r[iCell] = diff/n[iCell];
+        rErr[iCell] = sqrt( diffErr2*n2 + nErr[iCell]*nErr[iCell]*diff*diff )/n2;
+      }
+    }
+  }
+  return true;
+}
+
+bool SystematicArrays::combine( const SystematicArrays& in, const std::vector<std::string>& groupNames,
+                                const std::vector< std::vector<unsigned int> >& groupDirs, SystematicArrays& out ){
+  out.clear();
+  int nominal = in.nominalDir();
+  if( nominal < 0 )
+    return false;
+
+  const std::vector<int>& nomEntries = in.dirEntries( nominal );
+  for(unsigned int iGroup=0; iGroup < groupNames.size(); ++iGroup){
+    unsigned int iOutDir = out.addDir( "Combined_"+groupNames.at(iGroup) );
+    for(unsigned int iE=0; iE < nomEntries.size(); ++iE){
+      int iNomEntry = nomEntries.at(iE);
+      const std::string& histName = in.entryName( iNomEntry );
+      const TH1* nomHist = in.entryHist( iNomEntry );
+      // Bands are only drawn for 1D histograms
+      if( nomHist->GetDimension() != 1 || histName.find("prof_") != std::string::npos || histName.find("ptSlice") != std::string::npos )
+        continue;
+
+      int iUp = out.addEntry( iOutDir, histName+"_Up", nomHist );
+      int iDn = out.addEntry( iOutDir, histName+"_Dn", nomHist );
+      double* up = out.content( iUp );
+      double* dn = out.content( iDn );
+      const double* n = in.content( iNomEntry );
+      // Under and overflows stay 0
+      const int lastBin = in.numCells( iNomEntry )-2;
+
+      for(unsigned int iD=0; iD < groupDirs.at(iGroup).size(); ++iD){
+        unsigned int iDir = groupDirs.at(iGroup).at(iD);
+        int iEntry = in.findEntry( iDir, histName );
+        if( iEntry < 0 || !sameBinning( in.entryHist( iEntry ), nomHist ) ){
+          cout << "SystematicArrays: " << in.dirName(iDir) << " has no " << histName << " of the nominal binning" << endl;
+          return false;
+        }
+        const double* s = in.content( iEntry );
+        for(int iBin=1; iBin <= lastBin; ++iBin){
+          double shift = n[iBin] != 0. ? (s[iBin]-n[iBin])/n[iBin] : 0.;
+          if( shift > 0. )
+            up[iBin] += shift*shift;
+          else
+            dn[iBin] += shift*shift;
+        }
+      }
+
+      for(int iBin=1; iBin <= lastBin; ++iBin){
+        up[iBin] = sqrt( up[iBin] );
+        dn[iBin] = -sqrt( dn[iBin] );
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,138 @@
+#include "MultijetBalance/ThreadPool.h"
+
+namespace {
+  // Lets submit() and workerIndex() know which worker (if any) is calling
+  thread_local const ThreadPool* t_pool = nullptr;
+  thread_local int t_workerIndex = -1;
+}
+
+ThreadPool :: ThreadPool(unsigned int nThreads, unsigned int maxQueued) :
+  m_maxQueued(maxQueued),
+  m_nextQueue(0),
+  m_queued(0),
+  m_active(0),
+  m_stop(false)
+{
+  if( nThreads == 0 )
+    nThreads = std::thread::hardware_concurrency();
+  if( nThreads == 0 )
+    nThreads = 1;
+
+  for(unsigned int iT=0; iT < nThreads; ++iT){
+    m_queues.push_back( new WorkerQueue() );
+  }
+  for(unsigned int iT=0; iT < nThreads; ++iT){
+    m_threads.push_back( std::thread( &ThreadPool::run, this, iT ) );
+  }
+}
+
+ThreadPool :: ~ThreadPool()
+{
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_taskReady.notify_all();
+  m_taskDone.notify_all();
+  for(unsigned int iT=0; iT < m_threads.size(); ++iT){
+    m_threads.at(iT).join();
+  }
+  for(unsigned int iT=0; iT < m_queues.size(); ++iT){
+    delete m_queues.at(iT);
+  }
+}
+
+int ThreadPool::workerIndex() const {
+  return (t_pool == this) ? t_workerIndex : -1;
+}
+
+void ThreadPool::submit( std::function<void()> task ){
+  int iWorker = workerIndex();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  // Never block a worker, it may be the one that has to drain the queue
+  if( m_maxQueued > 0 && iWorker < 0 )
+    m_taskDone.wait(lock, [this]{ return m_queued < m_maxQueued || m_stop; });
+
+  unsigned int iQueue;
+  if( iWorker >= 0 ){
+    iQueue = iWorker;
+  }else{
+    iQueue = m_nextQueue;
+    m_nextQueue = (m_nextQueue+1) % m_queues.size();
+  }
+
+  // Count the task before it becomes visible to the workers
+  ++m_queued;
+  {
+    std::lock_guard<std::mutex> queueLock( m_queues.at(iQueue)->mutex );
+    m_queues.at(iQueue)->tasks.push_back( task );
+  }
+  m_taskReady.notify_one();
+}
+
+// Block until every submitted task has finished
+void ThreadPool::wait(){
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_taskDone.wait(lock, [this]{ return (m_queued == 0 && m_active == 0) || m_stop; });
+}
+
+// Newest task of this worker's own deque
+bool ThreadPool::popLocal(unsigned int iWorker, std::function<void()>& task){
+  WorkerQueue* queue = m_queues.at(iWorker);
+  std::lock_guard<std::mutex> queueLock( queue->mutex );
+  if( queue->tasks.empty() )
+    return false;
+  task = queue->tasks.back();
+  queue->tasks.pop_back();
+  return true;
+}
+
+// Oldest task of any other worker's deque
+bool ThreadPool::steal(unsigned int iWorker, std::function<void()>& task){
+  for(unsigned int iOffset=1; iOffset < m_queues.size(); ++iOffset){
+    WorkerQueue* queue = m_queues.at( (iWorker+iOffset) % m_queues.size() );
+    std::lock_guard<std::mutex> queueLock( queue->mutex );
+    if( queue->tasks.empty() )
+      continue;
+    task = queue->tasks.front();
+    queue->tasks.pop_front();
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::run(unsigned int iWorker){
+  t_pool = this;
+  t_workerIndex = iWorker;
+
+  while( true ){
+    std::function<void()> task;
+    if( popLocal(iWorker, task) || steal(iWorker, task) ){
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_queued;
+        ++m_active;
+      }
+      // Wake a submit() waiting on the queue depth
+      m_taskDone.notify_all();
+
+      task();
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_active;
+      }
+      m_taskDone.notify_all();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if( m_stop && m_queued == 0 )
+      return;
+    m_taskReady.wait(lock, [this]{ return m_queued > 0 || m_stop; });
+    if( m_stop && m_queued == 0 )
+      return;
+  }
+}
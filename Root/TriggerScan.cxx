@@ -0,0 +1,292 @@
+#include <iostream>
+#include <algorithm>
+
+#include <TTree.h>
+#include <TBranch.h>
+#include <TLeaf.h>
+#include <TDirectory.h>
+#include <TH1F.h>
+
+#include "MultijetBalance/TriggerScan.h"
+
+using namespace std;
+
+const char* TriggerScanHists::typeNames[TriggerScanHists::nTypes] = { "wrong", "unbaised", "correct" };
+
+TriggerScanEvent :: TriggerScanEvent() :
+  flatJets(false), njet(0), weight(1.), recoilPt(0.),
+  jet_ptVector(NULL), passedTriggers(NULL)
+{
+  std::fill( jet_ptArray, jet_ptArray+maxJets, 0. );
+}
+
+TriggerScanEvent :: ~TriggerScanEvent()
+{
+  delete jet_ptVector;
+  delete passedTriggers;
+}
+
+bool TriggerScanEvent::connect( TTree* tree, bool useWeight ){
+  std::vector<const char*> required = { "recoilPt", "passedTriggers", "jet_pt" };
+  if( useWeight )
+    required.push_back( "weight" );
+  for( const char* branchName : required ){
+    if( !tree->GetBranch( branchName ) ){
+      cout << "Error, " << tree->GetName() << " has no branch " << branchName << endl;
+      return false;
+    }
+  }
+
+  // m_flatJetBranches trees hold jet_pt[njet] arrays instead of vectors
+  TLeaf* ptLeaf = tree->GetBranch("jet_pt")->GetLeaf("jet_pt");
+  flatJets = ptLeaf && ptLeaf->GetLeafCount();
+
+  tree->SetBranchStatus("*", 0);
+  for( const char* branchName : required )
+    tree->SetBranchStatus( branchName, 1 );
+
+  tree->SetBranchAddress("recoilPt", &recoilPt);
+  tree->SetBranchAddress("passedTriggers", &passedTriggers);
+  if( useWeight )
+    tree->SetBranchAddress("weight", &weight);
+  if( flatJets ){
+    tree->SetBranchStatus("njet", 1);
+    tree->SetBranchAddress("njet", &njet);
+    tree->SetBranchAddress("jet_pt", jet_ptArray);
+  }else{
+    tree->SetBranchAddress("jet_pt", &jet_ptVector);
+  }
+  return true;
+}
+
+void TriggerScanEvent::update( const std::vector<std::string>& triggerNames ){
+  passed.assign( triggerNames.size(), 0 );
+  for(unsigned int iPassed=0; iPassed < passedTriggers->size(); ++iPassed){
+    const std::string& thisTrigger = passedTriggers->at(iPassed);
+    for(unsigned int iT=0; iT < triggerNames.size(); ++iT){
+      if( thisTrigger == triggerNames.at(iT) )
+        passed.at(iT) = 1;
+    }
+  }
+}
+
+TriggerScanHists :: TriggerScanHists( const std::vector<std::string>& turnOnTriggers, const std::vector<std::string>& binTriggers,
+                                      const std::vector<double>& binThresholds, float ptAsym ) :
+  m_turnOnTriggers( turnOnTriggers ),
+  m_triggerNames( turnOnTriggers ),
+  m_ptAsym( ptAsym )
+{
+  for(unsigned int iB=0; iB < binTriggers.size(); ++iB){
+    std::vector<std::string>::iterator it = std::find( m_triggerNames.begin(), m_triggerNames.end(), binTriggers.at(iB) );
+    m_binTriggerIndex.push_back( it - m_triggerNames.begin() );
+    if( it == m_triggerNames.end() )
+      m_triggerNames.push_back( binTriggers.at(iB) );
+    m_binThresholds.push_back( binThresholds.at(iB)*1e3 );
+  }
+
+  // The last trigger is only the reference of the one before
+  for(unsigned int iT=0; iT+1 < m_turnOnTriggers.size(); ++iT){
+    const std::string& trigger = m_turnOnTriggers.at(iT);
+    m_numerators.push_back( std::vector<TH1F*>() );
+    m_denominators.push_back( std::vector<TH1F*>() );
+    m_leadNumerators.push_back( std::vector<TH1F*>() );
+    m_leadDenominators.push_back( std::vector<TH1F*>() );
+    for(int iType=0; iType < nTypes; ++iType){
+      std::string thisType = typeNames[iType];
+      m_numerators.back().push_back( new TH1F( (thisType+"_"+trigger).c_str(), ("h_"+trigger).c_str(), 300, 50, 2000) );
+      m_leadNumerators.back().push_back( new TH1F( (thisType+"_lead_"+trigger).c_str(), ("h_lead_"+trigger).c_str(), 300, 50, 2000) );
+      m_denominators.back().push_back( new TH1F( (thisType+"_denom_"+trigger).c_str(), "h_full", 300, 50, 2000) );
+      m_leadDenominators.back().push_back( new TH1F( (thisType+"_lead_denom_"+trigger).c_str(), "h_lead", 300, 50, 2000) );
+      m_hists.push_back( m_numerators.back().back() );
+      m_hists.push_back( m_leadNumerators.back().back() );
+      m_hists.push_back( m_denominators.back().back() );
+      m_hists.push_back( m_leadDenominators.back().back() );
+    }
+  }
+
+  m_finePt = new TH1F("finept", "finept", 400, 0, 4000.);
+  m_hists.push_back( m_finePt );
+
+  for(unsigned int iH=0; iH < m_hists.size(); ++iH){
+    m_hists.at(iH)->SetDirectory(0);
+    m_hists.at(iH)->Sumw2();
+  }
+}
+
+TriggerScanHists :: ~TriggerScanHists()
+{
+  for(unsigned int iH=0; iH < m_hists.size(); ++iH)
+    delete m_hists.at(iH);
+}
+
+bool TriggerScanHists::fill( const TriggerScanEvent& event, double eventWeight ){
+  if( event.numJets() < 2 || event.recoilPt <= 0. )
+    return false;
+  if( event.jetPt(1)*1e3/event.recoilPt > m_ptAsym )
+    return false;
+
+  const std::vector<char>& passed = event.passed;
+  float recoilPt = event.recoilPt/1e3;
+  float leadJetPt = event.jetPt(0);
+  for(unsigned int iT=0; iT < m_numerators.size(); ++iT){
+    bool thisPassed = passed.at(iT);
+    bool nextPassed = passed.at(iT+1);
+
+    // Wrong method
+    if( thisPassed || nextPassed ){
+      m_denominators.at(iT).at(0)->Fill( recoilPt, eventWeight );
+      m_leadDenominators.at(iT).at(0)->Fill( leadJetPt, eventWeight );
+    }
+    if( thisPassed ){
+      m_numerators.at(iT).at(0)->Fill( recoilPt, eventWeight );
+      m_leadNumerators.at(iT).at(0)->Fill( leadJetPt, eventWeight );
+    }
+
+    // Unbiased
+    m_denominators.at(iT).at(1)->Fill( recoilPt, eventWeight );
+    m_leadDenominators.at(iT).at(1)->Fill( leadJetPt, eventWeight );
+    if( thisPassed ){
+      m_numerators.at(iT).at(1)->Fill( recoilPt, eventWeight );
+      m_leadNumerators.at(iT).at(1)->Fill( leadJetPt, eventWeight );
+    }
+
+    // Correct biased
+    if( nextPassed ){
+      m_denominators.at(iT).at(2)->Fill( recoilPt, eventWeight );
+      m_leadDenominators.at(iT).at(2)->Fill( leadJetPt, eventWeight );
+      if( thisPassed ){
+        m_numerators.at(iT).at(2)->Fill( recoilPt, eventWeight );
+        m_leadNumerators.at(iT).at(2)->Fill( leadJetPt, eventWeight );
+      }
+    }
+  }
+
+  // Only the highest trigger that is efficient for this recoil pt is checked
+  for(unsigned int iB=0; iB < m_binThresholds.size(); ++iB){
+    if( event.recoilPt > m_binThresholds.at(iB) ){
+      // Unweighted, minEvents of balancedBinning counts events
+      if( passed.at( m_binTriggerIndex.at(iB) ) )
+        m_finePt->Fill( recoilPt );
+      break;
+    }
+  }
+
+  return true;
+}
+
+void TriggerScanHists::add( const TriggerScanHists& other ){
+  for(unsigned int iH=0; iH < m_hists.size(); ++iH)
+    m_hists.at(iH)->Add( other.m_hists.at(iH) );
+}
+
+void TriggerScanHists::write( TDirectory* dir ) const {
+  for(unsigned int iH=0; iH < m_hists.size(); ++iH)
+    dir->WriteTObject( m_hists.at(iH), m_hists.at(iH)->GetName() );
+}
+
+const TH1F* TriggerScanHists::numerator( unsigned int iTurnOn, int iType, bool lead ) const {
+  return lead ? m_leadNumerators.at(iTurnOn).at(iType) : m_numerators.at(iTurnOn).at(iType);
+}
+
+const TH1F* TriggerScanHists::denominator( unsigned int iTurnOn, int iType, bool lead ) const {
+  return lead ? m_leadDenominators.at(iTurnOn).at(iType) : m_denominators.at(iTurnOn).at(iType);
+}
+
+double TriggerScanHists::efficientPt( const TH1* numerator, const TH1* denominator ){
+  const int nBins = numerator->GetNbinsX();
+  std::vector<double> eff( nBins+2, 0. );
+  int firstHalf = -1;
+  for(int iBin=1; iBin <= nBins; ++iBin){
+    double denom = denominator->GetBinContent(iBin);
+    if( denom != 0. )
+      eff.at(iBin) = numerator->GetBinContent(iBin)/denom;
+    if( firstHalf < 0 && eff.at(iBin) > 0.5 )
+      firstHalf = iBin;
+  }
+  // Empty bins above the turn-on are efficient
+  if( firstHalf > 0 ){
+    for(int iBin=firstHalf; iBin <= nBins; ++iBin){
+      if( denominator->GetBinContent(iBin) == 0. )
+        eff.at(iBin) = 1.;
+    }
+  }
+
+  // Skip the fluctuations below the turn-on
+  const int checkNum = 5;
+  int minBin = 1;
+  for(int iBin=1; iBin < 60 && iBin+checkNum <= nBins; ++iBin){
+    bool onlyIncreasing = true;
+    for(int iCheck=iBin; iCheck < iBin+checkNum; ++iCheck){
+      if( eff.at(iCheck+1) <= eff.at(iCheck) ){
+        onlyIncreasing = false;
+        break;
+      }
+    }
+    if( onlyIncreasing ){
+      minBin = iBin;
+      break;
+    }
+  }
+
+  int effBin = minBin;
+  for(int iBin=minBin+1; iBin < nBins; ++iBin){
+    if( eff.at(iBin) > eff.at(effBin) )
+      effBin = iBin;
+    else
+      break;
+    if( eff.at(iBin) > 0.990 )
+      break;
+  }
+
+  return numerator->GetXaxis()->GetBinLowEdge( effBin );
+}
+
+std::vector<double> TriggerScanHists::balancedBinning( const TH1* finePt, const std::vector<double>& fixedEdges,
+                                                       double minEvents, int minFineBins, std::vector<double>& numEvents ){
+  std::vector<double> binEdges( fixedEdges );
+  numEvents.clear();
+  if( binEdges.size() == 0 )
+    return binEdges;
+
+  const TAxis* axis = finePt->GetXaxis();
+  for(unsigned int iEdge=1; iEdge < binEdges.size(); ++iEdge){
+    double thisNumEvents = 0.;
+    for(int iB = axis->FindBin( binEdges.at(iEdge-1) ); iB <= finePt->GetNbinsX() && axis->GetBinCenter(iB) < binEdges.at(iEdge); ++iB){
+      if( axis->GetBinCenter(iB) > binEdges.at(iEdge-1) )
+        thisNumEvents += finePt->GetBinContent(iB);
+    }
+    numEvents.push_back( thisNumEvents );
+  }
+
+  // The new bins start at the first fine bin above the fixed edges
+  int firstBin = axis->FindBin( binEdges.back() );
+  if( axis->GetBinCenter(firstBin) < binEdges.back() )
+    ++firstBin;
+  int lastBin = finePt->FindLastBinAbove(0);
+  unsigned int numFixed = binEdges.size();
+
+  double thisNumEvents = 0.;
+  int numBinsAdded = 0;
+  for(int currentBin = firstBin; currentBin <= lastBin; ++currentBin){
+    thisNumEvents += finePt->GetBinContent( currentBin );
+    ++numBinsAdded;
+    if( numBinsAdded >= minFineBins && thisNumEvents >= minEvents ){
+      binEdges.push_back( axis->GetBinUpEdge( currentBin ) );
+      numEvents.push_back( thisNumEvents );
+      thisNumEvents = 0.;
+      numBinsAdded = 0;
+    }
+  }
+
+  if( numBinsAdded > 0 && lastBin >= firstBin ){
+    if( binEdges.size() > numFixed ){
+      binEdges.back() = axis->GetBinUpEdge( lastBin );
+      numEvents.back() += thisNumEvents;
+    }else{
+      binEdges.push_back( axis->GetBinUpEdge( lastBin ) );
+      numEvents.push_back( thisNumEvents );
+    }
+  }
+
+  return binEdges;
+}
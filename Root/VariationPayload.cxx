@@ -0,0 +1,57 @@
+#include <algorithm>
+
+#include <TTree.h>
+#include <TList.h>
+#include <TObjString.h>
+
+#include "MultijetBalance/VariationPayload.h"
+
+using namespace std;
+
+VariationPayload :: VariationPayload( const std::vector<std::string>& sysVarNames ) :
+  m_sysVarNames( sysVarNames ),
+  m_passMask( (sysVarNames.size()+63)/64, 0 ),
+  m_recoilPt( sysVarNames.size(), 0. ),
+  m_ptBal( sysVarNames.size(), 0. ),
+  m_weight( sysVarNames.size(), 0. ),
+  m_njet( sysVarNames.size(), 0 )
+{
+}
+
+void VariationPayload::book( TTree* tree ){
+  // The arrays are never resized, so their addresses stay valid
+  std::string nVar = to_string( m_sysVarNames.size() );
+  std::string nWords = to_string( m_passMask.size() );
+  tree->Branch("passMask", &m_passMask[0], ("passMask["+nWords+"]/l").c_str());
+  tree->Branch("recoilPt", &m_recoilPt[0], ("recoilPt["+nVar+"]/F").c_str());
+  tree->Branch("ptBal", &m_ptBal[0], ("ptBal["+nVar+"]/F").c_str());
+  tree->Branch("weight", &m_weight[0], ("weight["+nVar+"]/F").c_str());
+  tree->Branch("njet", &m_njet[0], ("njet["+nVar+"]/b").c_str());
+
+  for(unsigned int iVar=0; iVar < m_sysVarNames.size(); ++iVar)
+    tree->GetUserInfo()->Add( new TObjString( m_sysVarNames.at(iVar).c_str() ) );
+}
+
+void VariationPayload::clear(){
+  std::fill( m_passMask.begin(), m_passMask.end(), 0 );
+  std::fill( m_recoilPt.begin(), m_recoilPt.end(), 0. );
+  std::fill( m_ptBal.begin(), m_ptBal.end(), 0. );
+  std::fill( m_weight.begin(), m_weight.end(), 0. );
+  std::fill( m_njet.begin(), m_njet.end(), 0 );
+}
+
+void VariationPayload::set( unsigned int iVar, float recoilPt, float ptBal, float weight, int njet ){
+  m_passMask.at(iVar/64) |= (1ULL << (iVar%64));
+  m_recoilPt.at(iVar) = recoilPt;
+  m_ptBal.at(iVar) = ptBal;
+  m_weight.at(iVar) = weight;
+  m_njet.at(iVar) = std::min( njet, 255 );
+}
+
+bool VariationPayload::anyPassed() const {
+  for(unsigned int iW=0; iW < m_passMask.size(); ++iW){
+    if( m_passMask.at(iW) )
+      return true;
+  }
+  return false;
+}
@@ -61,6 +61,19 @@ c.setalg("MultijetBalanceAlgo",   { "m_name"                : "MultijetAlgo",
 #  "m_bootstrap" : True,
 #  "m_systTool_nToys" : 100,
 
+#------ Event Cache ------#
+  ## Write the iteration independent inputs of the variation loop to the eventCache output stream (data-eventCache/):
+#  "m_writeEventCache" : True,
+  ## Later iterations: run from <dir>/<sample name>.root instead of the input, over the same input files with any job splitting.
+  ## Each input entry replays its own cache entry, the input events themselves are not read.
+  ## Needs the variations and calibration stages of this job in the cache, and kinematic jet details only.
+  ## B-tagging depends on the varied kinematics and is not cached, both jobs need "m_bTagWPsString" : "".
+#  "m_eventCacheDir" : "gridOutput/Iteration0/data-eventCache",
+  ## Lighter alternative: write the input entries passing the common selection (data-eventList/),
+#  "m_writeEventList" : True,
+  ## and in later iterations skip all other entries of the same input files before anything is read by this algorithm.
+#  "m_eventListDir" : "gridOutput/Iteration0/data-eventList",
+
 #------ Validation Mode ------#
   ## Apply the jet calibrations to the leading jet:
 #  "m_leadingInsitu" : True,
@@ -91,6 +104,17 @@ c.setalg("MultijetBalanceAlgo",   { "m_name"                : "MultijetAlgo",
 ### Plotting Options ###
 #  "m_writeTree" : True,
   "m_writeNominalTree" : True,
+  ## With m_writeTree, one outTree of the jets before variations and a friend outTree_variations of the per-variation results:
+  ## (recoil pt, pt balance, weight and njet only, so runMiniTreeReplay can only rebuild them with --minimal)
+#  "m_compactTree" : True,
+  ## Jets as njet and jet_pt[njet] arrays (one per b-tag WP), with the kinematic and MJB variables only, for faster reading:
+#  "m_flatJetBranches" : True,
+  ## Fill and compress the TTrees on a background thread:
+#  "m_asyncTreeWriter" : True,
+  ## Compression and basket settings per output stream (tree, SystToolOutput, cutflow, eventCache, eventList),
+  ## stream=ALGO:level:autoFlush:basketSize with ALGO ZLIB, LZMA or LZ4 (ROOT 6.12+).  Compare them with benchmarkOutputPolicy.
+  ## The hist output takes no policy, compress it afterwards with runHistMerge --policy.
+#  "m_outputPolicies" : "tree=LZMA:6:-30000000:32000,SystToolOutput=LZMA:6,eventCache=ZLIB:1",
 #  "m_MJBDetailStr" : "bTag85 bTag77",
 #  "m_MJBDetailStr" : "extraMJB",
   "m_eventDetailStr" : "pileup",
@@ -3,6 +3,8 @@ import math
 import time
 import argparse
 
+## The tree loop of this script is done multi-threaded by runTriggerScan (util/runTriggerScan.cxx)
+
 #parser = argparse.ArgumentParser(description="%prog [options]", formatter_class=argparse.ArgumentDefaultsHelpFormatter)
 #parser.add_argument("-b", dest='batchMode', action='store_true', default=False, help="Batch mode for PyRoot")
 #parser.add_argument("--dataFile", dest='dataFile', default="submitDir/hist-data12_8TeV.root",
@@ -3,6 +3,8 @@ import math
 import time
 import argparse
 
+## The tree loop of this script is done multi-threaded by runTriggerScan (util/runTriggerScan.cxx)
+
 #parser = argparse.ArgumentParser(description="%prog [options]", formatter_class=argparse.ArgumentDefaultsHelpFormatter)
 #parser.add_argument("-b", dest='batchMode', action='store_true', default=False, help="Batch mode for PyRoot")
 #parser.add_argument("--dataFile", dest='dataFile', default="submitDir/hist-data12_8TeV.root",
@@ -34,7 +36,12 @@ tree = inFile.Get(treeName)
 
 numEntries = tree.GetEntries()
 tree.SetBranchStatus('*', 0)
-jet_pt =   ROOT.std.vector('float')()
+# m_flatJetBranches trees hold jet_pt[njet] arrays instead of vectors
+if tree.GetBranch("jet_pt").GetLeaf("jet_pt").GetLeafCount():
+  jet_pt = array.array('f', [0]*64)
+  tree.SetBranchStatus( "njet", 1)
+else:
+  jet_pt =   ROOT.std.vector('float')()
 tree.SetBranchStatus( "jet_pt", 1)
 tree.SetBranchAddress( "jet_pt", jet_pt)
 b_pt = array.array('f',[0])
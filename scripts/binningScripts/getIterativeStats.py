@@ -32,7 +32,12 @@ tree = inFile.Get(treeName)
 
 numEntries = tree.GetEntries()
 tree.SetBranchStatus('*', 0)
-jet_pt =   ROOT.std.vector('float')()
+# m_flatJetBranches trees hold jet_pt[njet] arrays instead of vectors
+if tree.GetBranch("jet_pt").GetLeaf("jet_pt").GetLeafCount():
+  jet_pt = array.array('f', [0]*64)
+  tree.SetBranchStatus( "njet", 1)
+else:
+  jet_pt =   ROOT.std.vector('float')()
 tree.SetBranchStatus( "jet_pt", 1)
 tree.SetBranchAddress( "jet_pt", jet_pt)
 b_pt = array.array('f',[0])
@@ -15,7 +15,24 @@ import subprocess, os, time, sys, glob
 import datetime, argparse
 import ROOT
 
-def runBootstrapFitting(inFile, f_rebin, f_fit, sysType):
+def runBootstrapFitting(inFile, f_rebin, f_fit, sysType, f_inProcess=False, nThreads=0, convergence=0., threshold="2"):
+
+  ## All systematics in one process, writing the combined file directly ##
+  if f_inProcess:
+    command = "runBootstrapSystematics --file "+inFile+" --upperEdge 2000"
+    if (f_rebin):
+      command += " --rebin --threshold "+threshold
+      if convergence > 0:
+        command += " --convergence "+str(convergence)
+    if( f_fit ):
+      command += ' --fit'
+    if len(sysType) > 0:
+      command += " --sysType "+sysType
+    if nThreads > 0:
+      command += " --nThreads "+str(nThreads)
+    print command
+    os.system(command)
+    return
 
   pids = []
   logFiles = []
@@ -29,12 +46,17 @@ def runBootstrapFitting(inFile, f_rebin, f_fit, sysType):
 
   thisFile = ROOT.TFile.Open(inFile)
   for key in thisFile.GetListOfKeys():
-    if key.GetName().endswith("_1"):
-      sysList.append( '_'.join( key.GetName().split('_')[1:-1] ) )
+    keyName = key.GetName().replace('_recoilPt_PtBal', '')  #runBootstrapHistogrammer --flat layout
+    if keyName.endswith("_1"):
+      sysList.append( '_'.join( keyName.split('_')[1:-1] ) )
 
   if len(sysType) > 0:
     sysList = [sys for sys in sysList if sysType in sys]
 
+  ## Decode the Nominal toys once, every runBootstrapRebin job maps the cache ##
+  if (f_rebin):
+    os.system("runBootstrapRebin --file "+inFile+" --buildNominalCache")
+
   ## For each systematic ##
   for iS, sys in enumerate(sysList):
     while len(pids) >= NCORES:
@@ -44,7 +66,9 @@ def runBootstrapFitting(inFile, f_rebin, f_fit, sysType):
 
     if (f_rebin):
       command = "runBootstrapRebin --file "+inFile+" --sysType "+sys
-      command += " --upperEdge 2000 --threshold 2"
+      command += " --upperEdge 2000 --threshold "+threshold
+      if convergence > 0:
+        command += " --convergence "+str(convergence)
       if( f_fit ):
         command += ' --fit'
     else:
@@ -114,9 +138,13 @@ if __name__ == "__main__":
   parser.add_argument("-fit", dest='fit', action='store_true', default=False, help="Fit for the balance, rather than taking the average")
   parser.add_argument("--file", dest='file', default="", help="Input file name")
   parser.add_argument("--sysType", dest='sysType', default="", help="Run only on the given sysTypes")
+  parser.add_argument("-inProcess", dest='inProcess', action='store_true', default=False, help="Run all systematics in one multi-threaded runBootstrapSystematics process")
+  parser.add_argument("--nThreads", dest='nThreads', type=int, default=0, help="Threads for -inProcess (0 for all cores)")
+  parser.add_argument("--convergence", dest='convergence', type=float, default=0., help="Stop adding toys to a rebin range once its significance is this many sigma from the threshold (0 uses all toys, otherwise the values and edges can differ from using all toys)")
+  parser.add_argument("--threshold", dest='threshold', default="2", help="Rebinning significance threshold, or a comma separated list of thresholds to compare")
   args = parser.parse_args()
 
-  runBootstrapFitting(args.file, args.rebin, args.fit, args.sysType)
+  runBootstrapFitting(args.file, args.rebin, args.fit, args.sysType, args.inProcess, args.nThreads, args.convergence, args.threshold)
   print "Starting fitting at", beginTime
   print "Finished fitting at", datetime.datetime.now().time()
 
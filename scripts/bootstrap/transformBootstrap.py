@@ -49,13 +49,14 @@ if (args.firstIter):
 
     if(f_Data):
       ##  Grab all bootstrap histograms ##
-      ##  ~ 12 minutes
-      command = 'hadd '+args.workDir+'/bootstrap.data.bootstrap.initial.root '+args.workDir+'/../SystToolOutput/*.data*_SystToolOutput.root'
+      ##  ~ 12 minutes with hadd, runHistMerge reads the files in parallel (--nThreads)
+      command = 'runHistMerge --outFile '+args.workDir+'/bootstrap.data.bootstrap.initial.root --files "'+args.workDir+'/../SystToolOutput/*.data*_SystToolOutput.root"'
       print command
       if not f_printOnly:
         os.system(command)
 
       ## Create regular 2D histograms from all bootstrap toys and from nominal
+      ## Systematics are unpacked in parallel, add --flat to skip the TDirectory structure
       # ~ 2 minutes, bootstrap.data.bootstrap.initial.root -> hist.data.bootstrap.scaled.root
       command = 'runBootstrapHistogrammer --file '+args.workDir+'/bootstrap.data.bootstrap.initial.root'
       print command
@@ -65,8 +66,8 @@ if (args.firstIter):
 
       ## Grab all nominal histograms ##
       ##  !! This file can be directly copied from the nominal plotting results ##
-      # ~ 6  minutes
-      command = 'hadd '+args.workDir+'/hist.data.nominal.initial.root '+args.workDir+'/../hist/*.data*_hist.root'
+      # ~ 6  minutes with hadd
+      command = 'runHistMerge --outFile '+args.workDir+'/hist.data.nominal.initial.root --files "'+args.workDir+'/../hist/*.data*_hist.root"'
       print command
       if not f_printOnly:
         os.system(command)
@@ -88,22 +89,9 @@ if (args.firstIter):
 
     if( f_MC ):
       ## input -> scaled ##
-      files = glob.glob(args.workDir+'/../hist/*mc15*Pythia*_hist.root')
-      for file in files:
-        command = 'python MultijetBalance/scripts/plotting/scaleHist.py --file '+file
-        print command
-        if not f_printOnly:
-          os.system(command)
-      files = glob.glob(args.workDir+'/../hist/*scaled.root')
-      for file in files:
-        command = 'mv '+file+' '+args.workDir+'/initialFiles/'
-        print command
-        if not f_printOnly:
-          os.system(command)
-
-
-      ## Hadd MC slices together into scaled ##
-      command = 'hadd '+args.workDir+'/hist.mc.Pythia.scaled.root '+args.workDir+'/initialFiles/*.mc*Pythia*_hist.scaled.root'
+      ## Each MC channel is normalized by runHistMerge while it is read, using the
+      ## MJBNormalization of the hist files, instead of a scaleHist.py pass per file
+      command = 'runHistMerge --normalize --outFile '+args.workDir+'/hist.mc.Pythia.scaled.root --files "'+args.workDir+'/../hist/*mc15*Pythia*_hist.root"'
       print command
       if not f_printOnly:
         os.system(command)
@@ -131,28 +119,22 @@ if (args.firstIter):
         os.system(command)
 
 
-      mcFile = args.workDir+'/hist.mc.Pythia.mean_MJB_initial.root'
-      command = 'python MultijetBalance/scripts/bootstrap/mirrorMCtoData.py'
-      command += ' --mcFile '+mcFile
-      print command
-      if (not f_printOnly):
-        os.system(command)
-
   if (f_doubleRatio):
     dataFile = args.workDir+'/hist.data.all.mean_MJB_initial.root'
     mcFile = args.workDir+'/hist.mc.Pythia.mean_MJB_initial.root'
-    command = 'python MultijetBalance/scripts/plotting/calculateDoubleRatio.py --dataFile '+dataFile+' --mcFile '+mcFile
+    # Each data toy <sys>_<i> is divided by the MC <sys>, without copying the MC histograms per toy
+    command = 'runDoubleRatio --mirrorToys --dataFile '+dataFile+' --mcFile '+mcFile
     print command
     if (not f_printOnly):
       os.system(command)
 
 elif (args.lastIter):
   if(f_combine):
-      command = 'hadd '+args.workDir+'/hist.data.all.histOnlyFormat.root '+args.workDir+'/../hist/*.data*_hist.root'
+      command = 'runHistMerge --outFile '+args.workDir+'/hist.data.all.histOnlyFormat.root --files "'+args.workDir+'/../hist/*.data*_hist.root"'
       print command
       if not f_printOnly:
         os.system(command)
-        print "Finished hadding"
+        print "Finished merging"
 
   if(f_reformat):
       command = 'python MultijetBalance/scripts/bootstrap/reformatHists.py --file '+args.workDir+'/hist.data.all.histOnlyFormat.root'
@@ -16,6 +16,7 @@
 #------------------------------------------
 #import
 import os, sys, subprocess, glob, shutil
+import distutils.spawn
 import argparse
 parser = argparse.ArgumentParser(description="%prog [options]", formatter_class=argparse.ArgumentDefaultsHelpFormatter)
 parser.add_argument("--container", dest='container', default="None",
@@ -38,6 +39,12 @@ parser.add_argument("--ndownloader", dest='ndownloader', default=4,
      type=int, help="Number of parallel downloads ")
 args = parser.parse_args()
 
+## hist, cutflow and SystToolOutput files are summed by runHistMerge, reading the inputs in parallel
+def mergeCommand(variant, outputFile, inputFiles):
+  if variant in ['hist', 'cutflow', 'SystToolOutput'] and distutils.spawn.find_executable('runHistMerge'):
+    return 'runHistMerge --outFile '+outputFile+' --files "'+','.join(inputFiles)+'"'
+  return 'hadd '+outputFile+' '+' '.join(inputFiles)
+
 def main():
   ##******************************************
   #NOTE before starting, set the variables
@@ -164,7 +171,7 @@ def main():
           outputFileName = outputFileName[:-5] #strip .root
 
         if args.maxSize <= 0:
-          os.system('hadd '+outputFileName+'.root '+inputFilesNameWildCard)
+          os.system( mergeCommand(variant, outputFileName+'.root', [inputFilesNameWildCard]) )
         else:
           ## Get file sizes
           fileSizes = []
@@ -199,11 +206,11 @@ def main():
           ## Combine
           for iMerge, theseFilesToMerge in enumerate( filesToMerge ):
             if len( filesToMerge) == 1: #Only one output file
-              os.system('hadd '+outputFileName+'.root '+' '.join(theseFilesToMerge) )
+              os.system( mergeCommand(variant, outputFileName+'.root', theseFilesToMerge) )
             elif len(theseFilesToMerge) == 1:
               os.system("mv "+theseFilesToMerge[0]+" "+outputFileName+"."+str(iMerge)+".root")
             else:
-              os.system('hadd '+outputFileName+'.'+str(iMerge)+'.root '+' '.join(theseFilesToMerge) )
+              os.system( mergeCommand(variant, outputFileName+'.'+str(iMerge)+'.root', theseFilesToMerge) )
 
 
       elif (renameRawDatasets=="True") :
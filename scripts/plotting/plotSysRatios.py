@@ -62,7 +62,7 @@ def plotSysRatios(file):
 
   sysTypes = []
   for sysType in sysTypesToUse:
-    if any(sysType in sysDir for sysDir in sysDirNameList):
+    if any(sysType in sysDir.GetName() for sysDir in sysDirList):
       sysTypes.append( sysType )
 
   if len(sysTypes) == 0:
@@ -80,6 +80,15 @@ def plotSysRatios(file):
 
   histList = [key.GetName() for key in nomDir.GetListOfKeys()]
 
+  ## The combined up and down shifts of each type are computed by runDoubleRatio ##
+  combinedFileName = file[:-5]+'.sysCombined.root'
+  command = 'runDoubleRatio --combine '+file+' --outFile '+combinedFileName
+  command += ' --sysTypes '+','.join(sysTypesToUse)+' --mjbSys '+','.join(MJBsToUse)
+  if os.system(command) != 0:
+    print "Error, could not combine the systematics of ", file
+    exit(1)
+  combinedFile = TFile.Open(combinedFileName, "READ")
+
 
 
   for histName in histList:
@@ -92,12 +101,6 @@ def plotSysRatios(file):
     if not type(nomHist) == TH1F and not type(nomHist) == TH1D:  #Can't draw bands if not 1D
       continue
 
-    ## Get list of systematic histograms ##
-    fullHistList = []
-    for thisSysDir in sysDirList:
-      fullHistList.append( thisSysDir.Get(histName) )
-      fullHistList[-1].SetDirectory(0)
-
     ### Setup Plot ###
     leg = TLegend(0.83, 0.15, 0.99, 0.95)
     pad1 = TPad("pad1", "", 0, 0, 0.83, 1)
@@ -126,12 +129,10 @@ def plotSysRatios(file):
     for iTopSys, topSysName in enumerate(sysTypes):
 
 
-      if topSysName == 'All':
-        subHistList = [thisHist for thisDir, thisHist in zip(sysDirList, fullHistList) if any(otherTopName in thisDir.GetName() for otherTopName in sysTypes) ]
-      else:
-        subHistList = [thisHist for thisDir, thisHist in zip(sysDirList, fullHistList) if topSysName in thisDir.GetName()]
-
-      sysHistUp, sysHistDn = getCombinedSysHist(nomHist, subHistList, topSysName)
+      sysHistUp = combinedFile.Get( "Combined_"+topSysName+"/"+histName+"_Up" )
+      sysHistDn = combinedFile.Get( "Combined_"+topSysName+"/"+histName+"_Dn" )
+      sysHistUp.SetDirectory(0)
+      sysHistDn.SetDirectory(0)
 
       if topSysName == 'All':
         color = kBlack
@@ -166,12 +167,14 @@ def plotSysRatios(file):
     c1.Clear()
 
 
+  combinedFile.Close()
   inFile.Close()
 
 ########################################################
 # Take a list of systematics histograms and make a up  #
 # and down hists of the fractional difference compared #
 # to Nominal                                           #
+# plotSysRatios uses runDoubleRatio --combine instead  #
 ########################################################
 def getCombinedSysHist(nomHist, sysHistList, sysName = "tempSysHist"):
   sysHistUp = nomHist.Clone(sysName+"Up")
@@ -53,6 +53,13 @@ def scaleHist(file):
       thisHist.SetDirectory( newDir )
       thisHist.Scale( scaleFactor )
 
+  ## Job counts of MultijetBalanceAlgo, the MC jobs are now normalized ##
+  if "MJBSample" in keyList:
+    sampleHist = inFile.Get("MJBSample")
+    sampleHist.SetDirectory( outFile )
+    sampleHist.SetBinContent(3, sampleHist.GetBinContent(3)+sampleHist.GetBinContent(2))
+    sampleHist.SetBinContent(2, 0)
+
   outFile.Write()
   outFile.Close()
   inFile.Close()
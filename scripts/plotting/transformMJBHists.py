@@ -17,9 +17,6 @@ args = parser.parse_args()
 
 import getRecoilPtTree
 import scaleHist
-import calculateMJBHists
-import calculateDoubleRatio
-import calculateDoubleRatioSys
 import calculateFinalMJBGraphs
 import plotNominal
 import plotSysRatios
@@ -122,7 +119,8 @@ if(f_combine):
   ## Hadd MC slices together into scaled ##
   if( doMC ):
     for mcType in mcTypes:
-      command = 'hadd '+args.workDir+'/hist.mc.'+mcType+'.scaled.root '+args.workDir+'/initialFiles/*.mc*'+mcType+'*_hist.scaled.root'
+      ## Normalized while merging by the MJBNormalization of each channel, f_scale is only needed for doJZSlices
+      command = 'runHistMerge --normalize --outFile '+args.workDir+'/hist.mc.'+mcType+'.scaled.root --files "'+args.workDir+'/../hist/*mc15*'+mcType+'*_hist.root"'
       print command
       os.system(command)
 
@@ -167,10 +165,10 @@ if(f_calculateMJB):
   if( doAverage ):
     files = glob.glob(args.workDir+'/hist.*.*.scaled.root')
     for file in files:
-      print 'python MultijetBalance/scripts/plotting/calculateMJBHists.py --file '+file
+      command = 'runMJBHists --file '+file
+      print command
       if (not f_printOnly):
-        f_extraPlots = False
-        calculateMJBHists.calculateMJBHists(file, f_extraPlots)
+        os.system(command)
         #os.system('mv '+file+' '+args.workDir+'/initialFiles/')
 
   if( doFit ):
@@ -191,7 +189,7 @@ if(f_calculateMJB):
       ## If we're doing bootstrap, we must also create a new nominal version for each systematic
       ## so that their binnings may be matched, and the division of histograms may be performed
       if (doBootstrap):
-        command = 'runFit_NominalRebinning --fit --file '+file
+        command = 'runFit --nominalRebinning --fit --file '+file
         command += ' --upperEdge '+str(endPt)
         if (doNominalOnly):
           command += ' --sysType Nominal'
@@ -218,9 +216,10 @@ if(f_calculateMJB):
           dataFile = glob.glob(args.workDir+'/hist.data.all.fit_MJB_nominal.root')[0]
           mcFile = glob.glob(args.workDir+'/hist.mc.'+mcType+'.fit_MJB_nominal.root')[0]
 
-        print 'python MultijetBalance/scripts/plotting/calculateDoubleRatio.py --dataFile '+dataFile+' --mcFile '+mcFile
+        command = 'runDoubleRatio --dataFile '+dataFile+' --mcFile '+mcFile
+        print command
         if (not f_printOnly):
-          calculateDoubleRatio.calculateDoubleRatio(dataFile, mcFile)
+          os.system(command)
 
 
     ## Then get regular version
@@ -232,9 +231,10 @@ if(f_calculateMJB):
         dataFile = glob.glob(args.workDir+'/hist.data.all.fit_MJB_initial.root')[0]
         mcFile = glob.glob(args.workDir+'/hist.mc.'+mcType+'.fit_MJB_initial.root')[0]
 
-      print 'python MultijetBalance/scripts/plotting/calculateDoubleRatio.py --dataFile '+dataFile+' --mcFile '+mcFile
+      command = 'runDoubleRatio --dataFile '+dataFile+' --mcFile '+mcFile
+      print command
       if (not f_printOnly):
-        calculateDoubleRatio.calculateDoubleRatio(dataFile, mcFile)
+        os.system(command)
 
 
     ## Next get systematic variations ##
@@ -248,9 +248,12 @@ if(f_calculateMJB):
       if (doBootstrap):
         bootstrapFile = inFile.replace('DoubleMJB_initial','DoubleMJB_nominal')
 
-      print 'python MultijetBalance/scripts/plotting/calculateDoubleRatioSys.py --inFile '+inFile
+      command = 'runDoubleRatio --sysFile '+inFile
+      if len(bootstrapFile) > 0:
+        command += ' --bootstrapFile '+bootstrapFile
+      print command
       if not f_printOnly:
-        calculateDoubleRatioSys.calculateDoubleRatioSys(inFile, bootstrapFile)
+        os.system(command)
 
 
   ## Needs recoilPt_center
@@ -0,0 +1,282 @@
+//////////////////////////////////////////////////////////////////
+// benchmarkOutputPolicy.cxx
+//////////////////////////////////////////////////////////////////
+// Compare output policies (see OutputPolicy.h) on an existing
+// output of MultijetBalanceAlgo, e.g. a tree or SystToolOutput
+// file.  For each policy the input is rewritten with it, and the
+// size, the write time (copy from the input), the read time (every
+// entry and object) and the time to merge --nCopies copies with
+// TFileMerger are printed.  Files are read back right after they
+// are written, so read and merge times are mostly decompression.
+//////////////////////////////////////////////////////////////////
+// jeff.dandoy@cern.ch
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <set>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <chrono>
+#include <unistd.h>
+
+#include <TFile.h>
+#include <TKey.h>
+#include <TTree.h>
+#include <TBranch.h>
+#include <TH1.h>
+#include <TROOT.h>
+#include <TSystem.h>
+#include <TFileMerger.h>
+
+#include "MultijetBalance/OutputPolicy.h"
+
+using namespace std;
+
+double secondsSince( const std::chrono::steady_clock::time_point& start ){
+  return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+// Copies the newest cycle of every object of inDir to outDir, trees entry by entry
+// with the compression of outFile and the basket settings of policy
+void copyDirectory( TDirectory* inDir, TDirectory* outDir, TFile* outFile, const OutputPolicy& policy ){
+  std::set<std::string> copied;
+  TIter next( inDir->GetListOfKeys() );
+  TKey* key;
+  while( (key = (TKey*) next()) ){
+    std::string keyName = key->GetName();
+    if( copied.count(keyName) > 0 )
+      continue;
+    copied.insert( keyName );
+
+    std::string className = key->GetClassName();
+    if( className == "TDirectoryFile" ){
+      TDirectory* outSubDir = outDir->mkdir( keyName.c_str() );
+      copyDirectory( (TDirectory*) key->ReadObj(), outSubDir, outFile, policy );
+    }else if( className == "TTree" ){
+      TTree* inTree = (TTree*) key->ReadObj();
+      outDir->cd();
+      TTree* outTree = inTree->CloneTree(0);
+      // Cloned branches keep the compression of the input
+      TObjArray* branchList = outTree->GetListOfBranches();
+      for(int iB=0; iB < branchList->GetEntries(); ++iB)
+        ((TBranch*) branchList->At(iB))->SetCompressionSettings( outFile->GetCompressionSettings() );
+      policy.apply( outTree );
+      for(Long64_t iEntry=0; iEntry < inTree->GetEntries(); ++iEntry){
+        inTree->GetEntry(iEntry);
+        outTree->Fill();
+      }
+      outTree->Write();
+      delete outTree;
+      delete inTree;
+    }else{
+      TObject* obj = key->ReadObj();
+      outDir->cd();
+      obj->Write( keyName.c_str() );
+      delete obj;
+    }
+  }
+}
+
+// Reads every entry of every tree and every object of inDir
+void readDirectory( TDirectory* inDir ){
+  std::set<std::string> read;
+  TIter next( inDir->GetListOfKeys() );
+  TKey* key;
+  while( (key = (TKey*) next()) ){
+    std::string keyName = key->GetName();
+    if( read.count(keyName) > 0 )
+      continue;
+    read.insert( keyName );
+
+    TObject* obj = key->ReadObj();
+    if( obj->InheritsFrom("TDirectory") ){
+      readDirectory( (TDirectory*) obj );
+    }else if( obj->InheritsFrom("TTree") ){
+      TTree* tree = (TTree*) obj;
+      for(Long64_t iEntry=0; iEntry < tree->GetEntries(); ++iEntry)
+        tree->GetEntry(iEntry);
+      delete tree;
+    }else{
+      delete obj;
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  std::string inFileName = "";
+  std::string policiesString = "DEFAULT,ZLIB:1,ZLIB:6,LZMA:6,LZMA:9,ZLIB:1:-30000000:32000,LZMA:6:-30000000:32000";
+  std::string outDir = "";
+  unsigned int nCopies = 4;
+  bool f_keep = false;
+
+  /////////// Retrieve benchmarkOutputPolicy's arguments //////////////////////////
+  std::vector< std::string> options;
+  for(int ii=1; ii < argc; ++ii){
+    options.push_back( argv[ii] );
+  }
+
+  if (argc > 1 && options.at(0).compare("-h") == 0) {
+    std::cout << std::endl
+         << " benchmarkOutputPolicy : Compare compression and basket settings on an output file" << std::endl
+         << std::endl
+         << " Optional arguments:" << std::endl
+         << "  -h                Prints this menu" << std::endl
+         << "  --file            Output file of MultijetBalanceAlgo to rewrite" << std::endl
+         << "  --policies        Comma separated ALGO:level:autoFlush:basketSize policies" << std::endl
+         << "                    (default " << policiesString << ")" << std::endl
+         << "  --outDir          Directory of the rewritten files (default the directory of --file)" << std::endl
+         << "  --nCopies         Number of copies of each rewritten file to merge (default 4)" << std::endl
+         << "  --keep            Keep the rewritten and merged files" << std::endl
+         << std::endl;
+    exit(1);
+  }
+
+  int iArg = 0;
+  while(iArg < argc-1) {
+    if (options.at(iArg).compare("-h") == 0) {
+       // Ignore if not first argument
+       ++iArg;
+    } else if (options.at(iArg).compare("--file") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --file should be followed by a file" << std::endl;
+         return 1;
+       } else {
+         inFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--policies") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --policies should be followed by a comma separated list of policies" << std::endl;
+         return 1;
+       } else {
+         policiesString = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--outDir") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --outDir should be followed by a directory" << std::endl;
+         return 1;
+       } else {
+         outDir = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--nCopies") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --nCopies should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         nCopies = std::stoi(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--keep") == 0) {
+      f_keep = true;
+      ++iArg;
+    }else{
+      std::cout << "Couldn't understand argument " << options.at(iArg) << std::endl;
+      return 1;
+    }
+  }//while arguments
+
+  if ( inFileName.size() == 0){
+    cout << "No input file given " << endl;
+    exit(1);
+  }
+  if( outDir.size() == 0 )
+    outDir = (inFileName.find('/') != std::string::npos) ? inFileName.substr(0, inFileName.find_last_of("/") ) : ".";
+  if( nCopies < 1 )
+    nCopies = 1;
+
+  std::vector<std::string> policyStrings;
+  std::vector<OutputPolicy> policies;
+  std::stringstream ss(policiesString);
+  std::string thisSubStr;
+  while (std::getline(ss, thisSubStr, ',')) {
+    OutputPolicy thisPolicy;
+    if( !thisPolicy.parse( thisSubStr ) )
+      exit(1);
+    policyStrings.push_back( thisSubStr );
+    policies.push_back( thisPolicy );
+  }
+
+  TH1::AddDirectory(kFALSE);
+
+  TFile* inFile = TFile::Open( inFileName.c_str(), "READ" );
+  if( !inFile || inFile->IsZombie() ){
+    cout << "Error, could not open " << inFileName << ". Exiting..." << endl;
+    exit(1);
+  }
+
+  // Once, so that every policy starts from an input in the page cache
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  readDirectory( inFile );
+  double inputReadTime = secondsSince( start );
+  cout << "Input " << inFileName << ": " << std::fixed << std::setprecision(2) << inFile->GetSize()/1.e6
+       << " MB, read in " << inputReadTime << " s" << endl;
+
+  cout << endl << std::setw(32) << std::left << "policy" << std::right
+       << std::setw(12) << "size (MB)" << std::setw(12) << "write (s)" << std::setw(12) << "read (s)"
+       << std::setw(12) << "merge (s)" << endl;
+
+  for(unsigned int iP=0; iP < policies.size(); ++iP){
+    std::string outFileName = outDir+"/benchmarkOutputPolicy_"+to_string(iP)+".root";
+    std::string mergedFileName = outDir+"/benchmarkOutputPolicy_"+to_string(iP)+"_merged.root";
+
+    // Write
+    start = std::chrono::steady_clock::now();
+    TFile* outFile = TFile::Open( outFileName.c_str(), "RECREATE" );
+    if( !outFile || outFile->IsZombie() ){
+      cout << "Error, could not create " << outFileName << ". Exiting..." << endl;
+      exit(1);
+    }
+    policies.at(iP).apply( outFile );
+    int compressionSettings = outFile->GetCompressionSettings();
+    copyDirectory( inFile, outFile, outFile, policies.at(iP) );
+    outFile->Close();
+    double writeTime = secondsSince( start );
+    delete outFile;
+
+    // Read
+    start = std::chrono::steady_clock::now();
+    TFile* readFile = TFile::Open( outFileName.c_str(), "READ" );
+    Long64_t size = readFile->GetSize();
+    readDirectory( readFile );
+    readFile->Close();
+    double readTime = secondsSince( start );
+    delete readFile;
+
+    // Merge, keeping the compression of the policy as hadd -f<settings> would
+    start = std::chrono::steady_clock::now();
+    TFileMerger merger(kFALSE);
+    merger.SetPrintLevel(0);
+    merger.OutputFile( mergedFileName.c_str(), "RECREATE", compressionSettings );
+    for(unsigned int iCopy=0; iCopy < nCopies; ++iCopy)
+      merger.AddFile( outFileName.c_str(), kFALSE );
+    bool f_merged = merger.Merge();
+    double mergeTime = secondsSince( start );
+
+    cout << std::setw(32) << std::left << policyStrings.at(iP) << std::right << std::fixed << std::setprecision(2)
+         << std::setw(12) << size/1.e6 << std::setw(12) << writeTime << std::setw(12) << readTime;
+    if( f_merged )
+      cout << std::setw(12) << mergeTime << endl;
+    else
+      cout << std::setw(12) << "failed" << endl;
+
+    if( !f_keep ){
+      gSystem->Unlink( outFileName.c_str() );
+      gSystem->Unlink( mergedFileName.c_str() );
+    }
+  }
+
+  inFile->Close();
+  cout << endl << "Write times include reading the input, " << inputReadTime << " s on its own" << endl;
+
+  return 0;
+}
@@ -0,0 +1,101 @@
+//////////////////////////////////////////////////////////////////
+// drawFitPlots.cxx
+//////////////////////////////////////////////////////////////////
+// Draws the fit plots saved by runFit or runBootstrapRebin with
+// --fitPlots file, one png per fit, as they would have been drawn
+// with --fitPlots png.
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <ctime>
+#include <sys/stat.h>
+
+#include <TFile.h>
+#include <TH1.h>
+
+#include "MultijetBalance/FitPlotRecorder.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+  std::time_t initialTime = std::time(0);
+  gErrorIgnoreLevel = 2000;
+  std::string inFileName = "";
+  std::string outDir = "";
+
+  /////////// Retrieve arguments //////////////////////////
+  std::vector< std::string> options;
+  for(int ii=1; ii < argc; ++ii){
+    options.push_back( argv[ii] );
+  }
+
+  if (argc > 1 && options.at(0).compare("-h") == 0) {
+    std::cout << std::endl
+         << " drawFitPlots : draws fit plots saved with --fitPlots file" << std::endl
+         << std::endl
+         << " Optional arguments:" << std::endl
+         << "  -h                Prints this menu" << std::endl
+         << "  --file            Path to a .fitPlots.root file" << std::endl
+         << "  --outDir          Directory of the png files (default the directory of --file)" << std::endl
+         << std::endl;
+    exit(1);
+  }
+
+  int iArg = 0;
+  while(iArg < argc-1) {
+    if (options.at(iArg).compare("-h") == 0) {
+      // Ignore if not first argument
+      ++iArg;
+    } else if (options.at(iArg).compare("--file") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --file should be followed by a file" << std::endl;
+         return 1;
+       } else {
+         inFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--outDir") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --outDir should be followed by a directory" << std::endl;
+         return 1;
+       } else {
+         outDir = options.at(iArg+1);
+         iArg += 2;
+       }
+    }else{
+      std::cout << "Couldn't understand argument " << options.at(iArg) << std::endl;
+      return 1;
+    }
+  }//while arguments
+
+  if ( inFileName.size() == 0){
+    cout << "No input file given " << endl;
+    exit(1);
+  }
+
+  if( outDir.size() == 0 ){
+    std::size_t pos = inFileName.find_last_of("/");
+    outDir = (pos == std::string::npos) ? "." : inFileName.substr(0, pos);
+  }
+  mkdir(outDir.c_str(), 0777);
+
+  TH1::AddDirectory(kFALSE);
+  TFile *inFile = TFile::Open(inFileName.c_str(), "READ");
+  if( !inFile || inFile->IsZombie() ){
+    cout << "Error, could not open " << inFileName << ". Exiting..." << endl;
+    exit(1);
+  }
+
+  int nDrawn = FitPlotRecorder::drawFile( inFile, outDir+"/" );
+  inFile->Close();
+
+  std::cout << "Drew " << nDrawn << " fit plots in " << outDir << " after " << (std::time(0) - initialTime) << " seconds" << std::endl;
+
+  return 0;
+}
@@ -1,28 +1,51 @@
+//////////////////////////////////////////////////////////////////
+// runBootstrapHistogrammer.cxx
+//////////////////////////////////////////////////////////////////
+// Convert the TH2DBootstrap objects of a SystToolOutput file into
+// one recoilPt_PtBal histogram per toy.
+// Systematics are unpacked in parallel, while a single writer
+// thread owns the output file and reuses one TH2D for every toy.
+//////////////////////////////////////////////////////////////////
+// jeff.dandoy@cern.ch
+//////////////////////////////////////////////////////////////////
+
 #include <vector>
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <cstdlib>
+#include <thread>
 #include <unistd.h>
 
 #include <TFile.h>
-#include <TCanvas.h>
 #include <TKey.h>
 #include <TH1.h>
 #include <TH2D.h>
+#include <TROOT.h>
 
 #include "BootstrapGenerator/BootstrapGenerator.h"
 #include "BootstrapGenerator/TH2DBootstrap.h"
 
+#include "MultijetBalance/ThreadPool.h"
+
 using namespace std;
 
-/** Example program to get JES systematics */
+// Contents of one toy, handed from a worker to the writer thread
+struct ReplicaPayload {
+  std::string dirName;
+  std::vector<double> content;
+  std::vector<double> sumw2;
+  double entries;
+};
+
 int main(int argc, char *argv[])
 {
+  std::time_t initialTime = std::time(0);
 
-//  std::string inFileName = "/home/jdandoy/Documents/Dijet/MultijetBalanceFW/gridOutput/Oct20_area/SystToolOutput/group.phys-exotics.data15_13TeV.00280231.physics_Main.ST_20151020_SystToolOutput.root";
-  std::string inFileName = ""; // /home/jdandoy/Documents/Dijet/MultijetBalanceFW/gridOutput/workarea/Nov5_bootstrap_area/SystToolOutput/allData.root";
-  unsigned int nToys = 100;
+  std::string inFileName = "";
+  unsigned int nThreads = 0;
+  unsigned int queueDepth = 200;
+  bool f_flat = false;
 
   /////////// Retrieve getBootstrap's arguments //////////////////////////
   std::vector< std::string> options;
@@ -32,12 +55,14 @@ int main(int argc, char *argv[])
 
   if (argc > 1 && options.at(0).compare("-h") == 0) {
     std::cout << std::endl
-         << " runDijetResonance : DijetResonance job submission" << std::endl
+         << " runBootstrapHistogrammer : Turn bootstrap objects into toy histograms" << std::endl
          << std::endl
          << " Optional arguments:" << std::endl
          << "  -h                Prints this menu" << std::endl
          << "  --file            Path to a bootstrap file" << std::endl
-//         << "  --nominal         Only Nominal Hists" << std::endl
+         << "  --nThreads        Number of threads unpacking systematics (default all cores)" << std::endl
+         << "  --queueDepth      Maximum number of toys waiting to be written (default 200)" << std::endl
+         << "  --flat            Write histograms without TDirectories, as <dir>_recoilPt_PtBal" << std::endl
          << std::endl;
     exit(1);
   }
@@ -56,23 +81,54 @@ int main(int argc, char *argv[])
          inFileName = options.at(iArg+1);
          iArg += 2;
        }
+    } else if (options.at(iArg).compare("--nThreads") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --nThreads should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         nThreads = std::stoi(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--queueDepth") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --queueDepth should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         queueDepth = std::stoi(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--flat") == 0) {
+      f_flat = true;
+      ++iArg;
     }else{
       std::cout << "Couldn't understand argument " << options.at(iArg) << std::endl;
       return 1;
     }
   }//while arguments
 
+  if ( inFileName.size() == 0){
+    cout << "No input file given " << endl;
+    exit(1);
+  }
 
   std::string fileDir = inFileName.substr(0, inFileName.find_last_of("/") );
   cout << "saving to fileDir " << fileDir << endl;
 
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(kFALSE);
+
   // Get binning and systematics from SystToolOutput file //
   TFile *inFile = TFile::Open(inFileName.c_str(), "READ");
+  if( !inFile || inFile->IsZombie() ){
+    cout << "Error, could not open " << inFileName << ". Exiting..." << endl;
+    exit(1);
+  }
   TIter next(inFile->GetListOfKeys());
   TKey *key;
 
   std::vector<std::string> sysNames;
-  std::vector<double> ptBins;
   std::string sysName = "";
 
   // Get Systematics (Nominal first) //
@@ -86,27 +142,93 @@ int main(int argc, char *argv[])
     }
   }
 
+  // The writer reuses this one histogram for every toy of every systematic
+  TH2DBootstrap* nominalBootstrap = (TH2DBootstrap*) inFile->Get( "bootstrap_Nominal" );
+  if( !nominalBootstrap ){
+    cout << "Error, no bootstrap_Nominal in " << inFileName << ". Exiting..." << endl;
+    exit(1);
+  }
+  TH2D* outHist = (TH2D*) nominalBootstrap->GetNominal()->Clone("recoilPt_PtBal");
+  outHist->SetTitle("recoilPt_PtBal");
+  outHist->Reset();
+  outHist->Sumw2();
+  const int nCells = outHist->GetNcells();
+  delete nominalBootstrap;
+
   TFile *output = TFile::Open((fileDir+"/hist.data.bootstrap.scaled.root").c_str(), "RECREATE");
+
+  BoundedQueue< ReplicaPayload* > writeQueue( queueDepth );
+  unsigned int nWritten = 0;
+  std::thread writer( [&](){
+    ReplicaPayload* payload = NULL;
+    while( writeQueue.pop(payload) ){
+      std::copy( payload->content.begin(), payload->content.end(), outHist->GetArray() );
+      if( payload->sumw2.size() > 0 )
+        outHist->GetSumw2()->Set( nCells, &payload->sumw2[0] );
+      outHist->ResetStats();
+      outHist->SetEntries( payload->entries );
+
+      if( f_flat ){
+        output->cd();
+        outHist->Write( (payload->dirName+"_recoilPt_PtBal").c_str() );
+      }else{
+        TDirectory* thisDir = output->mkdir( payload->dirName.c_str() );
+        thisDir->cd();
+        outHist->Write( "recoilPt_PtBal" );
+      }
+      delete payload;
+      ++nWritten;
+    }
+  });
+
+  // Only one bootstrap object waits beyond those being unpacked
+  ThreadPool unpackPool( nThreads, 1 );
+
+  bool f_error = false;
   for (unsigned int iSys = 0; iSys < sysNames.size(); ++iSys) {
     std::cout << "Systematic " << sysNames.at(iSys) << ": " << iSys << "/" << sysNames.size() << std::endl;
 
+    // TFile reads stay on the main thread
     TH2DBootstrap* bootStrap = (TH2DBootstrap*) inFile->Get( ("bootstrap_"+sysNames.at(iSys)).c_str());
-    for( unsigned int iT = 0; iT < nToys; ++iT){
-      std::string dirName = "Iteration0_"+sysNames.at(iSys)+"_"+to_string(iT);
-      output->mkdir( dirName.c_str() );
-      TDirectory* thisDir = (TDirectory*) output->Get( dirName.c_str() );
-      TH2D* thisHist = (TH2D*) bootStrap->GetReplica(iT);
-      thisHist->SetName("recoilPt_PtBal");
-      thisHist->SetTitle("recoilPt_PtBal");
-      thisHist->SetDirectory(thisDir);
-      output->cd( dirName.c_str() );
-      thisHist->Write();
-      thisHist->Clear();
-
+    if( !bootStrap ){
+      cout << "Error, could not retrieve bootstrap_" << sysNames.at(iSys) << endl;
+      f_error = true;
+      break;
     }
+    std::string thisSysName = sysNames.at(iSys);
+
+    unpackPool.submit( [bootStrap, thisSysName, nCells, &writeQueue](){
+      unsigned int nToys = bootStrap->GetNReplica();
+      for( unsigned int iT = 0; iT < nToys; ++iT){
+        const TH2D* thisHist = (const TH2D*) bootStrap->GetReplica(iT);
+        if( thisHist->GetNcells() != nCells ){
+          cout << "Error, toy " << iT << " of " << thisSysName << " has a different binning. Skipping it." << endl;
+          continue;
+        }
+
+        ReplicaPayload* payload = new ReplicaPayload();
+        payload->dirName = "Iteration0_"+thisSysName+"_"+to_string(iT);
+        payload->content.assign( thisHist->GetArray(), thisHist->GetArray()+nCells );
+        if( thisHist->GetSumw2N() == nCells )
+          payload->sumw2.assign( thisHist->GetSumw2()->GetArray(), thisHist->GetSumw2()->GetArray()+nCells );
+        payload->entries = thisHist->GetEntries();
+        writeQueue.push( payload );
+      }
+      delete bootStrap;
+    });
   }
+
+  unpackPool.wait();
+  writeQueue.close();
+  writer.join();
+
   output->Close();
   inFile->Close();
 
+  if( f_error )
+    return 1;
+
+  std::cout << "Wrote " << nWritten << " toy histograms after " << (std::time(0) - initialTime) << " seconds" << std::endl;
+
   return 0;
 }
@@ -3,6 +3,8 @@
 //////////////////////////////////////////////////////////////////
 // Run fits on histograms made from bootstrap toys.
 // Allows rebinning based on RMS of bootstrap toy fits.
+// The rebinning itself is done by BootstrapRebinner, which is
+// shared with runBootstrapSystematics.
 //////////////////////////////////////////////////////////////////
 // jeff.dandoy@cern.ch
 //////////////////////////////////////////////////////////////////
@@ -14,118 +16,17 @@
 #include <sys/stat.h>
 
 #include <TFile.h>
-#include <TLatex.h>
-#include <TCanvas.h>
 #include <TKey.h>
 #include <TH1.h>
 #include <TH2.h>
+#include <TROOT.h>
 
-#include "JES_ResponseFitter/JES_BalanceFitter.h"
+#include "MultijetBalance/BootstrapRebinner.h"
+#include "MultijetBalance/BalanceFitDriver.h"
+#include "MultijetBalance/NominalToyCache.h"
 
 using namespace std;
 
-///// Function for plotting fitted distributions //////////////
-int SaveCanvas(int startBin, int endBin, string cName, JES_BalanceFitter* m_BalFit){
-  TCanvas c1;// = new TCanvas("c1");
-  TLatex lt;// = new TLatex();
-  lt.SetTextSize(0.04);
-  lt.SetNDC();
-
-  c1.cd();
-  TF1* thisFit = (TF1*) m_BalFit->GetFit();
-  TH1D* thisHisto = (TH1D*) m_BalFit->GetHisto();
-  thisHisto->Draw();
-  thisFit->Draw("same");
-
-  float thisMean = 0., thisError = 0., thisRedChi = 0., thisMedian = 0., thisWidth = 0., thisMedianHist = 0.;
-
-  thisMean = m_BalFit->GetMean();
-  thisError = m_BalFit->GetMeanError();
-  thisMedian = m_BalFit->GetMedian();
-  thisRedChi = m_BalFit->GetChi2Ndof();
-  thisWidth = m_BalFit->GetSigma();
-
-  if (thisError < 0.5)
-    thisMedianHist = m_BalFit->GetHistoMedian();
-  else
-    thisMedianHist = -99.;
-
-  float ltx = 0.62;
-  float lty = 0.80;
-
-  char name[200];
-
-  sprintf(name, "Bins: %i to %i", startBin, endBin);
-  lt.DrawLatex(ltx,lty,name);
-  lty -= 0.05;
-
-  sprintf(name, "pT: %.0f to %.0f", thisHisto->GetXaxis()->GetBinLowEdge(startBin), thisHisto->GetXaxis()->GetBinUpEdge(endBin));
-  lt.DrawLatex(ltx,lty,name);
-  lty -= 0.05;
-
-  sprintf(name,"Mean: %.3f", thisMean);
-  lt.DrawLatex(ltx,lty,name);
-  lty -= 0.05;
-
-  sprintf(name,"Fit Median: %.3f", thisMedian);
-  lt.DrawLatex(ltx,lty,name);
-  lty -= 0.05;
-
-  sprintf(name,"Hist Median: %.3f", thisMedianHist);
-  lt.DrawLatex(ltx,lty,name);
-  lty -= 0.05;
-
-  sprintf(name,"Error: %.4f", thisError);
-  lt.DrawLatex(ltx,lty,name);
-  lty -= 0.05;
-
-  sprintf(name,"RedChi2: %.2f", thisRedChi);
-  lt.DrawLatex(ltx,lty,name);
-  lty -= 0.05;
-
-  sprintf(name,"Width: %.2f", thisWidth);
-  lt.DrawLatex(ltx,lty,name);
-  lty -= 0.05;
-
-  c1.Update();
-  c1.SaveAs( cName.c_str() );
-
-return 0;
-}
-
-inline bool isInteger(const std::string & s){
-  if(s.empty() || ((!isdigit(s[0])) && (s[0] != '-') && (s[0] != '+'))) return false ;
-
-  char * p ;
-  strtol(s.c_str(), &p, 10) ;
-
-  return (*p == 0) ;
-}
-
-TH2F* initialRebin( TH2F* inputHist ){
-
-
-  std::string histName = inputHist->GetName();
-  inputHist->SetName( ("tmp_"+histName).c_str() );
-  double binArray[] = {300, 360, 420, 480, 540, 600, 660, 720, 780, 840, 900, 960, 1020, 1140, 1260, 1480, 2000};
-  int nBins = 16;
-  Double_t ptBalBins[501];
-  int numPtBalBins = 500;
-  for(int i=0; i < numPtBalBins+1; ++i){
-    ptBalBins[i] = i/100.;
-  }
-
-  TH2F* newHist = new TH2F( histName.c_str(), inputHist->GetTitle(), nBins, binArray, numPtBalBins, ptBalBins);
-  newHist->Sumw2();
-  for(int iBinX=1; iBinX < inputHist->GetNbinsX()+1; ++iBinX){
-    for(int iBinY=1; iBinY < inputHist->GetNbinsY()+1; ++iBinY){
-      newHist->Fill( inputHist->GetXaxis()->GetBinLowEdge(iBinX)+0.0001, inputHist->GetYaxis()->GetBinLowEdge(iBinY)+0.0001, inputHist->GetBinContent(iBinX, iBinY) );
-    }
-  }
-  return newHist;
-}
-
-
 int main(int argc, char *argv[])
 {
   std::time_t initialTime = std::time(0);
@@ -148,15 +49,33 @@ int main(int argc, char *argv[])
          << "  --file            Path to a file ending in appended" << std::endl
          << "  --upperEdge       Upper edge for final bin" << std::endl
          << "  --sysType         String tag for which sys to run" << std::endl
-         << "  --threshold       Threshold value to determine rebinning (default 2 sigma)" << std::endl
+         << "  --threshold       Threshold value(s) to determine rebinning, comma separated (default 2 sigma)" << std::endl
          << "  --fit             Perform fits rather than a mean" << std::endl
+         << "  --warmStart       Seed fits from the Nominal fit of the same range or the previous range" << std::endl
+         << "  --fitPlots        file (default, one ROOT file in RMSFits/, drawn later by drawFitPlots), png (the same file, drawn at the end and removed) or none" << std::endl
+         << "  --fitCache        File caching fit results by histogram contents and fit configuration, reused by later runs" << std::endl
+         << "  --fitCachePrune   Only keep the fits of this job in the --fitCache file" << std::endl
+         << "  --fitMode         fit (default), estimator (closed-form truncated Gaussian, no minimizer) or validate (fit and compare to the estimator).  Implies --fit" << std::endl
+         << "  --convergence     Stop using toys for a range once the significance is this many sigma from the threshold (default 0, all toys; otherwise the values and edges can differ from using all toys)" << std::endl
+         << "  --minToys         Minimum toys per range before checking convergence (default 20)" << std::endl
+         << "  --binningFile     File with an initialBinning TH2 giving the initial recoil pt and pt balance binning (default: initialBinning of --file, else 16 bins from 300 to 2000 and 500 from 0 to 5)" << std::endl
+         << "  --buildNominalCache  Only write the Nominal toy cache, to be shared by later jobs" << std::endl
          << std::endl;
     exit(1);
   }
 
   std::string sysType = "";
-  double threshold = 2.; //sigma
+  std::string thresholdList = "2"; //sigma
+  double convergenceSigma = 0.;
+  unsigned int minToys = 20;
   bool f_fit = false;
+  bool f_warmStart = false;
+  BalanceFitDriver::Mode fitMode = BalanceFitDriver::Fitting;
+  FitPlotRecorder::Mode fitPlotsMode = FitPlotRecorder::File;
+  std::string fitCacheName = "";
+  std::string binningFileName = "";
+  bool f_fitCachePrune = false;
+  bool f_buildCache = false;
 
   int iArg = 0;
   while(iArg < argc-1) {
@@ -193,15 +112,77 @@ int main(int argc, char *argv[])
     } else if (options.at(iArg).compare("--threshold") == 0) {
        char tmpChar = options.at(iArg+1)[0];
        if (iArg+1 == argc || tmpChar == '-' ) {
-         std::cout << " --threshold should be followed by a float" << std::endl;
+         std::cout << " --threshold should be followed by a comma separated list of floats" << std::endl;
+         return 1;
+       } else {
+         thresholdList = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--convergence") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --convergence should be followed by a float" << std::endl;
          return 1;
        } else {
-         threshold = std::stof(options.at(iArg+1));
+         convergenceSigma = std::stof(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--binningFile") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --binningFile should be followed by a file path" << std::endl;
+         return 1;
+       } else {
+         binningFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--minToys") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --minToys should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         minToys = std::stoi(options.at(iArg+1));
          iArg += 2;
        }
     } else if (options.at(iArg).compare("--fit") == 0) {
       f_fit = true;
       ++iArg;
+    } else if (options.at(iArg).compare("--fitMode") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' || !BalanceFitDriver::parseMode( options.at(iArg+1), fitMode ) ) {
+         std::cout << " --fitMode should be followed by fit, estimator or validate" << std::endl;
+         return 1;
+       } else {
+         f_fit = true;
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--fitPlots") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' || !FitPlotRecorder::parseMode( options.at(iArg+1), fitPlotsMode ) ) {
+         std::cout << " --fitPlots should be followed by png, file or none" << std::endl;
+         return 1;
+       } else {
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--fitCache") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --fitCache should be followed by a file path" << std::endl;
+         return 1;
+       } else {
+         fitCacheName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--fitCachePrune") == 0) {
+      f_fitCachePrune = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--warmStart") == 0) {
+      f_warmStart = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--buildNominalCache") == 0) {
+      f_buildCache = true;
+      ++iArg;
     }else{
       std::cout << "Couldn't understand argument " << options.at(iArg) << std::endl;
       return 1;
@@ -209,6 +190,13 @@ int main(int argc, char *argv[])
   }//while arguments
 
 
+  std::vector<std::string> thresholdNames;
+  std::vector<double> thresholds = BootstrapRebinner::parseThresholds( thresholdList, thresholdNames );
+  if ( thresholds.size() == 0){
+    cout << "No threshold given " << endl;
+    exit(1);
+  }
+
   if ( inFileName.size() == 0){
     cout << "No input file given " << endl;
     exit(1);
@@ -221,6 +209,31 @@ int main(int argc, char *argv[])
     exit(1);
   }
 
+  // Decode the Nominal toys once for all systematic jobs //
+  if( f_buildCache ){
+    TFile *inFile = TFile::Open(inFileName.c_str(), "READ");
+    if( !inFile || inFile->IsZombie() ){
+      cout << "Error, could not open " << inFileName << ".  Exiting..." << endl;
+      exit(1);
+    }
+    if( !BootstrapRebinner::configureInitialBinning( inFile, binningFileName ) )
+      exit(1);
+    TIter next(inFile->GetListOfKeys());
+    TKey *key;
+    std::string iteration = "";
+    while ((key = (TKey*)next() )){
+      std::string sysName = BootstrapRebinner::stripFlatSuffix( key->GetName() );
+      if( sysName.find("_Nominal") != std::string::npos ){
+        iteration = sysName.substr(0, sysName.find_first_of('_'));
+        break;
+      }
+    }
+    if( iteration.size() == 0 || !NominalToyCache::build( inFile, inFileName, iteration ) )
+      exit(1);
+    inFile->Close();
+    return 0;
+  }
+
   /// Get output name ///
   std::string outFileName = inFileName;
   outFileName.replace(pos, 6, "significant");
@@ -235,167 +248,111 @@ int main(int argc, char *argv[])
   std::string fitPlotsOutDir = outFileName;
   fitPlotsOutDir.erase(fitPlotsOutDir.find_last_of("/"));
   fitPlotsOutDir += "/RMSFits/";
-  mkdir(fitPlotsOutDir.c_str(), 0777);
+  if( !f_fit )
+    fitPlotsMode = FitPlotRecorder::None;
+  if( fitPlotsMode != FitPlotRecorder::None )
+    mkdir(fitPlotsOutDir.c_str(), 0777);
 
-  std::string fitPlotsOutName = outFileName;
-  fitPlotsOutName.erase(0, fitPlotsOutName.find_last_of("/"));
+  std::string fitPlotsOutName = outFileName.substr( outFileName.find_last_of("/")+1 );
+  // Fit plots are drawn or saved off the fitting thread
+  ROOT::EnableThreadSafety();
+  FitPlotRecorder fitPlots( fitPlotsMode, fitPlotsOutDir, fitPlotsOutName+".fitPlots.root" );
 
 
   // Get relevant systematics //
   TFile *inFile = TFile::Open(inFileName.c_str(), "READ");
+  if( !inFile || inFile->IsZombie() ){
+    cout << "Error, could not open " << inFileName << ".  Exiting..." << endl;
+    exit(1);
+  }
+  if( !BootstrapRebinner::configureInitialBinning( inFile, binningFileName ) )
+    exit(1);
   TIter next(inFile->GetListOfKeys());
   TKey *key;
 
-  std::vector<TH2F*> h_2D_sys, h_2D_nominal;
-  TH2F *h_full_recoilPt_PtBal = NULL, *h_full_recoilPt_PtBal_nominal = NULL;
+  // The TH2Fs are only kept when fits need projections.  Otherwise each toy is
+  // reduced to cumulative moment tables and any bin range is a subtraction
+  BootstrapVariation sysVar, nominalVar;
+  sysVar.name = sysType;
+  nominalVar.name = "Nominal";
+  std::string iteration = "";
   while ((key = (TKey*)next() )){
-    std::string sysName = key->GetName();
+    std::string sysName = BootstrapRebinner::stripFlatSuffix( key->GetName() );
     if( sysName.find(sysType) == std::string::npos)
       continue;
 
     //sysName formats are like: Iteration1_Zjet_Stat1_neg_97
     //nominal format is like: Iteration1_Zjet_Stat1_neg
-    std::string iteration = sysName.substr(0, sysName.find_first_of('_'));
-    std::string toyNum = sysName.substr(sysName.find_last_of('_')+1, sysName.size());
-    //if last field is an integer, then it's a toy.  Otherwise it's the full (non-bootstrap) result
-    if( isInteger(toyNum) ){
-      std::string nominalName = iteration+"_Nominal_"+toyNum;
-
-      TH2F* h_recoilPt_PtBal = (TH2F*) inFile->Get((sysName+"/recoilPt_PtBal").c_str());
-      TH2F* rebin_recoilPt_PtBal = initialRebin( h_recoilPt_PtBal );
-      h_2D_sys.push_back( rebin_recoilPt_PtBal );
-      TH2F* h_recoilPt_PtBal_nominal = (TH2F*) inFile->Get((nominalName+"/recoilPt_PtBal").c_str());
-      TH2F* rebin_recoilPt_PtBal_nominal = initialRebin( h_recoilPt_PtBal_nominal );
-      h_2D_nominal.push_back( rebin_recoilPt_PtBal_nominal );
+    iteration = sysName.substr(0, sysName.find_first_of('_'));
+    if( !BootstrapRebinner::addToVariation( inFile, sysName, sysVar, f_fit ) )
+      exit(1);
+  }
 
-    }else{
-      std::string nominalName = iteration+"_Nominal";
-      TH2F* h_tmp_recoilPt_PtBal = (TH2F*) inFile->Get((sysName+"/recoilPt_PtBal").c_str());
-      h_full_recoilPt_PtBal = initialRebin( h_tmp_recoilPt_PtBal );
-      TH2F* h_tmp_recoilPt_PtBal_nominal = (TH2F*) inFile->Get((nominalName+"/recoilPt_PtBal").c_str());
-      h_full_recoilPt_PtBal_nominal = initialRebin( h_tmp_recoilPt_PtBal_nominal );
+  // Matching Nominal toys, from the shared cache if possible
+  NominalToyCache nominalCache;
+  if( nominalCache.open( inFileName, iteration ) || (NominalToyCache::build( inFile, inFileName, iteration ) && nominalCache.open( inFileName, iteration )) ){
+    nominalCache.fill( nominalVar, f_fit, sysVar.toyNumbers );
+    nominalCache.close();
+  }else{
+    for(unsigned int iT=0; iT < sysVar.toyNumbers.size(); ++iT){
+      std::string nominalName = iteration+"_Nominal_"+to_string(sysVar.toyNumbers.at(iT));
+      if( !BootstrapRebinner::addToVariation( inFile, nominalName, nominalVar, f_fit ) )
+        exit(1);
     }
-
+    if( !BootstrapRebinner::addToVariation( inFile, iteration+"_Nominal", nominalVar, f_fit ) )
+      exit(1);
   }
-  cout << "numToys is " << h_2D_sys.size() << " and " << h_2D_nominal.size() << endl;
 
-  if(  h_2D_sys.size() < 1 || !(h_full_recoilPt_PtBal) || !(h_full_recoilPt_PtBal_nominal) ||
-      h_full_recoilPt_PtBal->IsZombie() || h_full_recoilPt_PtBal_nominal->IsZombie() ){
+  cout << "numToys is " << sysVar.toyMoments.size() << " and " << nominalVar.toyMoments.size() << endl;
+
+  if(  sysVar.toyMoments.size() < 1 || !(sysVar.full) || !(nominalVar.full) ){
     cout << "Error getting toys or nominal histogram.  Exiting..." << endl;
     exit(1);
   }
 
   // Get Fitting Object
   double NsigmaForFit = 1.6;
-  JES_BalanceFitter* m_BalFit = new JES_BalanceFitter(NsigmaForFit);
-
-
-  //Ignore any bins above upperEdge
-  int largestBin = h_2D_sys.at(0)->GetNbinsX();
-  while( h_2D_sys.at(0)->GetXaxis()->GetBinLowEdge(largestBin) >= upperEdge){
-    largestBin--;
-  }
-
-  vector<int> reverseBinEdges; //we start from upper end
-  reverseBinEdges.push_back( largestBin );
-  vector<float> values_significant;
-
-
-  // Loop over all bins //
-  for( int iBin=reverseBinEdges.at(reverseBinEdges.size()-1); iBin > 0; --iBin){
-
-    cout << "Combining bins " << iBin << " to " << reverseBinEdges.at(reverseBinEdges.size()-1) << endl;
-
-    //Get fits of this iBin projection for full (non-bootstrap)
-    TH1D* h_full_proj_sys = h_full_recoilPt_PtBal->ProjectionY("h_full_proj_sys", iBin, reverseBinEdges.at(reverseBinEdges.size()-1), "ed" );
-    TH1D* h_full_proj_nominal = h_full_recoilPt_PtBal_nominal->ProjectionY("h_full_proj_nominal", iBin, reverseBinEdges.at(reverseBinEdges.size()-1), "ed" );
-    float full_sysVal = -1., full_nominalVal = -1.;
-
-    if(f_fit){
-      m_BalFit->Fit(h_full_proj_nominal, 0); // Rebin histogram and fit
-      full_nominalVal = m_BalFit->GetMean();
-      m_BalFit->Fit(h_full_proj_sys, 0); // Rebin histogram and fit
-      full_sysVal = m_BalFit->GetMean();
-    }else{
-      full_nominalVal = h_full_proj_nominal->GetMean();
-      full_sysVal = h_full_proj_sys->GetMean();
+  BalanceFitDriver* m_BalFit = NULL;
+  FitResultCache* fitCache = NULL;
+  if( f_fit ){
+    m_BalFit = new BalanceFitDriver(NsigmaForFit);
+    m_BalFit->setWarmStart( f_warmStart );
+    m_BalFit->setMode( fitMode );
+    if( fitCacheName.size() > 0 ){
+      fitCache = new FitResultCache( fitCacheName );
+      m_BalFit->setCache( fitCache );
     }
+  }
 
-    vector<float> meanValues;
-    // Loop over all toys //
-    for(unsigned int iH = 0; iH < h_2D_sys.size(); ++iH){
-      TH1D* h_proj_sys = h_2D_sys.at(iH)->ProjectionY("h_proj_sys", iBin, reverseBinEdges.at(reverseBinEdges.size()-1), "ed" );
-      TH1D* h_proj_nominal = h_2D_nominal.at(iH)->ProjectionY("h_proj_nominal", iBin, reverseBinEdges.at(reverseBinEdges.size()-1), "ed" );
-      float sysVal = -1., nominalVal = -1.;
-
-      if(f_fit){
-        m_BalFit->Fit(h_proj_nominal, 0); // Rebin histogram and fit
-        nominalVal = m_BalFit->GetMean();
-        m_BalFit->Fit(h_proj_sys, 0); // Rebin histogram and fit
-        sysVal = m_BalFit->GetMean();
-      }else{
-        nominalVal = h_proj_nominal->GetMean();
-        sysVal = h_proj_sys->GetMean();
-      }
-      //!! Need to check here if fit failed, and otherwise give the projection?
-      meanValues.push_back(   nominalVal == 0 ? 0 : ((sysVal/nominalVal)-1.)  );
-      //cout << (sysVal-nominalVal)/nominalVal << " sys: " << sysVal << " nominalVal: " << nominalVal << endl;
-
-      // Draw this fit for the first toy //
-      if( f_fit && iH == 0){
-        string cName = fitPlotsOutDir+fitPlotsOutName+"_"+to_string(iBin)+"_"+to_string( reverseBinEdges.at(reverseBinEdges.size()-1) )+".png";
-        SaveCanvas(iBin, reverseBinEdges.at(reverseBinEdges.size()-1), cName, m_BalFit);
-      }
-    }
-
-    // Get mean value from full (non-bootstrap) results //
-    float mean = (full_nominalVal == 0 ? 0 : ((full_sysVal/full_nominalVal)-1.)  );
-
-    // Get RMS value from toys //
-    float RMS =  TMath::RMS(meanValues.size(), &meanValues[0]);
-
-    double mu = mean / RMS / RMS;
-    double sig = 1.0/ RMS / RMS;
-
-    // If RMS is below threshold, then save this bin as an edge. //
-    // If above RMS, then this bin will be added with the next bin //
-    //if( RMS < thresholdRMS){
-    cout << "mean: " << mean << " and RMS: " << RMS << endl;
-    cout << "sig: " << sig << " and mean/RMS " << fabs(mu)/sqrt(sig) << " and reverse " << sqrt(sig)/fabs(mu) << endl;
-//    if (RMS==0 || ( (fabs(mu)/sqrt(sig) > threshold)) ){ // 3 sigma sig + <30% error
-    //if (RMS==0 || ( (fabs(mu)/sqrt(sig) > threshold) && ( sqrt(sig)/fabs(mu) < 1.0/sqrt(10.0) )) ){ // 3 sigma sig + <30% error
-    if (RMS==0 ||  (fabs(mu)/sqrt(sig) > threshold)  ){ // 3 sigma sig + <30% error
-      reverseBinEdges.push_back(iBin-1);
-      if (RMS == 0)
-        values_significant.push_back( 0 );
-      else
-        values_significant.push_back( fabs(mu)/sqrt(sig) );
-    }
-
-
-  }//for all bins
-
-  // Create histograms of the significance values with the final binning //
-  int numBins = reverseBinEdges.size()-1;
-  Double_t newXbins[numBins];
-  for(unsigned int i=0; i < reverseBinEdges.size(); ++i){
-    newXbins[numBins-i] = h_2D_sys.at(0)->GetXaxis()->GetBinUpEdge(reverseBinEdges.at(i));
-    if (newXbins[numBins-i] > upperEdge)
-      newXbins[numBins-i] = upperEdge;
-    cout << "!! " << newXbins[numBins-i] << endl;
+  BootstrapRebinner rebinner( *sysVar.full->GetXaxis(), upperEdge, thresholds.at(0) );
+  rebinner.setConvergence( convergenceSigma, minToys );
+  rebinner.setPlotRecorder( &fitPlots );
+  std::vector< TH1D* > h_significants = rebinner.rebin( sysVar, nominalVar, thresholds, m_BalFit, fitPlotsOutName );
+  if( h_significants.size() < 1 ){
+    cout << "Error rebinning " << sysType << ".  Exiting..." << endl;
+    exit(1);
   }
-  TH1D* h_significant = new TH1D( ("significant_"+sysType).c_str(), ("significant_"+sysType).c_str(), numBins, newXbins);
-  for(int iBin=1; iBin < h_significant->GetNbinsX()+1; ++iBin){
-    h_significant->SetBinContent(iBin, values_significant.at(numBins-iBin) );
+  for(unsigned int iT=0; iT < h_significants.size(); ++iT){
+    cout << "Threshold " << thresholdNames.at(iT) << endl;
+    for(int iBin=1; iBin < h_significants.at(iT)->GetNbinsX()+2; ++iBin){
+      cout << "!! " << h_significants.at(iT)->GetXaxis()->GetBinLowEdge(iBin) << endl;
+    }
   }
+
   TFile *outFile = TFile::Open(outFileName.c_str(), "RECREATE");
-  h_significant->Write("", TObject::kOverwrite);
+  BootstrapRebinner::writeSignificant( outFile, h_significants, thresholdNames );
   outFile->Close();
   inFile->Close();
 
+  fitPlots.finish();
+  if( fitCache ){
+    fitCache->printStats();
+    fitCache->save( f_fitCachePrune );
+    delete fitCache;
+  }
+  BalanceFitDriver::printStats();
+
   std::cout << "Finished Fitting after " << (std::time(0) - initialTime) << " seconds" << std::endl;
 
   return 0;
 }
-
-
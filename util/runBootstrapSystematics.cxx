@@ -0,0 +1,473 @@
+//////////////////////////////////////////////////////////////////
+// runBootstrapSystematics.cxx
+//////////////////////////////////////////////////////////////////
+// Run the rebin (runBootstrapRebin) or fit (runFit) step for every
+// systematic of a bootstrap file in one process.
+// The Nominal toys are read once and shared by all systematics,
+// the systematics are scheduled on a thread pool with one fitter
+// per thread, and a single combined output file is written.
+// This replaces one process per systematic followed by hadd.
+//////////////////////////////////////////////////////////////////
+// jeff.dandoy@cern.ch
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <iostream>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <TFile.h>
+#include <TKey.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <TROOT.h>
+#include <Math/MinimizerOptions.h>
+
+#include "MultijetBalance/ThreadPool.h"
+#include "MultijetBalance/BalanceFitDriver.h"
+#include "MultijetBalance/BootstrapRebinner.h"
+#include "MultijetBalance/BalanceFitEngine.h"
+#include "MultijetBalance/NominalToyCache.h"
+
+using namespace std;
+
+namespace {
+  bool s_warmStart = false;
+  BalanceFitDriver::Mode s_fitMode = BalanceFitDriver::Fitting;
+  FitResultCache* s_fitCache = NULL;
+
+  // One fitter per worker thread, as JES_BalanceFitter keeps the state of the last fit
+  BalanceFitDriver* threadFitter(){
+    double NsigmaForFit = 1.6;
+    thread_local std::unique_ptr<BalanceFitDriver> t_fitter;
+    if( !t_fitter ){
+      t_fitter.reset( new BalanceFitDriver(NsigmaForFit) );
+      t_fitter->setWarmStart( s_warmStart );
+      t_fitter->setMode( s_fitMode );
+      t_fitter->setCache( s_fitCache );
+    }
+    return t_fitter.get();
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  std::time_t initialTime = std::time(0);
+  gErrorIgnoreLevel = 2000;
+  std::string inFileName = "";
+  float upperEdge = 999999;
+
+  /////////// Retrieve arguments //////////////////////////
+  std::vector< std::string> options;
+  for(int ii=1; ii < argc; ++ii){
+    options.push_back( argv[ii] );
+  }
+
+  if (argc > 1 && options.at(0).compare("-h") == 0) {
+    std::cout << std::endl
+         << " runBootstrapSystematics : rebin or fit all systematics in one process" << std::endl
+         << std::endl
+         << " Optional arguments:" << std::endl
+         << "  -h                Prints this menu" << std::endl
+         << "  --file            Path to a file ending in scaled" << std::endl
+         << "  --rebin           Run the rebinning step (runBootstrapRebin) rather than the fit step (runFit)" << std::endl
+         << "  --rebinFileName   Path to rebin file for the fit step.  No rebinning if this is not set" << std::endl
+         << "  --upperEdge       Upper edge for final bin" << std::endl
+         << "  --sysType         Only run on systematics containing this string" << std::endl
+         << "  --threshold       Threshold value(s) to determine rebinning, comma separated (default 2 sigma)" << std::endl
+         << "  --fit             Perform fits rather than a mean" << std::endl
+         << "  --warmStart       Seed fits from the Nominal fit of the same range or the previous range" << std::endl
+         << "  --fitCache        File caching fit results by histogram contents and fit configuration, reused by later runs" << std::endl
+         << "  --fitCachePrune   Only keep the fits of this job in the --fitCache file" << std::endl
+         << "  --fitMode         fit (default), estimator (closed-form truncated Gaussian, no minimizer) or validate (fit and compare to the estimator).  Implies --fit" << std::endl
+         << "  --convergence     Stop using toys for a range once the significance is this many sigma from the threshold (default 0, all toys; otherwise the values and edges can differ from using all toys)" << std::endl
+         << "  --minToys         Minimum toys per range before checking convergence (default 20)" << std::endl
+         << "  --binningFile     File with an initialBinning TH2 giving the initial recoil pt and pt balance binning (default: initialBinning of --file, else 16 bins from 300 to 2000 and 500 from 0 to 5)" << std::endl
+         << "  --nThreads        Number of threads (default all cores)" << std::endl
+         << std::endl;
+    exit(1);
+  }
+
+  std::string sysType = "";
+  std::string rebinFileName = "";
+  std::string thresholdList = "2"; //sigma
+  double convergenceSigma = 0.;
+  unsigned int minToys = 20;
+  bool f_fit = false;
+  bool f_warmStart = false;
+  BalanceFitDriver::Mode fitMode = BalanceFitDriver::Fitting;
+  std::string fitCacheName = "";
+  std::string binningFileName = "";
+  bool f_fitCachePrune = false;
+  bool f_rebin = false;
+  unsigned int nThreads = 0;
+
+  int iArg = 0;
+  while(iArg < argc-1) {
+    if (options.at(iArg).compare("-h") == 0) {
+       // Ignore if not first argument
+       ++iArg;
+    } else if (options.at(iArg).compare("--file") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --file should be followed by a file or folder" << std::endl;
+         return 1;
+       } else {
+         inFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--rebinFileName") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --rebinFileName should be followed by a file" << std::endl;
+         return 1;
+       } else {
+         rebinFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--sysType") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --sysType should be followed by a string" << std::endl;
+         return 1;
+       } else {
+         sysType = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--upperEdge") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --upperEdge should be followed by a float" << std::endl;
+         return 1;
+       } else {
+         upperEdge = std::stof(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--threshold") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --threshold should be followed by a comma separated list of floats" << std::endl;
+         return 1;
+       } else {
+         thresholdList = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--nThreads") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --nThreads should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         nThreads = std::stoi(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--convergence") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --convergence should be followed by a float" << std::endl;
+         return 1;
+       } else {
+         convergenceSigma = std::stof(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--binningFile") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --binningFile should be followed by a file path" << std::endl;
+         return 1;
+       } else {
+         binningFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--minToys") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --minToys should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         minToys = std::stoi(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--fit") == 0) {
+      f_fit = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--fitMode") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' || !BalanceFitDriver::parseMode( options.at(iArg+1), fitMode ) ) {
+         std::cout << " --fitMode should be followed by fit, estimator or validate" << std::endl;
+         return 1;
+       } else {
+         f_fit = true;
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--fitCache") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --fitCache should be followed by a file path" << std::endl;
+         return 1;
+       } else {
+         fitCacheName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--fitCachePrune") == 0) {
+      f_fitCachePrune = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--warmStart") == 0) {
+      f_warmStart = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--rebin") == 0) {
+      f_rebin = true;
+      ++iArg;
+    }else{
+      std::cout << "Couldn't understand argument " << options.at(iArg) << std::endl;
+      return 1;
+    }
+  }//while arguments
+
+  std::vector<std::string> thresholdNames;
+  std::vector<double> thresholds = BootstrapRebinner::parseThresholds( thresholdList, thresholdNames );
+  if ( thresholds.size() == 0){
+    cout << "No threshold given " << endl;
+    exit(1);
+  }
+
+  if ( inFileName.size() == 0){
+    cout << "No input file given " << endl;
+    exit(1);
+  }
+
+  std::size_t pos = inFileName.find("scaled");
+  if( pos == std::string::npos ){
+    cout << "Only runs on \"scaled\" files " << endl;
+    exit(1);
+  }
+
+  /// Combined output, as previously made by hadd in runBootstrapFitting.py ///
+  std::string histType;
+  if( f_rebin )
+    histType = "significant";
+  else if( f_fit )
+    histType = "fit_MJB_initial";
+  else
+    histType = "mean_MJB_initial";
+  std::string outFileName = inFileName.substr(0, inFileName.find_last_of('/')+1) + "hist.data.all."+histType+".root";
+  cout << "Creating Output File " << outFileName << endl;
+
+  s_warmStart = f_warmStart;
+  s_fitMode = fitMode;
+  if( f_fit && fitCacheName.size() > 0 )
+    s_fitCache = new FitResultCache( fitCacheName );
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(kFALSE);
+  // Minuit2 does not share global state between concurrent fits, unlike TMinuit
+  ROOT::Math::MinimizerOptions::SetDefaultMinimizer("Minuit2");
+
+  TFile *inFile = TFile::Open(inFileName.c_str(), "READ");
+  if( !inFile || inFile->IsZombie() ){
+    cout << "Error, could not open " << inFileName << ".  Exiting..." << endl;
+    exit(1);
+  }
+  if( !BootstrapRebinner::configureInitialBinning( inFile, binningFileName ) )
+    exit(1);
+
+  // All reading happens on this thread, while the pool processes earlier systematics.
+  // maxQueued bounds how many systematics are held in memory at once.
+  ThreadPool pool( nThreads, 2 );
+  cout << "Running with " << pool.size() << " threads" << endl;
+
+  TFile *outFile = NULL;
+
+  if( f_rebin ){
+
+    // Group the toys by systematic, the toy number is the last field of the name
+    std::vector< std::string > sysNames;
+    std::vector< std::vector< std::string > > sysDirs;
+    std::string iteration = "";
+    TIter next(inFile->GetListOfKeys());
+    TKey *key;
+    while ((key = (TKey*)next() )){
+      std::string dirName = BootstrapRebinner::stripFlatSuffix( key->GetName() );
+      std::string sysName = dirName.substr( dirName.find_first_of('_')+1 );
+      iteration = dirName.substr(0, dirName.find_first_of('_'));
+      if( BootstrapRebinner::isInteger( sysName.substr(sysName.find_last_of('_')+1) ) )
+        sysName = sysName.substr(0, sysName.find_last_of('_'));
+      if( sysType.size() > 0 && sysName.find(sysType) == std::string::npos && sysName.compare("Nominal") != 0 )
+        continue;
+
+      unsigned int iS = 0;
+      while( iS < sysNames.size() && sysNames.at(iS).compare(sysName) != 0 )
+        ++iS;
+      if( iS == sysNames.size() ){
+        sysNames.push_back( sysName );
+        sysDirs.push_back( std::vector< std::string >() );
+      }
+      sysDirs.at(iS).push_back( dirName );
+    }
+
+    // The Nominal is read once and shared read-only by every task
+    BootstrapVariation nominalVar;
+    nominalVar.name = "Nominal";
+    NominalToyCache nominalCache;
+    if( nominalCache.open( inFileName, iteration ) || (NominalToyCache::build( inFile, inFileName, iteration ) && nominalCache.open( inFileName, iteration )) ){
+      nominalCache.fill( nominalVar, f_fit );
+      nominalCache.close();
+    }else{
+      for(unsigned int iS=0; iS < sysNames.size(); ++iS){
+        if( sysNames.at(iS).compare("Nominal") != 0 )
+          continue;
+        for(unsigned int iD=0; iD < sysDirs.at(iS).size(); ++iD){
+          if( !BootstrapRebinner::addToVariation( inFile, sysDirs.at(iS).at(iD), nominalVar, f_fit ) )
+            exit(1);
+        }
+      }
+    }
+    if( !(nominalVar.full) ){
+      cout << "Error getting nominal histogram " << iteration << "_Nominal.  Exiting..." << endl;
+      exit(1);
+    }
+    cout << "numToys is " << nominalVar.toyMoments.size() << " for Nominal" << endl;
+
+    BootstrapRebinner rebinner( *nominalVar.full->GetXaxis(), upperEdge, thresholds.at(0) );
+    rebinner.setConvergence( convergenceSigma, minToys );
+
+    std::mutex resultMutex;
+    std::vector< std::vector< TH1D* > > results( sysNames.size() );
+    for(unsigned int iS=0; iS < sysNames.size(); ++iS){
+      if( sysType.size() > 0 && sysNames.at(iS).find(sysType) == std::string::npos )
+        continue;
+
+      if( sysNames.at(iS).compare("Nominal") == 0 ){
+        pool.submit( [&, iS](){
+          std::vector< TH1D* > h_significants = rebinner.rebin( nominalVar, nominalVar, thresholds, f_fit ? threadFitter() : NULL );
+          std::lock_guard<std::mutex> lock(resultMutex);
+          results.at(iS) = h_significants;
+        });
+        continue;
+      }
+
+      std::shared_ptr< BootstrapVariation > sysVar( new BootstrapVariation() );
+      sysVar->name = sysNames.at(iS);
+      for(unsigned int iD=0; iD < sysDirs.at(iS).size(); ++iD){
+        if( !BootstrapRebinner::addToVariation( inFile, sysDirs.at(iS).at(iD), *sysVar, f_fit ) )
+          exit(1);
+      }
+      if( sysVar->toyMoments.size() < 1 || !(sysVar->full) ){
+        cout << "Error getting toys or full histogram for " << sysVar->name << ", skipping" << endl;
+        sysVar->clear();
+        continue;
+      }
+      cout << "Systematic " << sysVar->name << " (" << iS+1 << "/" << sysNames.size() << ")" << endl;
+
+      pool.submit( [&, sysVar, iS](){
+        std::vector< TH1D* > h_significants = rebinner.rebin( *sysVar, nominalVar, thresholds, f_fit ? threadFitter() : NULL );
+        sysVar->clear();
+        std::lock_guard<std::mutex> lock(resultMutex);
+        results.at(iS) = h_significants;
+      });
+    }
+    pool.wait();
+
+    outFile = TFile::Open(outFileName.c_str(), "RECREATE");
+    for(unsigned int iS=0; iS < results.size(); ++iS){
+      BootstrapRebinner::writeSignificant( outFile, results.at(iS), thresholdNames );
+      for(unsigned int iT=0; iT < results.at(iS).size(); ++iT){
+        delete results.at(iS).at(iT);
+      }
+    }
+    nominalVar.clear();
+
+  }else{
+
+    BalanceFitEngine engine( f_fit, upperEdge );
+    if( rebinFileName.size() > 0 && !engine.loadRebinFile( rebinFileName ) )
+      exit(1);
+
+    outFile = TFile::Open(outFileName.c_str(), "RECREATE");
+
+    // Outputs are written by this thread's writer in the order of the input keys,
+    // whatever order the fits finish in
+    std::mutex outputMutex;
+    std::condition_variable outputReady;
+    std::vector< BalanceFitOutput* > outputs;
+    unsigned int nSubmitted = 0;
+    bool doneSubmitting = false;
+
+    std::thread writer( [&](){
+      unsigned int iWrite = 0;
+      while( true ){
+        BalanceFitOutput* output = NULL;
+        {
+          std::unique_lock<std::mutex> lock(outputMutex);
+          outputReady.wait(lock, [&]{ return (iWrite < outputs.size() && outputs.at(iWrite)) || (doneSubmitting && iWrite == nSubmitted); });
+          if( iWrite == nSubmitted && doneSubmitting )
+            return;
+          output = outputs.at(iWrite);
+        }
+        output->printValidation();
+        output->write( outFile );
+        output->clear();
+        delete output;
+        ++iWrite;
+      }
+    });
+
+    TIter next(inFile->GetListOfKeys());
+    TKey *key;
+    int nKeys = inFile->GetNkeys();
+    int keyCount = 0;
+    while ((key = (TKey*)next() )){
+      std::string sysName = BootstrapRebinner::stripFlatSuffix( key->GetName() );
+      keyCount++;
+      if( sysType.size() > 0 && sysName.find(sysType) == std::string::npos)
+        continue;
+
+      TH2* h_recoilPt_PtBal = BootstrapRebinner::getBalanceHist( inFile, sysName );
+      if( !h_recoilPt_PtBal ){
+        cout << "Error, could not retrieve recoilPt_PtBal for " << sysName << ", skipping" << endl;
+        continue;
+      }
+      h_recoilPt_PtBal->SetDirectory(0);
+      cout << "Systematic " << sysName << " (" << keyCount << "/" << nKeys << ")" << endl;
+
+      unsigned int iOutput;
+      {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        iOutput = nSubmitted++;
+        outputs.push_back( NULL );
+      }
+      pool.submit( [&, sysName, h_recoilPt_PtBal, iOutput](){
+        BalanceFitOutput* output = engine.fit( sysName, h_recoilPt_PtBal, f_fit ? threadFitter() : NULL );
+        {
+          std::lock_guard<std::mutex> lock(outputMutex);
+          outputs.at(iOutput) = output;
+        }
+        outputReady.notify_one();
+      });
+    }
+    pool.wait();
+
+    {
+      std::lock_guard<std::mutex> lock(outputMutex);
+      doneSubmitting = true;
+    }
+    outputReady.notify_one();
+    writer.join();
+  }
+
+  outFile->Close();
+  inFile->Close();
+
+  if( s_fitCache ){
+    s_fitCache->printStats();
+    s_fitCache->save( f_fitCachePrune );
+    delete s_fitCache;
+  }
+  BalanceFitDriver::printStats();
+
+  std::cout << "Finished after " << (std::time(0) - initialTime) << " seconds" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,380 @@
+//////////////////////////////////////////////////////////////////
+// runDoubleRatio.cxx
+//////////////////////////////////////////////////////////////////
+// Second stage combination of the MJB histograms of data and MC,
+// on the contiguous systematic x bin arrays of SystematicArrays:
+//  - with --dataFile and --mcFile, the double ratio of each
+//    systematic, as calculateDoubleRatio.py, and with --sys its
+//    relative differences to nominal, as calculateDoubleRatioSys.py
+//  - with --sysFile, only the relative differences of an existing
+//    DoubleMJB file
+//  - with --combine, the quadrature sums of the relative shifts of
+//    each group of systematics of a file, as getCombinedSysHist of
+//    plotSysRatios.py, for the plotting scripts to draw
+//////////////////////////////////////////////////////////////////
+// jeff.dandoy@cern.ch
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+
+#include <TFile.h>
+#include <TH1.h>
+#include <TROOT.h>
+
+#include "MultijetBalance/SystematicArrays.h"
+
+using namespace std;
+
+namespace {
+
+std::string dirName( const std::string& fileName ){
+  size_t slash = fileName.find_last_of('/');
+  return slash == std::string::npos ? "" : fileName.substr(0, slash+1);
+}
+
+std::string baseName( const std::string& fileName ){
+  size_t slash = fileName.find_last_of('/');
+  return slash == std::string::npos ? fileName : fileName.substr(slash+1);
+}
+
+std::string replaceAll( std::string text, const std::string& from, const std::string& to ){
+  size_t pos = 0;
+  while( (pos = text.find(from, pos)) != std::string::npos ){
+    text.replace(pos, from.size(), to);
+    pos += to.size();
+  }
+  return text;
+}
+
+std::vector<std::string> splitList( const std::string& list ){
+  std::vector<std::string> items;
+  std::stringstream ss( list );
+  std::string item;
+  while( std::getline(ss, item, ',') )
+    items.push_back( item );
+  return items;
+}
+
+bool loadFile( const std::string& fileName, const std::string& histFilter, SystematicArrays& arrays ){
+  TFile* inFile = TFile::Open( fileName.c_str(), "READ" );
+  if( !inFile || inFile->IsZombie() ){
+    cout << "Error, could not open " << fileName << endl;
+    return false;
+  }
+  bool f_loaded = arrays.load( inFile, histFilter );
+  inFile->Close();
+  delete inFile;
+  if( f_loaded && arrays.numDirs() == 0 ){
+    cout << "Error, no Iteration directory in " << fileName << endl;
+    return false;
+  }
+  return f_loaded;
+}
+
+bool writeFile( const std::string& fileName, const SystematicArrays& arrays ){
+  TFile* outFile = TFile::Open( fileName.c_str(), "RECREATE" );
+  if( !outFile || outFile->IsZombie() ){
+    cout << "Error, could not create " << fileName << endl;
+    return false;
+  }
+  bool f_written = arrays.write( outFile );
+  outFile->Close();
+  delete outFile;
+  if( f_written )
+    cout << "Wrote " << arrays.numDirs() << " directories to " << fileName << endl;
+  return f_written;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  std::time_t initialTime = std::time(0);
+
+  std::string dataFileName = "";
+  std::string mcFileName = "";
+  std::string sysFileName = "";
+  std::string bootstrapFileName = "";
+  std::string combineFileName = "";
+  std::string outFileName = "";
+  std::string histFilter = "MJB";
+  std::string sysTypesString = "Zjet,Gjet,LAr,Flavor,EtaIntercalibration,PunchThrough,Pileup,MCType,MJB";
+  std::string mjbSysString = "a40,a20,b15,b05,pta90,pta70,ptt30,ptt20";
+  bool f_sys = false;
+  bool f_mirrorToys = false;
+
+  /////////// Retrieve runDoubleRatio's arguments //////////////////////////
+  std::vector< std::string> options;
+  for(int ii=1; ii < argc; ++ii){
+    options.push_back( argv[ii] );
+  }
+
+  if (argc > 1 && options.at(0).compare("-h") == 0) {
+    std::cout << std::endl
+         << " runDoubleRatio : Double ratios and systematic combinations of MJB files" << std::endl
+         << std::endl
+         << " Optional arguments:" << std::endl
+         << "  -h                Prints this menu" << std::endl
+         << "  --dataFile        Data MJB_initial or MJB_nominal file, with --mcFile" << std::endl
+         << "  --mcFile          MC MJB file of the same type, with --dataFile" << std::endl
+         << "  --sys             Also write the DoubleMJB_sys differences of the double ratio" << std::endl
+         << "  --sysFile         Only write the DoubleMJB_sys differences of this DoubleMJB file" << std::endl
+         << "  --bootstrapFile   DoubleMJB_nominal file giving the nominal of each rebinned systematic" << std::endl
+         << "  --mirrorToys      Divide the data bootstrap toys <sys>_<i> by the MC <sys>, as mirrorMCtoData.py" << std::endl
+         << "  --combine         Write the combined up and down relative shifts of the systematics of this file" << std::endl
+         << "  --sysTypes        Comma separated groups of systematics to combine (default Zjet,...,MCType,MJB)" << std::endl
+         << "  --mjbSys          Comma separated MJB systematics kept in the combination (default a40,...,ptt20)" << std::endl
+         << "  --histFilter      Histograms of the double ratio contain this (default MJB)" << std::endl
+         << "  --outFile         Output file of the main step (default named as the Python scripts)" << std::endl
+         << std::endl;
+    exit(1);
+  }
+
+  int iArg = 0;
+  while(iArg < argc-1) {
+    if (options.at(iArg).compare("-h") == 0) {
+       // Ignore if not first argument
+       ++iArg;
+    } else if (options.at(iArg).compare("--dataFile") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --dataFile should be followed by a file" << std::endl;
+         return 1;
+       } else {
+         dataFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--mcFile") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --mcFile should be followed by a file" << std::endl;
+         return 1;
+       } else {
+         mcFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--sysFile") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --sysFile should be followed by a file" << std::endl;
+         return 1;
+       } else {
+         sysFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--bootstrapFile") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --bootstrapFile should be followed by a file" << std::endl;
+         return 1;
+       } else {
+         bootstrapFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--combine") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --combine should be followed by a file" << std::endl;
+         return 1;
+       } else {
+         combineFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--sysTypes") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --sysTypes should be followed by a list of systematic groups" << std::endl;
+         return 1;
+       } else {
+         sysTypesString = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--mjbSys") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --mjbSys should be followed by a list of MJB systematics" << std::endl;
+         return 1;
+       } else {
+         mjbSysString = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--histFilter") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --histFilter should be followed by a string" << std::endl;
+         return 1;
+       } else {
+         histFilter = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--outFile") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --outFile should be followed by a file" << std::endl;
+         return 1;
+       } else {
+         outFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--sys") == 0) {
+      f_sys = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--mirrorToys") == 0) {
+      f_mirrorToys = true;
+      ++iArg;
+    }else{
+      std::cout << "Couldn't understand argument " << options.at(iArg) << std::endl;
+      return 1;
+    }
+  }//while arguments
+
+  bool f_doubleRatio = dataFileName.size() > 0 || mcFileName.size() > 0;
+  int nModes = (f_doubleRatio ? 1 : 0) + (sysFileName.size() > 0 ? 1 : 0) + (combineFileName.size() > 0 ? 1 : 0);
+  if( nModes != 1 ){
+    cout << "Give one of --dataFile and --mcFile, --sysFile or --combine " << endl;
+    exit(1);
+  }
+  if( f_doubleRatio && (dataFileName.size() == 0 || mcFileName.size() == 0) ){
+    cout << "A double ratio needs both --dataFile and --mcFile " << endl;
+    exit(1);
+  }
+
+  TH1::AddDirectory(kFALSE);
+
+  SystematicArrays bootstrapArrays;
+  if( bootstrapFileName.size() > 0 && !loadFile( bootstrapFileName, "DoubleMJB", bootstrapArrays ) )
+    exit(1);
+  const SystematicArrays* reference = bootstrapFileName.size() > 0 ? &bootstrapArrays : NULL;
+
+  /////////// Double ratio (and its systematic differences) //////////////////////////
+  if( f_doubleRatio ){
+    if( !((dataFileName.find("MJB_initial") != std::string::npos && mcFileName.find("MJB_initial") != std::string::npos) ||
+          (dataFileName.find("MJB_nominal") != std::string::npos && mcFileName.find("MJB_nominal") != std::string::npos)) ){
+      cout << "Error, trying to run runDoubleRatio on non \"MJB_initial\" input " << mcFileName << " " << dataFileName << endl;
+      exit(1);
+    }
+
+    // Named as calculateDoubleRatio.py, hist.combined.<mcType>.(Fit_)DoubleMJB_<initial|nominal>.root
+    std::string mcType = "";
+    std::vector<std::string> mcNameParts;
+    std::stringstream ssName( baseName(mcFileName) );
+    std::string thisPart;
+    while( std::getline(ssName, thisPart, '.') )
+      mcNameParts.push_back( thisPart );
+    if( mcNameParts.size() >= 3 )
+      mcType = mcNameParts.at( mcNameParts.size()-3 );
+
+    // Bootstrap data files are all compared to the nominal MC
+    bool f_bootstrap = baseName(dataFileName).compare(0, 9, "bootstrap") == 0;
+    if( outFileName.size() == 0 ){
+      outFileName = dirName(dataFileName) + (f_bootstrap ? "bootstrap" : "hist") + ".combined." + mcType;
+      outFileName += (dataFileName.find("fit_MJB_") != std::string::npos) ? ".Fit_DoubleMJB" : ".DoubleMJB";
+      outFileName += (dataFileName.find("_nominal") != std::string::npos) ? "_nominal.root" : "_initial.root";
+    }
+
+    SystematicArrays dataArrays, mcArrays, doubleArrays;
+    if( !loadFile( dataFileName, histFilter, dataArrays ) || !loadFile( mcFileName, histFilter, mcArrays ) )
+      exit(1);
+    cout << "Creating Double MJB Correction Hists of " << dataArrays.numDirs() << " data and " << mcArrays.numDirs() << " MC systematics" << endl;
+    if( !SystematicArrays::doubleRatio( dataArrays, mcArrays, f_mirrorToys, f_bootstrap, histFilter, doubleArrays ) )
+      exit(1);
+    if( !writeFile( outFileName, doubleArrays ) )
+      exit(1);
+
+    if( f_sys ){
+      SystematicArrays sysArrays;
+      if( !SystematicArrays::relativeShifts( doubleArrays, reference, sysArrays ) )
+        exit(1);
+      if( !writeFile( replaceAll( outFileName, "DoubleMJB", "DoubleMJB_sys" ), sysArrays ) )
+        exit(1);
+    }
+  }
+
+  /////////// Systematic differences of an existing double ratio //////////////////////////
+  if( sysFileName.size() > 0 ){
+    if( outFileName.size() == 0 )
+      outFileName = replaceAll( sysFileName, "DoubleMJB", "DoubleMJB_sys" );
+    if( outFileName == sysFileName ){
+      cout << "Error, " << sysFileName << " is not a DoubleMJB file, give --outFile" << endl;
+      exit(1);
+    }
+    SystematicArrays inArrays, sysArrays;
+    if( !loadFile( sysFileName, "DoubleMJB", inArrays ) )
+      exit(1);
+    cout << "Creating Systematic Differences for Double MJB Correction Hists" << endl;
+    if( !SystematicArrays::relativeShifts( inArrays, reference, sysArrays ) )
+      exit(1);
+    if( !writeFile( outFileName, sysArrays ) )
+      exit(1);
+  }
+
+  /////////// Combined systematic bands //////////////////////////
+  if( combineFileName.size() > 0 ){
+    if( outFileName.size() == 0 )
+      outFileName = combineFileName.substr(0, combineFileName.size()-5) + ".sysCombined.root";
+
+    SystematicArrays inArrays, combinedArrays;
+    if( !loadFile( combineFileName, "", inArrays ) )
+      exit(1);
+    int nominal = inArrays.nominalDir();
+    if( nominal < 0 )
+      exit(1);
+
+    // Only some of the MJB systematics are used
+    std::vector<std::string> mjbSys = splitList( mjbSysString );
+    std::vector<unsigned int> sysDirs;
+    for(unsigned int iDir=0; iDir < inArrays.numDirs(); ++iDir){
+      const std::string& thisDir = inArrays.dirName(iDir);
+      if( (int) iDir == nominal )
+        continue;
+      bool f_use = thisDir.find("MJB") == std::string::npos;
+      for(unsigned int iM=0; iM < mjbSys.size() && !f_use; ++iM)
+        f_use = thisDir.find( mjbSys.at(iM) ) != std::string::npos;
+      if( f_use )
+        sysDirs.push_back( iDir );
+    }
+
+    std::vector<std::string> groupNames;
+    std::vector< std::vector<unsigned int> > groupDirs;
+    std::vector<unsigned int> allDirs;
+    std::vector<std::string> sysTypes = splitList( sysTypesString );
+    for(unsigned int iType=0; iType < sysTypes.size(); ++iType){
+      std::vector<unsigned int> thisGroup;
+      for(unsigned int iD=0; iD < sysDirs.size(); ++iD){
+        if( inArrays.dirName( sysDirs.at(iD) ).find( sysTypes.at(iType) ) != std::string::npos ){
+          thisGroup.push_back( sysDirs.at(iD) );
+          if( std::find( allDirs.begin(), allDirs.end(), sysDirs.at(iD) ) == allDirs.end() )
+            allDirs.push_back( sysDirs.at(iD) );
+        }
+      }
+      if( thisGroup.size() > 0 ){
+        groupNames.push_back( sysTypes.at(iType) );
+        groupDirs.push_back( thisGroup );
+      }
+    }
+    if( groupNames.size() == 0 ){
+      cout << "Error, found no systematics!!" << endl;
+      exit(1);
+    }
+    if( groupNames.size() > 1 ){
+      std::sort( allDirs.begin(), allDirs.end() );
+      groupNames.push_back( "All" );
+      groupDirs.push_back( allDirs );
+    }
+
+    cout << "Combining " << allDirs.size() << " systematics in " << groupNames.size() << " groups" << endl;
+    if( !SystematicArrays::combine( inArrays, groupNames, groupDirs, combinedArrays ) )
+      exit(1);
+    if( !writeFile( outFileName, combinedArrays ) )
+      exit(1);
+  }
+
+  std::cout << "Finished after " << (std::time(0) - initialTime) << " seconds" << std::endl;
+
+  return 0;
+}
@@ -1,4 +1,5 @@
 #include <vector>
+#include <map>
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -6,22 +7,47 @@
 #include <unistd.h>
 
 #include <TFile.h>
-#include <TProfile.h>
-#include <TLatex.h>
-#include <TCanvas.h>
 #include <TKey.h>
 #include <TH1.h>
 #include <TH2.h>
 #include <TROOT.h>
+#include <Math/MinimizerOptions.h>
 #include <sys/time.h>
 #include <sys/stat.h>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <atomic>
 
 
-//#include "/home/jdandoy/Documents/Dijet/MultijetBalanceFW/JES_ResponseFitter/JES_ResponseFitter/JES_BalanceFitter.h"
-#include "JES_ResponseFitter/JES_BalanceFitter.h"
+#include "MultijetBalance/ThreadPool.h"
+#include "MultijetBalance/BalanceFitDriver.h"
+#include "MultijetBalance/BalanceFitEngine.h"
+#include "MultijetBalance/BootstrapRebinner.h"
+#include "MultijetBalance/MCNormalization.h"
 
 using namespace std;
 
+namespace {
+  bool s_warmStart = false;
+  BalanceFitDriver::Mode s_fitMode = BalanceFitDriver::Fitting;
+  FitResultCache* s_fitCache = NULL;
+
+  // One fitter per worker thread, as JES_BalanceFitter keeps the state of the last fit
+  BalanceFitDriver* threadFitter(){
+    double NsigmaForFit = 1.6;
+    thread_local std::unique_ptr<BalanceFitDriver> t_fitter;
+    if( !t_fitter ){
+      t_fitter.reset( new BalanceFitDriver(NsigmaForFit) );
+      t_fitter->setWarmStart( s_warmStart );
+      t_fitter->setMode( s_fitMode );
+      t_fitter->setCache( s_fitCache );
+    }
+    return t_fitter.get();
+  }
+}
+
 int main(int argc, char *argv[])
 {
   std::time_t initialTime = std::time(0);
@@ -46,6 +72,13 @@ int main(int argc, char *argv[])
          << "  --sysType         String tag for which sys to run" << std::endl
          << "  --rebinFileName   Path to rebin file.  No rebinning if this is not set" << std::endl
          << "  --fit             Fit the histograms, rather than retrieving their mean directly" << std::endl
+         << "  --warmStart       Seed the systematic fits from the Nominal fit of the closest range (the Nominal from its previous range), unseeded fits stay JES_BalanceFitter, Nominal warm fits are timed and compared against cold ones" << std::endl
+         << "  --fitPlots        file (default, one ROOT file in fits/, drawn later by drawFitPlots), png (the same file, drawn at the end and removed) or none" << std::endl
+         << "  --fitCache        File caching fit results by histogram contents and fit configuration, reused by later runs" << std::endl
+         << "  --fitCachePrune   Only keep the fits of this job in the --fitCache file" << std::endl
+         << "  --fitMode         fit (default), estimator (closed-form truncated Gaussian, no minimizer) or validate (fit and compare to the estimator).  Implies --fit" << std::endl
+         << "  --nominalRebinning  Fit the Nominal histogram in the binning of every systematic (was runFit_NominalRebinning)" << std::endl
+         << "  --nThreads        Number of threads fitting systematics and ranges (default all cores)" << std::endl
          << std::endl;
     exit(1);
   }
@@ -53,6 +86,13 @@ int main(int argc, char *argv[])
   std::string sysType = "Iteration";
   std::string rebinFileName = "";
   bool f_fit = false;
+  bool f_warmStart = false;
+  BalanceFitDriver::Mode fitMode = BalanceFitDriver::Fitting;
+  FitPlotRecorder::Mode fitPlotsMode = FitPlotRecorder::File;
+  std::string fitCacheName = "";
+  bool f_fitCachePrune = false;
+  bool f_nominalRebinning = false;
+  unsigned int nThreads = 0;
 
   int iArg = 0;
   while(iArg < argc-1) {
@@ -95,9 +135,53 @@ int main(int argc, char *argv[])
          rebinFileName = options.at(iArg+1);
          iArg += 2;
        }
+    } else if (options.at(iArg).compare("--nThreads") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --nThreads should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         nThreads = std::stoi(options.at(iArg+1));
+         iArg += 2;
+       }
     } else if (options.at(iArg).compare("--fit") == 0) {
       f_fit = true;
       ++iArg;
+    } else if (options.at(iArg).compare("--fitMode") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' || !BalanceFitDriver::parseMode( options.at(iArg+1), fitMode ) ) {
+         std::cout << " --fitMode should be followed by fit, estimator or validate" << std::endl;
+         return 1;
+       } else {
+         f_fit = true;
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--fitPlots") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' || !FitPlotRecorder::parseMode( options.at(iArg+1), fitPlotsMode ) ) {
+         std::cout << " --fitPlots should be followed by png, file or none" << std::endl;
+         return 1;
+       } else {
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--fitCache") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --fitCache should be followed by a file path" << std::endl;
+         return 1;
+       } else {
+         fitCacheName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--fitCachePrune") == 0) {
+      f_fitCachePrune = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--warmStart") == 0) {
+      f_warmStart = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--nominalRebinning") == 0) {
+      f_nominalRebinning = true;
+      ++iArg;
     }else{
       std::cout << "Couldn't understand argument " << options.at(iArg) << std::endl;
       return 1;
@@ -116,29 +200,30 @@ int main(int argc, char *argv[])
     cout << "Only runs on \"scaled\" files " << endl;
     exit(1);
   }
+  // Nominal rebinning outputs were made by runFit_NominalRebinning
+  std::string outTag = f_nominalRebinning ? "nominal" : "initial";
   std::string outFileName = inFileName;
   if( f_fit )
-    outFileName.replace(pos, 6, "fit_MJB_initial");
+    outFileName.replace(pos, 6, "fit_MJB_"+outTag);
   else
-    outFileName.replace(pos, 6, "mean_MJB_initial");
+    outFileName.replace(pos, 6, "mean_MJB_"+outTag);
 
   if (sysType.size() > 0 && sysType.compare("Iteration") != 0)
     outFileName += ("."+sysType);
 
-  TFile* rebinFile = NULL;
-  if (rebinFileName.size() > 0){
-
-    pos = rebinFileName.find("significant");
-    if( pos == std::string::npos){
-      cout << "Rebinning only accepts \"significant\" files " << endl;
-      exit(1);
-    }
-
-    rebinFile = TFile::Open(rebinFileName.c_str(), "READ");
-    if( rebinFile->IsZombie() ){
-      cout << "Error, rebin file " << rebinFileName << " does not exist. Exiting..." << endl;
-      exit(1);
-    }
+  s_warmStart = f_warmStart;
+  s_fitMode = fitMode;
+  if( f_fit && fitCacheName.size() > 0 )
+    s_fitCache = new FitResultCache( fitCacheName );
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(kFALSE);
+  // Minuit2 does not share global state between concurrent fits, unlike TMinuit
+  ROOT::Math::MinimizerOptions::SetDefaultMinimizer("Minuit2");
+
+  BalanceFitEngine engine( f_fit, upperEdge );
+  if (rebinFileName.size() > 0 && !engine.loadRebinFile( rebinFileName ) ){
+    cout << "Error, could not load rebin file " << rebinFileName << ". Exiting..." << endl;
+    exit(1);
   }
 
   cout << "Creating Output File " << outFileName << endl;
@@ -146,7 +231,14 @@ int main(int argc, char *argv[])
   std::string fitPlotsOutDir = outFileName;
   fitPlotsOutDir.erase(fitPlotsOutDir.find_last_of("/"));
   fitPlotsOutDir += "/fits/";
-  mkdir(fitPlotsOutDir.c_str(), 0777);
+  if( !f_fit )
+    fitPlotsMode = FitPlotRecorder::None;
+  if( fitPlotsMode != FitPlotRecorder::None )
+    mkdir(fitPlotsOutDir.c_str(), 0777);
+  std::string outFileBase = outFileName.substr( outFileName.find_last_of("/")+1 );
+  // Fit plots are drawn or saved off the fitting and writing threads
+  FitPlotRecorder fitPlots( fitPlotsMode, fitPlotsOutDir, outFileBase+".fitPlots.root" );
+  engine.setKeepFits( fitPlots.enabled() );
 
 
   // Get binning and systematics from SystToolOutput file //
@@ -155,17 +247,101 @@ int main(int argc, char *argv[])
   TKey *key;
   int nKeys = inFile->GetNkeys();
 
+  // The MC of a single channel that was not scaled yet is normalized on read
+  double normScale = 1.;
+  std::map< int, MCNormalization > channels;
+  if( !MCNormalization::read( inFile, channels ) || !MCNormalization::check( inFile, channels ) )
+    exit(1);
+  if( channels.size() > 1 ){
+    cout << "Error, " << inFileName << " sums " << channels.size() << " MC channels without normalizing them, merge them with runHistMerge --normalize. Exiting..." << endl;
+    exit(1);
+  }else if( channels.size() == 1 ){
+    normScale = channels.begin()->second.scale();
+    cout << "Scaling the histograms of channel " << channels.begin()->first << " by " << normScale << endl;
+  }
+
   TFile *outFile = TFile::Open(outFileName.c_str(), "RECREATE");
 
+  //!! This is ad-hoc
+  std::string nomDirName = "Iteration1_Nominal";
+  TH2* h_nominal = NULL;
+  if( f_nominalRebinning ){
+    h_nominal = BootstrapRebinner::getBalanceHist( inFile, nomDirName );
+    if( !h_nominal ){
+      cout << "Error, could not retrieve " << nomDirName << ". Exiting..." << endl;
+      exit(1);
+    }
+    if( normScale != 1. )
+      h_nominal->Scale( normScale );
+  }
 
-  // Get Fitting Object
-  double NsigmaForFit = 1.6;
-  JES_BalanceFitter* m_BalFit = new JES_BalanceFitter(NsigmaForFit);
+  // Outputs are written (and their fit plots recorded) by one writer thread in the order of the input keys,
+  // whatever order the fits finish in
+  std::mutex outputMutex;
+  std::condition_variable outputReady;
+  std::vector< BalanceFitOutput* > outputs;
+  std::vector< std::string > plotNames;
+  unsigned int nSubmitted = 0;
+  bool doneSubmitting = false;
+
+  std::thread writer( [&](){
+    unsigned int iWrite = 0;
+    while( true ){
+      BalanceFitOutput* output = NULL;
+      std::string plotName;
+      {
+        std::unique_lock<std::mutex> lock(outputMutex);
+        outputReady.wait(lock, [&]{ return (iWrite < outputs.size() && outputs.at(iWrite)) || (doneSubmitting && iWrite == nSubmitted); });
+        if( iWrite == nSubmitted && doneSubmitting )
+          return;
+        output = outputs.at(iWrite);
+        plotName = plotNames.at(iWrite);
+      }
+      if( fitPlots.enabled() )
+        output->record( fitPlots, plotName );
+      output->printValidation();
+      output->write( outFile );
+      output->clear();
+      delete output;
+      ++iWrite;
+    }
+  });
+
+  // Warm-started fits are seeded by the Nominal fit of the closest range, which is
+  // done first so that the seeds (and results) do not depend on the thread scheduling
+  if( f_fit && f_warmStart ){
+    TH2* h_seed = NULL;
+    std::string seedName = nomDirName;
+    if( f_nominalRebinning ){
+      h_seed = (TH2*) h_nominal->Clone();
+    }else{
+      TIter nextSeed(inFile->GetListOfKeys());
+      while ((key = (TKey*)nextSeed() )){
+        std::string keyName = key->GetName();
+        if( keyName.size() > 8 && keyName.compare(keyName.size()-8, 8, "_Nominal") == 0 ){
+          seedName = keyName;
+          h_seed = BootstrapRebinner::getBalanceHist( inFile, keyName );
+          break;
+        }
+      }
+    }
+    if( h_seed ){
+      h_seed->SetDirectory(0);
+      if( normScale != 1. && !f_nominalRebinning )
+        h_seed->Scale( normScale );
+      BalanceFitOutput* seedOutput = engine.fit( seedName, h_seed, threadFitter() );
+      engine.addSeeds( seedOutput );
+      seedOutput->clear();
+      delete seedOutput;
+    }else{
+      cout << "Warning, no Nominal histogram to seed the fits, the systematics are fit without warm starts" << endl;
+    }
+  }
 
-  TCanvas* c1 = new TCanvas("c1");
-  TLatex *lt = new TLatex();
-  lt->SetTextSize(0.04);
-  lt->SetNDC();
+  // Systematics are read on this thread.  Each becomes one task per recoil pt range,
+  // and the last range of a systematic to finish hands the output to the writer.
+  ThreadPool pool( nThreads, 64 );
+  cout << "Running with " << pool.size() << " threads" << endl;
 
   int keyCount = 0;
   while ((key = (TKey*)next() )){
@@ -173,246 +349,81 @@ int main(int argc, char *argv[])
     if( sysName.find(sysType) == std::string::npos)
       continue;
 
-//    if( sysName.find("MJB_") != std::string::npos)
-//      continue;
-//    if( sysName.find("MCType") != std::string::npos)
-//      continue;
+    if( f_nominalRebinning && sysName.find("MCType") != std::string::npos)
+      continue;
 
-    std::string fitPlotsOutName = outFileName;
-    fitPlotsOutName.erase(0, fitPlotsOutName.find_last_of("/"));
-    fitPlotsOutName += "_"+sysName;
+    std::string fitPlotsOutName = outFileBase+"_"+sysName;
 
-    TH2F* h_recoilPt_PtBal = (TH2F*) inFile->Get((sysName+"/recoilPt_PtBal").c_str());
+    TH2* h_recoilPt_PtBal = NULL;
+    if( f_nominalRebinning )
+      h_recoilPt_PtBal = (TH2*) h_nominal->Clone();
+    else
+      h_recoilPt_PtBal = BootstrapRebinner::getBalanceHist( inFile, sysName );
+    if( !h_recoilPt_PtBal ){
+      cout << "Error, could not retrieve recoilPt_PtBal for " << sysName << ", skipping" << endl;
+      continue;
+    }
+    h_recoilPt_PtBal->SetDirectory(0);
+    if( normScale != 1. && !f_nominalRebinning )
+      h_recoilPt_PtBal->Scale( normScale );
 
     keyCount++;
     cout << "Systematic " << sysName << " (" << keyCount << "/" << nKeys << ")" << endl;
 
-    // Get Binning of output histogram
-    TArrayD* xBins = (TArrayD*) h_recoilPt_PtBal->GetXaxis()->GetXbins();
-    Double_t* xBinsD = xBins->GetArray();
-    int numBins = h_recoilPt_PtBal->GetNbinsX();
-
-    while( upperEdge < xBinsD[numBins]){
-      numBins--;
-    }
-    Double_t final_xBins[numBins];
-    for(int iBin = 0; iBin <= numBins; ++iBin){
-      if (xBinsD[iBin] < upperEdge)
-        final_xBins[iBin] = xBinsD[iBin];
-      else
-        final_xBins[iBin] = upperEdge;
-//cout << "iBin: " << iBin << " : " << final_xBins[iBin] << endl;
-    }
-    cout << "Setting last bin upper edge to " << final_xBins[numBins] << endl;
-
-    TH1D* h_template = new TH1D("Template", "Template", numBins, final_xBins);
-
-    TH1D* h_mean = (TH1D*) h_template->Clone("MJB");  h_mean->SetTitle("MJB");
-    TH1D* h_error = (TH1D*) h_template->Clone("Error");  h_mean->SetTitle("Error");
-    TH1D* h_redchi = (TH1D*) h_template->Clone("ReducedChi");  h_mean->SetTitle("ReducedChi");
-    TH1D* h_median = (TH1D*) h_template->Clone("Median");  h_mean->SetTitle("Median");
-    TH1D* h_width = (TH1D*) h_template->Clone("Width");  h_mean->SetTitle("Width");
-    TH1D* h_medianHist = (TH1D*) h_template->Clone("MedianHist");  h_mean->SetTitle("MedianHist");
-
-//    // Original Profile
-//    TProfile* prof_MJBcorrection = (TProfile*) h_recoilPt_PtBal->ProfileX("prof_MJBcorrection", 1, -1, "");
-//    TH1D* h_mean_prof = (TH1D*) prof_MJBcorrection->ProjectionX("h_mean_prof");
-
-    vector<int> binsToCombine;
-    if(rebinFile){
-    //if(rebinFile && (sysName.find("MCType") == std::string::npos) ){
-      std::string thisSysType;
-      if (sysName.find("MCType") != std::string::npos){
-        thisSysType = "significant_Nominal";
-      }else{
-        thisSysType = "significant_"+sysName.substr(11, sysName.size());
-      }
-      cout << "Rebin histogram is: " << thisSysType << endl;
-      TH1D* rebinHist = (TH1D*) rebinFile->Get(thisSysType.c_str());
-
-      // Get Binning of rebin histogram
-      TArrayD* xBinsRebin = (TArrayD*) rebinHist->GetXaxis()->GetXbins();
-      Double_t* xBinsDRebin = xBinsRebin->GetArray();
-      int rebin_numBins = rebinHist->GetNbinsX();
+    BalanceFitOutput* output = engine.prepare( sysName, h_recoilPt_PtBal );
 
-      while( upperEdge < xBinsDRebin[rebin_numBins]){
-        rebin_numBins--;
-      }
-
-      //Check that starting point is same between the two !!
-
-      //Find mapping between actual hist and rebin hist
-      //each index of binsToRebin will correspond to 1 fit (and to 1 bin of the rebin hist)
-      //each element of binsToRebin will be the end bin to fit to, with the previous element being the starting bin
-      int iRebin = 0;
-      for(int iBin = 0; iBin <= numBins; ++iBin){
-        if( xBinsDRebin[iRebin] == final_xBins[iBin]){
-          binsToCombine.push_back( iBin );
-          iRebin++;
-        }
-      }
-//      for( int iBin = 0; iBin < binsToCombine.size(); ++iBin){
-//        cout << iBin << " : " << binsToCombine.at(iBin) << endl;
-//        cout << xBinsDRebin[iBin] << " : " << final_xBins[binsToCombine.at(iBin)] << endl;
-//      }
-//      exit(1);
-    }else{
-      for(int iBin = 0; iBin <= numBins; ++iBin){
-        binsToCombine.push_back( iBin );
-      }
-//      for( int iBin = 0; iBin < binsToCombine.size(); ++iBin){
-//        cout << iBin << " : " << binsToCombine.at(iBin) << endl;
-//      }
-//      exit(1);
+    unsigned int iOutput;
+    {
+      std::lock_guard<std::mutex> lock(outputMutex);
+      iOutput = nSubmitted++;
+      outputs.push_back( NULL );
+      plotNames.push_back( fitPlotsOutName );
     }
-    // Loop over all projections, and fit
-    //for( int iBin=1; iBin < h_recoilPt_PtBal->GetNbinsX()+1; ++iBin){
-    for( unsigned int iRange=1; iRange < binsToCombine.size(); ++iRange){
-      int iBin_start = binsToCombine.at(iRange-1)+1;
-      int iBin_end = binsToCombine.at(iRange);
-      cout << iRange << " : " << iBin_start << " : " << iBin_end << endl;
-      TH1D* h_proj = h_recoilPt_PtBal->ProjectionY( "h_proj", iBin_start, iBin_end, "ed");
-      if (h_proj->GetEntries() < 1)
-        continue;
-
-      float thisMean = 0., thisError = 0., thisRedChi = 0., thisMedian = 0., thisWidth = 0., thisMedianHist = 0.;
-
-      if( f_fit ){
-        m_BalFit->Fit(h_proj, 0); // Rebin histogram and fit
-//Refit       m_BalFit->ReFit(h_proj, 0); // Rebin histogram and fit
-        thisMean = m_BalFit->GetMean();
-        thisError = m_BalFit->GetMeanError();
-      } else {
-        thisMean = h_proj->GetMean();
-        thisError = h_proj->GetMeanError();
-      }
 
-      //Save nominal results
-      for(int iBin = iBin_start; iBin <= iBin_end; ++iBin){
-        h_mean->SetBinContent( iBin, thisMean );
-        h_mean->SetBinError( iBin, thisError );
+    std::shared_ptr< std::atomic<unsigned int> > rangesLeft( new std::atomic<unsigned int>( output->ranges.size() ) );
+    auto publish = [&, output, iOutput](){
+      engine.finish( output );
+      {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        outputs.at(iOutput) = output;
       }
+      outputReady.notify_one();
+    };
 
-      //Save extra fit information
-      if( f_fit ){
-
-        TF1* thisFit = (TF1*) m_BalFit->GetFit();
-        TH1D* thisHisto = (TH1D*) m_BalFit->GetHisto();
-        thisHisto->Draw();
-        thisFit->Draw("same");
-
-
-        thisMedian = m_BalFit->GetMedian();
-        thisRedChi = m_BalFit->GetChi2Ndof();
-        thisWidth = m_BalFit->GetSigma();
-        if (thisError < 0.5)
-          thisMedianHist = m_BalFit->GetHistoMedian();
-        else
-          thisMedianHist = -99.0;
-
-        //output histogram will have the same binning as the final result
-        for(int iBin = iBin_start; iBin <= iBin_end; ++iBin){
-          h_error->SetBinContent(iBin, thisError );
-          h_median->SetBinContent(iBin, thisMedian);
-          h_redchi->SetBinContent(iBin, thisRedChi);
-          h_width->SetBinContent(iBin, thisWidth);
-          h_medianHist->SetBinContent(iBin, thisMedianHist);
-        }
-
-        float ltx = 0.62;
-        float lty = 0.80;
-
-        char name[200];
-
-        sprintf(name, "Bins: %i to %i", iBin_start, iBin_end);
-        lt->DrawLatex(ltx,lty,name);
-        lty -= 0.05;
-
-        sprintf(name, "pT: %.0f %.0f", h_recoilPt_PtBal->GetXaxis()->GetBinLowEdge(iBin_start), h_recoilPt_PtBal->GetXaxis()->GetBinUpEdge(iBin_end));
-        lt->DrawLatex(ltx,lty,name);
-        lty -= 0.05;
-
-        sprintf(name,"Mean: %.3f", thisMean);
-        lt->DrawLatex(ltx,lty,name);
-        lty -= 0.05;
-
-        sprintf(name,"Fit Median: %.3f", thisMedian);
-        lt->DrawLatex(ltx,lty,name);
-        lty -= 0.05;
-
-        if (thisError < 0.5){
-          sprintf(name,"Hist Median: %.3f", thisMedianHist);
-          lt->DrawLatex(ltx,lty,name);
-          lty -= 0.05;
-        }
-
-        sprintf(name,"Error: %.4f", thisError);
-        lt->DrawLatex(ltx,lty,name);
-        lty -= 0.05;
-
-        sprintf(name,"RedChi2: %.2f", thisRedChi);
-        lt->DrawLatex(ltx,lty,name);
-        lty -= 0.05;
-
-        sprintf(name,"Width: %.2f", thisWidth);
-        lt->DrawLatex(ltx,lty,name);
-        lty -= 0.05;
-
-        sprintf(name,"Projection Mean: %.3f", h_proj->GetMean());
-        lt->DrawLatex(ltx,lty,name);
-        lty -= 0.05;
-
-        sprintf(name,"Projection Error: %.4f", h_proj->GetMeanError());
-        lt->DrawLatex(ltx,lty,name);
-        lty -= 0.05;
-
-
-        c1->Update();
-        c1->SaveAs( (fitPlotsOutDir+fitPlotsOutName+"_"+to_string(iRange)+".png").c_str() );
-      }// if f_fit
-      h_proj->Delete();
+    if( output->ranges.size() == 0 ){
+      publish();
+      continue;
     }
-
-    h_mean->Draw();
-    c1->Update();
-    c1->SaveAs( (fitPlotsOutDir+fitPlotsOutName+"_preprofMJB.png").c_str() );
-
-
-
-    // Create output directory
-    outFile->mkdir(sysName.c_str());
-    TDirectoryFile* sysDir = (TDirectoryFile*) outFile->Get(sysName.c_str());
-    sysDir->cd();
-
-    // Save Histograms
-    h_recoilPt_PtBal->SetDirectory(sysDir); h_recoilPt_PtBal->Write();
-//    h_recoilPt_center->SetDirectory(sysDir); h_recoilPt_center->Write();
-    h_mean->SetDirectory(sysDir); h_mean->Write();
-    if (f_fit){
-      h_error->SetDirectory(sysDir); h_error->Write();
-      h_redchi->SetDirectory(sysDir); h_redchi->Write();
-      h_median->SetDirectory(sysDir); h_median->Write();
-      h_width->SetDirectory(sysDir); h_width->Write();
-      h_medianHist->SetDirectory(sysDir); h_medianHist->Write();
+    for( unsigned int iRange=0; iRange < output->ranges.size(); ++iRange){
+      pool.submit( [&, output, iRange, rangesLeft, publish](){
+        engine.fitRange( output, iRange, f_fit ? threadFitter() : NULL );
+        if( --(*rangesLeft) == 0 )
+          publish();
+      });
     }
+  }
+  pool.wait();
 
-    c1->Clear();
-    h_template->Delete();
-    h_recoilPt_PtBal->Delete();
-    h_mean->Delete();
-    h_error->Delete();
-    h_redchi->Delete();
-    h_median->Delete();
-    h_width->Delete();
-    h_medianHist->Delete();
-
-
+  {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    doneSubmitting = true;
   }
+  outputReady.notify_one();
+  writer.join();
+  fitPlots.finish();
 
+  delete h_nominal;
   outFile->Close();
   inFile->Close();
 
 
+  if( s_fitCache ){
+    s_fitCache->printStats();
+    s_fitCache->save( f_fitCachePrune );
+    delete s_fitCache;
+  }
+  BalanceFitDriver::printStats();
+
   std::cout << "Finished Fitting after " << (std::time(0) - initialTime) << " seconds" << std::endl;
 
     return 0;
@@ -0,0 +1,284 @@
+//////////////////////////////////////////////////////////////////
+// runHistMerge.cxx
+//////////////////////////////////////////////////////////////////
+// Sum the hist, cutflow or SystToolOutput files of many jobs into
+// one file, replacing hadd for these outputs (see HistMerger.h).
+// Each of --nThreads workers reads input files one at a time into
+// its own HistMerger, then the partial sums are added pairwise in
+// parallel, so at most one partial sum and one input file per
+// worker are in memory at any time.
+// With --normalize, unscaled MC inputs are scaled while they are
+// read by the MCNormalization of their channel summed over all
+// inputs, replacing the scaleHist.py pass.  An input that cannot be
+// told from data, or with MC jobs without MJBNormalization, is an
+// error.
+//////////////////////////////////////////////////////////////////
+// jeff.dandoy@cern.ch
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <map>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <glob.h>
+#include <unistd.h>
+
+#include <TFile.h>
+#include <TH1.h>
+#include <TROOT.h>
+
+#include "MultijetBalance/HistMerger.h"
+#include "MultijetBalance/MCNormalization.h"
+#include "MultijetBalance/OutputPolicy.h"
+#include "MultijetBalance/ThreadPool.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+  std::time_t initialTime = std::time(0);
+
+  std::vector<std::string> inFileNames;
+  std::string outFileName = "";
+  std::string policyString = "";
+  unsigned int nThreads = 0;
+  bool f_force = false;
+  bool f_normalize = false;
+  bool f_bySumOfWeights = false;
+
+  /////////// Retrieve runHistMerge's arguments //////////////////////////
+  std::vector< std::string> options;
+  for(int ii=1; ii < argc; ++ii){
+    options.push_back( argv[ii] );
+  }
+
+  if (argc > 1 && options.at(0).compare("-h") == 0) {
+    std::cout << std::endl
+         << " runHistMerge : Sum hist, cutflow or SystToolOutput files" << std::endl
+         << std::endl
+         << " Optional arguments:" << std::endl
+         << "  -h                Prints this menu" << std::endl
+         << "  --files           Comma separated list of input files, which may contain wildcards" << std::endl
+         << "  --outFile         Merged output file" << std::endl
+         << "  --policy          Output compression, ALGO:level as in m_outputPolicies (default ROOT's)" << std::endl
+         << "  --nThreads        Number of input files read at the same time (default all cores)" << std::endl
+         << "  -f                Overwrite --outFile if it exists" << std::endl
+         << "  --normalize       Scale each MC channel by 1/numEvents of its MJBNormalization, as scaleHist.py" << std::endl
+         << "  --bySumOfWeights  With --normalize, scale by 1/sumOfWeights instead" << std::endl
+         << std::endl;
+    exit(1);
+  }
+
+  int iArg = 0;
+  while(iArg < argc-1) {
+    if (options.at(iArg).compare("-h") == 0) {
+       // Ignore if not first argument
+       ++iArg;
+    } else if (options.at(iArg).compare("--files") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --files should be followed by a list of files" << std::endl;
+         return 1;
+       } else {
+         std::stringstream ss( options.at(iArg+1) );
+         std::string thisPattern;
+         while( std::getline(ss, thisPattern, ',') ){
+           glob_t globResult;
+           if( glob( thisPattern.c_str(), 0, NULL, &globResult ) == 0 ){
+             for(size_t iPath=0; iPath < globResult.gl_pathc; ++iPath)
+               inFileNames.push_back( globResult.gl_pathv[iPath] );
+           }else{
+             std::cout << " No file matches " << thisPattern << std::endl;
+             globfree( &globResult );
+             return 1;
+           }
+           globfree( &globResult );
+         }
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--outFile") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --outFile should be followed by a file" << std::endl;
+         return 1;
+       } else {
+         outFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--policy") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --policy should be followed by ALGO:level" << std::endl;
+         return 1;
+       } else {
+         policyString = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--nThreads") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --nThreads should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         nThreads = std::stoi(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("-f") == 0) {
+      f_force = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--normalize") == 0) {
+      f_normalize = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--bySumOfWeights") == 0) {
+      f_bySumOfWeights = true;
+      ++iArg;
+    }else{
+      std::cout << "Couldn't understand argument " << options.at(iArg) << std::endl;
+      return 1;
+    }
+  }//while arguments
+
+  if ( inFileNames.size() == 0 || outFileName.size() == 0 ){
+    cout << "Input files and an output file are needed " << endl;
+    exit(1);
+  }
+  if( !f_force && access( outFileName.c_str(), F_OK ) == 0 ){
+    cout << outFileName << " already exists, use -f to overwrite it " << endl;
+    exit(1);
+  }
+
+  OutputPolicy policy;
+  if( policyString.size() > 0 && !policy.parse( policyString ) )
+    exit(1);
+
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(kFALSE);
+
+  ThreadPool pool( nThreads );
+  unsigned int nWorkers = std::min( (unsigned int) inFileNames.size(), pool.size() );
+  cout << "Merging " << inFileNames.size() << " files with " << nWorkers << " threads" << endl;
+
+  std::atomic<bool> f_error(false);
+
+  // The normalization of a channel is summed over every input before any histogram is read
+  std::vector<double> fileScales( inFileNames.size(), 1. );
+  if( f_normalize ){
+    std::vector<int> fileChannels( inFileNames.size(), 0 );
+    std::map< int, MCNormalization > channels;
+    std::mutex channelMutex;
+    for(unsigned int iFile=0; iFile < inFileNames.size(); ++iFile){
+      pool.submit( [iFile, &inFileNames, &fileChannels, &channels, &channelMutex, &f_error](){
+        TFile* inFile = TFile::Open( inFileNames.at(iFile).c_str(), "READ" );
+        std::map< int, MCNormalization > thisChannels;
+        // MC inputs without their normalization are an error, not added unscaled
+        if( !inFile || inFile->IsZombie() || !MCNormalization::read( inFile, thisChannels ) || !MCNormalization::check( inFile, thisChannels, true ) ){
+          cout << "Error, could not read the normalization of " << inFileNames.at(iFile) << endl;
+          f_error = true;
+        }else if( thisChannels.size() > 1 ){
+          cout << "Error, " << inFileNames.at(iFile) << " already sums " << thisChannels.size() << " MC channels without normalizing them" << endl;
+          f_error = true;
+        }else if( thisChannels.size() == 1 ){
+          std::lock_guard<std::mutex> lock( channelMutex );
+          fileChannels.at(iFile) = thisChannels.begin()->first;
+          channels[ thisChannels.begin()->first ].add( thisChannels.begin()->second );
+        }
+        if( inFile )
+          inFile->Close();
+        delete inFile;
+      });
+    }
+    pool.wait();
+    if( f_error )
+      exit(1);
+
+    for( std::map< int, MCNormalization >::iterator it = channels.begin(); it != channels.end(); ++it ){
+      cout << "Channel " << it->first << ": " << it->second.m_nJobs << " jobs, " << it->second.m_numEvents << " events, sum of weights "
+           << it->second.m_sumOfWeights << ", xs " << it->second.xs() << ", acceptance " << it->second.acceptance()
+           << ", scale " << it->second.scale( f_bySumOfWeights ) << endl;
+    }
+    unsigned int nUnscaled = 0;
+    for(unsigned int iFile=0; iFile < inFileNames.size(); ++iFile){
+      if( fileChannels.at(iFile) != 0 )
+        fileScales.at(iFile) = channels[ fileChannels.at(iFile) ].scale( f_bySumOfWeights );
+      else
+        ++nUnscaled;
+    }
+    if( nUnscaled > 0 )
+      cout << nUnscaled << " files are data or already normalized MC, they are added unscaled" << endl;
+  }
+
+  // Every worker pulls the next unread file into its own partial sum
+  std::vector< HistMerger* > partialSums;
+  for(unsigned int iW=0; iW < nWorkers; ++iW)
+    partialSums.push_back( new HistMerger() );
+  std::atomic<unsigned int> nextFile(0);
+  for(unsigned int iW=0; iW < nWorkers; ++iW){
+    HistMerger* thisSum = partialSums.at(iW);
+    pool.submit( [thisSum, &inFileNames, &fileScales, &nextFile, &f_error](){
+      unsigned int iFile;
+      while( !f_error && (iFile = nextFile++) < inFileNames.size() ){
+        TFile* inFile = TFile::Open( inFileNames.at(iFile).c_str(), "READ" );
+        if( !inFile || inFile->IsZombie() ){
+          cout << "Error, could not open " << inFileNames.at(iFile) << endl;
+          f_error = true;
+        }else if( !thisSum->add( inFile, fileScales.at(iFile) ) ){
+          cout << "Error, could not add " << inFileNames.at(iFile) << endl;
+          f_error = true;
+        }
+        if( inFile )
+          inFile->Close();
+        delete inFile;
+      }
+    });
+  }
+  pool.wait();
+
+  // Pairwise reduction of the partial sums, log2(nWorkers) rounds
+  for(unsigned int step=1; step < partialSums.size() && !f_error; step *= 2){
+    for(unsigned int iSum=0; iSum+step < partialSums.size(); iSum += 2*step){
+      HistMerger* toSum = partialSums.at(iSum);
+      HistMerger* fromSum = partialSums.at(iSum+step);
+      pool.submit( [toSum, fromSum, &f_error](){
+        if( !toSum->add( *fromSum ) )
+          f_error = true;
+      });
+    }
+    pool.wait();
+  }
+
+  // The output is normalized, its histograms must not be scaled again
+  if( f_normalize && !f_error )
+    partialSums.at(0)->removeNormalization();
+
+  bool f_written = false;
+  if( !f_error ){
+    TFile* output = TFile::Open( outFileName.c_str(), "RECREATE" );
+    if( !output || output->IsZombie() ){
+      cout << "Error, could not create " << outFileName << ". Exiting..." << endl;
+      exit(1);
+    }
+    policy.apply( output );
+    f_written = partialSums.at(0)->write( output );
+    if( f_written )
+      cout << "Wrote " << partialSums.at(0)->numObjects() << " objects to " << outFileName;
+    output->Close();
+    delete output;
+  }
+
+  for(unsigned int iW=0; iW < partialSums.size(); ++iW)
+    delete partialSums.at(iW);
+
+  if( !f_written ){
+    cout << "Error merging, " << outFileName << " is not complete" << endl;
+    return 1;
+  }
+
+  std::cout << " after " << (std::time(0) - initialTime) << " seconds" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,246 @@
+//////////////////////////////////////////////////////////////////
+// runMJBHists.cxx
+//////////////////////////////////////////////////////////////////
+// Compiled calculateMJBHists.py: from a scaled file, writes the
+// appended file (a copy of every Iteration directory plus the MJB
+// corrections) and the MJB_initial file (only the corrections),
+// reading each directory once (see MJBHistCalculator.h).
+// Directories are read and processed by --nThreads workers, each
+// with its own TFile, and written in the order of the input keys.
+//////////////////////////////////////////////////////////////////
+// jeff.dandoy@cern.ch
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <map>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+#include <TFile.h>
+#include <TKey.h>
+#include <TH1.h>
+#include <TROOT.h>
+
+#include "MultijetBalance/MJBHistCalculator.h"
+#include "MultijetBalance/MCNormalization.h"
+#include "MultijetBalance/OutputPolicy.h"
+#include "MultijetBalance/ThreadPool.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+  std::time_t initialTime = std::time(0);
+  gErrorIgnoreLevel = 2000;
+  std::string inFileName = "";
+  std::string policyString = "";
+  unsigned int nThreads = 0;
+
+  /////////// Retrieve runMJBHists's arguments //////////////////////////
+  std::vector< std::string> options;
+  for(int ii=1; ii < argc; ++ii){
+    options.push_back( argv[ii] );
+  }
+
+  if (argc > 1 && options.at(0).compare("-h") == 0) {
+    std::cout << std::endl
+         << " runMJBHists : Create the appended and MJB_initial files of a scaled file" << std::endl
+         << std::endl
+         << " Optional arguments:" << std::endl
+         << "  -h                Prints this menu" << std::endl
+         << "  --file            Path to a file ending in scaled" << std::endl
+         << "  --policy          Output compression, ALGO:level as in m_outputPolicies (default ROOT's)" << std::endl
+         << "  --nThreads        Number of directories processed at the same time (default all cores)" << std::endl
+         << std::endl;
+    exit(1);
+  }
+
+  int iArg = 0;
+  while(iArg < argc-1) {
+    if (options.at(iArg).compare("-h") == 0) {
+       // Ignore if not first argument
+       ++iArg;
+    } else if (options.at(iArg).compare("--file") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --file should be followed by a file" << std::endl;
+         return 1;
+       } else {
+         inFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--policy") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --policy should be followed by ALGO:level" << std::endl;
+         return 1;
+       } else {
+         policyString = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--nThreads") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --nThreads should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         nThreads = std::stoi(options.at(iArg+1));
+         iArg += 2;
+       }
+    }else{
+      std::cout << "Couldn't understand argument " << options.at(iArg) << std::endl;
+      return 1;
+    }
+  }//while arguments
+
+  if ( inFileName.size() == 0){
+    cout << "No input file given " << endl;
+    exit(1);
+  }
+
+  std::size_t pos = inFileName.find("scaled");
+  if( pos == std::string::npos ){
+    cout << "Error, trying to run runMJBHists on non \"scaled\" input " << inFileName << endl;
+    exit(1);
+  }
+  std::string appendedFileName = inFileName;
+  appendedFileName.replace(pos, 6, "appended");
+  std::string correctionFileName = inFileName;
+  correctionFileName.replace(pos, 6, "MJB_initial");
+
+  OutputPolicy policy;
+  if( policyString.size() > 0 && !policy.parse( policyString ) )
+    exit(1);
+
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(kFALSE);
+
+  TFile *inFile = TFile::Open(inFileName.c_str(), "READ");
+  if( !inFile || inFile->IsZombie() ){
+    cout << "Error, could not open " << inFileName << ". Exiting..." << endl;
+    exit(1);
+  }
+
+  std::vector< std::string > dirNames;
+  TIter next(inFile->GetListOfKeys());
+  TKey *key;
+  while ((key = (TKey*)next() )){
+    std::string keyName = key->GetName();
+    if( keyName.find("Iteration") != std::string::npos )
+      dirNames.push_back( keyName );
+  }
+  if( dirNames.size() == 0 ){
+    cout << "Error, no Iteration directory in " << inFileName << ". Exiting..." << endl;
+    exit(1);
+  }
+
+  // The MC of a single channel that was not scaled yet is normalized on read
+  double normScale = 1.;
+  std::map< int, MCNormalization > channels;
+  if( !MCNormalization::read( inFile, channels ) || !MCNormalization::check( inFile, channels ) )
+    exit(1);
+  if( channels.size() > 1 ){
+    cout << "Error, " << inFileName << " sums " << channels.size() << " MC channels without normalizing them, merge them with runHistMerge --normalize. Exiting..." << endl;
+    exit(1);
+  }else if( channels.size() == 1 ){
+    normScale = channels.begin()->second.scale();
+    cout << "Scaling the histograms of channel " << channels.begin()->first << " by " << normScale << endl;
+  }
+  // Carried to both outputs, which are normalized
+  TH1* sampleHist = dynamic_cast<TH1*>( inFile->Get( MCNormalization::sampleName.c_str() ) );
+  if( sampleHist ){
+    sampleHist->SetDirectory(0);
+    MCNormalization::setNormalized( sampleHist );
+  }
+  inFile->Close();
+  delete inFile;
+
+  TFile* appendedFile = TFile::Open(appendedFileName.c_str(), "RECREATE");
+  TFile* correctionFile = TFile::Open(correctionFileName.c_str(), "RECREATE");
+  if( !appendedFile || appendedFile->IsZombie() || !correctionFile || correctionFile->IsZombie() ){
+    cout << "Error, could not create " << appendedFileName << " or " << correctionFileName << ". Exiting..." << endl;
+    exit(1);
+  }
+  policy.apply( appendedFile );
+  policy.apply( correctionFile );
+  if( sampleHist ){
+    appendedFile->WriteTObject( sampleHist, sampleHist->GetName() );
+    correctionFile->WriteTObject( sampleHist, sampleHist->GetName() );
+    delete sampleHist;
+  }
+
+  MJBHistCalculator calculator( normScale );
+
+  // Outputs are written by one writer thread in the order of the input keys,
+  // whatever order the directories finish in
+  std::mutex outputMutex;
+  std::condition_variable outputReady;
+  std::vector< MJBHistOutput* > outputs( dirNames.size(), NULL );
+  std::vector< bool > finished( dirNames.size(), false );
+  std::atomic<bool> f_error(false);
+
+  std::thread writer( [&](){
+    for(unsigned int iWrite=0; iWrite < dirNames.size(); ++iWrite){
+      MJBHistOutput* output = NULL;
+      {
+        std::unique_lock<std::mutex> lock(outputMutex);
+        outputReady.wait(lock, [&]{ return finished.at(iWrite); });
+        output = outputs.at(iWrite);
+        outputs.at(iWrite) = NULL;
+      }
+      if( !output )
+        continue;
+      output->write( appendedFile, correctionFile );
+      output->clear();
+      delete output;
+    }
+  });
+
+  // Every directory is one task, reading from its own handle of the input file
+  ThreadPool pool( nThreads, 64 );
+  cout << "Creating new hists for " << dirNames.size() << " directories with " << pool.size() << " threads" << endl;
+  for(unsigned int iDir=0; iDir < dirNames.size(); ++iDir){
+    pool.submit( [&, iDir](){
+      MJBHistOutput* output = NULL;
+      TFile* thisFile = TFile::Open(inFileName.c_str(), "READ");
+      if( !thisFile || thisFile->IsZombie() ){
+        cout << "Error, could not open " << inFileName << endl;
+        f_error = true;
+      }else{
+        output = calculator.calculate( thisFile, dirNames.at(iDir) );
+        if( !output )
+          f_error = true;
+      }
+      if( thisFile )
+        thisFile->Close();
+      delete thisFile;
+      {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        outputs.at(iDir) = output;
+        finished.at(iDir) = true;
+      }
+      outputReady.notify_one();
+    });
+  }
+  pool.wait();
+  writer.join();
+
+  appendedFile->Close();
+  correctionFile->Close();
+  delete appendedFile;
+  delete correctionFile;
+
+  if( f_error ){
+    cout << "Error, " << appendedFileName << " and " << correctionFileName << " are not complete" << endl;
+    return 1;
+  }
+
+  std::cout << "Wrote " << appendedFileName << " and " << correctionFileName << " after " << (std::time(0) - initialTime) << " seconds" << std::endl;
+
+  return 0;
+}
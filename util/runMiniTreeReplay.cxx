@@ -0,0 +1,461 @@
+//////////////////////////////////////////////////////////////////
+// runMiniTreeReplay.cxx
+//////////////////////////////////////////////////////////////////
+// Rebuild the MultijetHists histograms from the outTree_<sysVar>
+// MiniTrees of MultijetBalanceAlgo, with a new recoil binning or
+// a tighter event selection, without rerunning on xAOD.
+// Each task fills private histograms for one range of entries of
+// one tree of one file, and adds them to the histograms of its
+// variation when done.
+// The outTree_variations of m_compactTree only hold the recoil pt,
+// pt balance, weight and njet of each variation, so they can only
+// be replayed with --minimal and without a tighter selection.  A
+// task then fills every variation from one range of entries.
+//////////////////////////////////////////////////////////////////
+// jeff.dandoy@cern.ch
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <map>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <unistd.h>
+
+#include <TFile.h>
+#include <TKey.h>
+#include <TTree.h>
+#include <TH1.h>
+#include <TROOT.h>
+
+#include "MultijetBalance/MiniTreeHists.h"
+#include "MultijetBalance/ThreadPool.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+  std::time_t initialTime = std::time(0);
+
+  std::vector<std::string> inFileNames;
+  std::string outFileName = "hist.miniTreeReplay.root";
+  std::string binningString = "";
+  std::vector<std::string> sysVars;
+  int iteration = 0;
+  MiniTreeSelection selection;
+  bool f_minimal = false;
+  bool f_flat = false;
+  unsigned int nThreads = 0;
+  Long64_t chunkSize = 200000;
+
+  /////////// Retrieve runMiniTreeReplay's arguments //////////////////////////
+  std::vector< std::string> options;
+  for(int ii=1; ii < argc; ++ii){
+    options.push_back( argv[ii] );
+  }
+
+  if (argc > 1 && options.at(0).compare("-h") == 0) {
+    std::cout << std::endl
+         << " runMiniTreeReplay : Histogram MultijetBalanceAlgo MiniTrees" << std::endl
+         << std::endl
+         << " Optional arguments:" << std::endl
+         << "  -h                Prints this menu" << std::endl
+         << "  --files           Comma separated list of MiniTree files" << std::endl
+         << "  --outFile         Output histogram file (default hist.miniTreeReplay.root)" << std::endl
+         << "  --binning         Comma separated recoil pt bin edges in GeV, as m_binning" << std::endl
+         << "  --iteration       Iteration number of the output directories (default 0)" << std::endl
+         << "  --sysVar          Comma separated variations (default all outTree_ of the first file)" << std::endl
+         << "  --ptAsym          Tighter maximum pt asymmetry" << std::endl
+         << "  --alpha           Tighter maximum pi-alpha" << std::endl
+         << "  --beta            Tighter minimum beta" << std::endl
+         << "  --allJetBeta      Apply --beta to all jets, as m_allJetBeta" << std::endl
+         << "  --minimal         Only make recoilPt_PtBal, required for m_compactTree MiniTrees" << std::endl
+         << "  --flat            Write histograms without TDirectories, as <dir>_<histogram>" << std::endl
+         << "  --nThreads        Number of threads filling histograms (default all cores)" << std::endl
+         << "  --chunkSize       Number of entries per task (default 200000)" << std::endl
+         << std::endl;
+    exit(1);
+  }
+
+  int iArg = 0;
+  while(iArg < argc-1) {
+    if (options.at(iArg).compare("-h") == 0) {
+       // Ignore if not first argument
+       ++iArg;
+    } else if (options.at(iArg).compare("--files") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --files should be followed by a list of files" << std::endl;
+         return 1;
+       } else {
+         std::stringstream ss( options.at(iArg+1) );
+         std::string thisFile;
+         while( std::getline(ss, thisFile, ',') )
+           inFileNames.push_back( thisFile );
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--outFile") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --outFile should be followed by a file" << std::endl;
+         return 1;
+       } else {
+         outFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--binning") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --binning should be followed by a list of bin edges" << std::endl;
+         return 1;
+       } else {
+         binningString = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--iteration") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --iteration should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         iteration = std::stoi(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--sysVar") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --sysVar should be followed by a list of variations" << std::endl;
+         return 1;
+       } else {
+         std::stringstream ss( options.at(iArg+1) );
+         std::string thisSysVar;
+         while( std::getline(ss, thisSysVar, ',') )
+           sysVars.push_back( thisSysVar );
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--ptAsym") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --ptAsym should be followed by a number" << std::endl;
+         return 1;
+       } else {
+         selection.ptAsym = std::stof(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--alpha") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --alpha should be followed by a number" << std::endl;
+         return 1;
+       } else {
+         selection.alpha = std::stof(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--beta") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --beta should be followed by a number" << std::endl;
+         return 1;
+       } else {
+         selection.beta = std::stof(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--allJetBeta") == 0) {
+      selection.allJetBeta = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--minimal") == 0) {
+      f_minimal = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--flat") == 0) {
+      f_flat = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--nThreads") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --nThreads should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         nThreads = std::stoi(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--chunkSize") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --chunkSize should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         chunkSize = std::stoll(options.at(iArg+1));
+         iArg += 2;
+       }
+    }else{
+      std::cout << "Couldn't understand argument " << options.at(iArg) << std::endl;
+      return 1;
+    }
+  }//while arguments
+
+  if ( inFileNames.size() == 0){
+    cout << "No input files given " << endl;
+    exit(1);
+  }
+  if ( binningString.size() == 0){
+    cout << "No binning given, use the m_binning of the MiniTree job " << endl;
+    exit(1);
+  }
+  if ( chunkSize <= 0 ){
+    cout << "Error, --chunkSize must be positive " << endl;
+    exit(1);
+  }
+
+  std::vector<double> binning;
+  std::stringstream binningStream( binningString );
+  std::string thisBinEdge;
+  while( std::getline(binningStream, thisBinEdge, ',') )
+    binning.push_back( std::stod(thisBinEdge) );
+  if( binning.size() < 2 ){
+    cout << "Error, --binning needs at least 2 bin edges " << endl;
+    exit(1);
+  }
+  for(unsigned int iB=1; iB < binning.size(); ++iB){
+    if( binning.at(iB) <= binning.at(iB-1) ){
+      cout << "Error, --binning must be increasing " << endl;
+      exit(1);
+    }
+  }
+
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(kFALSE);
+
+  // Get variations and entries of each tree, on the main thread //
+  std::map< std::string, std::vector<Long64_t> > treeEntries;
+  // For m_compactTree MiniTrees, the variations of the outTree_variations arrays and the index of each of sysVars
+  bool f_compact = false;
+  std::vector<std::string> compactNames;
+  std::vector<unsigned int> compactIndex;
+  for(unsigned int iFile=0; iFile < inFileNames.size(); ++iFile){
+    TFile* inFile = TFile::Open( inFileNames.at(iFile).c_str(), "READ" );
+    if( !inFile || inFile->IsZombie() ){
+      cout << "Error, could not open " << inFileNames.at(iFile) << ". Exiting..." << endl;
+      exit(1);
+    }
+
+    TTree* variationTree = (TTree*) inFile->Get( "outTree_variations" );
+    if( iFile == 0 && variationTree ){
+      f_compact = true;
+      compactNames = MiniTreeVariations::names( variationTree );
+      if( sysVars.size() == 0 )
+        sysVars = compactNames;
+      for(unsigned int iSys=0; iSys < sysVars.size(); ++iSys){
+        std::vector<std::string>::iterator found = std::find(compactNames.begin(), compactNames.end(), sysVars.at(iSys));
+        if( found == compactNames.end() ){
+          cout << "Error, no variation " << sysVars.at(iSys) << " in outTree_variations of " << inFileNames.at(iFile) << ". Exiting..." << endl;
+          exit(1);
+        }
+        compactIndex.push_back( found-compactNames.begin() );
+      }
+    }
+    if( f_compact ){
+      if( !variationTree || MiniTreeVariations::names( variationTree ) != compactNames ){
+        cout << "Error, " << inFileNames.at(iFile) << " does not have the outTree_variations of " << inFileNames.at(0) << ". Exiting..." << endl;
+        exit(1);
+      }
+      treeEntries["outTree_variations"].push_back( variationTree->GetEntries() );
+      inFile->Close();
+      continue;
+    }
+
+    if( iFile == 0 && sysVars.size() == 0 ){
+      TIter next(inFile->GetListOfKeys());
+      TKey *key;
+      while ((key = (TKey*)next() )){
+        std::string keyName = key->GetName();
+        if( keyName.find("outTree_") == 0 && std::string(key->GetClassName()) == "TTree" ){
+          // Keys of several cycles share a name
+          std::string thisSysVar = keyName.substr(8);
+          if( std::find(sysVars.begin(), sysVars.end(), thisSysVar) == sysVars.end() ){
+            cout << "Adding variation " << thisSysVar << endl;
+            sysVars.push_back( thisSysVar );
+          }
+        }
+      }
+      if( sysVars.size() == 0 ){
+        cout << "Error, no outTree_ in " << inFileNames.at(iFile) << ". Exiting..." << endl;
+        exit(1);
+      }
+    }
+
+    for(unsigned int iSys=0; iSys < sysVars.size(); ++iSys){
+      TTree* thisTree = (TTree*) inFile->Get( ("outTree_"+sysVars.at(iSys)).c_str() );
+      if( !thisTree ){
+        cout << "Error, no outTree_" << sysVars.at(iSys) << " in " << inFileNames.at(iFile) << ". Exiting..." << endl;
+        exit(1);
+      }
+      treeEntries[sysVars.at(iSys)].push_back( thisTree->GetEntries() );
+    }
+    inFile->Close();
+  }
+
+  if( f_compact && (!f_minimal || selection.ptAsym >= 0. || selection.alpha >= 0. || selection.beta >= 0.) ){
+    cout << "Error, m_compactTree MiniTrees only hold the recoil pt and pt balance of each variation, use --minimal without --ptAsym, --alpha or --beta. Exiting..." << endl;
+    exit(1);
+  }
+
+  std::vector< MiniTreeHists* > sysHists;
+  std::vector< std::mutex* > sysMutexes;
+  for(unsigned int iSys=0; iSys < sysVars.size(); ++iSys){
+    sysHists.push_back( new MiniTreeHists( binning, f_minimal ) );
+    sysMutexes.push_back( new std::mutex() );
+  }
+
+  std::atomic<bool> f_error(false);
+  std::atomic<Long64_t> nRead(0), nPassed(0);
+
+  ThreadPool pool( nThreads );
+  for(unsigned int iFile=0; f_compact && iFile < inFileNames.size(); ++iFile){
+    Long64_t nEntries = treeEntries["outTree_variations"].at(iFile);
+    for(Long64_t firstEntry = 0; firstEntry < nEntries; firstEntry += chunkSize){
+      Long64_t lastEntry = std::min( nEntries, firstEntry+chunkSize );
+      std::string thisFileName = inFileNames.at(iFile);
+
+      pool.submit( [=, &binning, &compactIndex, &sysHists, &sysMutexes, &f_error, &nRead, &nPassed](){
+        if( f_error )
+          return;
+
+        TFile* inFile = TFile::Open( thisFileName.c_str(), "READ" );
+        if( !inFile || inFile->IsZombie() ){
+          cout << "Error, could not open " << thisFileName << endl;
+          f_error = true;
+          return;
+        }
+        TTree* thisTree = (TTree*) inFile->Get( "outTree_variations" );
+        MiniTreeVariations variations;
+        if( !thisTree || !variations.connect( thisTree ) ){
+          cout << "Error, could not read outTree_variations of " << thisFileName << endl;
+          f_error = true;
+          inFile->Close();
+          return;
+        }
+        thisTree->SetCacheSize( 10*1024*1024 );
+        thisTree->SetCacheEntryRange( firstEntry, lastEntry );
+        thisTree->AddBranchToCache( "*", true );
+
+        // Each entry is an event, which fills every variation it passed
+        std::vector< MiniTreeHists* > taskHists;
+        for(unsigned int iSys=0; iSys < compactIndex.size(); ++iSys)
+          taskHists.push_back( new MiniTreeHists( binning, true ) );
+        MiniTreeEvent event;
+        Long64_t nTaskPassed = 0;
+        for(Long64_t iEntry = firstEntry; iEntry < lastEntry; ++iEntry){
+          if( thisTree->GetEntry( iEntry ) <= 0 ){
+            cout << "Error, could not read entry " << iEntry << " of outTree_variations of " << thisFileName << endl;
+            f_error = true;
+            break;
+          }
+          for(unsigned int iSys=0; iSys < compactIndex.size(); ++iSys){
+            if( !variations.get( compactIndex.at(iSys), event ) )
+              continue;
+            taskHists.at(iSys)->fill( event );
+            ++nTaskPassed;
+          }
+        }
+        inFile->Close();
+
+        for(unsigned int iSys=0; iSys < compactIndex.size(); ++iSys){
+          {
+            std::lock_guard<std::mutex> lock( *sysMutexes.at(iSys) );
+            sysHists.at(iSys)->add( *taskHists.at(iSys) );
+          }
+          delete taskHists.at(iSys);
+        }
+        nRead += (lastEntry-firstEntry)*compactIndex.size();
+        nPassed += nTaskPassed;
+      });
+    }
+  }
+  for(unsigned int iSys=0; !f_compact && iSys < sysVars.size(); ++iSys){
+    for(unsigned int iFile=0; iFile < inFileNames.size(); ++iFile){
+      Long64_t nEntries = treeEntries[sysVars.at(iSys)].at(iFile);
+      for(Long64_t firstEntry = 0; firstEntry < nEntries; firstEntry += chunkSize){
+        Long64_t lastEntry = std::min( nEntries, firstEntry+chunkSize );
+        std::string thisFileName = inFileNames.at(iFile);
+        std::string thisSysVar = sysVars.at(iSys);
+
+        pool.submit( [=, &binning, &sysHists, &sysMutexes, &f_error, &nRead, &nPassed](){
+          if( f_error )
+            return;
+
+          // Every task has its own file handle
+          TFile* inFile = TFile::Open( thisFileName.c_str(), "READ" );
+          if( !inFile || inFile->IsZombie() ){
+            cout << "Error, could not open " << thisFileName << endl;
+            f_error = true;
+            return;
+          }
+          TTree* thisTree = (TTree*) inFile->Get( ("outTree_"+thisSysVar).c_str() );
+          MiniTreeEvent event;
+          if( !thisTree || !event.connect( thisTree ) ){
+            cout << "Error, could not read outTree_" << thisSysVar << " of " << thisFileName << endl;
+            f_error = true;
+            inFile->Close();
+            return;
+          }
+          thisTree->SetCacheSize( 10*1024*1024 );
+          thisTree->SetCacheEntryRange( firstEntry, lastEntry );
+          thisTree->AddBranchToCache( "*", true );
+
+          MiniTreeHists taskHists( binning, f_minimal );
+          Long64_t nTaskPassed = 0;
+          for(Long64_t iEntry = firstEntry; iEntry < lastEntry; ++iEntry){
+            if( thisTree->GetEntry( iEntry ) <= 0 ){
+              cout << "Error, could not read entry " << iEntry << " of outTree_" << thisSysVar << " of " << thisFileName << endl;
+              f_error = true;
+              break;
+            }
+            event.update();
+            if( event.jet_pt->size() < 2 || !selection.pass( event ) )
+              continue;
+            taskHists.fill( event );
+            ++nTaskPassed;
+          }
+          inFile->Close();
+
+          std::lock_guard<std::mutex> lock( *sysMutexes.at(iSys) );
+          sysHists.at(iSys)->add( taskHists );
+          nRead += lastEntry-firstEntry;
+          nPassed += nTaskPassed;
+        });
+      }
+    }
+  }
+  pool.wait();
+
+  if( f_error ){
+    cout << "Error reading the MiniTrees, no output written" << endl;
+    return 1;
+  }
+
+  TFile* output = TFile::Open( outFileName.c_str(), "RECREATE" );
+  if( !output || output->IsZombie() ){
+    cout << "Error, could not create " << outFileName << ". Exiting..." << endl;
+    exit(1);
+  }
+  for(unsigned int iSys=0; iSys < sysVars.size(); ++iSys){
+    std::string dirName = "Iteration"+to_string(iteration)+"_"+sysVars.at(iSys);
+    if( f_flat ){
+      sysHists.at(iSys)->write( output, dirName+"_" );
+    }else{
+      TDirectory* thisDir = output->mkdir( dirName.c_str() );
+      sysHists.at(iSys)->write( thisDir, "" );
+    }
+    delete sysHists.at(iSys);
+    delete sysMutexes.at(iSys);
+  }
+  output->Close();
+
+  std::cout << "Kept " << nPassed << " of " << nRead << " entries of " << sysVars.size() << " variations after " << (std::time(0) - initialTime) << " seconds" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,451 @@
+//////////////////////////////////////////////////////////////////
+// runTriggerScan.cxx
+//////////////////////////////////////////////////////////////////
+// Trigger turn-on curves, efficiency points and a recoil pt
+// binning of a target number of events per bin, from the
+// outTree_Nominal MiniTrees of MultijetBalanceAlgo, replacing the
+// tree loops of checkTrigger.py, getBinning.py and
+// getBinningQuick.py (see TriggerScan.h).
+// Only recoilPt, passedTriggers, jet_pt and, for MC, weight are
+// read.  Each task fills private histograms for one range of
+// entries of one file, and adds them to the total when done.
+//////////////////////////////////////////////////////////////////
+// jeff.dandoy@cern.ch
+//////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <map>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <glob.h>
+
+#include <TFile.h>
+#include <TKey.h>
+#include <TTree.h>
+#include <TH1.h>
+#include <TH1F.h>
+#include <TROOT.h>
+
+#include "MultijetBalance/TriggerScan.h"
+#include "MultijetBalance/MCNormalization.h"
+#include "MultijetBalance/ThreadPool.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+  std::time_t initialTime = std::time(0);
+
+  std::vector<std::string> inFileNames;
+  std::string outFileName = "TriggerHists.root";
+  std::string treeName = "outTree_Nominal";
+  std::string turnOnString = "HLT_j360,HLT_j260,HLT_j200,HLT_j175,HLT_j150,HLT_j110,HLT_j85";
+  std::string triggerString = "HLT_j360:480,HLT_j260:360,HLT_j200:300";
+  std::string binningString = "300,360,420,480";
+  double minEvents = 300.;
+  int minFineBins = 6;
+  float ptAsym = 0.8;
+  bool f_data = false;
+  unsigned int nThreads = 0;
+  Long64_t chunkSize = 200000;
+
+  /////////// Retrieve runTriggerScan's arguments //////////////////////////
+  std::vector< std::string> options;
+  for(int ii=1; ii < argc; ++ii){
+    options.push_back( argv[ii] );
+  }
+
+  if (argc > 1 && options.at(0).compare("-h") == 0) {
+    std::cout << std::endl
+         << " runTriggerScan : Trigger turn-ons and recoil pt binning from MultijetBalanceAlgo MiniTrees" << std::endl
+         << std::endl
+         << " Optional arguments:" << std::endl
+         << "  -h                Prints this menu" << std::endl
+         << "  --files           Comma separated list of MiniTree files, which may contain wildcards" << std::endl
+         << "  --outFile         Output histogram file (default TriggerHists.root)" << std::endl
+         << "  --treeName        Tree to read (default outTree_Nominal)" << std::endl
+         << "  --turnOnTriggers  Comma separated triggers, each measured against the next one (default HLT_j360,...,HLT_j85)" << std::endl
+         << "  --triggers        Comma separated trigger:efficientPt for the binning, as m_triggerAndPt (default HLT_j360:480,HLT_j260:360,HLT_j200:300)" << std::endl
+         << "  --binning         Comma separated fixed recoil pt bin edges in GeV, new bins start at the last one (default 300,360,420,480)" << std::endl
+         << "  --minEvents       Minimum events per new bin (default 300)" << std::endl
+         << "  --minFineBins     Minimum 10 GeV bins per new bin (default 6)" << std::endl
+         << "  --ptAsym          Maximum subleading jet over recoil pt (default 0.8)" << std::endl
+         << "  --data            Unweighted turn-ons, otherwise weight is scaled by MJBNormalization, or the first cutflow bin (finept is always unweighted)" << std::endl
+         << "  --nThreads        Number of threads filling histograms (default all cores)" << std::endl
+         << "  --chunkSize       Number of entries per task (default 200000)" << std::endl
+         << std::endl;
+    exit(1);
+  }
+
+  int iArg = 0;
+  while(iArg < argc-1) {
+    if (options.at(iArg).compare("-h") == 0) {
+       // Ignore if not first argument
+       ++iArg;
+    } else if (options.at(iArg).compare("--files") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --files should be followed by a list of files" << std::endl;
+         return 1;
+       } else {
+         std::stringstream ss( options.at(iArg+1) );
+         std::string thisPattern;
+         while( std::getline(ss, thisPattern, ',') ){
+           glob_t globResult;
+           if( glob( thisPattern.c_str(), 0, NULL, &globResult ) == 0 ){
+             for(size_t iPath=0; iPath < globResult.gl_pathc; ++iPath)
+               inFileNames.push_back( globResult.gl_pathv[iPath] );
+           }else{
+             std::cout << " No file matches " << thisPattern << std::endl;
+             globfree( &globResult );
+             return 1;
+           }
+           globfree( &globResult );
+         }
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--outFile") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --outFile should be followed by a file" << std::endl;
+         return 1;
+       } else {
+         outFileName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--treeName") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --treeName should be followed by a tree name" << std::endl;
+         return 1;
+       } else {
+         treeName = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--turnOnTriggers") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --turnOnTriggers should be followed by a list of triggers" << std::endl;
+         return 1;
+       } else {
+         turnOnString = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--triggers") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --triggers should be followed by a list of trigger:efficientPt" << std::endl;
+         return 1;
+       } else {
+         triggerString = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--binning") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --binning should be followed by a list of bin edges" << std::endl;
+         return 1;
+       } else {
+         binningString = options.at(iArg+1);
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--minEvents") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --minEvents should be followed by a number" << std::endl;
+         return 1;
+       } else {
+         minEvents = std::stod(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--minFineBins") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --minFineBins should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         minFineBins = std::stoi(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--ptAsym") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --ptAsym should be followed by a number" << std::endl;
+         return 1;
+       } else {
+         ptAsym = std::stof(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--data") == 0) {
+      f_data = true;
+      ++iArg;
+    } else if (options.at(iArg).compare("--nThreads") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --nThreads should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         nThreads = std::stoi(options.at(iArg+1));
+         iArg += 2;
+       }
+    } else if (options.at(iArg).compare("--chunkSize") == 0) {
+       char tmpChar = options.at(iArg+1)[0];
+       if (iArg+1 == argc || tmpChar == '-' ) {
+         std::cout << " --chunkSize should be followed by an integer" << std::endl;
+         return 1;
+       } else {
+         chunkSize = std::stoll(options.at(iArg+1));
+         iArg += 2;
+       }
+    }else{
+      std::cout << "Couldn't understand argument " << options.at(iArg) << std::endl;
+      return 1;
+    }
+  }//while arguments
+
+  if ( inFileNames.size() == 0){
+    cout << "No input files given " << endl;
+    exit(1);
+  }
+  if ( chunkSize <= 0 || minFineBins <= 0 ){
+    cout << "Error, --chunkSize and --minFineBins must be positive " << endl;
+    exit(1);
+  }
+
+  std::vector<std::string> turnOnTriggers;
+  std::stringstream turnOnStream( turnOnString );
+  std::string thisTrigger;
+  while( std::getline(turnOnStream, thisTrigger, ',') )
+    turnOnTriggers.push_back( thisTrigger );
+
+  std::vector<std::string> binTriggers;
+  std::vector<double> binThresholds;
+  std::stringstream triggerStream( triggerString );
+  std::string thisTriggerAndPt;
+  while( std::getline(triggerStream, thisTriggerAndPt, ',') ){
+    size_t colon = thisTriggerAndPt.find(':');
+    if( colon == std::string::npos ){
+      cout << "Error, " << thisTriggerAndPt << " of --triggers is not trigger:efficientPt " << endl;
+      exit(1);
+    }
+    binTriggers.push_back( thisTriggerAndPt.substr(0, colon) );
+    binThresholds.push_back( std::stod( thisTriggerAndPt.substr(colon+1) ) );
+  }
+  for(unsigned int iB=1; iB < binThresholds.size(); ++iB){
+    if( binThresholds.at(iB) >= binThresholds.at(iB-1) ){
+      cout << "Error, --triggers must go from the highest to the lowest threshold " << endl;
+      exit(1);
+    }
+  }
+
+  std::vector<double> fixedEdges;
+  std::stringstream binningStream( binningString );
+  std::string thisBinEdge;
+  while( std::getline(binningStream, thisBinEdge, ',') )
+    fixedEdges.push_back( std::stod(thisBinEdge) );
+  if( fixedEdges.size() == 0 ){
+    cout << "Error, --binning needs at least 1 bin edge " << endl;
+    exit(1);
+  }
+  for(unsigned int iB=1; iB < fixedEdges.size(); ++iB){
+    if( fixedEdges.at(iB) <= fixedEdges.at(iB-1) ){
+      cout << "Error, --binning must be increasing " << endl;
+      exit(1);
+    }
+  }
+
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(kFALSE);
+
+  // Get entries and MC scale of each file, on the main thread //
+  std::vector<Long64_t> fileEntries;
+  std::vector<int> fileChannels( inFileNames.size(), 0 );
+  std::vector<double> fileScales( inFileNames.size(), 1. );
+  std::map< int, MCNormalization > channels;
+  for(unsigned int iFile=0; iFile < inFileNames.size(); ++iFile){
+    TFile* inFile = TFile::Open( inFileNames.at(iFile).c_str(), "READ" );
+    if( !inFile || inFile->IsZombie() ){
+      cout << "Error, could not open " << inFileNames.at(iFile) << ". Exiting..." << endl;
+      exit(1);
+    }
+    TTree* thisTree = (TTree*) inFile->Get( treeName.c_str() );
+    if( !thisTree ){
+      cout << "Error, no " << treeName << " in " << inFileNames.at(iFile) << ". Exiting..." << endl;
+      exit(1);
+    }
+    fileEntries.push_back( thisTree->GetEntries() );
+
+    if( !f_data ){
+      std::map< int, MCNormalization > thisChannels;
+      if( !MCNormalization::read( inFile, thisChannels ) || thisChannels.size() > 1 ){
+        cout << "Error, could not read a single MJBNormalization from " << inFileNames.at(iFile) << ". Exiting..." << endl;
+        exit(1);
+      }
+      if( thisChannels.size() == 1 ){
+        fileChannels.at(iFile) = thisChannels.begin()->first;
+        channels[ thisChannels.begin()->first ].add( thisChannels.begin()->second );
+      }else{
+        // Without MJBNormalization, as checkTrigger.py
+        TIter next(inFile->GetListOfKeys());
+        TKey *key;
+        while ((key = (TKey*)next() )){
+          std::string keyName = key->GetName();
+          if( keyName.find("cutflow") != std::string::npos && keyName.find("weight") == std::string::npos ){
+            TH1* cutflow = (TH1*) key->ReadObj();
+            if( cutflow && cutflow->GetBinContent(1) > 0. )
+              fileScales.at(iFile) = 1./cutflow->GetBinContent(1);
+            delete cutflow;
+          }
+        }
+        if( fileScales.at(iFile) == 1. )
+          cout << "Warning, " << inFileNames.at(iFile) << " has neither MJBNormalization nor cutflow, its weights are not scaled" << endl;
+      }
+    }
+    inFile->Close();
+    delete inFile;
+  }
+  for(unsigned int iFile=0; iFile < inFileNames.size(); ++iFile){
+    if( fileChannels.at(iFile) != 0 )
+      fileScales.at(iFile) = channels[ fileChannels.at(iFile) ].scale();
+  }
+
+  TriggerScanHists totalHists( turnOnTriggers, binTriggers, binThresholds, ptAsym );
+  std::mutex totalMutex;
+  std::atomic<bool> f_error(false);
+  std::atomic<Long64_t> nRead(0), nPassed(0);
+
+  ThreadPool pool( nThreads );
+  for(unsigned int iFile=0; iFile < inFileNames.size(); ++iFile){
+    Long64_t nEntries = fileEntries.at(iFile);
+    for(Long64_t firstEntry = 0; firstEntry < nEntries; firstEntry += chunkSize){
+      Long64_t lastEntry = std::min( nEntries, firstEntry+chunkSize );
+      std::string thisFileName = inFileNames.at(iFile);
+      double thisScale = fileScales.at(iFile);
+
+      pool.submit( [=, &turnOnTriggers, &binTriggers, &binThresholds, &totalHists, &totalMutex, &f_error, &nRead, &nPassed](){
+        if( f_error )
+          return;
+
+        TriggerScanHists taskHists( turnOnTriggers, binTriggers, binThresholds, ptAsym );
+        TriggerScanEvent event;
+        Long64_t nTaskPassed = 0;
+        {
+          // Every task has its own file handle, closed before event releases its branch objects
+          TFile* inFile = TFile::Open( thisFileName.c_str(), "READ" );
+          if( !inFile || inFile->IsZombie() ){
+            cout << "Error, could not open " << thisFileName << endl;
+            f_error = true;
+            return;
+          }
+          TTree* thisTree = (TTree*) inFile->Get( treeName.c_str() );
+          if( !thisTree || !event.connect( thisTree, !f_data ) ){
+            cout << "Error, could not read " << treeName << " of " << thisFileName << endl;
+            f_error = true;
+            inFile->Close();
+            delete inFile;
+            return;
+          }
+          thisTree->SetCacheSize( 10*1024*1024 );
+          thisTree->SetCacheEntryRange( firstEntry, lastEntry );
+          thisTree->AddBranchToCache( "*", true );
+
+          for(Long64_t iEntry = firstEntry; iEntry < lastEntry; ++iEntry){
+            if( thisTree->GetEntry( iEntry ) <= 0 ){
+              cout << "Error, could not read entry " << iEntry << " of " << treeName << " of " << thisFileName << endl;
+              f_error = true;
+              break;
+            }
+            if( event.flatJets && event.njet > TriggerScanEvent::maxJets ){
+              cout << "Error, entry " << iEntry << " of " << thisFileName << " has more than " << TriggerScanEvent::maxJets << " jets" << endl;
+              f_error = true;
+              break;
+            }
+            event.update( taskHists.triggerNames() );
+            double eventWeight = f_data ? 1. : event.weight*thisScale;
+            if( taskHists.fill( event, eventWeight ) )
+              ++nTaskPassed;
+          }
+          inFile->Close();
+          delete inFile;
+        }
+
+        std::lock_guard<std::mutex> lock( totalMutex );
+        totalHists.add( taskHists );
+        nRead += lastEntry-firstEntry;
+        nPassed += nTaskPassed;
+      });
+    }
+  }
+  pool.wait();
+
+  if( f_error ){
+    cout << "Error reading the MiniTrees, no output written" << endl;
+    return 1;
+  }
+
+  /////////// Efficiency points //////////////////////////
+  cout << endl << "Efficient at (GeV):" << endl;
+  cout << std::setw(12) << "trigger";
+  for(int iType=0; iType < TriggerScanHists::nTypes; ++iType)
+    cout << std::setw(12) << TriggerScanHists::typeNames[iType] << std::setw(14) << (std::string(TriggerScanHists::typeNames[iType])+"_lead");
+  cout << endl;
+  for(unsigned int iT=0; iT < totalHists.numTurnOns(); ++iT){
+    cout << std::setw(12) << totalHists.turnOnTrigger(iT);
+    for(int iType=0; iType < TriggerScanHists::nTypes; ++iType){
+      cout << std::setw(12) << TriggerScanHists::efficientPt( totalHists.numerator(iT, iType, false), totalHists.denominator(iT, iType, false) );
+      cout << std::setw(14) << TriggerScanHists::efficientPt( totalHists.numerator(iT, iType, true), totalHists.denominator(iT, iType, true) );
+    }
+    cout << endl;
+  }
+
+  /////////// Binning //////////////////////////
+  std::vector<double> numEvents;
+  std::vector<double> binEdges = TriggerScanHists::balancedBinning( totalHists.finePt(), fixedEdges, minEvents, minFineBins, numEvents );
+  TH1F* ptHist = NULL;
+  if( binEdges.size() > 1 ){
+    ptHist = new TH1F("ptHist", "ptHist", binEdges.size()-1, &binEdges[0]);
+    for(unsigned int iBin=0; iBin < numEvents.size(); ++iBin)
+      ptHist->SetBinContent( iBin+1, numEvents.at(iBin) );
+  }
+
+  cout << endl << "m_binning : ";
+  for(unsigned int iB=0; iB < binEdges.size(); ++iB)
+    cout << (iB > 0 ? "," : "") << binEdges.at(iB);
+  cout << endl << "Content:";
+  for(unsigned int iB=0; iB < numEvents.size(); ++iB)
+    cout << " " << numEvents.at(iB);
+  cout << endl << endl;
+
+  // Nothing, or only a remainder below minEvents, above the fixed edges
+  bool f_binned = binEdges.size() > fixedEdges.size() && numEvents.back() >= minEvents;
+  if( !f_binned ){
+    double numAbove = (binEdges.size() > fixedEdges.size()) ? numEvents.back() : 0.;
+    cout << "Error, the " << numAbove << " events above " << fixedEdges.back() << " GeV never reach --minEvents "
+         << minEvents << ", no new bin could be made" << endl;
+  }
+
+  TFile* output = TFile::Open( outFileName.c_str(), "RECREATE" );
+  if( !output || output->IsZombie() ){
+    cout << "Error, could not create " << outFileName << ". Exiting..." << endl;
+    exit(1);
+  }
+  totalHists.write( output );
+  if( ptHist )
+    output->WriteTObject( ptHist, "ptHist" );
+  output->Close();
+  delete output;
+  delete ptHist;
+
+  std::cout << "Kept " << nPassed << " of " << nRead << " entries after " << (std::time(0) - initialTime) << " seconds" << std::endl;
+
+  if( !f_binned )
+    return 1;
+
+  return 0;
+}